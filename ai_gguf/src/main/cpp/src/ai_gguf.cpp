@@ -22,106 +22,32 @@
 #include "cpu/cpu_helper.h"
 #include "utils/logger.h"
 #include "tool_calling/tool_call_state.h"
+#include "generation/stop_string_checker.h"
+#include "generation/utf8_stream_decoder.h"
+#include "generation/generation_trace.h"
+#include "generation/token_arena.h"
+#include "generation/generation_request.h"
 
 #include <jni.h>
 #include <string>
+#include <string_view>
 #include <mutex>
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <cstring>
+#include <system_error>
+#include <thread>
 #include <sys/stat.h>
 
 static std::mutex g_init_mtx;
-static std::mutex g_generate_mtx;  // Shared by nativeGenerateStream + nativeGenerateStreamMultiTurn
-static std::atomic<bool> g_stop_requested{false};
-
-/**
- * Stop string checker for streaming generation.
- *
- * Small/quantized models often generate chat template turn markers
- * (e.g. <end_of_turn>, <|im_end|>) as regular text tokens instead of the
- * special EOT token ID. This causes the model to keep generating fake
- * conversation turns in a loop.
- *
- * This class buffers recent output and checks for stop strings. Text is
- * only released for streaming once it's confirmed not to be the start of
- * a stop string, so stop markers are never sent to the user.
- */
-class StopStringChecker {
-public:
-    void init(const std::vector<std::string>& stops) {
-        stop_strings_ = stops;
-        max_len_ = 0;
-        for (const auto& s : stops) {
-            if (s.size() > max_len_) max_len_ = s.size();
-        }
-        pending_.clear();
-        pending_.reserve(max_len_ * 2 + 64);
-    }
-
-    bool has_stops() const { return !stop_strings_.empty(); }
-
-    /**
-     * Feed new text. Returns text that is safe to send to the user.
-     * Sets `stopped` to true if a stop string was found.
-     */
-    std::string feed(const std::string& text, bool& stopped) {
-        stopped = false;
-        if (stop_strings_.empty()) return text;
-
-        pending_ += text;
-
-        // Check for any stop string in the pending buffer
-        for (const auto& stop : stop_strings_) {
-            size_t pos = pending_.find(stop);
-            if (pos != std::string::npos) {
-                // Found a stop string — return everything before it
-                stopped = true;
-                std::string safe = pending_.substr(0, pos);
-                pending_.clear();
-                return safe;
-            }
-        }
-
-        // No complete match yet. Hold back the last max_len_ characters
-        // because they could be the start of a stop string.
-        if (pending_.size() > max_len_) {
-            size_t safe_len = pending_.size() - max_len_;
-            std::string safe = pending_.substr(0, safe_len);
-            pending_ = pending_.substr(safe_len);
-            return safe;
-        }
-
-        // Everything is still in the danger zone — hold it all
-        return "";
-    }
-
-    /**
-     * Flush remaining buffered text (call at end of generation).
-     * Strips any trailing stop string if present.
-     */
-    std::string flush() {
-        // Final check for stop strings before flushing
-        for (const auto& stop : stop_strings_) {
-            size_t pos = pending_.find(stop);
-            if (pos != std::string::npos) {
-                std::string safe = pending_.substr(0, pos);
-                pending_.clear();
-                return safe;
-            }
-        }
-        std::string result = std::move(pending_);
-        pending_.clear();
-        return result;
-    }
-
-private:
-    std::vector<std::string> stop_strings_;
-    std::string pending_;
-    size_t max_len_ = 0;
-};
+// One generation at a time (blocking and async). Timed so queued requests
+// can notice a cancel or an expired deadline while they wait.
+static std::timed_mutex g_generate_mtx;
+static RequestRegistry g_requests;
 
 struct GenerationMetrics {
     int32_t total_tokens = 0;
@@ -135,262 +61,107 @@ struct GenerationMetrics {
 
 namespace {
 
-// Pre-cached JNI references for minimal lookup overhead
-    struct JniCallbackCache {
-        jclass cls = nullptr;
-        jmethodID onToken = nullptr;
-        jmethodID onError = nullptr;
-        jmethodID onToolCall = nullptr;
-        jmethodID onDone = nullptr;
-        jmethodID onMetrics = nullptr;
-
-        // Metrics class cache
-        jclass metricsClass = nullptr;
-        jmethodID metricsConstructor = nullptr;
-
-        bool initialized = false;
-
-        void init(JNIEnv *env, jobject callback) {
-            if (initialized) return;
+    inline void send_metrics(JNIEnv *env, const jni::StreamCallback &callback,
+                             const GenerationMetrics &metrics) {
+        const jni::ClassCache &classes = jni::classes();
+        if (!classes.decoding_metrics_init) return;
 
-            jclass tempCls = env->GetObjectClass(callback);
-            if (!tempCls) {
-                LOG_ERROR("JniCallbackCache: Failed to get callback class");
-                return;
-            }
-
-            cls = static_cast<jclass>(env->NewGlobalRef(tempCls));
-            env->DeleteLocalRef(tempCls);
-
-            onToken = env->GetMethodID(cls, "onToken", "(Ljava/lang/String;)V");
-            onError = env->GetMethodID(cls, "onError", "(Ljava/lang/String;)V");
-            onToolCall = env->GetMethodID(cls, "onToolCall",
-                                          "(Ljava/lang/String;Ljava/lang/String;)V");
-            onDone = env->GetMethodID(cls, "onDone", "()V");
-            onMetrics = env->GetMethodID(cls, "onMetrics",
-                                         "(Lcom/mp/ai_gguf/models/DecodingMetrics;)V");
-
-            // Cache metrics class
-            jclass tempMetricsCls = env->FindClass("com/mp/ai_gguf/models/DecodingMetrics");
-            if (tempMetricsCls) {
-                metricsClass = static_cast<jclass>(env->NewGlobalRef(tempMetricsCls));
-                metricsConstructor = env->GetMethodID(metricsClass, "<init>", "(IIIFJJ)V");
-                env->DeleteLocalRef(tempMetricsCls);
-            }
-
-            initialized = true;
-        }
-
-        void release(JNIEnv *env) {
-            if (cls) {
-                env->DeleteGlobalRef(cls);
-                cls = nullptr;
-            }
-            if (metricsClass) {
-                env->DeleteGlobalRef(metricsClass);
-                metricsClass = nullptr;
-            }
-            initialized = false;
-        }
-    };
-
-// Thread-local callback cache for multi-threaded safety
-    static thread_local JniCallbackCache g_callback_cache;
-
-/**
- * Send a single token immediately to the Java callback
- * This is the core streaming function - no buffering, immediate delivery
- */
-    inline void send_token_immediate(JNIEnv *env, jobject callback, const std::string &token) {
-        if (token.empty() || !callback) return;
-
-        g_callback_cache.init(env, callback);
-        if (!g_callback_cache.onToken) return;
-
-        // Convert UTF-8 to Java string
-        // Note: We use NewStringUTF for ASCII-compatible tokens (most cases)
-        // For full UTF-8 with surrogates, we need proper conversion
-        jstring jtoken = nullptr;
-
-        // Fast path for ASCII-only tokens (most common case)
-        bool is_ascii = true;
-        for (unsigned char c: token) {
-            if (c >= 0x80) {
-                is_ascii = false;
-                break;
-            }
-        }
-
-        if (is_ascii) {
-            jtoken = env->NewStringUTF(token.c_str());
-        } else {
-            // Full UTF-8 to UTF-16 conversion for non-ASCII
-            jtoken = utf8::to_jstring_immediate(env, token);
-        }
-
-        if (jtoken) {
-            env->CallVoidMethod(callback, g_callback_cache.onToken, jtoken);
-            env->DeleteLocalRef(jtoken);
-        }
-    }
-
-    inline void send_error(JNIEnv *env, jobject callback, const char *msg) {
-        if (!callback) return;
-
-        g_callback_cache.init(env, callback);
-        if (!g_callback_cache.onError) return;
-
-        jstring jmsg = env->NewStringUTF(msg ? msg : "<unknown error>");
-        env->CallVoidMethod(callback, g_callback_cache.onError, jmsg);
-        env->DeleteLocalRef(jmsg);
-    }
-
-    inline void send_toolcall(JNIEnv *env, jobject callback, const std::string &name,
-                              const std::string &payload) {
-        if (!callback) return;
-
-        g_callback_cache.init(env, callback);
-        if (!g_callback_cache.onToolCall) return;
-
-        jstring jname = env->NewStringUTF(name.c_str());
-        jstring jpayload = utf8::to_jstring_immediate(env, payload);
-
-        env->CallVoidMethod(callback, g_callback_cache.onToolCall, jname, jpayload);
-
-        env->DeleteLocalRef(jname);
-        env->DeleteLocalRef(jpayload);
-    }
-
-    inline void send_done(JNIEnv *env, jobject callback) {
-        if (!callback) return;
-
-        g_callback_cache.init(env, callback);
-        if (!g_callback_cache.onDone) return;
-
-        env->CallVoidMethod(callback, g_callback_cache.onDone);
-    }
-
-    inline void send_metrics(JNIEnv *env, jobject callback, const GenerationMetrics &metrics) {
-        if (!callback) return;
-
-        g_callback_cache.init(env, callback);
-        if (!g_callback_cache.onMetrics || !g_callback_cache.metricsClass) return;
-
-        jobject metricsObj = env->NewObject(g_callback_cache.metricsClass,
-                                            g_callback_cache.metricsConstructor,
+        jobject metricsObj = env->NewObject(classes.decoding_metrics,
+                                            classes.decoding_metrics_init,
                                             metrics.total_tokens, metrics.prompt_tokens,
                                             metrics.generated_tokens, metrics.tokens_per_second,
                                             metrics.time_to_first_token_ms, metrics.total_time_ms);
 
         if (metricsObj) {
-            env->CallVoidMethod(callback, g_callback_cache.onMetrics, metricsObj);
+            callback.on_metrics(metricsObj);
             env->DeleteLocalRef(metricsObj);
         }
     }
 
-} // anonymous namespace
-
-class Utf8StreamDecoder {
-public:
-    void reset() {
-        pending_bytes_.clear();
-    }
+    // How often a queued request re-checks its cancel flag / deadline
+    constexpr auto QUEUE_POLL_INTERVAL = std::chrono::milliseconds(20);
 
     /**
-     * Process raw token bytes and return complete UTF-8 characters
-     * Incomplete sequences are buffered until the next token completes them
+     * Wait for the model. Returns an unowned lock if the request was
+     * cancelled or expired while queued - it must not run at all then.
      */
-    std::string decode(const std::string &raw_bytes) {
-        if (raw_bytes.empty()) return {};
-
-        // Prepend any pending bytes from previous tokens
-        std::string input;
-        if (!pending_bytes_.empty()) {
-            input = pending_bytes_ + raw_bytes;
-            pending_bytes_.clear();
-        } else {
-            input = raw_bytes;
+    std::unique_lock<std::timed_mutex> acquire_generation_slot(const GenerationRequest &req) {
+        std::unique_lock<std::timed_mutex> lock(g_generate_mtx, std::defer_lock);
+        while (!lock.try_lock_for(QUEUE_POLL_INTERVAL)) {
+            if (req.should_stop()) break;
         }
-
-        std::string complete;
-        complete.reserve(input.size());
-
-        size_t i = 0;
-        while (i < input.size()) {
-            unsigned char c = static_cast<unsigned char>(input[i]);
-            size_t char_len = utf8_char_length(c);
-
-            if (char_len == 0) {
-                // Invalid start byte - skip
-                ++i;
-                continue;
-            }
-
-            // Check if we have all bytes for this character
-            if (i + char_len > input.size()) {
-                // Incomplete sequence - save for next token
-                pending_bytes_.assign(input.data() + i, input.size() - i);
-                break;
-            }
-
-            // Validate continuation bytes
-            bool valid = true;
-            for (size_t j = 1; j < char_len; ++j) {
-                unsigned char cont = static_cast<unsigned char>(input[i + j]);
-                if ((cont & 0xC0) != 0x80) {
-                    valid = false;
-                    break;
-                }
-            }
-
-            if (valid) {
-                complete.append(input.data() + i, char_len);
-                i += char_len;
-            } else {
-                // Invalid sequence - skip start byte
-                ++i;
-            }
+        if (lock.owns_lock() && req.should_stop()) {
+            lock.unlock();
         }
-
-        return complete;
+        return lock;
     }
 
     /**
-     * Flush any remaining pending bytes (call at end of generation)
+     * End a request that stopped before producing output (queued or mid-prefill)
      */
-    std::string flush() {
-        std::string result;
-        if (!pending_bytes_.empty()) {
-            // Return replacement character for incomplete sequence
-            result = "\xEF\xBF\xBD"; // U+FFFD
-            pending_bytes_.clear();
+    jboolean finish_stopped(const jni::StreamCallback &callback, GenerationRequest &req) {
+        req.set_state(req.stopped_state());
+        LOG_INFO("Request %llu %s before decoding",
+                 static_cast<unsigned long long>(req.handle()), request_state_name(req.state()));
+        callback.on_done();
+        return JNI_TRUE;
+    }
+
+    RequestState final_state(const GenerationRequest &req, trace::StopReason reason) {
+        switch (reason) {
+            case trace::StopReason::Cancelled: return req.stopped_state();
+            case trace::StopReason::Error:     return RequestState::Failed;
+            default:                           return RequestState::Done;
         }
-        return result;
     }
 
-    bool has_pending() const { return !pending_bytes_.empty(); }
+} // anonymous namespace
 
-private:
-    std::string pending_bytes_;
+// ============================================================================
+// TRACE RECORDING
+// Captures sessions for the host-side replay tool (tools/trace_replay.cpp)
+// ============================================================================
 
-    static size_t utf8_char_length(unsigned char c) {
-        if ((c & 0x80) == 0x00) return 1;      // 0xxxxxxx - ASCII
-        if ((c & 0xE0) == 0xC0) return 2;      // 110xxxxx
-        if ((c & 0xF0) == 0xE0) return 3;      // 1110xxxx
-        if ((c & 0xF8) == 0xF0) return 4;      // 11110xxx
-        return 0; // Invalid start byte
-    }
-};
+static trace::TraceWriter g_trace_writer;  // Guarded by g_generate_mtx
 
-/**
- * Initialize or update grammar sampler for tool calls
- * Uses caching to avoid rebuilds when tools haven't changed
- */
-static void maybe_init_grammar() {
-    if (!g_state.tools_enabled) return;
+static uint32_t elapsed_us(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - since).count());
+}
 
-    // Use cached grammar management
-    g_state.update_grammar_if_needed();
+static std::unique_ptr<trace::SessionTrace> begin_trace_session(
+        const GenerationConfig &cfg, const LoraMix &lora_mix, const std::string &prompt,
+        const std::vector<llama_token> &prompt_toks, int32_t max_tokens) {
+    if (!g_trace_writer.is_open()) return nullptr;
+
+    auto rec = std::make_unique<trace::SessionTrace>();
+
+    char desc[256] = {0};
+    llama_model_desc(g_state.model, desc, sizeof(desc));
+    rec->model_desc = desc;
+    rec->n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(g_state.model));
+    rec->n_ctx = g_state.ctx_size;
+    rec->sampler = cfg.sampler_params;
+    rec->max_tokens = max_tokens;
+    rec->stop_strings = cfg.stop_strings;
+    rec->tools_enabled = cfg.tools_enabled;
+    rec->grammar_mode = cfg.grammar_mode;
+    rec->typed_grammar = cfg.use_typed_grammar;
+    rec->tools_json = cfg.tools_json;
+    rec->response_schema = cfg.response_schema;
+    for (const auto &m : lora_mix) {
+        // Adapters unloaded since submit aren't applied, so aren't recorded
+        std::string path = g_state.lora_adapter_path(m.first);
+        if (!path.empty()) rec->lora_adapters.push_back({m.first, std::move(path), m.second});
+    }
+    rec->prompt = prompt;
+    rec->prompt_tokens = prompt_toks;
+    rec->tokens.reserve(static_cast<size_t>(max_tokens));
+
+    if (rec->sampler.seed < 0 && rec->sampler.temp > 0.0f) {
+        LOG_WARN("Recording with a random seed - replayed tokens will diverge");
+    }
+    return rec;
 }
 
 static const char *get_model_architecture(llama_model *model) {
@@ -530,58 +301,72 @@ static std::vector<chat::ChatMessage> parse_messages_json(const std::string& jso
     return messages;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, jstring jprompt,
-                                                        jint max_tokens, jobject jcallback) {
+// ============================================================================
+// SINGLE-TURN GENERATION
+// Runs on the caller's thread (nativeGenerateStream) or on a worker thread
+// (nativeGenerateAsync). `req` carries the cancel flag, deadline and state.
+// ============================================================================
+
+static jboolean generate_stream(JNIEnv *env, const jni::StreamCallback &callback,
+                                GenerationRequest &req, const std::string &user_msg,
+                                int32_t max_tokens) {
     // Validate model state
     if (!g_state.is_ready()) {
-        send_error(env, jcallback, "Model not initialized");
+        callback.on_error("Model not initialized");
         return JNI_FALSE;
     }
 
+    // Wait for the model; a request cancelled or expired while queued never runs
+    std::unique_lock<std::timed_mutex> lock = acquire_generation_slot(req);
+    if (!lock.owns_lock()) {
+        return finish_stopped(callback, req);
+    }
+    req.set_state(RequestState::Prefilling);
+
+    // Pin the configuration for the whole request; setters publish new
+    // snapshots without touching this one
+    const ConfigSnapshot cfg = g_state.config();
+
     // Prepare for new generation
-    LOG_INFO("Starting new generation, calling prepare_for_generation");
-    g_state.prepare_for_generation();
-    LOG_INFO("prepare_for_generation completed");
-    g_stop_requested.store(false, std::memory_order_relaxed);
+    LOG_DEBUG("Starting new generation (config v%llu)",
+              static_cast<unsigned long long>(cfg->version));
+    g_state.prepare_for_generation(*cfg);
 
-    std::lock_guard<std::mutex> lock(g_generate_mtx);
+    // Attach the LoRA mix captured at submit time (no-op when unchanged)
+    g_state.apply_lora_adapters(req.lora_mix());
 
     // Initialize metrics
     GenerationMetrics metrics;
     auto start_time = std::chrono::steady_clock::now();
     bool first_token_generated = false;
 
-    // Get user message
-    const std::string user_msg = utf8::from_jstring(env, jprompt);
-
     // Get vocab
     const llama_vocab *vocab = llama_model_get_vocab(g_state.model);
     if (!vocab) {
-        send_error(env, jcallback, "Failed to get vocab");
+        callback.on_error("Failed to get vocab");
         return JNI_FALSE;
     }
 
     // Build system prompt with tool preamble if needed
-    std::string system = g_state.system_prompt;
-    if (g_state.tools_enabled && !g_state.tools_json.empty()) {
-        system.reserve(system.size() + g_state.tools_json.size() + 256);
+    std::string system = cfg->system_prompt;
+    if (cfg->tools_enabled && !cfg->tools_json.empty() && !cfg->has_response_schema()) {
+        system.reserve(system.size() + cfg->tools_json.size() + 256);
         system += "\n";
-        system += chat::build_tool_preamble(g_state.tools_json);
+        system += chat::build_tool_preamble(cfg->tools_json);
     }
 
     // Apply chat template
     const std::string prompt = chat::apply_template(g_state.model, system, user_msg,
-                                                    g_state.chat_template_override,
+                                                    cfg->chat_template_override,
                                                     true // add generation prompt
     );
 
-    LOG_INFO("Rendered prompt size=%zu", prompt.size());
+    LOG_DEBUG("Rendered prompt size=%zu", prompt.size());
 
     // Tokenize prompt
     std::vector<llama_token> prompt_toks = g_state.tokenize(prompt);
     if (prompt_toks.empty()) {
-        send_error(env, jcallback, "Tokenization failed");
+        callback.on_error("Tokenization failed");
         return JNI_FALSE;
     }
 
@@ -591,73 +376,102 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
     // Check context size
     int32_t available = g_state.ctx_size - metrics.prompt_tokens - 8;
     if (available <= 0) {
-        send_error(env, jcallback, "Context overflow - shorten your prompt");
+        callback.on_error("Context overflow - shorten your prompt");
         return JNI_TRUE;
     }
 
-    int32_t to_generate = (max_tokens > 0) ? static_cast<int32_t>(max_tokens) : 128;
+    int32_t to_generate = (max_tokens > 0) ? max_tokens : 128;
     to_generate = std::min(to_generate, available);
 
+    // Trace recording (record/replay harness) - null when not recording
+    std::unique_ptr<trace::SessionTrace> rec =
+            begin_trace_session(*cfg, req.lora_mix(), prompt, prompt_toks, to_generate);
+    auto emit = [&](std::string_view text) {
+        callback.on_token(text);
+        if (rec) rec->output_text.append(text.data(), text.size());
+    };
+
     // Decode prompt (prefill phase)
-    if (!g_state.decode_prompt(prompt_toks)) {
-        jni::on_error(env, jcallback, "Decoding prompt failed");
+    auto prefill_start = std::chrono::steady_clock::now();
+    if (!g_state.decode_prompt(prompt_toks, &req)) {
+        if (req.should_stop()) {
+            return finish_stopped(callback, req);
+        }
+        callback.on_error("Decoding prompt failed");
         return JNI_TRUE;
     }
+    req.set_state(RequestState::Decoding);
+    if (rec) rec->prefill_us = elapsed_us(prefill_start);
 
     // Verify we have logits available
     float *logits = llama_get_logits(g_state.ctx);
     if (!logits) {
         LOG_ERROR("No logits available after prompt decode");
-        jni::on_error(env, jcallback, "No logits available");
+        callback.on_error("No logits available");
         return JNI_TRUE;
     }
 
     // Initialize streaming components
+    // (a response schema replaces tool calling: output is one JSON document)
+    const bool detect_tool_calls = cfg->tools_enabled && !cfg->has_response_schema();
     ToolCallState tool_state;
     Utf8StreamDecoder utf8_decoder;
     StopStringChecker stop_checker;
-    stop_checker.init(g_state.stop_strings);
+    stop_checker.init(cfg->stop_strings);
+
+    // Per-session scratch for per-token text (reset every token)
+    TokenArena arena;
 
     llama_token eos = llama_vocab_eos(vocab);
     llama_token eot = llama_vocab_eot(vocab);
 
-    // Single-token batch for autoregressive generation
-    llama_batch single = llama_batch_init(1, 0, 1);
-
     // Exception check interval - less frequent for better performance
     // Check every 64 tokens or so
     constexpr int EXCEPTION_CHECK_INTERVAL = 64;
     bool has_exception = false;
     bool hit_stop_string = false;
+    trace::StopReason stop_reason = trace::StopReason::MaxTokens;
 
     // ========================================================================
     // LAZY TOOL DETECTION OPTIMIZATION
     // Only engage tool call parsing after seeing potential tool call start
     // This reduces overhead when generating normal text
     // ========================================================================
-    bool tool_detection_active = g_state.tools_enabled;
+    bool tool_detection_active = detect_tool_calls;
     bool seen_non_whitespace = false;
     bool definitely_not_tool_call = false;
 
     // ========================================================================
     // MAIN GENERATION LOOP - IMMEDIATE TOKEN STREAMING
     // ========================================================================
-    for (int i = 0; i < to_generate && !g_stop_requested.load(std::memory_order_relaxed); ++i) {
+    for (int i = 0; i < to_generate; ++i) {
+        // Cancel / deadline checked before every decode step
+        if (req.should_stop()) {
+            stop_reason = trace::StopReason::Cancelled;
+            break;
+        }
+
         // Use -1 which means "last token with logits enabled"
         // BUT we must ensure decode succeeded first
         int current_pos = static_cast<int>(prompt_toks.size()) + i;
         if (current_pos >= g_state.ctx_size - 1) {
             LOG_ERROR("Context overflow at pos %d, ctx_size %d", current_pos, g_state.ctx_size);
-            jni::on_error(env, jcallback, "Context size exceeded");
+            callback.on_error("Context size exceeded");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
+        arena.reset();
+
+        auto sample_start = std::chrono::steady_clock::now();
+        const uint64_t logits_hash = rec ? trace::hash_logits(llama_get_logits_ith(g_state.ctx, -1), rec->n_vocab) : 0;
         llama_token tok = llama_sampler_sample(g_state.sampler, g_state.ctx, -1);
 
         // Check for invalid token
         if (tok < 0) {
             LOG_ERROR("llama_sampler_sample returned invalid token");
-            jni::on_error(env, jcallback, "Sampling failed");
+            callback.on_error("Sampling failed");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
@@ -666,16 +480,16 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
             llama_sampler_accept(g_state.sampler, tok);
         } catch (const std::runtime_error& e) {
             LOG_WARN("Grammar accept threw: %s - rebuilding sampler without grammar", e.what());
-            // Disable grammar for the rest of this generation turn.
-            // Save and restore the master grammar_sampler pointer so it's
-            // available for future turns (it will be re-cloned next time).
-            llama_sampler* saved_grammar = g_state.grammar_sampler;
-            g_state.grammar_sampler = nullptr;
-            g_state.rebuild_sampler_cached();
-            g_state.grammar_sampler = saved_grammar;
+            // Disable grammar for the rest of this generation turn. The
+            // snapshot keeps its master grammar; the next turn re-clones it.
+            g_state.rebuild_sampler(*cfg, /*with_grammar=*/false);
             // Don't re-accept - the new chain has no grammar state to update
         }
 
+        if (rec) {
+            rec->tokens.push_back({tok, logits_hash, elapsed_us(sample_start), 0});
+        }
+
         // Handle first-token edge case
         if (i == 0 && (tok == eos || tok == eot)) {
             tok = g_state.space_token();
@@ -683,6 +497,7 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
 
         // Check for end of generation
         if (tok == eos || tok == eot) {
+            stop_reason = trace::StopReason::EndOfGeneration;
             break;
         }
 
@@ -699,8 +514,8 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
         metrics.total_tokens++;
 
         // Detokenize and decode UTF-8
-        std::string raw_piece = g_state.detokenize_single(tok);
-        std::string complete_chars = utf8_decoder.decode(raw_piece);
+        std::string_view raw_piece = g_state.detokenize(tok, arena);
+        std::string_view complete_chars = utf8_decoder.decode(raw_piece, arena);
 
         // ====================================================================
         // TOKEN STREAMING WITH STOP STRING DETECTION
@@ -709,12 +524,17 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
             bool tool_complete = false;
 
             // Check for tool calls if tools are enabled
-            if (g_state.tools_enabled) {
+            if (detect_tool_calls) {
                 tool_complete = tool_state.accumulate(complete_chars);
                 if (tool_complete) {
                     std::string name, payload;
                     if (tool_state.extract_tool_call(name, payload)) {
-                        send_toolcall(env, jcallback, name, payload);
+                        callback.on_toolcall(name, payload);
+                        stop_reason = trace::StopReason::ToolCall;
+                        if (rec) {
+                            rec->tool_name = name;
+                            rec->tool_payload = payload;
+                        }
                         break;
                     }
                     tool_state.reset();
@@ -727,35 +547,31 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
                     // Feed through stop string checker — it buffers text
                     // and only releases what's confirmed safe
                     bool stopped = false;
-                    std::string safe = stop_checker.feed(complete_chars, stopped);
+                    std::string_view safe = stop_checker.feed(complete_chars, stopped, arena);
                     if (!safe.empty()) {
-                        send_token_immediate(env, jcallback, safe);
+                        emit(safe);
                     }
                     if (stopped) {
                         LOG_INFO("Stop string detected at token %d — ending generation", i);
                         hit_stop_string = true;
+                        stop_reason = trace::StopReason::StopString;
                         break;
                     }
                 } else {
-                    send_token_immediate(env, jcallback, complete_chars);
+                    emit(complete_chars);
                 }
             }
         }
 
-        // Prepare batch for next token prediction
-        single.n_tokens = 1;
-        single.token[0] = tok;
-        single.pos[0] = static_cast<int32_t>(prompt_toks.size() + i);
-        single.n_seq_id[0] = 1;
-        single.seq_id[0][0] = 0;
-        single.logits[0] = true;
-
-        // Decode (forward pass for next token)
-        int decode_result = llama_decode(g_state.ctx, single);
+        // Decode (forward pass for next token) through the reused batch
+        auto decode_start = std::chrono::steady_clock::now();
+        int decode_result = g_state.decode_token(tok, current_pos);
+        if (rec && !rec->tokens.empty()) rec->tokens.back().decode_us = elapsed_us(decode_start);
         if (decode_result != 0) {
             LOG_ERROR("llama_decode failed with code %d at token %d, pos %d", decode_result, i,
                       (int) (prompt_toks.size() + i));
-            jni::on_error(env, jcallback, "llama_decode failed during generation");
+            callback.on_error("llama_decode failed during generation");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
@@ -765,6 +581,7 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
                 LOG_ERROR("Java exception during callback - aborting");
                 env->ExceptionClear();
                 has_exception = true;
+                stop_reason = trace::StopReason::Error;
                 break;
             }
         }
@@ -775,24 +592,25 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
     // ========================================================================
 
     // Flush any remaining UTF-8 bytes
-    std::string remaining = utf8_decoder.flush();
+    arena.reset();
+    std::string_view remaining = utf8_decoder.flush();
     if (!remaining.empty()) {
         if (stop_checker.has_stops()) {
             bool stopped = false;
-            std::string safe = stop_checker.feed(remaining, stopped);
+            std::string_view safe = stop_checker.feed(remaining, stopped, arena);
             if (!safe.empty()) {
-                send_token_immediate(env, jcallback, safe);
+                emit(safe);
             }
         } else {
-            send_token_immediate(env, jcallback, remaining);
+            emit(remaining);
         }
     }
 
     // Flush stop checker buffer (anything held back that wasn't a stop string)
     if (stop_checker.has_stops()) {
-        std::string buffered = stop_checker.flush();
+        std::string_view buffered = stop_checker.flush(arena);
         if (!buffered.empty()) {
-            send_token_immediate(env, jcallback, buffered);
+            emit(buffered);
         }
     }
 
@@ -806,13 +624,19 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
                 (metrics.generated_tokens * 1000.0f) / static_cast<float>(metrics.total_time_ms);
     }
 
-    // Clean up batch
-    llama_batch_free(single);
+    if (rec) {
+        rec->stop_reason = stop_reason;
+        rec->total_us = elapsed_us(start_time);
+        g_trace_writer.write(*rec);
+    }
+
+    req.set_state(final_state(req, stop_reason));
 
     // Send completion callbacks (unless exception occurred)
+
     if (!has_exception) {
-        send_metrics(env, jcallback, metrics);
-        send_done(env, jcallback);
+        send_metrics(env, callback, metrics);
+        callback.on_done();
     }
 
     return JNI_TRUE;
@@ -824,24 +648,31 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStream(JNIEnv *env, jobject, js
 // Used by the Kotlin ToolCallManager orchestrator for multi-turn tool calling.
 // ============================================================================
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jobject,
-                                                                  jstring jmessagesJson,
-                                                                  jint max_tokens,
-                                                                  jobject jcallback) {
+static jboolean generate_multi_turn(JNIEnv *env, const jni::StreamCallback &callback,
+                                    GenerationRequest &req, const std::string &messages_json,
+                                    int32_t max_tokens) {
     // Validate model state
     if (!g_state.is_ready()) {
-        send_error(env, jcallback, "Model not initialized");
+        callback.on_error("Model not initialized");
         return JNI_FALSE;
     }
 
-    // Prepare for new generation (clear KV cache)
-    g_state.prepare_for_generation();
-    // Rebuild sampler with fresh grammar clone for this turn
-    g_state.rebuild_sampler_cached();
-    g_stop_requested.store(false, std::memory_order_relaxed);
+    // Wait for the model; a request cancelled or expired while queued never runs
+    std::unique_lock<std::timed_mutex> lock = acquire_generation_slot(req);
+    if (!lock.owns_lock()) {
+        return finish_stopped(callback, req);
+    }
+    req.set_state(RequestState::Prefilling);
+
+    // Pin the configuration for the whole request
+    const ConfigSnapshot cfg = g_state.config();
 
-    std::lock_guard<std::mutex> lock(g_generate_mtx);
+    // Prepare for new generation (clear KV cache, grammar clone back to
+    // its start state for this turn)
+    g_state.prepare_for_generation(*cfg);
+
+    // Attach the LoRA mix captured at submit time (no-op when unchanged)
+    g_state.apply_lora_adapters(req.lora_mix());
 
     // Initialize metrics
     GenerationMetrics metrics;
@@ -849,11 +680,10 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
     bool first_token_generated = false;
 
     // Parse messages JSON
-    const std::string messages_json = utf8::from_jstring(env, jmessagesJson);
     auto messages = parse_messages_json(messages_json);
 
     if (messages.empty()) {
-        send_error(env, jcallback, "Empty or invalid messages JSON");
+        callback.on_error("Empty or invalid messages JSON");
         return JNI_FALSE;
     }
 
@@ -862,7 +692,7 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
     // Skip if the caller already included tool instructions (e.g. from
     // ToolCallManager.generateWithTools which builds its own system msg).
     // ====================================================================
-    if (g_state.tools_enabled && !g_state.tools_json.empty()) {
+    if (cfg->tools_enabled && !cfg->tools_json.empty() && !cfg->has_response_schema()) {
         bool already_has_preamble = false;
         if (!messages.empty() && messages[0].role == "system") {
             already_has_preamble =
@@ -870,15 +700,15 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
         }
 
         if (!already_has_preamble) {
-            std::string preamble = chat::build_tool_preamble(g_state.tools_json);
+            std::string preamble = chat::build_tool_preamble(cfg->tools_json);
             if (!messages.empty() && messages[0].role == "system") {
                 messages[0].content += "\n" + preamble;
             } else {
                 chat::ChatMessage sys;
                 sys.role = "system";
-                sys.content = g_state.system_prompt.empty()
+                sys.content = cfg->system_prompt.empty()
                               ? preamble
-                              : g_state.system_prompt + "\n" + preamble;
+                              : cfg->system_prompt + "\n" + preamble;
                 messages.insert(messages.begin(), sys);
             }
         }
@@ -935,39 +765,39 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
         }
     }
 
-    LOG_INFO("Multi-turn generation: %zu messages", messages.size());
+    LOG_DEBUG("Multi-turn generation: %zu messages", messages.size());
     for (size_t mi = 0; mi < messages.size(); ++mi) {
-        LOG_INFO("  msg[%zu] role=%s content_len=%zu first40=%.40s",
-                 mi, messages[mi].role.c_str(),
-                 messages[mi].content.size(),
-                 messages[mi].content.c_str());
+        LOG_DEBUG("  msg[%zu] role=%s content_len=%zu first40=%.40s",
+                  mi, messages[mi].role.c_str(),
+                  messages[mi].content.size(),
+                  messages[mi].content.c_str());
     }
 
     // Get vocab
     const llama_vocab *vocab = llama_model_get_vocab(g_state.model);
     if (!vocab) {
-        send_error(env, jcallback, "Failed to get vocab");
+        callback.on_error("Failed to get vocab");
         return JNI_FALSE;
     }
 
     // Apply multi-turn chat template
     const std::string prompt = chat::apply_template_multi(
             g_state.model, messages,
-            g_state.chat_template_override,
+            cfg->chat_template_override,
             true // add generation prompt
     );
 
     if (prompt.empty()) {
-        send_error(env, jcallback, "Chat template application failed");
+        callback.on_error("Chat template application failed");
         return JNI_FALSE;
     }
 
-    LOG_INFO("Multi-turn rendered prompt size=%zu", prompt.size());
+    LOG_DEBUG("Multi-turn rendered prompt size=%zu", prompt.size());
 
     // Tokenize prompt
     std::vector<llama_token> prompt_toks = g_state.tokenize(prompt);
     if (prompt_toks.empty()) {
-        send_error(env, jcallback, "Tokenization failed");
+        callback.on_error("Tokenization failed");
         return JNI_FALSE;
     }
 
@@ -977,58 +807,88 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
     // Check context size
     int32_t available = g_state.ctx_size - metrics.prompt_tokens - 8;
     if (available <= 0) {
-        send_error(env, jcallback, "Context overflow - conversation too long");
+        callback.on_error("Context overflow - conversation too long");
         return JNI_TRUE;
     }
 
-    int32_t to_generate = (max_tokens > 0) ? static_cast<int32_t>(max_tokens) : 128;
+    int32_t to_generate = (max_tokens > 0) ? max_tokens : 128;
     to_generate = std::min(to_generate, available);
 
+    // Trace recording (record/replay harness) - null when not recording
+    std::unique_ptr<trace::SessionTrace> rec =
+            begin_trace_session(*cfg, req.lora_mix(), prompt, prompt_toks, to_generate);
+    auto emit = [&](std::string_view text) {
+        callback.on_token(text);
+        if (rec) rec->output_text.append(text.data(), text.size());
+    };
+
     // Decode prompt (prefill phase)
-    if (!g_state.decode_prompt(prompt_toks)) {
-        jni::on_error(env, jcallback, "Decoding prompt failed");
+    auto prefill_start = std::chrono::steady_clock::now();
+    if (!g_state.decode_prompt(prompt_toks, &req)) {
+        if (req.should_stop()) {
+            return finish_stopped(callback, req);
+        }
+        callback.on_error("Decoding prompt failed");
         return JNI_TRUE;
     }
+    req.set_state(RequestState::Decoding);
+    if (rec) rec->prefill_us = elapsed_us(prefill_start);
 
     // Verify logits
     float *logits = llama_get_logits(g_state.ctx);
     if (!logits) {
         LOG_ERROR("No logits available after prompt decode");
-        jni::on_error(env, jcallback, "No logits available");
+        callback.on_error("No logits available");
         return JNI_TRUE;
     }
 
     // Initialize streaming components
+    // (a response schema replaces tool calling: output is one JSON document)
+    const bool detect_tool_calls = cfg->tools_enabled && !cfg->has_response_schema();
     ToolCallState tool_state;
     Utf8StreamDecoder utf8_decoder;
     StopStringChecker stop_checker;
-    stop_checker.init(g_state.stop_strings);
+    stop_checker.init(cfg->stop_strings);
+
+    // Per-session scratch for per-token text (reset every token)
+    TokenArena arena;
 
     llama_token eos = llama_vocab_eos(vocab);
     llama_token eot = llama_vocab_eot(vocab);
 
-    llama_batch single = llama_batch_init(1, 0, 1);
-
     constexpr int EXCEPTION_CHECK_INTERVAL = 64;
     bool has_exception = false;
     bool hit_stop_string = false;
+    trace::StopReason stop_reason = trace::StopReason::MaxTokens;
 
     // ========================================================================
     // GENERATION LOOP (with stop string detection)
     // ========================================================================
-    for (int i = 0; i < to_generate && !g_stop_requested.load(std::memory_order_relaxed); ++i) {
+    for (int i = 0; i < to_generate; ++i) {
+        // Cancel / deadline checked before every decode step
+        if (req.should_stop()) {
+            stop_reason = trace::StopReason::Cancelled;
+            break;
+        }
+
         int current_pos = static_cast<int>(prompt_toks.size()) + i;
         if (current_pos >= g_state.ctx_size - 1) {
             LOG_ERROR("Context overflow at pos %d, ctx_size %d", current_pos, g_state.ctx_size);
-            jni::on_error(env, jcallback, "Context size exceeded");
+            callback.on_error("Context size exceeded");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
+        arena.reset();
+
+        auto sample_start = std::chrono::steady_clock::now();
+        const uint64_t logits_hash = rec ? trace::hash_logits(llama_get_logits_ith(g_state.ctx, -1), rec->n_vocab) : 0;
         llama_token tok = llama_sampler_sample(g_state.sampler, g_state.ctx, -1);
 
         if (tok < 0) {
             LOG_ERROR("llama_sampler_sample returned invalid token");
-            jni::on_error(env, jcallback, "Sampling failed");
+            callback.on_error("Sampling failed");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
@@ -1037,10 +897,11 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
             llama_sampler_accept(g_state.sampler, tok);
         } catch (const std::runtime_error& e) {
             LOG_WARN("Grammar accept threw: %s - rebuilding sampler without grammar", e.what());
-            llama_sampler* saved_grammar = g_state.grammar_sampler;
-            g_state.grammar_sampler = nullptr;
-            g_state.rebuild_sampler_cached();
-            g_state.grammar_sampler = saved_grammar;
+            g_state.rebuild_sampler(*cfg, /*with_grammar=*/false);
+        }
+
+        if (rec) {
+            rec->tokens.push_back({tok, logits_hash, elapsed_us(sample_start), 0});
         }
 
         if (i == 0 && (tok == eos || tok == eot)) {
@@ -1048,6 +909,7 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
         }
 
         if (tok == eos || tok == eot) {
+            stop_reason = trace::StopReason::EndOfGeneration;
             break;
         }
 
@@ -1061,18 +923,23 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
         metrics.generated_tokens++;
         metrics.total_tokens++;
 
-        std::string raw_piece = g_state.detokenize_single(tok);
-        std::string complete_chars = utf8_decoder.decode(raw_piece);
+        std::string_view raw_piece = g_state.detokenize(tok, arena);
+        std::string_view complete_chars = utf8_decoder.decode(raw_piece, arena);
 
         if (!complete_chars.empty()) {
             bool tool_complete = false;
 
-            if (g_state.tools_enabled) {
+            if (detect_tool_calls) {
                 tool_complete = tool_state.accumulate(complete_chars);
                 if (tool_complete) {
                     std::string name, payload;
                     if (tool_state.extract_tool_call(name, payload)) {
-                        send_toolcall(env, jcallback, name, payload);
+                        callback.on_toolcall(name, payload);
+                        stop_reason = trace::StopReason::ToolCall;
+                        if (rec) {
+                            rec->tool_name = name;
+                            rec->tool_payload = payload;
+                        }
                         break;
                     }
                     tool_state.reset();
@@ -1082,32 +949,29 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
             if (!tool_state.is_collecting()) {
                 if (stop_checker.has_stops()) {
                     bool stopped = false;
-                    std::string safe = stop_checker.feed(complete_chars, stopped);
+                    std::string_view safe = stop_checker.feed(complete_chars, stopped, arena);
                     if (!safe.empty()) {
-                        send_token_immediate(env, jcallback, safe);
+                        emit(safe);
                     }
                     if (stopped) {
                         LOG_INFO("Stop string detected at token %d — ending generation", i);
                         hit_stop_string = true;
+                        stop_reason = trace::StopReason::StopString;
                         break;
                     }
                 } else {
-                    send_token_immediate(env, jcallback, complete_chars);
+                    emit(complete_chars);
                 }
             }
         }
 
-        single.n_tokens = 1;
-        single.token[0] = tok;
-        single.pos[0] = static_cast<int32_t>(prompt_toks.size() + i);
-        single.n_seq_id[0] = 1;
-        single.seq_id[0][0] = 0;
-        single.logits[0] = true;
-
-        int decode_result = llama_decode(g_state.ctx, single);
+        auto decode_start = std::chrono::steady_clock::now();
+        int decode_result = g_state.decode_token(tok, current_pos);
+        if (rec && !rec->tokens.empty()) rec->tokens.back().decode_us = elapsed_us(decode_start);
         if (decode_result != 0) {
             LOG_ERROR("llama_decode failed with code %d at token %d", decode_result, i);
-            jni::on_error(env, jcallback, "llama_decode failed during generation");
+            callback.on_error("llama_decode failed during generation");
+            stop_reason = trace::StopReason::Error;
             break;
         }
 
@@ -1116,6 +980,7 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
                 LOG_ERROR("Java exception during callback - aborting");
                 env->ExceptionClear();
                 has_exception = true;
+                stop_reason = trace::StopReason::Error;
                 break;
             }
         }
@@ -1124,24 +989,25 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
     // ========================================================================
     // CLEANUP
     // ========================================================================
-    std::string remaining = utf8_decoder.flush();
+    arena.reset();
+    std::string_view remaining = utf8_decoder.flush();
     if (!remaining.empty()) {
         if (stop_checker.has_stops()) {
             bool stopped = false;
-            std::string safe = stop_checker.feed(remaining, stopped);
+            std::string_view safe = stop_checker.feed(remaining, stopped, arena);
             if (!safe.empty()) {
-                send_token_immediate(env, jcallback, safe);
+                emit(safe);
             }
         } else {
-            send_token_immediate(env, jcallback, remaining);
+            emit(remaining);
         }
     }
 
     // Flush stop checker buffer
     if (stop_checker.has_stops()) {
-        std::string buffered = stop_checker.flush();
+        std::string_view buffered = stop_checker.flush(arena);
         if (!buffered.empty()) {
-            send_token_immediate(env, jcallback, buffered);
+            emit(buffered);
         }
     }
 
@@ -1154,22 +1020,174 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGenerateStreamMultiTurn(JNIEnv *env, jo
                 (metrics.generated_tokens * 1000.0f) / static_cast<float>(metrics.total_time_ms);
     }
 
-    llama_batch_free(single);
+    if (rec) {
+        rec->stop_reason = stop_reason;
+        rec->total_us = elapsed_us(start_time);
+        g_trace_writer.write(*rec);
+    }
+
+    req.set_state(final_state(req, stop_reason));
 
     if (!has_exception) {
-        send_metrics(env, jcallback, metrics);
-        send_done(env, jcallback);
+        send_metrics(env, callback, metrics);
+        callback.on_done();
     }
 
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadModelFromFd(JNIEnv *env, jobject, jint fd,
-                                                         jint jthreads, jint ctxSize, jfloat temp,
-                                                         jint topK, jfloat topP, jfloat minP,
-                                                         jint mirostat, jfloat mirostatTau,
-                                                         jfloat mirostatEta, jint seed) {
+// ============================================================================
+// GENERATION ENTRY POINTS
+// Blocking calls run on the caller's thread, async calls on a native worker
+// thread attached to the VM. Both run under their own GenerationRequest,
+// queue on g_generate_mtx and can be cancelled individually.
+// ============================================================================
+
+namespace {
+
+    enum class GenerateKind {
+        SingleTurn,  // input is the user message
+        MultiTurn,   // input is a messages JSON array
+    };
+
+    jboolean run_request(JNIEnv *env, const jni::StreamCallback &callback,
+                         GenerationRequest &req, GenerateKind kind,
+                         const std::string &input, int32_t max_tokens) {
+        const jboolean ok = (kind == GenerateKind::SingleTurn)
+                            ? generate_stream(env, callback, req, input, max_tokens)
+                            : generate_multi_turn(env, callback, req, input, max_tokens);
+
+        // Both generators set the final state once decoding ends; only the
+        // early error returns (before the decode loop) leave it unfinished
+        if (!is_finished(req.state())) {
+            req.set_state(RequestState::Failed);
+        }
+        return ok;
+    }
+
+    jboolean generate_blocking(JNIEnv *env, jstring jinput, jint max_tokens,
+                               jobject jcallback, GenerateKind kind) {
+        // Resolve callback methods once for the whole request
+        const jni::StreamCallback callback(env, jcallback);
+        const std::string input = utf8::from_jstring(env, jinput);
+
+        // Registered so nativeStopGeneration() reaches it, even while queued
+        const std::shared_ptr<GenerationRequest> req = g_requests.create(0);
+        req->set_lora_mix(g_state.lora_mix());
+        const jboolean ok = run_request(env, callback, *req, kind, input, max_tokens);
+        g_requests.release(req->handle());
+        return ok;
+    }
+
+    jlong generate_async(JNIEnv *env, jstring jinput, jint max_tokens, jlong timeout_ms,
+                         jobject jcallback, GenerateKind kind) {
+        JavaVM *vm = jni::vm();
+        if (!vm || !jcallback) {
+            LOG_ERROR("Async generation: %s", vm ? "null callback" : "JavaVM not captured");
+            return 0;
+        }
+
+        std::string input = utf8::from_jstring(env, jinput);
+        jobject callback_ref = env->NewGlobalRef(jcallback);
+        std::shared_ptr<GenerationRequest> req = g_requests.create(timeout_ms);
+        // The mix in effect now, not when the request reaches the model
+        req->set_lora_mix(g_state.lora_mix());
+
+        auto worker = [vm, req, callback_ref, kind, max_tokens, input = std::move(input)]() {
+            JavaVMAttachArgs args{JNI_VERSION_1_6, "ai_gguf-generate", nullptr};
+            JNIEnv *worker_env = nullptr;
+            if (vm->AttachCurrentThread(&worker_env, &args) != JNI_OK) {
+                // The global ref can't be deleted without an env; leaked
+                LOG_ERROR("Async generation: AttachCurrentThread failed");
+                req->set_state(RequestState::Failed);
+                return;
+            }
+
+            {
+                const jni::StreamCallback callback(worker_env, callback_ref);
+                run_request(worker_env, callback, *req, kind, input, max_tokens);
+            }
+
+            if (worker_env->ExceptionCheck()) {
+                worker_env->ExceptionClear();
+            }
+            worker_env->DeleteGlobalRef(callback_ref);
+            vm->DetachCurrentThread();
+        };
+
+        try {
+            std::thread(std::move(worker)).detach();
+        } catch (const std::system_error &e) {
+            LOG_ERROR("Async generation: cannot start worker thread: %s", e.what());
+            env->DeleteGlobalRef(callback_ref);
+            g_requests.release(req->handle());
+            return 0;
+        }
+
+        LOG_DEBUG("Request %llu queued (timeout %lld ms)",
+                  static_cast<unsigned long long>(req->handle()),
+                  static_cast<long long>(timeout_ms));
+        return static_cast<jlong>(req->handle());
+    }
+
+} // anonymous namespace
+
+static jboolean JNICALL
+nativeGenerateStream(JNIEnv *env, jobject, jstring jprompt,
+                     jint max_tokens, jobject jcallback) {
+    return generate_blocking(env, jprompt, max_tokens, jcallback, GenerateKind::SingleTurn);
+}
+
+static jboolean JNICALL
+nativeGenerateStreamMultiTurn(JNIEnv *env, jobject,
+                              jstring jmessagesJson,
+                              jint max_tokens,
+                              jobject jcallback) {
+    return generate_blocking(env, jmessagesJson, max_tokens, jcallback, GenerateKind::MultiTurn);
+}
+
+static jlong JNICALL
+nativeGenerateAsync(JNIEnv *env, jobject, jstring jprompt,
+                    jint max_tokens, jlong timeout_ms, jobject jcallback) {
+    return generate_async(env, jprompt, max_tokens, timeout_ms, jcallback,
+                          GenerateKind::SingleTurn);
+}
+
+static jlong JNICALL
+nativeGenerateMultiTurnAsync(JNIEnv *env, jobject, jstring jmessagesJson,
+                             jint max_tokens, jlong timeout_ms, jobject jcallback) {
+    return generate_async(env, jmessagesJson, max_tokens, timeout_ms, jcallback,
+                          GenerateKind::MultiTurn);
+}
+
+// @CriticalNative: takes the registry lock only briefly, never blocks on generation
+static jboolean JNICALL
+nativeCancelGenerationCritical(jlong handle) {
+    const bool cancelled = g_requests.cancel(static_cast<uint64_t>(handle));
+    LOG_INFO("Cancel request %lld: %s", static_cast<long long>(handle),
+             cancelled ? "ok" : "unknown or finished");
+    return cancelled ? JNI_TRUE : JNI_FALSE;
+}
+
+// @CriticalNative: RequestState value, or -1 for an unknown/released handle
+static jint JNICALL
+nativeGetGenerationStateCritical(jlong handle) {
+    const std::shared_ptr<GenerationRequest> req = g_requests.find(static_cast<uint64_t>(handle));
+    return req ? static_cast<jint>(req->state()) : -1;
+}
+
+// @CriticalNative
+static void JNICALL
+nativeReleaseGenerationCritical(jlong handle) {
+    g_requests.release(static_cast<uint64_t>(handle));
+}
+
+static jboolean JNICALL
+nativeLoadModelFromFd(JNIEnv *env, jobject, jint fd,
+                      jint jthreads, jint ctxSize, jfloat temp,
+                      jint topK, jfloat topP, jfloat minP,
+                      jint mirostat, jfloat mirostatTau,
+                      jfloat mirostatEta, jint seed) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
 
     g_state.release();
@@ -1229,17 +1247,21 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadModelFromFd(JNIEnv *env, jobject, j
     g_state.ctx_size = ctxSize;
     g_state.batch_size = cparams.n_batch;
 
-    g_state.rebuild_sampler(static_cast<int>(topK), topP, temp, minP, mirostat, mirostatTau,
-                            mirostatEta, seed);
-    g_state.warmup_context();
+    // Sampler params, fallback chat template, stop strings and the tool
+    // grammar for this model, published as one snapshot
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.sampler_params = {static_cast<int>(topK), topP, temp, minP,
+                            mirostat, mirostatTau, mirostatEta, seed};
 
-    // If model has no chat template, apply one based on architecture
-    g_state.apply_fallback_chat_template();
+        // If model has no chat template, apply one based on architecture
+        g_state.apply_fallback_chat_template(c);
 
-    maybe_init_grammar();
+        // Auto-detect stop strings from chat template
+        g_state.detect_stop_strings(c);
+    });
 
-    // Auto-detect stop strings from chat template
-    g_state.detect_stop_strings();
+    g_state.rebuild_sampler(*cfg);
+    g_state.warmup_context();
 
     LOG_INFO("Model initialized successfully from fd");
     return JNI_TRUE;
@@ -1248,12 +1270,12 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadModelFromFd(JNIEnv *env, jobject, j
 
 
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadModel(JNIEnv *env, jobject, jstring jpath,
-                                                   jint jthreads, jint ctxSize, jfloat temp,
-                                                   jint topK, jfloat topP, jfloat minP,
-                                                   jint mirostat, jfloat mirostatTau,
-                                                   jfloat mirostatEta, jint seed) {
+static jboolean JNICALL
+nativeLoadModel(JNIEnv *env, jobject, jstring jpath,
+                jint jthreads, jint ctxSize, jfloat temp,
+                jint topK, jfloat topP, jfloat minP,
+                jint mirostat, jfloat mirostatTau,
+                jfloat mirostatEta, jint seed) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
 
     const std::string path = utf8::from_jstring(env, jpath);
@@ -1303,65 +1325,84 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadModel(JNIEnv *env, jobject, jstring
     g_state.ctx_size = ctxSize;
     g_state.batch_size = cparams.n_batch;
 
-    // Build sampler chain
-    g_state.rebuild_sampler(static_cast<int>(topK), topP, temp, minP, mirostat, mirostatTau,
-                            mirostatEta, seed);
+    // Sampler params, fallback chat template, stop strings and the tool
+    // grammar (if tools are enabled) for this model, published as one snapshot
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.sampler_params = {static_cast<int>(topK), topP, temp, minP,
+                            mirostat, mirostatTau, mirostatEta, seed};
 
-    // Warm up context
-    g_state.warmup_context();
+        // If model has no chat template, apply one based on architecture
+        g_state.apply_fallback_chat_template(c);
 
-    // If model has no chat template, apply one based on architecture
-    g_state.apply_fallback_chat_template();
+        // Auto-detect stop strings from chat template
+        g_state.detect_stop_strings(c);
+    });
 
-    // Initialize grammar if tools are enabled
-    maybe_init_grammar();
+    // Build sampler chain
+    g_state.rebuild_sampler(*cfg);
 
-    // Auto-detect stop strings from chat template
-    g_state.detect_stop_strings();
+    // Warm up context
+    g_state.warmup_context();
 
     LOG_INFO("Model initialized successfully");
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeRelease(JNIEnv *, jobject) {
+static jboolean JNICALL
+nativeRelease(JNIEnv *, jobject) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
     g_state.release();
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetSystemPrompt(JNIEnv *env, jobject, jstring jprompt) {
-    g_state.system_prompt = utf8::from_jstring(env, jprompt);
-    LOG_INFO("System prompt updated (%zu bytes)", g_state.system_prompt.size());
+// ============================================================================
+// CONFIGURATION SETTERS
+// Each builds and publishes a new GenerationConfig snapshot (grammar
+// compiled here if needed). A running generation keeps its own snapshot.
+// ============================================================================
+
+static void JNICALL
+nativeSetSystemPrompt(JNIEnv *env, jobject, jstring jprompt) {
+    std::string prompt = utf8::from_jstring(env, jprompt);
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.system_prompt = std::move(prompt);
+    });
+    LOG_INFO("System prompt updated (%zu bytes)", cfg->system_prompt.size());
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetChatTemplate(JNIEnv *env, jobject, jstring jtemplate) {
-    g_state.chat_template_override = utf8::from_jstring(env, jtemplate);
-    LOG_INFO("Chat template override set (%zu bytes)", g_state.chat_template_override.size());
-    // Re-detect stop strings since template changed
-    g_state.detect_stop_strings();
+static void JNICALL
+nativeSetChatTemplate(JNIEnv *env, jobject, jstring jtemplate) {
+    std::string tmpl = utf8::from_jstring(env, jtemplate);
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.chat_template_override = std::move(tmpl);
+        // Re-detect stop strings since template changed
+        g_state.detect_stop_strings(c);
+    });
+    LOG_INFO("Chat template override set (%zu bytes)", cfg->chat_template_override.size());
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetToolsJson(JNIEnv *env, jobject, jstring jtools) {
-    std::string raw = utf8::from_jstring(env, jtools);
-    g_state.tools_json = chat::normalize_tools_json(raw);
-    g_state.tools_enabled = !g_state.tools_json.empty();
-    LOG_INFO("Tools JSON set (%zu bytes), enabled=%d", g_state.tools_json.size(),
-             static_cast<int>(g_state.tools_enabled));
-    maybe_init_grammar();
+static void JNICALL
+nativeSetToolsJson(JNIEnv *env, jobject, jstring jtools) {
+    std::string tools = chat::normalize_tools_json(utf8::from_jstring(env, jtools));
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.tools_json = std::move(tools);
+        c.tools_enabled = !c.tools_json.empty();
+    });
+    LOG_INFO("Tools JSON set (%zu bytes), enabled=%d", cfg->tools_json.size(),
+             static_cast<int>(cfg->tools_enabled));
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeStopGeneration(JNIEnv *, jobject) {
-    g_stop_requested.store(true, std::memory_order_relaxed);
-    LOG_INFO("Stop generation requested");
+// @CriticalNative: no JNIEnv/jclass, callable while a generation is running.
+// Cancels every request that is queued or running at the time of the call;
+// requests started afterwards are unaffected.
+static void JNICALL
+nativeStopGenerationCritical() {
+    const size_t n = g_requests.cancel_all();
+    LOG_INFO("Stop generation requested (%zu requests cancelled)", n);
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeClearMemory(JNIEnv *, jobject) {
+static void JNICALL
+nativeClearMemory(JNIEnv *, jobject) {
     if (g_state.ctx) {
         // Updated API: llama_memory_* instead of llama_kv_cache_*
         llama_memory_t mem = llama_get_memory(g_state.ctx);
@@ -1372,14 +1413,14 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeClearMemory(JNIEnv *, jobject) {
     }
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_llamaPrintTimings(JNIEnv *, jobject) {
+static void JNICALL
+llamaPrintTimings(JNIEnv *, jobject) {
     llama_print_system_info();
     llama_perf_context_print(g_state.ctx);
 }
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetModelInfo(JNIEnv *env, jobject thiz) {
+static jstring JNICALL
+nativeGetModelInfo(JNIEnv *env, jobject thiz) {
     if (!g_state.model) return env->NewStringUTF("{}");
 
     const llama_vocab *vocab = llama_model_get_vocab(g_state.model);
@@ -1493,81 +1534,10 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetModelInfo(JNIEnv *env, jobject thiz)
 // ============================================================================
 
 namespace {
-    // Pre-cached JNI references for embedding callbacks
-    struct EmbeddingCallbackCache {
-        jclass cls = nullptr;
-        jmethodID onProgress = nullptr;
-        jmethodID onComplete = nullptr;
-        jmethodID onError = nullptr;
-
-        // EmbeddingResult class cache
-        jclass resultClass = nullptr;
-        jmethodID resultConstructor = nullptr;
-
-        bool initialized = false;
-
-        void init(JNIEnv *env, jobject callback) {
-            if (initialized) return;
-
-            jclass tempCls = env->GetObjectClass(callback);
-            if (!tempCls) {
-                LOG_ERROR("EmbeddingCallbackCache: Failed to get callback class");
-                return;
-            }
-
-            cls = static_cast<jclass>(env->NewGlobalRef(tempCls));
-            env->DeleteLocalRef(tempCls);
-
-            onProgress = env->GetMethodID(cls, "onProgress", "(FII)V");
-            onComplete = env->GetMethodID(cls, "onComplete",
-                                          "(Lcom/mp/ai_gguf/models/EmbeddingResult;)V");
-            onError = env->GetMethodID(cls, "onError", "(Ljava/lang/String;)V");
-
-            // Cache EmbeddingResult class
-            jclass tempResultCls = env->FindClass("com/mp/ai_gguf/models/EmbeddingResult");
-            if (tempResultCls) {
-                resultClass = static_cast<jclass>(env->NewGlobalRef(tempResultCls));
-                resultConstructor = env->GetMethodID(resultClass, "<init>",
-                                                     "([FILjava/lang/String;IJ)V");
-                env->DeleteLocalRef(tempResultCls);
-            }
-
-            initialized = true;
-        }
-
-        void release(JNIEnv *env) {
-            if (cls) {
-                env->DeleteGlobalRef(cls);
-                cls = nullptr;
-            }
-            if (resultClass) {
-                env->DeleteGlobalRef(resultClass);
-                resultClass = nullptr;
-            }
-            initialized = false;
-        }
-    };
-
-    static thread_local EmbeddingCallbackCache g_embedding_callback_cache;
-
-    inline void send_embedding_progress(JNIEnv *env, jobject callback,
-                                        float progress, int32_t current, int32_t total) {
-        if (!callback) return;
-
-        g_embedding_callback_cache.init(env, callback);
-        if (!g_embedding_callback_cache.onProgress) return;
-
-        env->CallVoidMethod(callback, g_embedding_callback_cache.onProgress,
-                            progress, current, total);
-    }
-
-    inline void send_embedding_complete(JNIEnv *env, jobject callback,
+    inline void send_embedding_complete(JNIEnv *env, const jni::EmbeddingCallback &callback,
                                         const EmbeddingOutput &output) {
-        if (!callback) return;
-
-        g_embedding_callback_cache.init(env, callback);
-        if (!g_embedding_callback_cache.onComplete ||
-            !g_embedding_callback_cache.resultClass) return;
+        const jni::ClassCache &classes = jni::classes();
+        if (!classes.embedding_result_init) return;
 
         // Convert embeddings to jfloatArray
         jfloatArray jembeddings = env->NewFloatArray(output.dimension);
@@ -1599,13 +1569,13 @@ namespace {
         jstring jpooling = env->NewStringUTF(pooling_str);
 
         // Create EmbeddingResult object
-        jobject result = env->NewObject(g_embedding_callback_cache.resultClass,
-                                        g_embedding_callback_cache.resultConstructor,
+        jobject result = env->NewObject(classes.embedding_result,
+                                        classes.embedding_result_init,
                                         jembeddings, output.dimension, jpooling,
                                         output.num_tokens, output.time_ms);
 
         if (result) {
-            env->CallVoidMethod(callback, g_embedding_callback_cache.onComplete, result);
+            callback.on_complete(result);
             env->DeleteLocalRef(result);
         }
 
@@ -1613,24 +1583,13 @@ namespace {
         env->DeleteLocalRef(jpooling);
     }
 
-    inline void send_embedding_error(JNIEnv *env, jobject callback, const char *msg) {
-        if (!callback) return;
-
-        g_embedding_callback_cache.init(env, callback);
-        if (!g_embedding_callback_cache.onError) return;
-
-        jstring jmsg = env->NewStringUTF(msg ? msg : "<unknown error>");
-        env->CallVoidMethod(callback, g_embedding_callback_cache.onError, jmsg);
-        env->DeleteLocalRef(jmsg);
-    }
-
 } // anonymous namespace
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadEmbeddingModelFromFd(JNIEnv *env, jobject,
-                                                                  jint fd,
-                                                                  jint jthreads,
-                                                                  jint ctxSize) {
+static jboolean JNICALL
+nativeLoadEmbeddingModelFromFd(JNIEnv *env, jobject,
+                               jint fd,
+                               jint jthreads,
+                               jint ctxSize) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
 
     g_embedding_state.release();
@@ -1701,11 +1660,11 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadEmbeddingModelFromFd(JNIEnv *env, j
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadEmbeddingModel(JNIEnv *env, jobject,
-                                                            jstring jpath,
-                                                            jint jthreads,
-                                                            jint ctxSize) {
+static jboolean JNICALL
+nativeLoadEmbeddingModel(JNIEnv *env, jobject,
+                         jstring jpath,
+                         jint jthreads,
+                         jint ctxSize) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
 
     const std::string path = utf8::from_jstring(env, jpath);
@@ -1768,25 +1727,27 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeLoadEmbeddingModel(JNIEnv *env, jobject
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeEncodeText(JNIEnv *env, jobject, jstring jtext,
-                                                    jboolean normalize, jobject jcallback) {
+static jboolean JNICALL
+nativeEncodeText(JNIEnv *env, jobject, jstring jtext,
+                 jboolean normalize, jobject jcallback) {
+    const jni::EmbeddingCallback callback(env, jcallback);
+
     if (!g_embedding_state.is_ready()) {
-        send_embedding_error(env, jcallback, "Embedding model not initialized");
+        callback.on_error("Embedding model not initialized");
         return JNI_FALSE;
     }
 
     const std::string text = utf8::from_jstring(env, jtext);
     if (text.empty()) {
-        send_embedding_error(env, jcallback, "Empty text provided");
+        callback.on_error("Empty text provided");
         return JNI_FALSE;
     }
 
-    LOG_INFO("Encoding text (%zu bytes)", text.size());
+    LOG_DEBUG("Encoding text (%zu bytes)", text.size());
 
     // Create progress callback that forwards to Java
-    auto progress_callback = [env, jcallback](float progress, int32_t current, int32_t total) {
-        send_embedding_progress(env, jcallback, progress, current, total);
+    auto progress_callback = [&callback](float progress, int32_t current, int32_t total) {
+        callback.on_progress(progress, current, total);
     };
 
     // Encode text
@@ -1794,25 +1755,25 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeEncodeText(JNIEnv *env, jobject, jstrin
 
     // Check if encoding succeeded
     if (output.embeddings.empty()) {
-        send_embedding_error(env, jcallback, "Encoding failed");
+        callback.on_error("Encoding failed");
         return JNI_FALSE;
     }
 
     // Send result to callback
-    send_embedding_complete(env, jcallback, output);
+    send_embedding_complete(env, callback, output);
 
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeReleaseEmbeddingModel(JNIEnv *, jobject) {
+static jboolean JNICALL
+nativeReleaseEmbeddingModel(JNIEnv *, jobject) {
     std::lock_guard<std::mutex> lk(g_init_mtx);
     g_embedding_state.release();
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetEmbeddingModelInfo(JNIEnv *env, jobject) {
+static jstring JNICALL
+nativeGetEmbeddingModelInfo(JNIEnv *env, jobject) {
     if (!g_embedding_state.model) return env->NewStringUTF("{}");
 
     std::ostringstream json;
@@ -1877,8 +1838,8 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetEmbeddingModelInfo(JNIEnv *env, jobj
 // TOOL CALLING SDK FUNCTIONS
 // ============================================================================
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetModelArchitecture(JNIEnv *env, jobject) {
+static jstring JNICALL
+nativeGetModelArchitecture(JNIEnv *env, jobject) {
     if (!g_state.model) {
         return env->NewStringUTF("");
     }
@@ -1887,8 +1848,9 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeGetModelArchitecture(JNIEnv *env, jobje
     return env->NewStringUTF(arch ? arch : "");
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeIsToolCallingSupported(JNIEnv *env, jobject) {
+// @CriticalNative
+static jboolean JNICALL
+nativeIsToolCallingSupportedCritical() {
     if (!g_state.model) {
         return JNI_FALSE;
     }
@@ -1899,72 +1861,163 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeIsToolCallingSupported(JNIEnv *env, job
     return (tmpl && *tmpl) ? JNI_TRUE : JNI_FALSE;
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeEnableToolCalling(JNIEnv *env, jobject, jstring jtools) {
+static jboolean JNICALL
+nativeEnableToolCalling(JNIEnv *env, jobject, jstring jtools) {
     if (!g_state.model) {
         LOG_ERROR("Cannot enable tool calling: model not loaded");
         return JNI_FALSE;
     }
 
     // Set tools JSON (normalize in case of double-nested "function" wrappers)
-    const std::string raw_json = utf8::from_jstring(env, jtools);
-    g_state.tools_json = chat::normalize_tools_json(raw_json);
-    g_state.tools_enabled = !g_state.tools_json.empty();
+    // and compile the grammar as part of publishing the new snapshot
+    std::string tools = chat::normalize_tools_json(utf8::from_jstring(env, jtools));
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.tools_json = std::move(tools);
+        c.tools_enabled = !c.tools_json.empty();
+    });
 
     // System prompt and chat template are set separately from Kotlin
     // via nativeSetSystemPrompt() and nativeSetChatTemplate().
     // This allows the caller to configure them per-model instead of
     // hardcoding a specific architecture's format.
 
-    // Initialize grammar
-    maybe_init_grammar();
-
     const char *arch = get_model_architecture(g_state.model);
     LOG_INFO("Tool calling enabled for %s model (%zu bytes of tools JSON)",
-             arch ? arch : "unknown", g_state.tools_json.size());
+             arch ? arch : "unknown", cfg->tools_json.size());
     return JNI_TRUE;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeDisableToolCalling(JNIEnv *env, jobject) {
-    g_state.tools_json.clear();
-    g_state.tools_enabled = false;
-    g_state.system_prompt.clear();
-    g_state.chat_template_override.clear();
+static void JNICALL
+nativeDisableToolCalling(JNIEnv *env, jobject) {
+    g_state.update_config([](GenerationConfig &c) {
+        c.tools_json.clear();
+        c.tools_enabled = false;
+        c.system_prompt.clear();
+        c.chat_template_override.clear();
+    });
 
     LOG_INFO("Tool calling disabled, reverted to default model settings");
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeIsToolCallingEnabled(JNIEnv *env, jobject) {
-    return g_state.tools_enabled ? JNI_TRUE : JNI_FALSE;
+// @CriticalNative
+static jboolean JNICALL
+nativeIsToolCallingEnabledCritical() {
+    return g_state.config()->tools_enabled ? JNI_TRUE : JNI_FALSE;
 }
 
 // ============================================================================
-// GRAMMAR MODE CONFIGURATION
+// TRACE RECORDING
 // ============================================================================
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetGrammarMode(JNIEnv *, jobject, jint mode) {
-    g_state.grammar_mode = (mode == 1) ? GrammarMode::LAZY : GrammarMode::STRICT;
-    g_state.invalidate_grammar();
-    LOG_INFO("Grammar mode set to %s", (mode == 1) ? "LAZY" : "STRICT");
+static jboolean JNICALL
+nativeStartTraceRecording(JNIEnv *env, jobject, jstring jpath) {
+    std::lock_guard<std::timed_mutex> lock(g_generate_mtx);
+    return g_trace_writer.open(utf8::from_jstring(env, jpath)) ? JNI_TRUE : JNI_FALSE;
+}
+
+static void JNICALL
+nativeStopTraceRecording(JNIEnv *, jobject) {
+    std::lock_guard<std::timed_mutex> lock(g_generate_mtx);
+    g_trace_writer.close();
+}
+
+// ============================================================================
+// LORA ADAPTERS
+// ============================================================================
+
+static jboolean JNICALL
+nativeLoadLoraAdapter(JNIEnv *env, jobject, jstring jpath,
+                      jstring jname) {
+    std::lock_guard<std::mutex> lk(g_init_mtx);
+    const std::string path = utf8::from_jstring(env, jpath);
+    const std::string name = utf8::from_jstring(env, jname);
+    // Adapter list itself is guarded by g_state.lora_mtx
+    return g_state.load_lora_adapter(name, path) ? JNI_TRUE : JNI_FALSE;
+}
+
+static jboolean JNICALL
+nativeUnloadLoraAdapter(JNIEnv *env, jobject, jstring jname) {
+    std::lock_guard<std::mutex> lk(g_init_mtx);
+    // Don't pull an adapter out from under a running generation
+    std::lock_guard<std::timed_mutex> gen_lock(g_generate_mtx);
+    return g_state.unload_lora_adapter(utf8::from_jstring(env, jname)) ? JNI_TRUE : JNI_FALSE;
+}
+
+static jboolean JNICALL
+nativeSetLoraAdapters(JNIEnv *env, jobject,
+                      jobjectArray jnames, jfloatArray jscales) {
+    std::vector<std::string> names;
+    std::vector<float> scales;
 
-    // Re-enable tools from tools_json if they were incorrectly disabled
-    if (!g_state.tools_enabled && !g_state.tools_json.empty()) {
-        g_state.tools_enabled = true;
-        LOG_INFO("Re-enabled tool calling from existing tools_json");
+    if (jnames) {
+        jsize len = env->GetArrayLength(jnames);
+        names.reserve(static_cast<size_t>(len));
+        for (jsize i = 0; i < len; ++i) {
+            auto jstr = static_cast<jstring>(env->GetObjectArrayElement(jnames, i));
+            names.push_back(utf8::from_jstring(env, jstr));
+            if (jstr) env->DeleteLocalRef(jstr);
+        }
     }
+    if (jscales) {
+        jsize len = env->GetArrayLength(jscales);
+        scales.resize(static_cast<size_t>(len));
+        env->GetFloatArrayRegion(jscales, 0, len, scales.data());
+    }
+
+    return g_state.set_lora_mix(names, scales) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Rebuild grammar if tools are enabled
-    if (g_state.tools_enabled) {
-        maybe_init_grammar();
+static jobjectArray JNICALL
+nativeGetLoraAdapters(JNIEnv *env, jobject) {
+    const std::vector<std::string> names = g_state.lora_adapter_names();
+    auto out = env->NewObjectArray(static_cast<jsize>(names.size()),
+                                   jni::classes().string, nullptr);
+    for (size_t i = 0; i < names.size(); ++i) {
+        jstring jname = env->NewStringUTF(names[i].c_str());
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), jname);
+        env->DeleteLocalRef(jname);
     }
+    return out;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetStopStrings(JNIEnv *env, jobject, jobjectArray jstrings) {
-    g_state.stop_strings.clear();
+// ============================================================================
+// STRUCTURED OUTPUT (JSON SCHEMA)
+// ============================================================================
+
+static jboolean JNICALL
+nativeSetResponseSchema(JNIEnv *env, jobject, jstring jschema) {
+    const std::string schema = utf8::from_jstring(env, jschema);
+    return g_state.set_response_schema(schema) ? JNI_TRUE : JNI_FALSE;
+}
+
+static void JNICALL
+nativeClearResponseSchema(JNIEnv *, jobject) {
+    g_state.clear_response_schema();
+}
+
+// ============================================================================
+// GRAMMAR MODE CONFIGURATION
+// ============================================================================
+
+static void JNICALL
+nativeSetGrammarMode(JNIEnv *, jobject, jint mode) {
+    LOG_INFO("Grammar mode set to %s", (mode == 1) ? "LAZY" : "STRICT");
+
+    // Grammar is rebuilt for the new mode when the snapshot is published
+    g_state.update_config([&](GenerationConfig &c) {
+        c.grammar_mode = (mode == 1) ? GrammarMode::LAZY : GrammarMode::STRICT;
+
+        // Re-enable tools from tools_json if they were incorrectly disabled
+        if (!c.tools_enabled && !c.tools_json.empty()) {
+            c.tools_enabled = true;
+            LOG_INFO("Re-enabled tool calling from existing tools_json");
+        }
+    });
+}
+
+static void JNICALL
+nativeSetStopStrings(JNIEnv *env, jobject, jobjectArray jstrings) {
+    std::vector<std::string> stop_strings;
 
     if (jstrings) {
         jsize len = env->GetArrayLength(jstrings);
@@ -1973,33 +2026,127 @@ Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetStopStrings(JNIEnv *env, jobject, jo
             if (jstr) {
                 std::string s = utf8::from_jstring(env, jstr);
                 if (!s.empty()) {
-                    g_state.stop_strings.push_back(std::move(s));
+                    stop_strings.push_back(std::move(s));
                 }
                 env->DeleteLocalRef(jstr);
             }
         }
     }
 
-    LOG_INFO("Stop strings set: %zu entries", g_state.stop_strings.size());
-    for (const auto& s : g_state.stop_strings) {
-        LOG_INFO("  stop: \"%s\"", s.c_str());
+    const ConfigSnapshot cfg = g_state.update_config([&](GenerationConfig &c) {
+        c.stop_strings = std::move(stop_strings);
+    });
+
+    LOG_INFO("Stop strings set: %zu entries", cfg->stop_strings.size());
+    for (const auto& s : cfg->stop_strings) {
+        LOG_DEBUG("  stop: \"%s\"", s.c_str());
     }
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_mp_ai_1gguf_GGUFNativeLib_nativeSetTypedGrammar(JNIEnv *, jobject, jboolean enabled) {
-    g_state.use_typed_grammar = (enabled == JNI_TRUE);
-    g_state.invalidate_grammar();
-    LOG_INFO("Typed grammar %s", g_state.use_typed_grammar ? "enabled" : "disabled");
+static void JNICALL
+nativeSetTypedGrammar(JNIEnv *, jobject, jboolean enabled) {
+    LOG_INFO("Typed grammar %s", (enabled == JNI_TRUE) ? "enabled" : "disabled");
+
+    // Grammar is rebuilt when the snapshot is published
+    g_state.update_config([&](GenerationConfig &c) {
+        c.use_typed_grammar = (enabled == JNI_TRUE);
+
+        // Re-enable tools from tools_json if they were incorrectly disabled
+        if (!c.tools_enabled && !c.tools_json.empty()) {
+            c.tools_enabled = true;
+            LOG_INFO("Re-enabled tool calling from existing tools_json");
+        }
+    });
+}
+// ============================================================================
+// NATIVE REGISTRATION
+// Bound explicitly from JNI_OnLoad - no exported Java_* symbols, no dlsym
+// lookup on first call. @CriticalNative methods must be registered this way
+// before Android 12. Signatures must match GGUFNativeLib.kt exactly.
+// ============================================================================
+
+#define NATIVE_METHOD(name, sig) { #name, sig, reinterpret_cast<void *>(name) }
+
+static const JNINativeMethod kGGUFNativeLibMethods[] = {
+        // Model lifecycle
+        NATIVE_METHOD(nativeLoadModelFromFd, "(IIIFIFFIFFI)Z"),
+        NATIVE_METHOD(nativeLoadModel, "(Ljava/lang/String;IIFIFFIFFI)Z"),
+        NATIVE_METHOD(nativeRelease, "()Z"),
+        NATIVE_METHOD(nativeGetModelInfo, "()Ljava/lang/String;"),
+        NATIVE_METHOD(nativeGetModelArchitecture, "()Ljava/lang/String;"),
+        NATIVE_METHOD(nativeClearMemory, "()V"),
+        NATIVE_METHOD(llamaPrintTimings, "()V"),
+
+        // Prompting / generation
+        NATIVE_METHOD(nativeSetSystemPrompt, "(Ljava/lang/String;)V"),
+        NATIVE_METHOD(nativeSetChatTemplate, "(Ljava/lang/String;)V"),
+        NATIVE_METHOD(nativeSetStopStrings, "([Ljava/lang/String;)V"),
+        NATIVE_METHOD(nativeGenerateStream,
+                      "(Ljava/lang/String;ILcom/mp/ai_gguf/models/StreamCallback;)Z"),
+        NATIVE_METHOD(nativeGenerateStreamMultiTurn,
+                      "(Ljava/lang/String;ILcom/mp/ai_gguf/models/StreamCallback;)Z"),
+        NATIVE_METHOD(nativeStopGenerationCritical, "()V"),
+        NATIVE_METHOD(nativeGenerateAsync,
+                      "(Ljava/lang/String;IJLcom/mp/ai_gguf/models/StreamCallback;)J"),
+        NATIVE_METHOD(nativeGenerateMultiTurnAsync,
+                      "(Ljava/lang/String;IJLcom/mp/ai_gguf/models/StreamCallback;)J"),
+        NATIVE_METHOD(nativeCancelGenerationCritical, "(J)Z"),
+        NATIVE_METHOD(nativeGetGenerationStateCritical, "(J)I"),
+        NATIVE_METHOD(nativeReleaseGenerationCritical, "(J)V"),
+
+        // Tool calling / grammar
+        NATIVE_METHOD(nativeSetToolsJson, "(Ljava/lang/String;)V"),
+        NATIVE_METHOD(nativeIsToolCallingSupportedCritical, "()Z"),
+        NATIVE_METHOD(nativeEnableToolCalling, "(Ljava/lang/String;)Z"),
+        NATIVE_METHOD(nativeDisableToolCalling, "()V"),
+        NATIVE_METHOD(nativeIsToolCallingEnabledCritical, "()Z"),
+        NATIVE_METHOD(nativeSetGrammarMode, "(I)V"),
+        NATIVE_METHOD(nativeSetTypedGrammar, "(Z)V"),
+        NATIVE_METHOD(nativeSetResponseSchema, "(Ljava/lang/String;)Z"),
+        NATIVE_METHOD(nativeClearResponseSchema, "()V"),
+
+        // LoRA adapters
+        NATIVE_METHOD(nativeLoadLoraAdapter, "(Ljava/lang/String;Ljava/lang/String;)Z"),
+        NATIVE_METHOD(nativeUnloadLoraAdapter, "(Ljava/lang/String;)Z"),
+        NATIVE_METHOD(nativeSetLoraAdapters, "([Ljava/lang/String;[F)Z"),
+        NATIVE_METHOD(nativeGetLoraAdapters, "()[Ljava/lang/String;"),
+
+        // Trace recording
+        NATIVE_METHOD(nativeStartTraceRecording, "(Ljava/lang/String;)Z"),
+        NATIVE_METHOD(nativeStopTraceRecording, "()V"),
+
+        // Embeddings
+        NATIVE_METHOD(nativeLoadEmbeddingModel, "(Ljava/lang/String;II)Z"),
+        NATIVE_METHOD(nativeLoadEmbeddingModelFromFd, "(III)Z"),
+        NATIVE_METHOD(nativeEncodeText,
+                      "(Ljava/lang/String;ZLcom/mp/ai_gguf/models/EmbeddingCallback;)Z"),
+        NATIVE_METHOD(nativeReleaseEmbeddingModel, "()Z"),
+        NATIVE_METHOD(nativeGetEmbeddingModelInfo, "()Ljava/lang/String;"),
+};
+
+#undef NATIVE_METHOD
 
-    // Re-enable tools from tools_json if they were incorrectly disabled
-    if (!g_state.tools_enabled && !g_state.tools_json.empty()) {
-        g_state.tools_enabled = true;
-        LOG_INFO("Re-enabled tool calling from existing tools_json");
+extern "C" JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM *vm, void *) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
     }
 
-    // Rebuild grammar if tools are enabled
-    if (g_state.tools_enabled) {
-        maybe_init_grammar();
+    jni::on_load(vm, env);
+
+    if (!jni::register_natives(env, "com/mp/ai_gguf/GGUFNativeLib", kGGUFNativeLibMethods,
+                               sizeof(kGGUFNativeLibMethods) / sizeof(kGGUFNativeLibMethods[0]))) {
+        return JNI_ERR;
     }
-}
\ No newline at end of file
+
+    return JNI_VERSION_1_6;
+}
+
+extern "C" JNIEXPORT void JNICALL
+JNI_OnUnload(JavaVM *vm, void *) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        jni::on_unload(env);
+    }
+}
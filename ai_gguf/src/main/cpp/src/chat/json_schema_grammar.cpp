@@ -0,0 +1,1056 @@
+#include "json_schema_grammar.h"
+#include "chat_template.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace chat {
+
+    namespace {
+
+/* --------------------------------------------------------------------
+ *  Minimal JSON DOM (schemas are small; keep it simple)
+ * -------------------------------------------------------------------- */
+        struct JsonValue {
+            enum class Type { Null, Bool, Number, String, Array, Object };
+
+            Type type = Type::Null;
+            bool boolean = false;
+            std::string str;   // string value, or raw text of a number
+            std::vector<JsonValue> arr;
+            std::vector<std::pair<std::string, JsonValue>> obj;
+
+            bool is_object() const { return type == Type::Object; }
+            bool is_array() const { return type == Type::Array; }
+            bool is_string() const { return type == Type::String; }
+
+            const JsonValue* get(const char* key) const {
+                if (type != Type::Object) return nullptr;
+                for (const auto& kv : obj) {
+                    if (kv.first == key) return &kv.second;
+                }
+                return nullptr;
+            }
+
+            long long get_int(const char* key, long long fallback) const {
+                const JsonValue* v = get(key);
+                if (!v || v->type != Type::Number) return fallback;
+                return std::strtoll(v->str.c_str(), nullptr, 10);
+            }
+        };
+
+        class JsonParser {
+        public:
+            explicit JsonParser(const std::string& s) : s_(s) {}
+
+            bool parse(JsonValue& out, std::string& err) {
+                skip_ws();
+                if (!parse_value(out, 0)) {
+                    err = err_.empty() ? "invalid JSON" : err_;
+                    return false;
+                }
+                skip_ws();
+                if (pos_ != s_.size()) {
+                    err = "trailing characters after JSON value";
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            static constexpr int kMaxDepth = 64;
+
+            const std::string& s_;
+            size_t pos_ = 0;
+            std::string err_;
+
+            void skip_ws() {
+                while (pos_ < s_.size() &&
+                       (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r')) {
+                    ++pos_;
+                }
+            }
+
+            bool fail(const char* msg) {
+                if (err_.empty()) err_ = std::string(msg) + " at offset " + std::to_string(pos_);
+                return false;
+            }
+
+            bool literal(const char* word) {
+                size_t n = std::char_traits<char>::length(word);
+                if (s_.compare(pos_, n, word) != 0) return fail("unexpected token");
+                pos_ += n;
+                return true;
+            }
+
+            static void append_utf8(uint32_t cp, std::string& out) {
+                if (cp <= 0x7F) {
+                    out.push_back(static_cast<char>(cp));
+                } else if (cp <= 0x7FF) {
+                    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } else if (cp <= 0xFFFF) {
+                    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } else {
+                    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                }
+            }
+
+            bool parse_hex4(uint32_t& cp) {
+                if (pos_ + 4 > s_.size()) return fail("truncated \\u escape");
+                cp = 0;
+                for (int i = 0; i < 4; ++i) {
+                    char c = s_[pos_++];
+                    cp <<= 4;
+                    if (c >= '0' && c <= '9') cp |= static_cast<uint32_t>(c - '0');
+                    else if (c >= 'a' && c <= 'f') cp |= static_cast<uint32_t>(c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F') cp |= static_cast<uint32_t>(c - 'A' + 10);
+                    else return fail("invalid \\u escape");
+                }
+                return true;
+            }
+
+            bool parse_string(std::string& out) {
+                ++pos_; // opening quote
+                while (pos_ < s_.size()) {
+                    char c = s_[pos_++];
+                    if (c == '"') return true;
+                    if (c != '\\') {
+                        out.push_back(c);
+                        continue;
+                    }
+                    if (pos_ >= s_.size()) break;
+                    char e = s_[pos_++];
+                    switch (e) {
+                        case '"':  out.push_back('"');  break;
+                        case '\\': out.push_back('\\'); break;
+                        case '/':  out.push_back('/');  break;
+                        case 'b':  out.push_back('\b'); break;
+                        case 'f':  out.push_back('\f'); break;
+                        case 'n':  out.push_back('\n'); break;
+                        case 'r':  out.push_back('\r'); break;
+                        case 't':  out.push_back('\t'); break;
+                        case 'u': {
+                            uint32_t cp = 0;
+                            if (!parse_hex4(cp)) return false;
+                            if (cp >= 0xD800 && cp <= 0xDBFF &&
+                                pos_ + 1 < s_.size() && s_[pos_] == '\\' && s_[pos_ + 1] == 'u') {
+                                pos_ += 2;
+                                uint32_t lo = 0;
+                                if (!parse_hex4(lo)) return false;
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                            }
+                            append_utf8(cp, out);
+                            break;
+                        }
+                        default:
+                            return fail("invalid escape");
+                    }
+                }
+                return fail("unterminated string");
+            }
+
+            bool parse_value(JsonValue& out, int depth) {
+                if (depth > kMaxDepth) return fail("schema nested too deeply");
+                if (pos_ >= s_.size()) return fail("unexpected end of input");
+
+                char c = s_[pos_];
+                if (c == '{') {
+                    out.type = JsonValue::Type::Object;
+                    ++pos_;
+                    skip_ws();
+                    if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+                    while (true) {
+                        skip_ws();
+                        if (pos_ >= s_.size() || s_[pos_] != '"') return fail("expected object key");
+                        std::string key;
+                        if (!parse_string(key)) return false;
+                        skip_ws();
+                        if (pos_ >= s_.size() || s_[pos_] != ':') return fail("expected ':'");
+                        ++pos_;
+                        skip_ws();
+                        out.obj.emplace_back(std::move(key), JsonValue{});
+                        if (!parse_value(out.obj.back().second, depth + 1)) return false;
+                        skip_ws();
+                        if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+                        if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+                        return fail("expected ',' or '}'");
+                    }
+                }
+                if (c == '[') {
+                    out.type = JsonValue::Type::Array;
+                    ++pos_;
+                    skip_ws();
+                    if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+                    while (true) {
+                        skip_ws();
+                        out.arr.emplace_back();
+                        if (!parse_value(out.arr.back(), depth + 1)) return false;
+                        skip_ws();
+                        if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+                        if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+                        return fail("expected ',' or ']'");
+                    }
+                }
+                if (c == '"') {
+                    out.type = JsonValue::Type::String;
+                    return parse_string(out.str);
+                }
+                if (c == 't') { out.type = JsonValue::Type::Bool; out.boolean = true;  return literal("true"); }
+                if (c == 'f') { out.type = JsonValue::Type::Bool; out.boolean = false; return literal("false"); }
+                if (c == 'n') { out.type = JsonValue::Type::Null; return literal("null"); }
+                if (c == '-' || (c >= '0' && c <= '9')) {
+                    size_t start = pos_;
+                    ++pos_;
+                    while (pos_ < s_.size()) {
+                        char d = s_[pos_];
+                        if ((d >= '0' && d <= '9') || d == '.' || d == 'e' || d == 'E' || d == '+' || d == '-') {
+                            ++pos_;
+                        } else {
+                            break;
+                        }
+                    }
+                    out.type = JsonValue::Type::Number;
+                    out.str = s_.substr(start, pos_ - start);
+                    return true;
+                }
+                return fail("unexpected character");
+            }
+        };
+
+        // Compact re-serialization, used for enum/const literals
+        void to_json(const JsonValue& v, std::string& out) {
+            switch (v.type) {
+                case JsonValue::Type::Null:   out += "null"; break;
+                case JsonValue::Type::Bool:   out += v.boolean ? "true" : "false"; break;
+                case JsonValue::Type::Number: out += v.str; break;
+                case JsonValue::Type::String:
+                    out += '"';
+                    out += json_escape(v.str);
+                    out += '"';
+                    break;
+                case JsonValue::Type::Array:
+                    out += '[';
+                    for (size_t i = 0; i < v.arr.size(); ++i) {
+                        if (i) out += ',';
+                        to_json(v.arr[i], out);
+                    }
+                    out += ']';
+                    break;
+                case JsonValue::Type::Object:
+                    out += '{';
+                    for (size_t i = 0; i < v.obj.size(); ++i) {
+                        if (i) out += ',';
+                        out += '"';
+                        out += json_escape(v.obj[i].first);
+                        out += "\":";
+                        to_json(v.obj[i].second, out);
+                    }
+                    out += '}';
+                    break;
+            }
+        }
+
+/* --------------------------------------------------------------------
+ *  GBNF helpers
+ * -------------------------------------------------------------------- */
+
+        // Quote text as a GBNF string literal
+        std::string gbnf_literal(const std::string& s) {
+            std::string out;
+            out.reserve(s.size() + 2);
+            out += '"';
+            for (char c : s) {
+                switch (c) {
+                    case '"':  out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n";  break;
+                    case '\r': out += "\\r";  break;
+                    case '\t': out += "\\t";  break;
+                    default:   out += c;
+                }
+            }
+            out += '"';
+            return out;
+        }
+
+        // GBNF rule names only allow [a-zA-Z0-9-]
+        std::string sanitize_rule_name(const std::string& hint) {
+            std::string out;
+            out.reserve(hint.size());
+            for (char c : hint) {
+                bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+                if (ok) {
+                    out += c;
+                } else if (!out.empty() && out.back() != '-') {
+                    out += '-';
+                }
+            }
+            while (!out.empty() && out.back() == '-') out.pop_back();
+            return out.empty() ? "r" : out;
+        }
+
+        std::string repetition(long long min, long long max) {
+            if (max < 0) {
+                if (min == 0) return "*";
+                if (min == 1) return "+";
+                return "{" + std::to_string(min) + ",}";
+            }
+            if (min == 0 && max == 1) return "?";
+            if (min == max) return "{" + std::to_string(min) + "}";
+            return "{" + std::to_string(min) + "," + std::to_string(max) + "}";
+        }
+
+        // Shared building blocks, emitted only when referenced
+        struct PrimitiveRule {
+            const char* name;
+            const char* body;
+            const char* deps[6];
+        };
+
+        const PrimitiveRule kPrimitives[] = {
+            {"ws",            "| \" \" | \"\\n\" [ \\t]{0,20}", {}},
+            {"char",          "[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\/bfnrt] | \"u\" [0-9a-fA-F]{4})", {}},
+            {"string",        "\"\\\"\" char* \"\\\"\" ws", {"char", "ws"}},
+            {"integral-part", "[0] | [1-9] [0-9]{0,15}", {}},
+            {"decimal-part",  "[0-9]{1,16}", {}},
+            {"number",        "\"-\"? integral-part (\".\" decimal-part)? ([eE] [-+]? integral-part)? ws",
+                              {"integral-part", "decimal-part", "ws"}},
+            {"integer",       "\"-\"? integral-part ws", {"integral-part", "ws"}},
+            {"boolean",       "(\"true\" | \"false\") ws", {"ws"}},
+            {"null",          "\"null\" ws", {"ws"}},
+            {"value",         "object | array | string | number | boolean | null",
+                              {"object", "array", "string", "number", "boolean", "null"}},
+            {"object",        "\"{\" ws ( string \":\" ws value (\",\" ws string \":\" ws value)* )? \"}\" ws",
+                              {"string", "value", "ws"}},
+            {"array",         "\"[\" ws ( value (\",\" ws value)* )? \"]\" ws", {"value", "ws"}},
+            {"date",          "[0-9]{4} \"-\" ( \"0\" [1-9] | \"1\" [0-2] ) \"-\" ( \"0\" [1-9] | [1-2] [0-9] | \"3\" [0-1] )", {}},
+            {"time",          "( [01] [0-9] | \"2\" [0-3] ) \":\" [0-5] [0-9] \":\" [0-5] [0-9] ( \".\" [0-9]{3} )? "
+                              "( \"Z\" | [+-] ( [01] [0-9] | \"2\" [0-3] ) \":\" [0-5] [0-9] )", {}},
+            {"date-time",     "date \"T\" time", {"date", "time"}},
+            {"uuid",          "[0-9a-fA-F]{8} \"-\" [0-9a-fA-F]{4} \"-\" [0-9a-fA-F]{4} \"-\" [0-9a-fA-F]{4} \"-\" [0-9a-fA-F]{12}", {}},
+        };
+
+/* --------------------------------------------------------------------
+ *  Regex (JSON Schema "pattern") -> GBNF
+ *
+ *  Handles literals, escapes (\d \w \s and escaped punctuation),
+ *  character classes, '.', groups, alternation and the quantifiers
+ *  * + ? {n} {n,} {n,m}. Anchors are implicit. Backreferences and
+ *  lookaround are rejected so the caller can fall back to a plain
+ *  string.
+ * -------------------------------------------------------------------- */
+        class PatternTranslator {
+        public:
+            explicit PatternTranslator(const std::string& p) : p_(p) {}
+
+            bool translate(std::string& out) {
+                if (!p_.empty() && p_[0] == '^') ++pos_;
+                out = parse_alternation();
+                if (pos_ + 1 == p_.size() && p_[pos_] == '$') ++pos_;
+                if (!ok_ || pos_ != p_.size()) return false;
+                return true;
+            }
+
+        private:
+            const std::string& p_;
+            size_t pos_ = 0;
+            bool ok_ = true;
+
+            bool at_end() const {
+                // A trailing '$' is an anchor, not a literal
+                return pos_ >= p_.size() || (p_[pos_] == '$' && pos_ + 1 == p_.size());
+            }
+
+            std::string parse_alternation() {
+                std::vector<std::string> alts;
+                alts.push_back(parse_sequence());
+                while (ok_ && pos_ < p_.size() && p_[pos_] == '|') {
+                    ++pos_;
+                    alts.push_back(parse_sequence());
+                }
+                if (alts.size() == 1) return alts[0];
+
+                std::string out = "(";
+                for (size_t i = 0; i < alts.size(); ++i) {
+                    if (i) out += " | ";
+                    out += alts[i].empty() ? "\"\"" : alts[i];
+                }
+                out += ")";
+                return out;
+            }
+
+            bool is_quantifier_at(size_t i) const {
+                if (i >= p_.size()) return false;
+                char c = p_[i];
+                if (c == '*' || c == '+' || c == '?') return true;
+                if (c != '{') return false;
+                size_t j = i + 1;
+                if (j >= p_.size() || p_[j] < '0' || p_[j] > '9') return false;
+                return p_.find('}', j) != std::string::npos;
+            }
+
+            std::string parse_quantifier() {
+                char c = p_[pos_];
+                std::string q;
+                if (c == '{') {
+                    size_t close = p_.find('}', pos_);
+                    q = p_.substr(pos_, close - pos_ + 1);
+                    pos_ = close + 1;
+                } else {
+                    q = std::string(1, c);
+                    ++pos_;
+                }
+                // Lazy/possessive modifiers don't change the language
+                if (pos_ < p_.size() && (p_[pos_] == '?' || p_[pos_] == '+')) ++pos_;
+                return q;
+            }
+
+            std::string parse_sequence() {
+                std::vector<std::string> items;
+                std::string pending_literal;
+
+                auto flush = [&]() {
+                    if (!pending_literal.empty()) {
+                        items.push_back(gbnf_literal(json_escape(pending_literal)));
+                        pending_literal.clear();
+                    }
+                };
+
+                while (ok_ && !at_end() && p_[pos_] != '|' && p_[pos_] != ')') {
+                    std::string atom;
+                    std::string literal_char;
+                    char c = p_[pos_];
+
+                    if (c == '(') {
+                        ++pos_;
+                        if (pos_ < p_.size() && p_[pos_] == '?') {
+                            if (pos_ + 1 < p_.size() && p_[pos_ + 1] == ':') {
+                                pos_ += 2;
+                            } else {
+                                ok_ = false; // lookaround / named groups
+                                break;
+                            }
+                        }
+                        std::string inner = parse_alternation();
+                        if (pos_ >= p_.size() || p_[pos_] != ')') { ok_ = false; break; }
+                        ++pos_;
+                        atom = "(" + (inner.empty() ? std::string("\"\"") : inner) + ")";
+                    } else if (c == '[') {
+                        atom = parse_class();
+                    } else if (c == '.') {
+                        ++pos_;
+                        atom = "char";
+                    } else if (c == '\\') {
+                        if (pos_ + 1 >= p_.size()) { ok_ = false; break; }
+                        char e = p_[pos_ + 1];
+                        pos_ += 2;
+                        switch (e) {
+                            case 'd': atom = "[0-9]"; break;
+                            case 'D': atom = "[^0-9\"\\\\\\x00-\\x1F]"; break;
+                            case 'w': atom = "[a-zA-Z0-9_]"; break;
+                            case 'W': atom = "[^a-zA-Z0-9_\"\\\\\\x00-\\x1F]"; break;
+                            case 's': atom = "[ ]"; break;
+                            case 'S': atom = "[^ \"\\\\\\x00-\\x1F]"; break;
+                            case 'n': literal_char = "\n"; break;
+                            case 't': literal_char = "\t"; break;
+                            default:
+                                // Backreferences, \b, \B, \p{...}, ...: no GBNF equivalent
+                                if (std::isalnum(static_cast<unsigned char>(e))) { ok_ = false; break; }
+                                literal_char = std::string(1, e);
+                        }
+                    } else if (c == '*' || c == '+' || c == '?' || c == '{') {
+                        if (c == '{' && !is_quantifier_at(pos_)) {
+                            literal_char = "{";
+                            ++pos_;
+                        } else {
+                            ok_ = false; // dangling quantifier
+                            break;
+                        }
+                    } else {
+                        literal_char = std::string(1, c);
+                        ++pos_;
+                        // Keep multi-byte UTF-8 sequences together
+                        while (pos_ < p_.size() && (static_cast<unsigned char>(p_[pos_]) & 0xC0) == 0x80) {
+                            literal_char += p_[pos_++];
+                        }
+                    }
+                    if (!ok_) break;
+
+                    const bool quantified = is_quantifier_at(pos_);
+                    if (!literal_char.empty() && !quantified) {
+                        pending_literal += literal_char;
+                        continue;
+                    }
+
+                    flush();
+                    if (!literal_char.empty()) atom = gbnf_literal(json_escape(literal_char));
+                    if (quantified) atom += parse_quantifier();
+                    items.push_back(atom);
+                }
+                flush();
+
+                std::string out;
+                for (size_t i = 0; i < items.size(); ++i) {
+                    if (i) out += ' ';
+                    out += items[i];
+                }
+                return out;
+            }
+
+            std::string parse_class() {
+                ++pos_; // '['
+                std::string out = "[";
+                bool negated = false;
+                if (pos_ < p_.size() && p_[pos_] == '^') {
+                    negated = true;
+                    out += '^';
+                    ++pos_;
+                }
+                bool first = true;
+                while (pos_ < p_.size() && (p_[pos_] != ']' || first)) {
+                    first = false;
+                    char c = p_[pos_];
+                    if (c == '\\' && pos_ + 1 < p_.size()) {
+                        char e = p_[pos_ + 1];
+                        pos_ += 2;
+                        switch (e) {
+                            case 'd': out += "0-9"; break;
+                            case 'w': out += "a-zA-Z0-9_"; break;
+                            case 's': out += " "; break;
+                            case 'n': case 't': break; // not representable unescaped in JSON
+                            case '"': case '\\': break;
+                            default:
+                                // \D \W \S (a negated set inside a set), \b, \p{...}, ...
+                                if (std::isalnum(static_cast<unsigned char>(e))) {
+                                    ok_ = false;
+                                    return {};
+                                }
+                                out += class_char(e);
+                        }
+                        continue;
+                    }
+                    ++pos_;
+                    // Quotes and backslashes would need JSON escaping inside the string
+                    if (c == '"' || c == '\\') continue;
+                    out += c == ']' ? class_char(c) : std::string(1, c);  // ']' first is literal
+                }
+                if (pos_ >= p_.size()) {
+                    ok_ = false;
+                    return {};
+                }
+                ++pos_; // ']'
+                if (negated) out += "\"\\\\\\x00-\\x1F";
+                out += ']';
+                return out;
+            }
+
+            // GBNF only knows \x \u \U \t \r \n \\ \" \[ \] inside a class;
+            // characters that are special there are written as \xNN
+            static std::string class_char(char c) {
+                if (c != ']' && c != '[' && c != '\\' && c != '^' && c != '-') return std::string(1, c);
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "\\x%02X", static_cast<unsigned char>(c));
+                return hex;
+            }
+        };
+
+/* --------------------------------------------------------------------
+ *  Schema compiler
+ * -------------------------------------------------------------------- */
+        class SchemaCompiler {
+        public:
+            explicit SchemaCompiler(const JsonValue& root) : root_(root) {
+                for (const auto& p : kPrimitives) names_.insert(p.name);
+                names_.insert("root");
+            }
+
+            bool compile(std::string& out, std::string& err) {
+                std::string root_expr = visit(root_, "root", 0);
+                if (!ok_) {
+                    err = err_;
+                    return false;
+                }
+
+                out = "root ::= " + root_expr + "\n";
+                for (const auto& r : rules_) {
+                    out += r.first + " ::= " + r.second + "\n";
+                }
+                for (const auto& p : kPrimitives) {
+                    if (used_primitives_.count(p.name)) {
+                        out += std::string(p.name) + " ::= " + p.body + "\n";
+                    }
+                }
+                return true;
+            }
+
+        private:
+            static constexpr int kMaxDepth = 48;
+
+            const JsonValue& root_;
+            std::vector<std::pair<std::string, std::string>> rules_;
+            std::unordered_map<std::string, std::string> body_to_name_;
+            std::set<std::string> names_;
+            std::set<std::string> used_primitives_;
+            std::unordered_map<std::string, std::string> ref_rules_;
+            std::deque<JsonValue> owned_;   // synthesized schemas (allOf merges)
+            bool ok_ = true;
+            std::string err_;
+
+            std::string fail(const std::string& msg) {
+                if (ok_) {
+                    ok_ = false;
+                    err_ = msg;
+                }
+                return "value";
+            }
+
+            std::string use(const char* primitive) {
+                if (used_primitives_.insert(primitive).second) {
+                    for (const auto& p : kPrimitives) {
+                        if (std::string(p.name) != primitive) continue;
+                        for (const char* dep : p.deps) {
+                            if (dep) use(dep);
+                        }
+                    }
+                }
+                return primitive;
+            }
+
+            std::string unique_name(const std::string& hint) {
+                std::string base = sanitize_rule_name(hint);
+                std::string name = base;
+                for (int i = 1; names_.count(name); ++i) {
+                    name = base + "-" + std::to_string(i);
+                }
+                names_.insert(name);
+                return name;
+            }
+
+            // Add a rule, reusing an existing one with an identical body
+            std::string add_rule(const std::string& hint, const std::string& body) {
+                auto it = body_to_name_.find(body);
+                if (it != body_to_name_.end()) return it->second;
+                std::string name = unique_name(hint);
+                rules_.emplace_back(name, body);
+                body_to_name_.emplace(body, name);
+                return name;
+            }
+
+            const JsonValue* resolve_ref(const std::string& ref) {
+                if (ref.empty() || ref[0] != '#') return nullptr;
+                const JsonValue* cur = &root_;
+                size_t pos = 1;
+                while (pos < ref.size()) {
+                    if (ref[pos] != '/') return nullptr;
+                    size_t next = ref.find('/', pos + 1);
+                    std::string seg = ref.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+                    // JSON pointer escapes
+                    std::string key;
+                    for (size_t i = 0; i < seg.size(); ++i) {
+                        if (seg[i] == '~' && i + 1 < seg.size()) {
+                            key += (seg[i + 1] == '1') ? '/' : '~';
+                            ++i;
+                        } else {
+                            key += seg[i];
+                        }
+                    }
+                    cur = cur->get(key.c_str());
+                    if (!cur) return nullptr;
+                    pos = (next == std::string::npos) ? ref.size() : next;
+                }
+                return cur;
+            }
+
+            std::string visit_ref(const std::string& ref, int depth) {
+                auto it = ref_rules_.find(ref);
+                if (it != ref_rules_.end()) return it->second;
+
+                const JsonValue* target = resolve_ref(ref);
+                if (!target) return fail("unresolvable $ref: " + ref);
+
+                size_t slash = ref.rfind('/');
+                std::string hint = (ref == "#") ? "root-ref" : "ref-" + ref.substr(slash + 1);
+
+                // Register the name before visiting so recursive schemas terminate
+                std::string name = unique_name(hint);
+                ref_rules_.emplace(ref, name);
+                std::string body = visit(*target, name, depth + 1);
+                rules_.emplace_back(name, body);
+                return name;
+            }
+
+            std::string visit(const JsonValue& schema, const std::string& hint, int depth) {
+                if (!ok_) return "value";
+                if (depth > kMaxDepth) return fail("schema nested too deeply");
+
+                if (schema.type == JsonValue::Type::Bool || !schema.is_object() || schema.obj.empty()) {
+                    return use("value");
+                }
+
+                if (const JsonValue* ref = schema.get("$ref")) {
+                    if (ref->is_string()) return visit_ref(ref->str, depth);
+                }
+
+                if (const JsonValue* c = schema.get("const")) {
+                    std::string lit;
+                    to_json(*c, lit);
+                    use("ws");
+                    return add_rule(hint, gbnf_literal(lit) + " ws");
+                }
+
+                if (const JsonValue* e = schema.get("enum")) {
+                    if (e->is_array() && !e->arr.empty()) {
+                        std::string body = "(";
+                        for (size_t i = 0; i < e->arr.size(); ++i) {
+                            std::string lit;
+                            to_json(e->arr[i], lit);
+                            if (i) body += " | ";
+                            body += gbnf_literal(lit);
+                        }
+                        body += ") ws";
+                        use("ws");
+                        return add_rule(hint, body);
+                    }
+                }
+
+                const JsonValue* any_of = schema.get("anyOf");
+                if (!any_of) any_of = schema.get("oneOf");
+                if (any_of && any_of->is_array() && !any_of->arr.empty()) {
+                    std::string body;
+                    for (size_t i = 0; i < any_of->arr.size(); ++i) {
+                        if (i) body += " | ";
+                        body += visit(any_of->arr[i], hint + "-" + std::to_string(i), depth + 1);
+                    }
+                    return add_rule(hint, body);
+                }
+
+                if (const JsonValue* all_of = schema.get("allOf")) {
+                    if (all_of->is_array() && !all_of->arr.empty()) {
+                        return visit(merge_all_of(schema, *all_of), hint, depth + 1);
+                    }
+                }
+
+                const JsonValue* type = schema.get("type");
+                if (type && type->is_array()) {
+                    std::string body;
+                    for (size_t i = 0; i < type->arr.size(); ++i) {
+                        if (!type->arr[i].is_string()) continue;
+                        if (!body.empty()) body += " | ";
+                        body += visit_typed(schema, type->arr[i].str, hint + "-" + type->arr[i].str, depth);
+                    }
+                    return body.empty() ? use("value") : add_rule(hint, body);
+                }
+
+                std::string t;
+                if (type && type->is_string()) {
+                    t = type->str;
+                } else if (schema.get("properties") || schema.get("additionalProperties")) {
+                    t = "object";
+                } else if (schema.get("items") || schema.get("prefixItems")) {
+                    t = "array";
+                } else if (schema.get("pattern") || schema.get("format")) {
+                    t = "string";
+                } else {
+                    return use("value");
+                }
+                return visit_typed(schema, t, hint, depth);
+            }
+
+            // Merge allOf members (following $ref) into one object schema
+            const JsonValue& merge_all_of(const JsonValue& schema, const JsonValue& all_of) {
+                owned_.emplace_back();
+                JsonValue& merged = owned_.back();
+                merged.type = JsonValue::Type::Object;
+
+                JsonValue props;
+                props.type = JsonValue::Type::Object;
+                JsonValue required;
+                required.type = JsonValue::Type::Array;
+
+                auto absorb = [&](const JsonValue& s) {
+                    const JsonValue* cur = &s;
+                    for (int hops = 0; hops < 8; ++hops) {
+                        const JsonValue* ref = cur->get("$ref");
+                        if (!ref || !ref->is_string()) break;
+                        const JsonValue* target = resolve_ref(ref->str);
+                        if (!target) break;
+                        cur = target;
+                    }
+                    if (const JsonValue* p = cur->get("properties")) {
+                        for (const auto& kv : p->obj) props.obj.push_back(kv);
+                    }
+                    if (const JsonValue* r = cur->get("required")) {
+                        for (const auto& v : r->arr) required.arr.push_back(v);
+                    }
+                    for (const auto& kv : cur->obj) {
+                        if (kv.first != "properties" && kv.first != "required" &&
+                            kv.first != "allOf" && kv.first != "$ref" && !merged.get(kv.first.c_str())) {
+                            merged.obj.push_back(kv);
+                        }
+                    }
+                };
+
+                absorb(schema);
+                for (const auto& member : all_of.arr) absorb(member);
+
+                if (!props.obj.empty()) {
+                    merged.obj.emplace_back("properties", std::move(props));
+                    if (!merged.get("type")) {
+                        JsonValue t;
+                        t.type = JsonValue::Type::String;
+                        t.str = "object";
+                        merged.obj.emplace_back("type", std::move(t));
+                    }
+                }
+                if (!required.arr.empty()) merged.obj.emplace_back("required", std::move(required));
+                return merged;
+            }
+
+            std::string visit_typed(const JsonValue& schema, const std::string& t,
+                                    const std::string& hint, int depth) {
+                if (t == "string")  return visit_string(schema, hint);
+                if (t == "number")  return use("number");
+                if (t == "integer") return use("integer");
+                if (t == "boolean") return use("boolean");
+                if (t == "null")    return use("null");
+                if (t == "object")  return visit_object(schema, hint, depth);
+                if (t == "array")   return visit_array(schema, hint, depth);
+                return fail("unsupported type: " + t);
+            }
+
+            std::string visit_string(const JsonValue& schema, const std::string& hint) {
+                use("ws");
+
+                if (const JsonValue* pattern = schema.get("pattern")) {
+                    if (pattern->is_string()) {
+                        std::string expr;
+                        PatternTranslator translator(pattern->str);
+                        if (translator.translate(expr)) {
+                            if (expr.find("char") != std::string::npos) use("char");
+                            return add_rule(hint, "\"\\\"\" " + (expr.empty() ? std::string("\"\"") : expr) +
+                                                  " \"\\\"\" ws");
+                        }
+                        // Unsupported regex construct: fall through to a plain string
+                    }
+                }
+
+                if (const JsonValue* format = schema.get("format")) {
+                    if (format->is_string()) {
+                        const std::string& f = format->str;
+                        if (f == "date" || f == "time" || f == "date-time" || f == "uuid") {
+                            return add_rule(f + "-string", "\"\\\"\" " + use(f.c_str()) + " \"\\\"\" ws");
+                        }
+                    }
+                }
+
+                long long min_len = schema.get_int("minLength", 0);
+                long long max_len = schema.get_int("maxLength", -1);
+                if (min_len > 0 || max_len >= 0) {
+                    use("char");
+                    return add_rule(hint, "\"\\\"\" char" + repetition(min_len, max_len) + " \"\\\"\" ws");
+                }
+
+                return use("string");
+            }
+
+            std::string visit_object(const JsonValue& schema, const std::string& hint, int depth) {
+                const JsonValue* props = schema.get("properties");
+                const JsonValue* additional = schema.get("additionalProperties");
+
+                std::set<std::string> required;
+                if (const JsonValue* r = schema.get("required")) {
+                    for (const auto& v : r->arr) {
+                        if (v.is_string()) required.insert(v.str);
+                    }
+                }
+
+                const bool has_props = props && props->is_object() && !props->obj.empty();
+
+                // Extra keys: explicit schema/true allows them; when properties are
+                // declared and additionalProperties is absent, keep output closed.
+                std::string extra_kv;
+                if (additional && additional->is_object()) {
+                    std::string val = visit(*additional, hint + "-additional", depth + 1);
+                    extra_kv = add_rule(hint + "-additional-kv", use("string") + " \":\" ws " + val);
+                } else if ((additional && additional->type == JsonValue::Type::Bool && additional->boolean) ||
+                           (!additional && !has_props)) {
+                    if (!has_props) return use("object");
+                    extra_kv = add_rule("additional-kv", use("string") + " \":\" ws " + use("value"));
+                }
+                use("ws");
+
+                std::vector<std::string> req_kvs;
+                std::vector<std::string> opt_kvs;
+                if (has_props) {
+                    for (const auto& kv : props->obj) {
+                        std::string prop_hint = hint + "-" + kv.first;
+                        std::string val = visit(kv.second, prop_hint, depth + 1);
+                        std::string key = gbnf_literal("\"" + json_escape(kv.first) + "\"");
+                        std::string rule = add_rule(prop_hint + "-kv", key + " ws \":\" ws " + val);
+                        (required.count(kv.first) ? req_kvs : opt_kvs).push_back(rule);
+                    }
+                }
+
+                std::string extra_tail = extra_kv.empty() ? "" : " (\",\" ws " + extra_kv + ")*";
+                std::string body = "\"{\" ws ";
+
+                if (!req_kvs.empty()) {
+                    for (size_t i = 0; i < req_kvs.size(); ++i) {
+                        if (i) body += " \",\" ws ";
+                        body += req_kvs[i];
+                    }
+                    for (const auto& o : opt_kvs) body += " (\",\" ws " + o + ")?";
+                    body += extra_tail;
+                } else if (!opt_kvs.empty() || !extra_kv.empty()) {
+                    // All optional: any subset, in declaration order
+                    std::string alts;
+                    for (size_t i = 0; i < opt_kvs.size(); ++i) {
+                        if (!alts.empty()) alts += " | ";
+                        alts += opt_kvs[i];
+                        for (size_t j = i + 1; j < opt_kvs.size(); ++j) {
+                            alts += " (\",\" ws " + opt_kvs[j] + ")?";
+                        }
+                        alts += extra_tail;
+                    }
+                    if (!extra_kv.empty()) {
+                        if (!alts.empty()) alts += " | ";
+                        alts += extra_kv + extra_tail;
+                    }
+                    body += "( " + alts + " )?";
+                }
+
+                body += " \"}\" ws";
+                return add_rule(hint, body);
+            }
+
+            std::string visit_array(const JsonValue& schema, const std::string& hint, int depth) {
+                use("ws");
+
+                const JsonValue* prefix = schema.get("prefixItems");
+                if (prefix && prefix->is_array() && !prefix->arr.empty()) {
+                    std::string body = "\"[\" ws ";
+                    for (size_t i = 0; i < prefix->arr.size(); ++i) {
+                        if (i) body += " \",\" ws ";
+                        body += visit(prefix->arr[i], hint + "-" + std::to_string(i), depth + 1);
+                    }
+                    body += " \"]\" ws";
+                    return add_rule(hint, body);
+                }
+
+                const JsonValue* items = schema.get("items");
+                std::string item = items ? visit(*items, hint + "-item", depth + 1) : use("value");
+
+                long long min_items = schema.get_int("minItems", 0);
+                long long max_items = schema.get_int("maxItems", -1);
+                if (max_items >= 0 && max_items < min_items) {
+                    return fail("maxItems < minItems in " + hint);
+                }
+
+                std::string list;
+                if (max_items == 0) {
+                    list = "";
+                } else if (min_items == 0) {
+                    list = "( " + item + " (\",\" ws " + item + ")" +
+                           repetition(0, max_items < 0 ? -1 : max_items - 1) + " )?";
+                } else {
+                    list = item + " (\",\" ws " + item + ")" +
+                           repetition(min_items - 1, max_items < 0 ? -1 : max_items - 1);
+                }
+
+                std::string body = "\"[\" ws ";
+                if (!list.empty()) body += list + " ";
+                body += "\"]\" ws";
+                return add_rule(hint, body);
+            }
+        };
+
+/* --------------------------------------------------------------------
+ *  Compiled grammar cache (keyed by schema hash)
+ * -------------------------------------------------------------------- */
+        constexpr size_t kMaxCachedGrammars = 16;
+
+        struct CacheEntry {
+            uint64_t hash;
+            std::string schema;
+            std::string grammar;
+        };
+
+        std::mutex g_cache_mtx;
+        std::list<CacheEntry> g_cache;   // front = most recently used
+
+    } // anonymous namespace
+
+/* --------------------------------------------------------------------
+ *  Public API
+ * -------------------------------------------------------------------- */
+    uint64_t json_schema_hash(const std::string& schema_json) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : schema_json) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    std::string build_json_schema_grammar(const std::string& schema_json, std::string* error) {
+        std::string err;
+        JsonValue root;
+        JsonParser parser(schema_json);
+        if (!parser.parse(root, err)) {
+            if (error) *error = "invalid schema JSON: " + err;
+            return {};
+        }
+
+        // OpenAI response_format wrapper: { "name": ..., "schema": {...} }
+        const JsonValue* schema = &root;
+        if (const JsonValue* inner = root.get("schema")) {
+            if (inner->is_object() && !root.get("type") && !root.get("properties")) {
+                schema = inner;
+            }
+        }
+
+        std::string grammar;
+        SchemaCompiler compiler(*schema);
+        if (!compiler.compile(grammar, err)) {
+            if (error) *error = err;
+            return {};
+        }
+        return grammar;
+    }
+
+    std::string build_json_schema_grammar_cached(const std::string& schema_json, std::string* error) {
+        const uint64_t h = json_schema_hash(schema_json);
+        {
+            std::lock_guard<std::mutex> lk(g_cache_mtx);
+            for (auto it = g_cache.begin(); it != g_cache.end(); ++it) {
+                if (it->hash == h && it->schema == schema_json) {
+                    g_cache.splice(g_cache.begin(), g_cache, it);
+                    return g_cache.front().grammar;
+                }
+            }
+        }
+
+        std::string grammar = build_json_schema_grammar(schema_json, error);
+        if (grammar.empty()) return grammar;
+
+        std::lock_guard<std::mutex> lk(g_cache_mtx);
+        g_cache.push_front({h, schema_json, grammar});
+        if (g_cache.size() > kMaxCachedGrammars) g_cache.pop_back();
+        return grammar;
+    }
+
+} // namespace chat
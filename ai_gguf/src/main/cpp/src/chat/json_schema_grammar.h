@@ -0,0 +1,53 @@
+/*=============================================================
+ *   chat/json_schema_grammar.h
+ *=============================================================
+ *
+ *  JSON Schema -> GBNF compiler for structured output
+ *  (OpenAI-style `response_format: { type: json_schema }`).
+ *
+ *  Supported keywords:
+ *  - type (single or array), enum, const
+ *  - object: properties, required, additionalProperties
+ *  - array:  items, prefixItems, minItems, maxItems
+ *  - string: pattern (regex subset), minLength, maxLength,
+ *            format (date, time, date-time, uuid)
+ *  - anyOf / oneOf, allOf (object schemas are merged)
+ *  - $ref to "#", "#/definitions/..." and "#/$defs/..."
+ *
+ *  Unsupported keywords are ignored (the value is still valid
+ *  JSON of the declared type). Compiled grammars are cached by
+ *  a 64-bit hash of the schema text so switching between a few
+ *  schemas does not re-run the compiler.
+ *============================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace chat {
+
+    /**
+     * Compile a JSON Schema document into a GBNF grammar with a `root` rule.
+     *
+     * @param schema_json JSON Schema text
+     * @param error       Optional: receives a description on failure
+     * @return GBNF grammar, or empty string if the schema could not be parsed
+     */
+    std::string build_json_schema_grammar(const std::string& schema_json,
+                                          std::string* error = nullptr);
+
+    /**
+     * Same as build_json_schema_grammar(), but memoized by schema hash.
+     * Thread-safe. The cache is bounded; least recently used entries
+     * are evicted first.
+     */
+    std::string build_json_schema_grammar_cached(const std::string& schema_json,
+                                                 std::string* error = nullptr);
+
+    /**
+     * FNV-1a 64-bit hash of the schema text (cache key)
+     */
+    uint64_t json_schema_hash(const std::string& schema_json);
+
+} // namespace chat
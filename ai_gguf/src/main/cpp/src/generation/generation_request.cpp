@@ -0,0 +1,85 @@
+#include "generation_request.h"
+
+#include <algorithm>
+
+const char* request_state_name(RequestState s) {
+    switch (s) {
+        case RequestState::Queued:     return "queued";
+        case RequestState::Prefilling: return "prefilling";
+        case RequestState::Decoding:   return "decoding";
+        case RequestState::Done:       return "done";
+        case RequestState::Cancelled:  return "cancelled";
+        case RequestState::TimedOut:   return "timed_out";
+        case RequestState::Failed:     return "failed";
+    }
+    return "unknown";
+}
+
+GenerationRequest::GenerationRequest(uint64_t handle, int64_t timeout_ms)
+        : handle_(handle),
+          has_deadline_(timeout_ms > 0),
+          deadline_(Clock::now() + std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0))) {}
+
+// ============================================================================
+// REGISTRY
+// ============================================================================
+
+std::shared_ptr<GenerationRequest> RequestRegistry::create(int64_t timeout_ms) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    prune_locked();
+
+    auto req = std::make_shared<GenerationRequest>(next_handle_++, timeout_ms);
+    requests_.push_back(req);
+    return req;
+}
+
+std::shared_ptr<GenerationRequest> RequestRegistry::find(uint64_t handle) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& req : requests_) {
+        if (req->handle() == handle) return req;
+    }
+    return nullptr;
+}
+
+bool RequestRegistry::cancel(uint64_t handle) {
+    std::shared_ptr<GenerationRequest> req = find(handle);
+    if (!req || is_finished(req->state())) return false;
+    req->cancel();
+    return true;
+}
+
+size_t RequestRegistry::cancel_all() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t n = 0;
+    for (const auto& req : requests_) {
+        if (is_finished(req->state())) continue;
+        req->cancel();
+        ++n;
+    }
+    return n;
+}
+
+void RequestRegistry::release(uint64_t handle) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    requests_.erase(std::remove_if(requests_.begin(), requests_.end(),
+                                   [handle](const auto& req) { return req->handle() == handle; }),
+                    requests_.end());
+}
+
+void RequestRegistry::prune_locked() {
+    size_t finished = 0;
+    for (const auto& req : requests_) {
+        if (is_finished(req->state())) ++finished;
+    }
+    if (finished <= MAX_FINISHED) return;
+
+    // Drop the oldest finished requests; unfinished ones always stay
+    size_t excess = finished - MAX_FINISHED;
+    requests_.erase(std::remove_if(requests_.begin(), requests_.end(),
+                                   [&excess](const auto& req) {
+                                       if (excess == 0 || !is_finished(req->state())) return false;
+                                       --excess;
+                                       return true;
+                                   }),
+                    requests_.end());
+}
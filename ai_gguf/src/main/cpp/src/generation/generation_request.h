@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * Per-request generation control.
+ *
+ * Every generate call, blocking or async, runs under its own
+ * GenerationRequest: a cancel flag, an optional deadline and a lifecycle
+ * state. The generation loop polls should_stop() while queued, between
+ * prefill chunks and before each decode step, so
+ * - cancelling one request never touches another,
+ * - a cancel issued while a request is still queued is not lost,
+ * - a request that expires or is cancelled in the queue never runs.
+ *
+ * Requests are looked up by a 64-bit handle (never 0, never reused) that
+ * the Kotlin side holds as a Long.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * LoRA adapters and scales a request runs with (adapter name, scale)
+ */
+using LoraMix = std::vector<std::pair<std::string, float>>;
+
+/**
+ * Lifecycle of a request. Values are shared with GGUFNativeLib.GenerationState.
+ */
+enum class RequestState : int32_t {
+    Queued     = 0,  // Waiting for the model
+    Prefilling = 1,  // Decoding the prompt
+    Decoding   = 2,  // Generating tokens
+    Done       = 3,  // Finished normally (EOS, stop string, tool call, max tokens)
+    Cancelled  = 4,
+    TimedOut   = 5,  // Deadline passed
+    Failed     = 6,
+};
+
+inline bool is_finished(RequestState s) {
+    return static_cast<int32_t>(s) >= static_cast<int32_t>(RequestState::Done);
+}
+
+const char* request_state_name(RequestState s);
+
+class GenerationRequest {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * `timeout_ms` <= 0 means no deadline. The deadline counts from
+     * creation, so time spent queued is included.
+     */
+    GenerationRequest(uint64_t handle, int64_t timeout_ms);
+
+    uint64_t handle() const { return handle_; }
+
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    bool cancel_requested() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    bool deadline_passed() const {
+        return has_deadline_ && Clock::now() >= deadline_;
+    }
+
+    /**
+     * True once the request should stop at the next check point
+     */
+    bool should_stop() const { return cancel_requested() || deadline_passed(); }
+
+    /**
+     * Final state for a request that stopped because of should_stop()
+     */
+    RequestState stopped_state() const {
+        return cancel_requested() ? RequestState::Cancelled : RequestState::TimedOut;
+    }
+
+    RequestState state() const {
+        return static_cast<RequestState>(state_.load(std::memory_order_acquire));
+    }
+
+    void set_state(RequestState s) {
+        state_.store(static_cast<int32_t>(s), std::memory_order_release);
+    }
+
+    /**
+     * Adapter mix captured at submit time, so a queued request is not
+     * affected by later setLoraAdapters() calls. Set before the request
+     * is handed to its generation thread.
+     */
+    const LoraMix& lora_mix() const { return lora_mix_; }
+    void set_lora_mix(LoraMix mix) { lora_mix_ = std::move(mix); }
+
+private:
+    const uint64_t handle_;
+    const bool has_deadline_;
+    const Clock::time_point deadline_;
+    std::atomic<bool> cancelled_{false};
+    std::atomic<int32_t> state_{static_cast<int32_t>(RequestState::Queued)};
+    LoraMix lora_mix_;
+};
+
+/**
+ * Live requests by handle. The lock is only taken to create, look up,
+ * cancel or release a request - never on the per-token path, which holds
+ * its own reference.
+ */
+class RequestRegistry {
+public:
+    std::shared_ptr<GenerationRequest> create(int64_t timeout_ms);
+
+    /**
+     * nullptr if the handle is unknown or was released
+     */
+    std::shared_ptr<GenerationRequest> find(uint64_t handle) const;
+
+    /**
+     * Cancel one request (queued or running). False if unknown or finished.
+     */
+    bool cancel(uint64_t handle);
+
+    /**
+     * Cancel every unfinished request; returns how many were cancelled
+     */
+    size_t cancel_all();
+
+    /**
+     * Forget a request. Its state can no longer be queried.
+     */
+    void release(uint64_t handle);
+
+private:
+    // Finished requests kept for state queries before the oldest are dropped
+    static constexpr size_t MAX_FINISHED = 32;
+
+    void prune_locked();
+
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<GenerationRequest>> requests_;  // Creation order
+    uint64_t next_handle_ = 1;
+};
@@ -0,0 +1,395 @@
+#include "generation_trace.h"
+#include "../utils/logger.h"
+
+#include <cstring>
+
+namespace trace {
+
+    namespace {
+
+        constexpr char kFileMagic[4] = {'A', 'G', 'T', 'R'};
+        constexpr char kSessionMagic[4] = {'S', 'E', 'S', 'S'};
+        constexpr uint16_t kVersion = 2;  // 2: LoRA adapter mix
+
+        // Sessions larger than this are treated as corruption
+        constexpr uint32_t kMaxSessionBytes = 256u * 1024u * 1024u;
+
+/* --------------------------------------------------------------------
+ *  Encoding
+ * -------------------------------------------------------------------- */
+        void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(v));
+        }
+
+        void put_signed(std::vector<uint8_t>& out, int64_t v) {
+            // Zigzag so small negative values (seed = -1) stay short
+            put_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+        }
+
+        void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+            for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+
+        void put_f32(std::vector<uint8_t>& out, float f) {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+
+        void put_string(std::vector<uint8_t>& out, const std::string& s) {
+            put_varint(out, s.size());
+            out.insert(out.end(), s.begin(), s.end());
+        }
+
+/* --------------------------------------------------------------------
+ *  Decoding (bounds-checked; any overrun marks the cursor bad)
+ * -------------------------------------------------------------------- */
+        struct Cursor {
+            const uint8_t* p;
+            const uint8_t* end;
+            bool ok = true;
+
+            uint64_t varint() {
+                uint64_t v = 0;
+                for (int shift = 0; shift < 64; shift += 7) {
+                    if (p >= end) { ok = false; return 0; }
+                    uint8_t b = *p++;
+                    v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                    if (!(b & 0x80)) return v;
+                }
+                ok = false;
+                return 0;
+            }
+
+            int64_t signed_varint() {
+                uint64_t v = varint();
+                return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+            }
+
+            uint64_t u64() {
+                if (end - p < 8) { ok = false; return 0; }
+                uint64_t v = 0;
+                for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+                p += 8;
+                return v;
+            }
+
+            float f32() {
+                if (end - p < 4) { ok = false; return 0.0f; }
+                uint32_t bits = 0;
+                for (int i = 0; i < 4; ++i) bits |= static_cast<uint32_t>(p[i]) << (8 * i);
+                p += 4;
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                return f;
+            }
+
+            uint8_t u8() {
+                if (p >= end) { ok = false; return 0; }
+                return *p++;
+            }
+
+            std::string string() {
+                uint64_t n = varint();
+                if (!ok || static_cast<uint64_t>(end - p) < n) { ok = false; return {}; }
+                std::string s(reinterpret_cast<const char*>(p), static_cast<size_t>(n));
+                p += n;
+                return s;
+            }
+        };
+
+        void encode_session(const SessionTrace& s, std::vector<uint8_t>& out) {
+            put_string(out, s.model_desc);
+            put_varint(out, static_cast<uint64_t>(s.n_vocab));
+            put_varint(out, static_cast<uint64_t>(s.n_ctx));
+
+            put_signed(out, s.sampler.topK);
+            put_f32(out, s.sampler.topP);
+            put_f32(out, s.sampler.temp);
+            put_f32(out, s.sampler.minP);
+            put_signed(out, s.sampler.mirostat);
+            put_f32(out, s.sampler.mirostatTau);
+            put_f32(out, s.sampler.mirostatEta);
+            put_signed(out, s.sampler.seed);
+
+            put_signed(out, s.max_tokens);
+            put_varint(out, s.stop_strings.size());
+            for (const auto& stop : s.stop_strings) put_string(out, stop);
+
+            uint8_t flags = 0;
+            if (s.tools_enabled) flags |= 0x01;
+            if (s.grammar_mode == GrammarMode::LAZY) flags |= 0x02;
+            if (s.typed_grammar) flags |= 0x04;
+            out.push_back(flags);
+            put_string(out, s.tools_json);
+            put_string(out, s.response_schema);
+            put_varint(out, s.lora_adapters.size());
+            for (const auto& lora : s.lora_adapters) {
+                put_string(out, lora.name);
+                put_string(out, lora.path);
+                put_f32(out, lora.scale);
+            }
+
+            put_string(out, s.prompt);
+            put_varint(out, s.prompt_tokens.size());
+            for (llama_token t : s.prompt_tokens) put_varint(out, static_cast<uint32_t>(t));
+            put_varint(out, s.prefill_us);
+
+            put_varint(out, s.tokens.size());
+            for (const auto& t : s.tokens) {
+                put_varint(out, static_cast<uint32_t>(t.token));
+                put_u64(out, t.logits_hash);
+                put_varint(out, t.sample_us);
+                put_varint(out, t.decode_us);
+            }
+
+            out.push_back(static_cast<uint8_t>(s.stop_reason));
+            put_string(out, s.output_text);
+            put_string(out, s.tool_name);
+            put_string(out, s.tool_payload);
+            put_varint(out, s.total_us);
+        }
+
+        bool decode_session(Cursor& c, uint16_t version, SessionTrace& s) {
+            s = SessionTrace{};
+            s.model_desc = c.string();
+            s.n_vocab = static_cast<int32_t>(c.varint());
+            s.n_ctx = static_cast<int32_t>(c.varint());
+
+            s.sampler.topK = static_cast<int>(c.signed_varint());
+            s.sampler.topP = c.f32();
+            s.sampler.temp = c.f32();
+            s.sampler.minP = c.f32();
+            s.sampler.mirostat = static_cast<int>(c.signed_varint());
+            s.sampler.mirostatTau = c.f32();
+            s.sampler.mirostatEta = c.f32();
+            s.sampler.seed = static_cast<int>(c.signed_varint());
+
+            s.max_tokens = static_cast<int32_t>(c.signed_varint());
+            uint64_t n_stops = c.varint();
+            for (uint64_t i = 0; c.ok && i < n_stops; ++i) s.stop_strings.push_back(c.string());
+
+            uint8_t flags = c.u8();
+            s.tools_enabled = (flags & 0x01) != 0;
+            s.grammar_mode = (flags & 0x02) ? GrammarMode::LAZY : GrammarMode::STRICT;
+            s.typed_grammar = (flags & 0x04) != 0;
+            s.tools_json = c.string();
+            s.response_schema = c.string();
+            if (version >= 2) {
+                uint64_t n_lora = c.varint();
+                for (uint64_t i = 0; c.ok && i < n_lora; ++i) {
+                    LoraRecord lora;
+                    lora.name = c.string();
+                    lora.path = c.string();
+                    lora.scale = c.f32();
+                    s.lora_adapters.push_back(std::move(lora));
+                }
+            }
+
+            s.prompt = c.string();
+            uint64_t n_prompt = c.varint();
+            if (!c.ok || n_prompt > static_cast<uint64_t>(c.end - c.p)) return false;
+            s.prompt_tokens.reserve(static_cast<size_t>(n_prompt));
+            for (uint64_t i = 0; c.ok && i < n_prompt; ++i) {
+                s.prompt_tokens.push_back(static_cast<llama_token>(c.varint()));
+            }
+            s.prefill_us = c.varint();
+
+            uint64_t n_tokens = c.varint();
+            if (!c.ok || n_tokens > static_cast<uint64_t>(c.end - c.p)) return false;
+            s.tokens.reserve(static_cast<size_t>(n_tokens));
+            for (uint64_t i = 0; c.ok && i < n_tokens; ++i) {
+                TokenRecord t;
+                t.token = static_cast<llama_token>(c.varint());
+                t.logits_hash = c.u64();
+                t.sample_us = static_cast<uint32_t>(c.varint());
+                t.decode_us = static_cast<uint32_t>(c.varint());
+                s.tokens.push_back(t);
+            }
+
+            s.stop_reason = static_cast<StopReason>(c.u8());
+            s.output_text = c.string();
+            s.tool_name = c.string();
+            s.tool_payload = c.string();
+            s.total_us = c.varint();
+            return c.ok;
+        }
+
+    } // anonymous namespace
+
+    const char* stop_reason_name(StopReason r) {
+        switch (r) {
+            case StopReason::EndOfGeneration: return "eos";
+            case StopReason::MaxTokens:       return "max_tokens";
+            case StopReason::StopString:      return "stop_string";
+            case StopReason::ToolCall:        return "tool_call";
+            case StopReason::Error:           return "error";
+            case StopReason::Cancelled:       return "cancelled";
+        }
+        return "unknown";
+    }
+
+    uint64_t hash_logits(const float* logits, int32_t n_vocab) {
+        if (!logits || n_vocab <= 0) return 0;
+
+        // FNV-1a over 32-bit words: one multiply per logit keeps record
+        // mode overhead small even for 150k+ vocabularies
+        uint64_t h = 1469598103934665603ULL;
+        for (int32_t i = 0; i < n_vocab; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &logits[i], sizeof(bits));
+            h ^= bits;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+/* --------------------------------------------------------------------
+ *  TraceWriter
+ * -------------------------------------------------------------------- */
+    bool TraceWriter::open(const std::string& path) {
+        close();
+
+        // Validate an existing file before appending to it
+        bool needs_header = true;
+        if (FILE* existing = std::fopen(path.c_str(), "rb")) {
+            uint8_t header[8] = {};
+            size_t n = std::fread(header, 1, sizeof(header), existing);
+            std::fclose(existing);
+            if (n >= sizeof(kFileMagic)) {
+                if (std::memcmp(header, kFileMagic, sizeof(kFileMagic)) != 0) {
+                    LOG_ERROR("Trace file '%s' exists and is not a generation trace", path.c_str());
+                    return false;
+                }
+                // Sessions are encoded per the file's version: never mix them
+                const uint16_t version = static_cast<uint16_t>(header[4] | (header[5] << 8));
+                if (n != sizeof(header) || version != kVersion) {
+                    LOG_ERROR("Trace file '%s' has version %u (recording writes %u) - use a new file",
+                              path.c_str(), static_cast<unsigned>(version), static_cast<unsigned>(kVersion));
+                    return false;
+                }
+                needs_header = false;
+            }
+        }
+
+        file_ = std::fopen(path.c_str(), needs_header ? "wb" : "ab");
+        if (!file_) {
+            LOG_ERROR("Failed to open trace file '%s'", path.c_str());
+            return false;
+        }
+
+        if (needs_header) {
+            uint8_t header[8];
+            std::memcpy(header, kFileMagic, 4);
+            header[4] = static_cast<uint8_t>(kVersion);
+            header[5] = static_cast<uint8_t>(kVersion >> 8);
+            header[6] = 0;
+            header[7] = 0;
+            std::fwrite(header, 1, sizeof(header), file_);
+        }
+
+        LOG_INFO("Trace recording to '%s'", path.c_str());
+        return true;
+    }
+
+    void TraceWriter::close() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    bool TraceWriter::write(const SessionTrace& session) {
+        if (!file_) return false;
+
+        scratch_.clear();
+        scratch_.insert(scratch_.end(), kSessionMagic, kSessionMagic + 4);
+        scratch_.resize(8); // payload size, patched below
+        encode_session(session, scratch_);
+
+        const uint32_t payload = static_cast<uint32_t>(scratch_.size() - 8);
+        for (int i = 0; i < 4; ++i) scratch_[4 + i] = static_cast<uint8_t>(payload >> (8 * i));
+
+        // One write per session, then flush so a crash keeps earlier sessions
+        if (std::fwrite(scratch_.data(), 1, scratch_.size(), file_) != scratch_.size()) {
+            LOG_ERROR("Trace write failed");
+            return false;
+        }
+        std::fflush(file_);
+        return true;
+    }
+
+/* --------------------------------------------------------------------
+ *  TraceReader
+ * -------------------------------------------------------------------- */
+    bool TraceReader::open(const std::string& path) {
+        close();
+        error_.clear();
+
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_) {
+            error_ = "cannot open " + path;
+            return false;
+        }
+
+        uint8_t header[8];
+        if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+            std::memcmp(header, kFileMagic, 4) != 0) {
+            error_ = "not a generation trace: " + path;
+            close();
+            return false;
+        }
+
+        version_ = static_cast<uint16_t>(header[4] | (header[5] << 8));
+        if (version_ < 1 || version_ > kVersion) {
+            error_ = "unsupported trace version " + std::to_string(version_);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void TraceReader::close() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    bool TraceReader::next(SessionTrace& session) {
+        if (!file_) return false;
+
+        uint8_t head[8];
+        size_t n = std::fread(head, 1, sizeof(head), file_);
+        if (n == 0) return false; // clean end of file
+        if (n != sizeof(head) || std::memcmp(head, kSessionMagic, 4) != 0) {
+            error_ = "corrupt session header";
+            return false;
+        }
+
+        uint32_t size = 0;
+        for (int i = 0; i < 4; ++i) size |= static_cast<uint32_t>(head[4 + i]) << (8 * i);
+        if (size > kMaxSessionBytes) {
+            error_ = "session too large";
+            return false;
+        }
+
+        scratch_.resize(size);
+        if (std::fread(scratch_.data(), 1, size, file_) != size) {
+            error_ = "truncated session";
+            return false;
+        }
+
+        Cursor c{scratch_.data(), scratch_.data() + scratch_.size()};
+        if (!decode_session(c, version_, session)) {
+            error_ = "malformed session payload";
+            return false;
+        }
+        return true;
+    }
+
+} // namespace trace
@@ -0,0 +1,131 @@
+#pragma once
+
+/**
+ * Generation trace recording for record/replay regression testing.
+ *
+ * A trace file holds one or more sessions (one per generate call). Each
+ * session captures everything needed to re-run it deterministically on
+ * the host: sampler/grammar configuration, the LoRA adapter mix, the
+ * rendered prompt and its tokens, and per generated token the sampled id, a hash of the logits
+ * it was sampled from, and sample/decode timing.
+ *
+ * Format (little-endian, integers as LEB128 varints unless noted):
+ *   file    := "AGTR" u16:version u16:reserved session*
+ *   session := "SESS" u32:payload_size payload
+ * Sessions are length-prefixed so readers can skip unknown versions and
+ * a crash mid-generation never leaves a partial session in the file.
+ * Version 2 added the LoRA adapter mix; version 1 files still read (as
+ * sessions without adapters).
+ */
+
+#include "llama.h"
+#include "../state/model_state.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+    enum class StopReason : uint8_t {
+        EndOfGeneration = 0,  // EOS / EOT token
+        MaxTokens       = 1,
+        StopString      = 2,
+        ToolCall        = 3,
+        Error           = 4,
+        Cancelled       = 5,
+    };
+
+    const char* stop_reason_name(StopReason r);
+
+    struct TokenRecord {
+        llama_token token = 0;
+        uint64_t logits_hash = 0;
+        uint32_t sample_us = 0;   // sample + accept
+        uint32_t decode_us = 0;   // forward pass for the next position
+    };
+
+    struct LoraRecord {
+        std::string name;
+        std::string path;   // As loaded on the device
+        float scale = 0.0f;
+    };
+
+    struct SessionTrace {
+        // Model / configuration
+        std::string model_desc;
+        int32_t n_vocab = 0;
+        int32_t n_ctx = 0;
+        SamplerParams sampler;
+        int32_t max_tokens = 0;
+        std::vector<std::string> stop_strings;
+        bool tools_enabled = false;
+        GrammarMode grammar_mode = GrammarMode::STRICT;
+        bool typed_grammar = true;
+        std::string tools_json;
+        std::string response_schema;
+        std::vector<LoraRecord> lora_adapters;  // Active mix; empty = base model
+
+        // Prompt
+        std::string prompt;
+        std::vector<llama_token> prompt_tokens;
+        uint64_t prefill_us = 0;
+
+        // Generation
+        std::vector<TokenRecord> tokens;
+        StopReason stop_reason = StopReason::MaxTokens;
+        std::string output_text;     // Text streamed to the caller
+        std::string tool_name;
+        std::string tool_payload;
+        uint64_t total_us = 0;
+    };
+
+    /**
+     * 64-bit hash of a logits row. Hashes the raw float bits, so any
+     * numeric change (kernel, thread count, quantization) shows up.
+     */
+    uint64_t hash_logits(const float* logits, int32_t n_vocab);
+
+    /**
+     * Appends sessions to a trace file. Not thread-safe; the generation
+     * lock already serializes sessions.
+     */
+    class TraceWriter {
+    public:
+        ~TraceWriter() { close(); }
+
+        bool open(const std::string& path);
+        void close();
+        bool is_open() const { return file_ != nullptr; }
+
+        bool write(const SessionTrace& session);
+
+    private:
+        FILE* file_ = nullptr;
+        std::vector<uint8_t> scratch_;
+    };
+
+    class TraceReader {
+    public:
+        ~TraceReader() { close(); }
+
+        bool open(const std::string& path);
+        void close();
+
+        /**
+         * Read the next session. Returns false at end of file or on error
+         * (check error() to tell them apart).
+         */
+        bool next(SessionTrace& session);
+
+        const std::string& error() const { return error_; }
+
+    private:
+        FILE* file_ = nullptr;
+        uint16_t version_ = 0;
+        std::vector<uint8_t> scratch_;
+        std::string error_;
+    };
+
+} // namespace trace
@@ -0,0 +1,62 @@
+#include "stop_string_checker.h"
+
+void StopStringChecker::init(const std::vector<std::string>& stops) {
+    stop_strings_ = stops;
+    max_len_ = 0;
+    for (const auto& s : stops) {
+        if (s.size() > max_len_) max_len_ = s.size();
+    }
+    pending_.clear();
+    // Held-back tail plus a generous token; pending_ never shrinks, so
+    // after the first long token there are no further reallocations
+    pending_.reserve(max_len_ + 256);
+}
+
+size_t StopStringChecker::find_stop(size_t from) const {
+    size_t best = std::string::npos;
+    for (const auto& stop : stop_strings_) {
+        size_t pos = pending_.find(stop, from);
+        if (pos < best) best = pos;
+    }
+    return best;
+}
+
+std::string_view StopStringChecker::feed(std::string_view text, bool& stopped, TokenArena& arena) {
+    stopped = false;
+    if (stop_strings_.empty()) return text;
+
+    const size_t old_size = pending_.size();
+    pending_.append(text.data(), text.size());
+
+    // The held-back tail had no complete match, so a new match has to end
+    // inside the appended text: only rescan the last max_len_ - 1 old bytes
+    const size_t from = old_size >= max_len_ ? old_size - max_len_ + 1 : 0;
+    size_t pos = find_stop(from);
+    if (pos != std::string::npos) {
+        // Found a stop string — return everything before it
+        stopped = true;
+        std::string_view safe = arena.copy(std::string_view(pending_).substr(0, pos));
+        pending_.clear();
+        return safe;
+    }
+
+    // No complete match yet. Hold back the last max_len_ characters
+    // because they could be the start of a stop string.
+    if (pending_.size() > max_len_) {
+        size_t safe_len = pending_.size() - max_len_;
+        std::string_view safe = arena.copy(std::string_view(pending_).substr(0, safe_len));
+        pending_.erase(0, safe_len);
+        return safe;
+    }
+
+    // Everything is still in the danger zone — hold it all
+    return {};
+}
+
+std::string_view StopStringChecker::flush(TokenArena& arena) {
+    // Final check for stop strings before flushing
+    size_t pos = find_stop(0);
+    std::string_view safe = arena.copy(std::string_view(pending_).substr(0, pos));
+    pending_.clear();
+    return safe;
+}
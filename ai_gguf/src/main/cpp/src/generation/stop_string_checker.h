@@ -0,0 +1,47 @@
+#pragma once
+
+#include "token_arena.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Stop string checker for streaming generation.
+ *
+ * Small/quantized models often generate chat template turn markers
+ * (e.g. <end_of_turn>, <|im_end|>) as regular text tokens instead of the
+ * special EOT token ID. This causes the model to keep generating fake
+ * conversation turns in a loop.
+ *
+ * This class buffers recent output and checks for stop strings. Text is
+ * only released for streaming once it's confirmed not to be the start of
+ * a stop string, so stop markers are never sent to the user.
+ */
+class StopStringChecker {
+public:
+    void init(const std::vector<std::string>& stops);
+
+    bool has_stops() const { return !stop_strings_.empty(); }
+
+    /**
+     * Feed new text. Returns text that is safe to send to the user
+     * (a view into text or the arena). Sets `stopped` to true if a stop
+     * string was found.
+     */
+    std::string_view feed(std::string_view text, bool& stopped, TokenArena& arena);
+
+    /**
+     * Flush remaining buffered text (call at end of generation).
+     * Strips any trailing stop string if present.
+     */
+    std::string_view flush(TokenArena& arena);
+
+private:
+    std::vector<std::string> stop_strings_;
+    std::string pending_;   // Capacity is kept across tokens
+    size_t max_len_ = 0;
+
+    // Earliest stop string match at or after `from`, or npos
+    size_t find_stop(size_t from) const;
+};
@@ -0,0 +1,53 @@
+#include "token_arena.h"
+
+#include <cstring>
+
+TokenArena::TokenArena(size_t capacity) : block_(capacity) {}
+
+char* TokenArena::allocate(size_t n) {
+    if (n == 0) n = 1;
+
+    if (used_ + n <= block_.size()) {
+        last_ = block_.data() + used_;
+        used_ += n;
+    } else {
+        // Rare: larger than the block. Served from a spill chunk; the block
+        // grows to cover it on the next reset.
+        overflow_.emplace_back(new char[n]);
+        overflow_bytes_ += n;
+        last_ = overflow_.back().get();
+    }
+    last_size_ = n;
+    return last_;
+}
+
+void TokenArena::shrink_last(size_t unused) {
+    if (!last_ || unused > last_size_) return;
+
+    // Only the bump region can give bytes back
+    if (last_ + last_size_ == block_.data() + used_) {
+        used_ -= unused;
+    }
+    last_size_ -= unused;
+}
+
+std::string_view TokenArena::copy(std::string_view s) {
+    if (s.empty()) return {};
+    char* p = allocate(s.size());
+    std::memcpy(p, s.data(), s.size());
+    return {p, s.size()};
+}
+
+void TokenArena::reset() {
+    if (!overflow_.empty()) {
+        const size_t wanted = used_ + overflow_bytes_;
+        overflow_.clear();
+        overflow_bytes_ = 0;
+        if (wanted > block_.size()) {
+            block_.resize(wanted * 2);
+        }
+    }
+    used_ = 0;
+    last_ = nullptr;
+    last_size_ = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * Per-session bump allocator for the streaming text pipeline.
+ *
+ * Every per-token intermediate (detokenized piece, reassembled UTF-8,
+ * text released by the stop-string checker) is carved out of one block
+ * and handed around as std::string_view. reset() at the top of each
+ * token reclaims everything in O(1), so the steady-state loop does no
+ * heap allocation.
+ *
+ * If a token ever needs more than the block holds, the excess goes to an
+ * overflow chunk and the block is grown on the next reset(), so the
+ * arena converges to the session's high-water mark after one spill.
+ * Views are valid until the next reset().
+ */
+class TokenArena {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    explicit TokenArena(size_t capacity = DEFAULT_CAPACITY);
+
+    TokenArena(const TokenArena&) = delete;
+    TokenArena& operator=(const TokenArena&) = delete;
+
+    /**
+     * Uninitialized storage for n bytes
+     */
+    char* allocate(size_t n);
+
+    /**
+     * Give back the unused tail of the most recent allocate() call
+     * (for writers that reserve a worst case, e.g. detokenization)
+     */
+    void shrink_last(size_t unused);
+
+    std::string_view copy(std::string_view s);
+
+    /**
+     * Reclaim everything allocated since the last reset
+     */
+    void reset();
+
+    size_t capacity() const { return block_.size(); }
+    size_t used() const { return used_; }
+
+private:
+    std::vector<char> block_;
+    size_t used_ = 0;
+    size_t last_size_ = 0;
+    char* last_ = nullptr;
+
+    // Spill chunks for oversized tokens (freed and folded into block_ on reset)
+    std::vector<std::unique_ptr<char[]>> overflow_;
+    size_t overflow_bytes_ = 0;
+};
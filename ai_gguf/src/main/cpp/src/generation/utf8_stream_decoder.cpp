@@ -0,0 +1,68 @@
+#include "utf8_stream_decoder.h"
+
+#include <cstring>
+
+std::string_view Utf8StreamDecoder::decode(std::string_view raw_bytes, TokenArena& arena) {
+    if (raw_bytes.empty()) return {};
+
+    // Prepend any pending bytes from previous tokens
+    std::string_view input = raw_bytes;
+    if (pending_len_ != 0) {
+        char* joined = arena.allocate(pending_len_ + raw_bytes.size());
+        std::memcpy(joined, pending_, pending_len_);
+        std::memcpy(joined + pending_len_, raw_bytes.data(), raw_bytes.size());
+        input = std::string_view(joined, pending_len_ + raw_bytes.size());
+        pending_len_ = 0;
+    }
+
+    // Output is only materialized once the input stops being a clean
+    // prefix of itself (an invalid byte was skipped)
+    char* out = nullptr;
+    size_t out_len = 0;
+
+    size_t i = 0;
+    while (i < input.size()) {
+        unsigned char c = static_cast<unsigned char>(input[i]);
+        size_t char_len = utf8_char_length(c);
+
+        // Check if we have all bytes for this character
+        if (char_len != 0 && i + char_len > input.size()) {
+            // Incomplete sequence - save for next token
+            pending_len_ = static_cast<uint8_t>(input.size() - i);
+            std::memcpy(pending_, input.data() + i, pending_len_);
+            break;
+        }
+
+        // Validate continuation bytes
+        bool valid = char_len != 0;
+        for (size_t j = 1; valid && j < char_len; ++j) {
+            unsigned char cont = static_cast<unsigned char>(input[i + j]);
+            valid = (cont & 0xC0) == 0x80;
+        }
+
+        if (valid) {
+            if (out) std::memcpy(out + out_len, input.data() + i, char_len);
+            out_len += char_len;
+            i += char_len;
+        } else {
+            // Invalid start byte / sequence - skip the start byte
+            if (!out) {
+                out = arena.allocate(input.size());
+                std::memcpy(out, input.data(), out_len);
+            }
+            ++i;
+        }
+    }
+
+    if (!out) return input.substr(0, out_len);
+    arena.shrink_last(input.size() - out_len);
+    return {out, out_len};
+}
+
+std::string_view Utf8StreamDecoder::flush() {
+    if (pending_len_ == 0) return {};
+
+    // Replacement character for incomplete sequence
+    pending_len_ = 0;
+    return "\xEF\xBF\xBD"; // U+FFFD
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "token_arena.h"
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Streaming UTF-8 reassembly for detokenized pieces.
+ *
+ * BPE tokens can split a multi-byte character across tokens. decode()
+ * returns only complete characters and carries the trailing partial
+ * sequence (at most 3 bytes) over to the next call.
+ */
+class Utf8StreamDecoder {
+public:
+    void reset() {
+        pending_len_ = 0;
+    }
+
+    /**
+     * Process raw token bytes and return complete UTF-8 characters.
+     * Incomplete sequences are buffered until the next token completes them.
+     *
+     * The common case (no carry, well-formed piece) returns raw_bytes
+     * itself; otherwise the result is assembled in the arena. Either way
+     * the view is valid until the arena is reset or raw_bytes dies.
+     */
+    std::string_view decode(std::string_view raw_bytes, TokenArena& arena);
+
+    /**
+     * Flush any remaining pending bytes (call at end of generation).
+     * Returns U+FFFD for an incomplete trailing sequence.
+     */
+    std::string_view flush();
+
+    bool has_pending() const { return pending_len_ != 0; }
+
+private:
+    char pending_[4] = {0};
+    uint8_t pending_len_ = 0;
+
+    static size_t utf8_char_length(unsigned char c) {
+        if ((c & 0x80) == 0x00) return 1;      // 0xxxxxxx - ASCII
+        if ((c & 0xE0) == 0xC0) return 2;      // 110xxxxx
+        if ((c & 0xF0) == 0xE0) return 3;      // 1110xxxx
+        if ((c & 0xF8) == 0xF0) return 4;      // 11110xxx
+        return 0; // Invalid start byte
+    }
+};
@@ -194,7 +194,7 @@ EmbeddingOutput EmbeddingState::encode(
     }
 
     output.num_tokens = static_cast<int32_t>(tokens.size());
-    LOG_INFO("Encoding %d tokens", output.num_tokens);
+    LOG_DEBUG("Encoding %d tokens", output.num_tokens);
 
     // Report initial progress
     if (progress_callback) {
@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * Immutable generation configuration
+ *
+ * Everything a request reads besides the model itself - prompts, tools,
+ * grammar settings, stop strings, sampler parameters and the grammar
+ * samplers compiled from them - lives in one GenerationConfig snapshot.
+ *
+ * - A published snapshot is never modified. Setters copy the current one,
+ *   edit the copy and publish it (RCU-style).
+ * - A generation pins one snapshot when it starts and reads only that, so
+ *   a setter running mid-generation affects the next request, never the
+ *   current one, and never waits for it.
+ * - Old snapshots (and their compiled grammars) are freed when the last
+ *   request holding them finishes.
+ */
+
+#include "llama.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Grammar mode for tool calling
+ */
+enum class GrammarMode {
+    STRICT,  // Grammar active from first token (forces tool call output)
+    LAZY     // Grammar activates only on trigger pattern (model chooses tool vs text)
+};
+
+/**
+ * Sampler parameters the sampler chain is built from
+ */
+struct SamplerParams {
+    int topK = 40;
+    float topP = 0.9f;
+    float temp = 0.7f;
+    float minP = 0.05f;
+    int mirostat = 0;
+    float mirostatTau = 5.0f;
+    float mirostatEta = 0.1f;
+    int seed = -1;
+};
+
+/**
+ * Shared master sampler (freed with the last snapshot that references it)
+ */
+using SamplerHandle = std::shared_ptr<llama_sampler>;
+
+inline SamplerHandle make_sampler_handle(llama_sampler* s) {
+    if (!s) return nullptr;
+    return SamplerHandle(s, llama_sampler_free);
+}
+
+struct GenerationConfig {
+    // Chat/Tool state
+    std::string system_prompt;
+    std::string chat_template_override;
+    std::string tools_json;
+    bool tools_enabled = false;
+
+    // Grammar configuration
+    GrammarMode grammar_mode = GrammarMode::STRICT;
+    bool use_typed_grammar = true;  // Use parameter-aware GBNF
+
+    // Structured output: JSON Schema the response must conform to.
+    // Takes precedence over the tool-call grammar while set.
+    std::string response_schema;
+
+    // Stop strings checked against the generated text (see detect_stop_strings)
+    std::vector<std::string> stop_strings;
+
+    SamplerParams sampler_params;
+
+    // Master grammar samplers compiled from the fields above. Never sampled
+    // from directly - each sampler chain adds its own clone.
+    SamplerHandle grammar_sampler;   // tools_json in grammar_mode / use_typed_grammar
+    SamplerHandle schema_sampler;    // response_schema
+
+    // Model grammar_sampler was compiled against (nullptr = not compiled).
+    // A failed compile is remembered too, so it isn't retried every publish.
+    const llama_model* grammar_model = nullptr;
+
+    // Increases with every publish; lets the sampler chain skip rebuilds
+    uint64_t version = 0;
+
+    bool has_response_schema() const {
+        return schema_sampler != nullptr;
+    }
+};
+
+using ConfigSnapshot = std::shared_ptr<const GenerationConfig>;
+
+/**
+ * Holder of the current snapshot.
+ * load() is a single atomic shared_ptr load. update() serializes writers
+ * among themselves (so concurrent edits are never lost) but never
+ * involves readers.
+ */
+class ConfigStore {
+public:
+    ConfigStore() {
+        auto initial = std::make_shared<GenerationConfig>();
+        initial->version = next_version_++;
+        current_ = std::move(initial);
+    }
+
+    ConfigSnapshot load() const {
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+    }
+
+    /**
+     * Copy the current snapshot, let `edit(prev, next)` modify the copy,
+     * then publish it. Returns the published snapshot.
+     */
+    template <typename Edit>
+    ConfigSnapshot update(Edit&& edit) {
+        std::lock_guard<std::mutex> lock(write_mtx_);
+
+        const ConfigSnapshot prev = load();
+        auto next = std::make_shared<GenerationConfig>(*prev);
+        edit(*prev, *next);
+        next->version = next_version_++;
+
+        ConfigSnapshot published = std::move(next);
+        std::atomic_store_explicit(&current_, published, std::memory_order_release);
+        return published;
+    }
+
+private:
+    ConfigSnapshot current_;
+    std::mutex write_mtx_;
+    uint64_t next_version_ = 1;  // 0 means "no snapshot"
+};
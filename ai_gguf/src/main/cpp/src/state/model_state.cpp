@@ -6,17 +6,19 @@
  * - Optimized detokenization for immediate streaming
  * - Improved sampler chain construction
  * - Grammar caching for tool calls (avoids rebuilds)
+ * - Grammars compiled when a config snapshot is published, not per request
  * - Memory metrics tracking
  */
 
 #include "model_state.h"
 #include "../utils/logger.h"
 #include "../chat/chat_template.h"
+#include "../chat/json_schema_grammar.h"
+#include "../generation/generation_request.h"
 
 #include <cstring>
 #include <cctype>
 #include <algorithm>
-#include <jni.h>
 
 #if defined(__ANDROID__)
 #include <sys/sysinfo.h>
@@ -30,25 +32,23 @@ ModelState g_state;
 // Updated sampler chain API
 // ============================================================================
 
-void ModelState::rebuild_sampler(
-        int topK,
-        float topP,
-        float temp,
-        float minP,
-        int mirostat,
-        float mirostatTau,
-        float mirostatEta,
-        int seed)
-{
-    // Cache params for multi-turn rebuilds
-    cached_sampler_params = {topK, topP, temp, minP, mirostat, mirostatTau, mirostatEta, seed};
+void ModelState::rebuild_sampler(const GenerationConfig& cfg, bool with_grammar) {
+    const int topK = cfg.sampler_params.topK;
+    const float topP = cfg.sampler_params.topP;
+    const float temp = cfg.sampler_params.temp;
+    const float minP = cfg.sampler_params.minP;
+    const int mirostat = cfg.sampler_params.mirostat;
+    const float mirostatTau = cfg.sampler_params.mirostatTau;
+    const float mirostatEta = cfg.sampler_params.mirostatEta;
+    const int seed = cfg.sampler_params.seed;
 
     // Free existing sampler chain (this frees all samplers added to the chain,
-    // but NOT our master grammar_sampler since we clone it before adding)
+    // but NOT the snapshot's master grammar since we clone it before adding)
     if (sampler) {
         llama_sampler_free(sampler);
         sampler = nullptr;
     }
+    sampler_config_version = 0;
 
     const llama_vocab* vocab = llama_model_get_vocab(model);
     if (!vocab) {
@@ -60,11 +60,21 @@ void ModelState::rebuild_sampler(
     auto sparams = llama_sampler_chain_default_params();
     llama_sampler* chain = llama_sampler_chain_init(sparams);
 
-    // Add a CLONE of grammar sampler first if tools are enabled.
-    // The master grammar_sampler is owned by ModelState for reuse across turns.
+    // Add a CLONE of grammar sampler first if a response schema is set or tools
+    // are enabled (the schema wins: its output must be a single JSON document).
+    // The master samplers belong to the config snapshot and are never mutated.
     // The chain takes ownership of the clone and frees it when the chain is freed.
-    if (tools_enabled && grammar_sampler) {
-        llama_sampler* grammar_clone = llama_sampler_clone(grammar_sampler);
+    if (!with_grammar) {
+        // Grammar dropped for this turn only
+    } else if (cfg.schema_sampler) {
+        llama_sampler* schema_clone = llama_sampler_clone(cfg.schema_sampler.get());
+        if (schema_clone) {
+            llama_sampler_chain_add(chain, schema_clone);
+        } else {
+            LOG_WARN("Failed to clone schema sampler, proceeding without schema");
+        }
+    } else if (cfg.tools_enabled && cfg.grammar_sampler) {
+        llama_sampler* grammar_clone = llama_sampler_clone(cfg.grammar_sampler.get());
         if (grammar_clone) {
             llama_sampler_chain_add(chain, grammar_clone);
         } else {
@@ -112,23 +122,14 @@ void ModelState::rebuild_sampler(
 
     sampler = chain;
     llama_sampler_reset(sampler);
-
-    LOG_INFO("Sampler rebuilt: topK=%d, topP=%.2f, temp=%.2f, minP=%.2f, "
-             "mirostat=%d, tau=%.2f, eta=%.2f, seed=%d",
-             topK, topP, temp, minP,
-             mirostat, mirostatTau, mirostatEta, seed);
-}
-
-void ModelState::rebuild_sampler_cached() {
-    const auto& p = cached_sampler_params;
-    rebuild_sampler(p.topK, p.topP, p.temp, p.minP,
-                    p.mirostat, p.mirostatTau, p.mirostatEta, p.seed);
-}
-
-void ModelState::reset_grammar_sampler() {
-    if (grammar_sampler) {
-        llama_sampler_reset(grammar_sampler);
+    if (with_grammar) {
+        sampler_config_version = cfg.version;
     }
+
+    LOG_DEBUG("Sampler rebuilt: topK=%d, topP=%.2f, temp=%.2f, minP=%.2f, "
+              "mirostat=%d, tau=%.2f, eta=%.2f, seed=%d",
+              topK, topP, temp, minP,
+              mirostat, mirostatTau, mirostatEta, seed);
 }
 
 // ============================================================================
@@ -215,13 +216,52 @@ std::string ModelState::detokenize_single(llama_token t) const {
     return {};
 }
 
+std::string_view ModelState::detokenize(llama_token t, TokenArena& arena) const {
+    if (!model) return {};
+
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+    if (!vocab) return {};
+
+    // Most pieces are a few bytes; reserve a small window and give the
+    // unused tail back to the arena
+    constexpr int32_t kGuess = 64;
+    char* buf = arena.allocate(kGuess);
+    int32_t n = llama_token_to_piece(vocab, t, buf, kGuess, 0, false);
+    if (n >= 0) {
+        arena.shrink_last(static_cast<size_t>(kGuess - n));
+        return {buf, static_cast<size_t>(n)};
+    }
+
+    // Larger than the window (rare) - retry with the exact size
+    arena.shrink_last(kGuess);
+    const int32_t need = -n;
+    buf = arena.allocate(static_cast<size_t>(need));
+    n = llama_token_to_piece(vocab, t, buf, need, 0, false);
+    if (n >= 0) {
+        arena.shrink_last(static_cast<size_t>(need - n));
+        return {buf, static_cast<size_t>(n)};
+    }
+
+    LOG_ERROR("Failed to detokenize token %d", t);
+    return {};
+}
+
 // Legacy buffered detokenization
 std::string ModelState::detokenize_buffered(llama_token t) {
-    std::string piece = detokenize_single(t);
-    if (piece.empty()) return {};
+    if (!model) return {};
 
-    // Add to carry buffer
-    utf8_carry_buffer += piece;
+    // Detokenize straight into the carry buffer (no temporary piece)
+    const size_t old_size = utf8_carry_buffer.size();
+    char buffer[256];
+    int n = llama_token_to_piece(llama_model_get_vocab(model), t,
+                                 buffer, sizeof(buffer), 0, false);
+    if (n > 0) {
+        utf8_carry_buffer.append(buffer, static_cast<size_t>(n));
+    } else if (n < 0) {
+        std::string piece = detokenize_single(t);
+        utf8_carry_buffer += piece;
+    }
+    if (utf8_carry_buffer.size() == old_size) return {};
 
     // Extract complete UTF-8 characters
     std::string complete_chars;
@@ -263,15 +303,15 @@ std::string ModelState::detokenize_buffered(llama_token t) {
         }
 
         if (valid) {
-            complete_chars.append(utf8_carry_buffer.substr(i, char_len));
+            complete_chars.append(utf8_carry_buffer, i, char_len);
             i += char_len;
         } else {
             ++i;
         }
     }
 
-    // Keep incomplete bytes in buffer
-    utf8_carry_buffer = utf8_carry_buffer.substr(i);
+    // Keep incomplete bytes in buffer (erase keeps capacity)
+    utf8_carry_buffer.erase(0, i);
 
     return complete_chars;
 }
@@ -301,31 +341,55 @@ llama_token ModelState::space_token() const {
 // ============================================================================
 
 void ModelState::release() {
-    if (grammar_sampler) {
-        llama_sampler_free(grammar_sampler);
-        grammar_sampler = nullptr;
-    }
+    // Compiled grammars and detected stop strings belong to this model.
+    // Requests still holding the old snapshot keep it alive until they end.
+    config_store.update([](const GenerationConfig&, GenerationConfig& next) {
+        next.grammar_sampler.reset();
+        next.grammar_model = nullptr;
+        next.schema_sampler.reset();
+        next.response_schema.clear();
+        next.stop_strings.clear();
+    });
     if (sampler) {
         llama_sampler_free(sampler);
         sampler = nullptr;
     }
+    sampler_config_version = 0;
     if (ctx) {
         llama_free(ctx);
         ctx = nullptr;
     }
+    if (prompt_batch.token) {
+        llama_batch_free(prompt_batch);
+        prompt_batch = {};
+        prompt_batch_capacity = 0;
+    }
+    if (token_batch.token) {
+        llama_batch_free(token_batch);
+        token_batch = {};
+    }
+    // Adapters are bound to the model - free them before it
+    {
+        std::lock_guard<std::mutex> lk(lora_mtx);
+        for (auto& lora : lora_adapters) {
+            if (lora.adapter) {
+                llama_adapter_lora_free(lora.adapter);
+            }
+        }
+        lora_adapters.clear();
+    }
     if (model) {
         llama_model_free(model);
         model = nullptr;
     }
 
     utf8_carry_buffer.clear();
-    stop_strings.clear();
     llama_backend_free();
 
     LOG_INFO("ModelState: all resources released");
 }
 
-void ModelState::prepare_for_generation() {
+void ModelState::prepare_for_generation(const GenerationConfig& cfg) {
     if (!ctx) return;
 
     // Clear KV cache - requires 2 arguments!
@@ -334,28 +398,46 @@ void ModelState::prepare_for_generation() {
         llama_memory_clear(mem, true);
     }
 
-    if (sampler) {
+    // Same snapshot as last time: resetting restores the grammar clone to
+    // its start state, no need to clone again
+    if (sampler && sampler_config_version == cfg.version) {
         llama_sampler_reset(sampler);
+    } else {
+        rebuild_sampler(cfg);
     }
 
     utf8_carry_buffer.clear();
 
-    LOG_INFO("prepare_for_generation: KV cache cleared, sampler reset");
+    LOG_DEBUG("prepare_for_generation: KV cache cleared, sampler ready (config v%llu)",
+              static_cast<unsigned long long>(cfg.version));
 }
 
 // ============================================================================
 // INFERENCE
 // ============================================================================
 
-bool ModelState::decode_prompt(const std::vector<llama_token>& toks) const {
+bool ModelState::decode_prompt(const std::vector<llama_token>& toks,
+                               const GenerationRequest* req) {
     if (!ctx || toks.empty()) return true;
 
-    llama_batch batch = llama_batch_init(batch_size, 0, 1);
+    // Reuse the prompt batch across calls; only reallocate if batch_size grew
+    if (!prompt_batch.token || prompt_batch_capacity < batch_size) {
+        if (prompt_batch.token) llama_batch_free(prompt_batch);
+        prompt_batch = llama_batch_init(batch_size, 0, 1);
+        prompt_batch_capacity = batch_size;
+    }
+    llama_batch& batch = prompt_batch;
 
     int32_t pos = 0;
     size_t idx = 0;
 
     while (idx < toks.size()) {
+        if (req && req->should_stop()) {
+            LOG_INFO("Prefill stopped after %zu/%zu tokens (%s)", idx, toks.size(),
+                     req->cancel_requested() ? "cancelled" : "deadline");
+            return false;
+        }
+
         int32_t take = std::min<int32_t>(
                 batch_size,
                 static_cast<int32_t>(toks.size() - idx)
@@ -372,7 +454,6 @@ bool ModelState::decode_prompt(const std::vector<llama_token>& toks) const {
 
         if (llama_decode(ctx, batch) != 0) {
             LOG_ERROR("ModelState::decode_prompt: llama_decode failed");
-            llama_batch_free(batch);
             return false;
         }
 
@@ -380,33 +461,38 @@ bool ModelState::decode_prompt(const std::vector<llama_token>& toks) const {
         idx += static_cast<size_t>(take);
     }
 
-    llama_batch_free(batch);
     return true;
 }
 
-void ModelState::warmup_context() const {
+int32_t ModelState::decode_token(llama_token tok, llama_pos pos) {
+    if (!token_batch.token) {
+        token_batch = llama_batch_init(1, 0, 1);
+    }
+
+    token_batch.n_tokens = 1;
+    token_batch.token[0] = tok;
+    token_batch.pos[0] = pos;
+    token_batch.n_seq_id[0] = 1;
+    token_batch.seq_id[0][0] = 0;
+    token_batch.logits[0] = true;
+
+    return llama_decode(ctx, token_batch);
+}
+
+void ModelState::warmup_context() {
     llama_token space = space_token();
     if (space == 0) return;
 
-    llama_batch batch = llama_batch_init(1, 0, 1);
-    batch.n_tokens = 1;
-    batch.token[0] = space;
-    batch.pos[0] = 0;
-    batch.n_seq_id[0] = 1;
-    batch.seq_id[0][0] = 0;
-    batch.logits[0] = true;
-
-    llama_decode(ctx, batch);
-    llama_batch_free(batch);
+    decode_token(space, 0);
 }
 
 // ============================================================================
 // STATE PERSISTENCE
 // ============================================================================
 
-jlong ModelState::get_state_size() const {
+size_t ModelState::get_state_size() const {
     if (!ctx) return 0;
-    return static_cast<jlong>(llama_state_get_size(ctx));
+    return llama_state_get_size(ctx);
 }
 
 void* ModelState::get_state_data(void* buffer, size_t size) const {
@@ -433,64 +519,62 @@ bool ModelState::load_state_data(const void* data, size_t size) const {
 // GRAMMAR MANAGEMENT (Optimized for low-end devices)
 // ============================================================================
 
-void ModelState::update_grammar_if_needed() {
-    if (!tools_enabled || tools_json.empty()) {
-        // No tools - clean up any existing grammar
-        if (grammar_sampler) {
-            llama_sampler_free(grammar_sampler);
-            grammar_sampler = nullptr;
-        }
-        grammar_needs_rebuild = false;
-        cached_tools_json.clear();
+void ModelState::refresh_tool_grammar(const GenerationConfig& prev, GenerationConfig& next) const {
+    if (!next.tools_enabled || next.tools_json.empty() || !model) {
+        // No tools (or nothing to compile against) - drop any grammar
+        next.grammar_sampler.reset();
+        next.grammar_model = nullptr;
         return;
     }
 
-    // Check if we can reuse cached grammar (including "no grammar" cached state)
-    if (!grammar_needs_rebuild && tools_json == cached_tools_json) {
-        if (grammar_sampler) {
-            LOG_INFO("Reusing cached grammar sampler");
+    // Reuse prev's grammar (including a cached "no grammar" result) when
+    // nothing it was built from changed. `next` started as a copy of prev.
+    if (prev.grammar_model == model &&
+        prev.tools_json == next.tools_json &&
+        prev.grammar_mode == next.grammar_mode &&
+        prev.use_typed_grammar == next.use_typed_grammar) {
+        if (next.grammar_sampler) {
+            LOG_DEBUG("Reusing cached grammar sampler");
         }
         return;
     }
 
+    // Cache state regardless of success - avoid retrying every publish
+    next.grammar_sampler = build_tool_grammar(next);
+    next.grammar_model = model;
+}
+
+SamplerHandle ModelState::build_tool_grammar(const GenerationConfig& cfg) const {
+    const GrammarMode grammar_mode = cfg.grammar_mode;
+
     LOG_INFO("Building new grammar sampler (mode=%s, typed=%s)",
              grammar_mode == GrammarMode::STRICT ? "strict" : "lazy",
-             use_typed_grammar ? "yes" : "no");
-
-    // Free existing grammar sampler
-    if (grammar_sampler) {
-        llama_sampler_free(grammar_sampler);
-        grammar_sampler = nullptr;
-    }
+             cfg.use_typed_grammar ? "yes" : "no");
 
     // Build both grammar strings upfront
     std::string typed_grammar;
-    if (use_typed_grammar) {
-        typed_grammar = chat::build_tool_grammar_typed(tools_json);
+    if (cfg.use_typed_grammar) {
+        typed_grammar = chat::build_tool_grammar_typed(cfg.tools_json);
     }
-    std::string generic_grammar = chat::build_tool_grammar(tools_json);
+    std::string generic_grammar = chat::build_tool_grammar(cfg.tools_json);
 
     if (typed_grammar.empty() && generic_grammar.empty()) {
         LOG_WARN("Failed to build any tool grammar string - continuing without grammar");
-        cached_tools_json = tools_json;
-        grammar_needs_rebuild = false;
-        return;
+        return nullptr;
     }
 
     // Log grammar strings for debugging
     if (!typed_grammar.empty()) {
-        LOG_INFO("Typed grammar length: %zu chars", typed_grammar.size());
+        LOG_DEBUG("Typed grammar length: %zu chars", typed_grammar.size());
     }
     if (!generic_grammar.empty()) {
-        LOG_INFO("Generic grammar length: %zu chars", generic_grammar.size());
+        LOG_DEBUG("Generic grammar length: %zu chars", generic_grammar.size());
     }
 
     const llama_vocab* vocab = llama_model_get_vocab(model);
     if (!vocab) {
         LOG_ERROR("Failed to get vocab for grammar");
-        cached_tools_json = tools_json;
-        grammar_needs_rebuild = false;
-        return;
+        return nullptr;
     }
 
     // Helper: try to init sampler with given grammar in the preferred mode
@@ -519,6 +603,8 @@ void ModelState::update_grammar_if_needed() {
         }
     };
 
+    llama_sampler* grammar_sampler = nullptr;
+
     // Attempt 1: typed grammar + preferred mode
     if (!typed_grammar.empty()) {
         grammar_sampler = try_init_preferred(typed_grammar);
@@ -530,7 +616,7 @@ void ModelState::update_grammar_if_needed() {
 
     // Attempt 2: generic grammar + preferred mode
     if (!grammar_sampler && !generic_grammar.empty()) {
-        LOG_INFO("Trying generic grammar with preferred mode...");
+        LOG_DEBUG("Trying generic grammar with preferred mode...");
         grammar_sampler = try_init_preferred(generic_grammar);
         if (grammar_sampler) {
             LOG_INFO("Grammar sampler created: generic + %s mode",
@@ -540,7 +626,7 @@ void ModelState::update_grammar_if_needed() {
 
     // Attempt 3: typed grammar + alternate mode
     if (!grammar_sampler && !typed_grammar.empty()) {
-        LOG_INFO("Trying typed grammar with alternate mode...");
+        LOG_DEBUG("Trying typed grammar with alternate mode...");
         grammar_sampler = try_init_alt(typed_grammar);
         if (grammar_sampler) {
             LOG_INFO("Grammar sampler created: typed + %s mode",
@@ -550,7 +636,7 @@ void ModelState::update_grammar_if_needed() {
 
     // Attempt 4: generic grammar + alternate mode
     if (!grammar_sampler && !generic_grammar.empty()) {
-        LOG_INFO("Trying generic grammar with alternate mode...");
+        LOG_DEBUG("Trying generic grammar with alternate mode...");
         grammar_sampler = try_init_alt(generic_grammar);
         if (grammar_sampler) {
             LOG_INFO("Grammar sampler created: generic + %s mode",
@@ -558,10 +644,6 @@ void ModelState::update_grammar_if_needed() {
         }
     }
 
-    // Cache state regardless of success - avoid retrying every generation
-    cached_tools_json = tools_json;
-    grammar_needs_rebuild = false;
-
     if (grammar_sampler) {
         LOG_INFO("Grammar sampler cached successfully");
     } else {
@@ -572,17 +654,220 @@ void ModelState::update_grammar_if_needed() {
         LOG_WARN("All grammar init attempts failed - tool calling continues WITHOUT grammar constraints");
         LOG_WARN("Model will generate freely; tool calls detected via ToolCallState");
     }
+    return make_sampler_handle(grammar_sampler);
+}
+
+// ============================================================================
+// LORA ADAPTERS
+// ============================================================================
+
+bool ModelState::load_lora_adapter(const std::string& name, const std::string& path) {
+    if (!model) {
+        LOG_ERROR("Cannot load LoRA adapter: model not loaded");
+        return false;
+    }
+
+    auto is_loaded = [&]() {
+        for (const auto& lora : lora_adapters) {
+            if (lora.name == name) return true;
+        }
+        return false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lk(lora_mtx);
+        if (is_loaded()) {
+            LOG_INFO("LoRA adapter '%s' already loaded", name.c_str());
+            return true;
+        }
+    }
+
+    // Read the file without the lock, so a generation starting meanwhile
+    // isn't held up
+    llama_adapter_lora* adapter = llama_adapter_lora_init(model, path.c_str());
+    if (!adapter) {
+        LOG_ERROR("Failed to load LoRA adapter '%s' from '%s'", name.c_str(), path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    if (is_loaded()) {
+        llama_adapter_lora_free(adapter);
+        return true;
+    }
+
+    LoraAdapter lora;
+    lora.name = name;
+    lora.path = path;
+    lora.adapter = adapter;
+    lora_adapters.push_back(std::move(lora));
+
+    LOG_INFO("LoRA adapter '%s' loaded (%zu resident)", name.c_str(), lora_adapters.size());
+    return true;
+}
+
+bool ModelState::unload_lora_adapter(const std::string& name) {
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    for (auto it = lora_adapters.begin(); it != lora_adapters.end(); ++it) {
+        if (it->name != name) continue;
+
+        if (ctx && it->applied_scale != 0.0f) {
+            llama_rm_adapter_lora(ctx, it->adapter);
+        }
+        llama_adapter_lora_free(it->adapter);
+        lora_adapters.erase(it);
+
+        LOG_INFO("LoRA adapter '%s' unloaded", name.c_str());
+        return true;
+    }
+    return false;
+}
+
+bool ModelState::set_lora_mix(const std::vector<std::string>& names,
+                              const std::vector<float>& scales) {
+    if (names.size() != scales.size()) {
+        LOG_ERROR("LoRA mix: %zu names but %zu scales", names.size(), scales.size());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(lora_mtx);
+
+    // Validate first so a bad request leaves the current mix untouched
+    std::vector<float> requested(lora_adapters.size(), 0.0f);
+    for (size_t i = 0; i < names.size(); ++i) {
+        size_t idx = 0;
+        while (idx < lora_adapters.size() && lora_adapters[idx].name != names[i]) ++idx;
+        if (idx == lora_adapters.size()) {
+            LOG_ERROR("LoRA mix: adapter '%s' is not loaded", names[i].c_str());
+            return false;
+        }
+        requested[idx] = scales[i];
+    }
+
+    for (size_t i = 0; i < lora_adapters.size(); ++i) {
+        lora_adapters[i].scale = requested[i];
+    }
+    return true;
+}
+
+LoraMix ModelState::lora_mix() const {
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    LoraMix mix;
+    for (const auto& lora : lora_adapters) {
+        if (lora.scale != 0.0f) mix.emplace_back(lora.name, lora.scale);
+    }
+    return mix;
+}
+
+std::vector<std::string> ModelState::lora_adapter_names() const {
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    std::vector<std::string> names;
+    names.reserve(lora_adapters.size());
+    for (const auto& lora : lora_adapters) names.push_back(lora.name);
+    return names;
+}
+
+std::string ModelState::lora_adapter_path(const std::string& name) const {
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    for (const auto& lora : lora_adapters) {
+        if (lora.name == name) return lora.path;
+    }
+    return {};
+}
+
+void ModelState::apply_lora_adapters(const LoraMix& mix) {
+    if (!ctx) return;
+
+    std::lock_guard<std::mutex> lk(lora_mtx);
+    for (auto& lora : lora_adapters) {
+        float scale = 0.0f;
+        for (const auto& m : mix) {
+            if (m.first == lora.name) scale = m.second;
+        }
+        if (scale == lora.applied_scale) continue;
+
+        if (scale == 0.0f) {
+            llama_rm_adapter_lora(ctx, lora.adapter);
+        } else if (llama_set_adapter_lora(ctx, lora.adapter, scale) != 0) {
+            LOG_ERROR("Failed to attach LoRA adapter '%s'", lora.name.c_str());
+            continue;
+        }
+        lora.applied_scale = scale;
+    }
+}
+
+// ============================================================================
+// STRUCTURED OUTPUT (JSON SCHEMA)
+// ============================================================================
+
+bool ModelState::set_response_schema(const std::string& schema_json) {
+    if (schema_json.empty()) {
+        clear_response_schema();
+        return true;
+    }
+    if (!model) {
+        LOG_ERROR("Cannot set response schema: model not loaded");
+        return false;
+    }
+
+    // Same schema as before - the master sampler can be reused as-is
+    const ConfigSnapshot current = config();
+    if (current->schema_sampler && schema_json == current->response_schema) {
+        return true;
+    }
+
+    std::string error;
+    const std::string grammar = chat::build_json_schema_grammar_cached(schema_json, &error);
+    if (grammar.empty()) {
+        LOG_ERROR("Response schema rejected: %s", error.c_str());
+        return false;
+    }
+
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+    if (!vocab) {
+        LOG_ERROR("Failed to get vocab for response schema");
+        return false;
+    }
+
+    SamplerHandle compiled = make_sampler_handle(
+            llama_sampler_init_grammar(vocab, grammar.c_str(), "root"));
+    if (!compiled) {
+        LOG_ERROR("Response schema grammar failed to parse (%zu chars)", grammar.size());
+        return false;
+    }
+
+    // The sampler chain picks it up at the next generation
+    update_config([&](GenerationConfig& next) {
+        next.schema_sampler = std::move(compiled);
+        next.response_schema = schema_json;
+    });
+
+    LOG_INFO("Response schema set (hash=%016llx, grammar %zu chars)",
+             static_cast<unsigned long long>(chat::json_schema_hash(schema_json)),
+             grammar.size());
+    return true;
+}
+
+void ModelState::clear_response_schema() {
+    const ConfigSnapshot current = config();
+    if (!current->schema_sampler && current->response_schema.empty()) return;
+
+    update_config([](GenerationConfig& next) {
+        next.schema_sampler.reset();
+        next.response_schema.clear();
+    });
+    LOG_INFO("Response schema cleared");
 }
 
 // ============================================================================
 // FALLBACK CHAT TEMPLATE
 // ============================================================================
 
-void ModelState::apply_fallback_chat_template() {
+void ModelState::apply_fallback_chat_template(GenerationConfig& cfg) const {
     if (!model) return;
 
     // Skip if a custom template is already set
-    if (!chat_template_override.empty()) {
+    if (!cfg.chat_template_override.empty()) {
         LOG_INFO("Custom chat template already set, skipping fallback");
         return;
     }
@@ -605,7 +890,7 @@ void ModelState::apply_fallback_chat_template() {
 
     if (arch.find("gemma") != std::string::npos) {
         // Gemma / Gemma2 template
-        chat_template_override =
+        cfg.chat_template_override =
             "{% for message in messages %}"
             "{% if message['role'] == 'system' %}"
             "{{ message['content'] }}\n"
@@ -624,7 +909,7 @@ void ModelState::apply_fallback_chat_template() {
              arch.find("mistral") != std::string::npos ||
              arch.find("mixtral") != std::string::npos) {
         // Llama 3 / Mistral — ChatML-style
-        chat_template_override =
+        cfg.chat_template_override =
             "{% for message in messages %}"
             "<|im_start|>{{ message['role'] }}\n"
             "{{ message['content'] }}<|im_end|>\n"
@@ -634,7 +919,7 @@ void ModelState::apply_fallback_chat_template() {
     }
     else if (arch.find("phi") != std::string::npos) {
         // Phi template
-        chat_template_override =
+        cfg.chat_template_override =
             "{% for message in messages %}"
             "<|{{ message['role'] }}|>\n"
             "{{ message['content'] }}<|end|>\n"
@@ -644,7 +929,7 @@ void ModelState::apply_fallback_chat_template() {
     }
     else if (arch.find("qwen") != std::string::npos) {
         // Qwen — ChatML
-        chat_template_override =
+        cfg.chat_template_override =
             "{% for message in messages %}"
             "<|im_start|>{{ message['role'] }}\n"
             "{{ message['content'] }}<|im_end|>\n"
@@ -654,7 +939,7 @@ void ModelState::apply_fallback_chat_template() {
     }
     else {
         // Generic ChatML fallback — works reasonably with most models
-        chat_template_override =
+        cfg.chat_template_override =
             "{% for message in messages %}"
             "<|im_start|>{{ message['role'] }}\n"
             "{{ message['content'] }}<|im_end|>\n"
@@ -669,15 +954,16 @@ void ModelState::apply_fallback_chat_template() {
 // STOP STRING DETECTION
 // ============================================================================
 
-void ModelState::detect_stop_strings() {
+void ModelState::detect_stop_strings(GenerationConfig& cfg) const {
+    std::vector<std::string>& stop_strings = cfg.stop_strings;
     stop_strings.clear();
 
     if (!model) return;
 
     // Use custom template if set, otherwise use model's built-in template
-    const char* tmpl = chat_template_override.empty()
+    const char* tmpl = cfg.chat_template_override.empty()
                        ? llama_model_chat_template(model, nullptr)
-                       : chat_template_override.c_str();
+                       : cfg.chat_template_override.c_str();
 
     bool matched_template = false;
 
@@ -741,7 +1027,7 @@ void ModelState::detect_stop_strings() {
         LOG_INFO("No chat template — using %zu fallback stop strings:", stop_strings.size());
     }
     for (const auto& s : stop_strings) {
-        LOG_INFO("  stop: \"%s\"", s.c_str());
+        LOG_DEBUG("  stop: \"%s\"", s.c_str());
     }
 }
 
@@ -788,10 +1074,10 @@ void ModelState::update_memory_metrics() {
         memory_metrics.peak_memory_bytes = current_total;
     }
 
-    LOG_INFO("Memory metrics updated: model=%zu MB, ctx=%zu MB, peak=%zu MB",
-             memory_metrics.model_size_bytes / (1024 * 1024),
-             memory_metrics.context_size_bytes / (1024 * 1024),
-             memory_metrics.peak_memory_bytes / (1024 * 1024));
+    LOG_DEBUG("Memory metrics updated: model=%zu MB, ctx=%zu MB, peak=%zu MB",
+              memory_metrics.model_size_bytes / (1024 * 1024),
+              memory_metrics.context_size_bytes / (1024 * 1024),
+              memory_metrics.peak_memory_bytes / (1024 * 1024));
 }
 
 size_t ModelState::estimate_context_memory(int32_t ctx_size, int32_t n_embd, int32_t n_layer) {
@@ -10,14 +10,19 @@
  * - Grammar caching for tool calls
  * - Configurable batch sizes for low-end devices
  * - Multi-turn tool calling with lazy grammar support
+ * - Configuration published as immutable snapshots (generation_config.h)
  */
 
 #include "llama.h"
+#include "generation_config.h"
+#include "../generation/generation_request.h"
+#include "../generation/token_arena.h"
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <functional>
-#include <jni.h>
 
 /**
  * Memory usage metrics for monitoring
@@ -30,25 +35,15 @@ struct MemoryMetrics {
 };
 
 /**
- * Grammar mode for tool calling
+ * LoRA adapter loaded against the resident base model.
+ * Adapters stay loaded; only their per-request scale changes.
  */
-enum class GrammarMode {
-    STRICT,  // Grammar active from first token (forces tool call output)
-    LAZY     // Grammar activates only on trigger pattern (model chooses tool vs text)
-};
-
-/**
- * Cached sampler parameters for multi-turn rebuilds
- */
-struct SamplerParams {
-    int topK = 40;
-    float topP = 0.9f;
-    float temp = 0.7f;
-    float minP = 0.05f;
-    int mirostat = 0;
-    float mirostatTau = 5.0f;
-    float mirostatEta = 0.1f;
-    int seed = -1;
+struct LoraAdapter {
+    std::string name;
+    std::string path;
+    llama_adapter_lora* adapter = nullptr;
+    float scale = 0.0f;          // Scale for requests submitted from now on (0 = inactive)
+    float applied_scale = 0.0f;  // Scale currently attached to the context
 };
 
 /**
@@ -62,38 +57,29 @@ public:
     llama_model* model = nullptr;
     llama_context* ctx = nullptr;
     llama_sampler* sampler = nullptr;
-    llama_sampler* grammar_sampler = nullptr;
+    uint64_t sampler_config_version = 0;  // Snapshot the chain was built from (0 = stale)
 
     // Configuration
     int32_t ctx_size = 0;
     int32_t batch_size = 512;
     int32_t ubatch_size = 256;  // Micro-batch size for low-end devices
 
-    // Chat/Tool state
-    std::string system_prompt;
-    std::string chat_template_override;
-    std::string tools_json;
-    bool tools_enabled = false;
-
-    // Grammar configuration
-    GrammarMode grammar_mode = GrammarMode::STRICT;
-    bool use_typed_grammar = true;  // Use parameter-aware GBNF
-
-    // Grammar caching for tool calls
-    std::string cached_tools_json;     // Last tools JSON used to build grammar
-    bool grammar_needs_rebuild = true;  // Flag to trigger grammar rebuild
-
-    // Cached sampler params for multi-turn rebuilds
-    SamplerParams cached_sampler_params;
+    // Prompts, tools, grammar, stop strings and sampler parameters.
+    // Read through config(), changed through update_config().
+    ConfigStore config_store;
 
     // UTF-8 carry buffer for incomplete sequences (legacy)
     std::string utf8_carry_buffer;
 
-    // Stop strings for detecting end-of-turn in generated text.
-    // Small/quantized models often emit turn markers (e.g. <end_of_turn>,
-    // <|im_end|>) as regular text tokens instead of the special EOT token.
-    // These strings are checked during generation to stop the loop.
-    std::vector<std::string> stop_strings;
+    // LoRA adapters (loaded once, activated/scaled per request). Guarded
+    // by lora_mtx: JNI setters run concurrently with the generation thread.
+    std::vector<LoraAdapter> lora_adapters;
+    mutable std::mutex lora_mtx;
+
+    // Reused decode batches (allocated on first use, freed in release())
+    llama_batch prompt_batch = {};
+    int32_t prompt_batch_capacity = 0;
+    llama_batch token_batch = {};
 
     // Memory tracking
     MemoryMetrics memory_metrics;
@@ -115,59 +101,117 @@ public:
     void release();
 
     /**
-     * Prepare for new generation (clears KV cache and sampler state)
+     * Prepare for new generation with the pinned snapshot `cfg`: clears
+     * the KV cache and resets the sampler chain, rebuilding it only if it
+     * was built from a different snapshot
+     */
+    void prepare_for_generation(const GenerationConfig& cfg);
+
+    /**
+     * Rebuild the sampler chain from `cfg`. The chain gets its own clone
+     * of the snapshot's grammar; `with_grammar = false` leaves it out
+     * (and marks the chain stale so the next request rebuilds it).
      */
-    void prepare_for_generation();
+    void rebuild_sampler(const GenerationConfig& cfg, bool with_grammar = true);
+
+    // ========================================================================
+    // CONFIGURATION SNAPSHOTS
+    // ========================================================================
 
     /**
-     * Rebuild sampler with new parameters
+     * Pin the current configuration. Lock-free for readers; the snapshot
+     * stays valid (and unchanged) for as long as it is held.
      */
-    void rebuild_sampler(
-            int topK,
-            float topP,
-            float temp,
-            float minP,
-            int mirostat,
-            float mirostatTau,
-            float mirostatEta,
-            int seed
-    );
+    ConfigSnapshot config() const {
+        return config_store.load();
+    }
 
     /**
-     * Rebuild sampler using cached parameters (for multi-turn)
-     * Each call creates a fresh grammar clone in the sampler chain
+     * Publish a new configuration: `edit` modifies a copy of the current
+     * one. The tool grammar is recompiled here, off the generation path,
+     * when the tools, grammar settings or model changed.
      */
-    void rebuild_sampler_cached();
+    template <typename Edit>
+    ConfigSnapshot update_config(Edit&& edit) {
+        return config_store.update([&](const GenerationConfig& prev, GenerationConfig& next) {
+            edit(next);
+            refresh_tool_grammar(prev, next);
+        });
+    }
 
     // ========================================================================
     // GRAMMAR MANAGEMENT (Optimized for low-end devices)
     // ========================================================================
 
     /**
-     * Initialize or update grammar sampler for tool calls
-     * Only rebuilds if tools_json has changed (caching)
-     * Respects grammar_mode (STRICT vs LAZY) and use_typed_grammar
+     * Keep prev's compiled tool grammar if nothing it depends on changed,
+     * otherwise compile a new one (or drop it when tools are disabled)
      */
-    void update_grammar_if_needed();
+    void refresh_tool_grammar(const GenerationConfig& prev, GenerationConfig& next) const;
 
     /**
-     * Reset grammar sampler state for reuse across turns
+     * Compile the tool-call grammar for `cfg`
+     * Respects grammar_mode (STRICT vs LAZY) and use_typed_grammar,
+     * falling back to the generic grammar and the other mode
      */
-    void reset_grammar_sampler();
+    SamplerHandle build_tool_grammar(const GenerationConfig& cfg) const;
 
     /**
-     * Check if grammar needs to be rebuilt
+     * Constrain output to a JSON Schema (compiled to GBNF, cached by hash).
+     * The next generation is constrained.
+     * Returns false if the schema can't be compiled; previous state is kept.
      */
-    bool needs_grammar_rebuild() const {
-        return grammar_needs_rebuild || (tools_json != cached_tools_json);
-    }
+    bool set_response_schema(const std::string& schema_json);
 
     /**
-     * Force grammar rebuild on next generation
+     * Drop the response schema and return to unconstrained output
      */
-    void invalidate_grammar() {
-        grammar_needs_rebuild = true;
-    }
+    void clear_response_schema();
+
+    // ========================================================================
+    // LORA ADAPTERS
+    // ========================================================================
+
+    /**
+     * Load a LoRA GGUF adapter against the current base model.
+     * Loading an already-loaded name is a no-op. New adapters start inactive.
+     */
+    bool load_lora_adapter(const std::string& name, const std::string& path);
+
+    /**
+     * Unload an adapter (detaches it from the context first)
+     */
+    bool unload_lora_adapter(const std::string& name);
+
+    /**
+     * Set the adapter mix for subsequent generations. Adapters not listed
+     * are deactivated; an empty list runs the plain base model.
+     * Returns false (and changes nothing) if a name is not loaded.
+     */
+    bool set_lora_mix(const std::vector<std::string>& names, const std::vector<float>& scales);
+
+    /**
+     * The current mix (active adapters and their scales), captured by each
+     * request when it is submitted
+     */
+    LoraMix lora_mix() const;
+
+    /**
+     * Names of the loaded adapters
+     */
+    std::vector<std::string> lora_adapter_names() const;
+
+    /**
+     * File an adapter was loaded from (empty if `name` is not loaded)
+     */
+    std::string lora_adapter_path(const std::string& name) const;
+
+    /**
+     * Attach/detach adapters so the context runs `mix`, touching only
+     * those whose scale changed since the last generation - no reload.
+     * Adapters unloaded since the mix was captured are skipped.
+     */
+    void apply_lora_adapters(const LoraMix& mix);
 
     // ========================================================================
     // TOKENIZATION
@@ -184,6 +228,12 @@ public:
      */
     std::string detokenize_single(llama_token t) const;
 
+    /**
+     * Detokenize into the per-session arena (allocation-free hot path).
+     * The view is valid until the arena is reset.
+     */
+    std::string_view detokenize(llama_token t, TokenArena& arena) const;
+
     /**
      * Detokenize with UTF-8 buffering (legacy)
      * Handles incomplete UTF-8 sequences
@@ -205,14 +255,24 @@ public:
     // ========================================================================
 
     /**
-     * Decode prompt tokens (prefill phase)
+     * Decode prompt tokens (prefill phase).
+     * With a request, stops between batch-sized chunks once it is
+     * cancelled or past its deadline and returns false (check
+     * req->should_stop() to tell that apart from a decode failure).
+     */
+    bool decode_prompt(const std::vector<llama_token>& toks,
+                       const GenerationRequest* req = nullptr);
+
+    /**
+     * Decode one generated token at `pos` (logits requested).
+     * Returns the llama_decode result (0 = success).
      */
-    bool decode_prompt(const std::vector<llama_token>& toks) const;
+    int32_t decode_token(llama_token tok, llama_pos pos);
 
     /**
      * Warm up context
      */
-    void warmup_context() const;
+    void warmup_context();
 
     // ========================================================================
     // MEMORY MANAGEMENT
@@ -244,20 +304,24 @@ public:
      * broken "User: / Assistant:" fallback.
      * Called after model loading, before detect_stop_strings().
      */
-    void apply_fallback_chat_template();
+    void apply_fallback_chat_template(GenerationConfig& cfg) const;
 
     /**
      * Auto-detect stop strings from the model's chat template.
      * Called after model loading and after setting a custom chat template.
      * Detects turn boundary markers for Gemma, ChatML, Llama3, Phi, etc.
+     *
+     * Small/quantized models often emit turn markers (e.g. <end_of_turn>,
+     * <|im_end|>) as regular text tokens instead of the special EOT token;
+     * the generation loop stops on these strings.
      */
-    void detect_stop_strings();
+    void detect_stop_strings(GenerationConfig& cfg) const;
 
     // ========================================================================
     // STATE PERSISTENCE
     // ========================================================================
 
-    jlong get_state_size() const;
+    size_t get_state_size() const;
     void* get_state_data(void* buffer, size_t size) const;
     bool load_state_data(const void* data, size_t size) const;
 };
@@ -5,11 +5,10 @@
 #include <sstream>
 #include <algorithm>
 
-#include <jni.h>
 #include <string>
 #include <mutex>
 
-bool ToolCallState::accumulate(const std::string& chunk) {
+bool ToolCallState::accumulate(std::string_view chunk) {
     for (char c : chunk) {
         if (!collecting) {
             if (c == '{') {
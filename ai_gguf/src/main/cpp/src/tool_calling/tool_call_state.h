@@ -23,7 +23,7 @@ public:
 
     // Called for every generated piece; returns true when
     // a complete JSON object has been accumulated.
-    bool accumulate(const std::string& chunk);
+    bool accumulate(std::string_view chunk);
 
     // Fast check if chunk might start a tool call (optimization)
     bool might_be_tool_call(const std::string& chunk) const;
@@ -1,10 +1,14 @@
 /**
- * Optimized JNI utility functions for token streaming
- * 
+ * JNI bridge for token streaming and embedding callbacks
+ *
  * Optimizations:
- * 1. Thread-local caching of JNI method IDs
- * 2. Global reference for callback class (prevents repeated lookups)
- * 3. Fast path for ASCII tokens
+ * 1. Class references resolved once in JNI_OnLoad (no FindClass per call,
+ *    works from threads without an app class loader)
+ * 2. Per-class method ID cache: a fixed table of atomically published
+ *    entries, so lookups never take a lock and never go stale when a
+ *    different callback class shows up
+ * 3. Callbacks are resolved once per request (StreamCallback), leaving a
+ *    single upcall per token
  * 4. Immediate delivery - no buffering
  */
 
@@ -19,150 +23,296 @@
 namespace jni {
 
 // ============================================================================
-// JNI CALLBACK CACHE
-// Thread-local for multi-threaded safety
+// PER-CLASS METHOD CACHE
 // ============================================================================
 
     namespace {
 
-        struct CallbackCache {
-            jclass cls = nullptr;
-            jmethodID onToken = nullptr;
-            jmethodID onError = nullptr;
-            jmethodID onToolCall = nullptr;
-            jmethodID onDone = nullptr;
-            bool initialized = false;
-
-            void init(JNIEnv* env, jobject callback) {
-                if (initialized) return;
-
-                jclass tempCls = env->GetObjectClass(callback);
-                if (!tempCls) {
-                    LOG_ERROR("jni_utils: unable to find callback class");
-                    return;
+        /**
+         * Lock-free map jclass -> Methods. Entries are published with a CAS
+         * into the first free slot and stay until on_unload; readers scan
+         * the published prefix comparing with IsSameObject. Two threads
+         * resolving the same new class concurrently is harmless - the
+         * loser drops its copy.
+         */
+        template <typename Methods>
+        class MethodCache {
+        public:
+            using Resolver = void (*)(JNIEnv*, jclass, Methods&);
+
+            explicit MethodCache(Resolver resolve) : resolve_(resolve) {}
+
+            const Methods& get(JNIEnv* env, jobject obj) {
+                if (!obj) return empty_;
+
+                jclass cls = env->GetObjectClass(obj);
+                if (!cls) {
+                    LOG_ERROR("jni: unable to get callback class");
+                    return empty_;
                 }
 
-                // Create global reference to class (survives across JNI calls)
-                cls = static_cast<jclass>(env->NewGlobalRef(tempCls));
-                env->DeleteLocalRef(tempCls);
+                const Methods& methods = find_or_insert(env, cls);
+                env->DeleteLocalRef(cls);
+                return methods;
+            }
 
-                // Cache method IDs (these don't change for a class)
-                onToken = env->GetMethodID(cls, "onToken", "(Ljava/lang/String;)V");
-                onError = env->GetMethodID(cls, "onError", "(Ljava/lang/String;)V");
-                onToolCall = env->GetMethodID(cls, "onToolCall", "(Ljava/lang/String;Ljava/lang/String;)V");
-                onDone = env->GetMethodID(cls, "onDone", "()V");
+            void clear(JNIEnv* env) {
+                for (auto& slot : slots_) {
+                    Entry* e = slot.exchange(nullptr, std::memory_order_acq_rel);
+                    if (!e) continue;
+                    env->DeleteGlobalRef(e->cls);
+                    delete e;
+                }
+            }
 
-                if (!onToken || !onError || !onToolCall || !onDone) {
-                    LOG_ERROR("jni_utils: failed to find callback methods");
+        private:
+            struct Entry {
+                jclass cls;
+                Methods methods;
+            };
+
+            // Callback implementations seen by one process; in practice 1-3
+            static constexpr size_t MAX_CLASSES = 16;
+
+            const Methods& find_or_insert(JNIEnv* env, jclass cls) {
+                size_t i = 0;
+                for (; i < MAX_CLASSES; ++i) {
+                    Entry* e = slots_[i].load(std::memory_order_acquire);
+                    if (!e) break;
+                    if (env->IsSameObject(e->cls, cls)) return e->methods;
                 }
 
-                initialized = true;
+                // First sight of this class: resolve, then publish
+                auto* fresh = new Entry{static_cast<jclass>(env->NewGlobalRef(cls)), {}};
+                resolve_(env, fresh->cls, fresh->methods);
+
+                for (; i < MAX_CLASSES; ++i) {
+                    Entry* expected = nullptr;
+                    if (slots_[i].compare_exchange_strong(expected, fresh,
+                                                          std::memory_order_acq_rel)) {
+                        return fresh->methods;
+                    }
+                    if (env->IsSameObject(expected->cls, cls)) {
+                        discard(env, fresh);
+                        return expected->methods;
+                    }
+                }
+
+                // Table full: serve a per-thread copy instead of growing
+                LOG_WARN("jni: method cache full, callback class not cached");
+                static thread_local Methods overflow;
+                overflow = fresh->methods;
+                discard(env, fresh);
+                return overflow;
             }
 
-            void release(JNIEnv* env) {
-                if (cls) {
-                    env->DeleteGlobalRef(cls);
-                    cls = nullptr;
-                }
-                onToken = nullptr;
-                onError = nullptr;
-                onToolCall = nullptr;
-                onDone = nullptr;
-                initialized = false;
+            static void discard(JNIEnv* env, Entry* e) {
+                env->DeleteGlobalRef(e->cls);
+                delete e;
             }
+
+            Resolver resolve_;
+            std::atomic<Entry*> slots_[MAX_CLASSES] = {};
+            Methods empty_{};
         };
 
-// Thread-local cache for multi-threaded environments
-        static thread_local CallbackCache g_cache;
+        // Missing methods are logged and left null; the lookup must not
+        // leave a NoSuchMethodError pending for the next JNI call.
+        jmethodID find_method(JNIEnv* env, jclass cls, const char* name, const char* sig) {
+            jmethodID id = env->GetMethodID(cls, name, sig);
+            if (!id) {
+                env->ExceptionClear();
+                LOG_ERROR("jni: callback method %s%s not found", name, sig);
+            }
+            return id;
+        }
+
+        void resolve_stream(JNIEnv* env, jclass cls, StreamMethods& m) {
+            m.on_token = find_method(env, cls, "onToken", "(Ljava/lang/String;)V");
+            m.on_error = find_method(env, cls, "onError", "(Ljava/lang/String;)V");
+            m.on_tool_call = find_method(env, cls, "onToolCall",
+                                         "(Ljava/lang/String;Ljava/lang/String;)V");
+            m.on_done = find_method(env, cls, "onDone", "()V");
+            m.on_metrics = find_method(env, cls, "onMetrics",
+                                       "(Lcom/mp/ai_gguf/models/DecodingMetrics;)V");
+        }
+
+        void resolve_embedding(JNIEnv* env, jclass cls, EmbeddingMethods& m) {
+            m.on_progress = find_method(env, cls, "onProgress", "(FII)V");
+            m.on_complete = find_method(env, cls, "onComplete",
+                                        "(Lcom/mp/ai_gguf/models/EmbeddingResult;)V");
+            m.on_error = find_method(env, cls, "onError", "(Ljava/lang/String;)V");
+        }
+
+        MethodCache<StreamMethods> g_stream_cache{resolve_stream};
+        MethodCache<EmbeddingMethods> g_embedding_cache{resolve_embedding};
 
-// Global cache reset flag
-        static std::atomic<bool> g_cache_reset_requested{false};
+        JavaVM* g_vm = nullptr;
+        ClassCache g_classes;
+
+        jclass global_class(JNIEnv* env, const char* name) {
+            jclass local = env->FindClass(name);
+            if (!local) {
+                env->ExceptionClear();
+                LOG_ERROR("jni: class %s not found", name);
+                return nullptr;
+            }
+            auto global = static_cast<jclass>(env->NewGlobalRef(local));
+            env->DeleteLocalRef(local);
+            return global;
+        }
+
+        jmethodID constructor(JNIEnv* env, jclass cls, const char* sig) {
+            if (!cls) return nullptr;
+            jmethodID id = env->GetMethodID(cls, "<init>", sig);
+            if (!id) {
+                env->ExceptionClear();
+                LOG_ERROR("jni: constructor %s not found", sig);
+            }
+            return id;
+        }
+
+        void delete_global(JNIEnv* env, jclass& cls) {
+            if (cls) {
+                env->DeleteGlobalRef(cls);
+                cls = nullptr;
+            }
+        }
 
     } // anonymous namespace
 
 // ============================================================================
-// PUBLIC API
+// LIBRARY LIFETIME
 // ============================================================================
 
-    void on_token(JNIEnv* env, jobject cb, const std::string& txt) {
-        if (!cb || txt.empty()) return;
+    void on_load(JavaVM* vm, JNIEnv* env) {
+        g_vm = vm;
 
-        // Check for reset request
-        if (g_cache_reset_requested.exchange(false)) {
-            g_cache.release(env);
-        }
+        g_classes.string = global_class(env, "java/lang/String");
 
-        g_cache.init(env, cb);
-        if (!g_cache.onToken) return;
+        g_classes.decoding_metrics = global_class(env, "com/mp/ai_gguf/models/DecodingMetrics");
+        g_classes.decoding_metrics_init = constructor(env, g_classes.decoding_metrics, "(IIIFJJ)V");
 
-        // Create Java string from UTF-8
-        jstring jstr = nullptr;
+        g_classes.embedding_result = global_class(env, "com/mp/ai_gguf/models/EmbeddingResult");
+        g_classes.embedding_result_init = constructor(env, g_classes.embedding_result,
+                                                      "([FILjava/lang/String;IJ)V");
+    }
 
-        // Fast path: check if ASCII-only (most common case for LLM tokens)
-        bool is_ascii = true;
-        for (unsigned char c : txt) {
-            if (c >= 0x80) {
-                is_ascii = false;
-                break;
-            }
+    void on_unload(JNIEnv* env) {
+        g_stream_cache.clear(env);
+        g_embedding_cache.clear(env);
+
+        delete_global(env, g_classes.string);
+        delete_global(env, g_classes.decoding_metrics);
+        delete_global(env, g_classes.embedding_result);
+        g_classes = {};
+        g_vm = nullptr;
+    }
+
+    JavaVM* vm() {
+        return g_vm;
+    }
+
+    const ClassCache& classes() {
+        return g_classes;
+    }
+
+    bool register_natives(JNIEnv* env, const char* class_name,
+                          const JNINativeMethod* methods, size_t count) {
+        jclass cls = env->FindClass(class_name);
+        if (!cls) {
+            LOG_ERROR("jni: cannot register natives, class %s not found", class_name);
+            return false;
         }
 
-        if (is_ascii) {
-            // Fast path: ASCII-only, use NewStringUTF directly
-            jstr = env->NewStringUTF(txt.c_str());
-        } else {
-            // Slow path: full UTF-8 to UTF-16 conversion
-            jstr = utf8::to_jstring_immediate(env, txt);
+        const jint rc = env->RegisterNatives(cls, methods, static_cast<jint>(count));
+        env->DeleteLocalRef(cls);
+        if (rc != JNI_OK) {
+            LOG_ERROR("jni: RegisterNatives failed for %s (%d)", class_name, rc);
+            return false;
         }
+        return true;
+    }
 
-        if (jstr) {
-            // Call Java callback
-            env->CallVoidMethod(cb, g_cache.onToken, jstr);
+    const StreamMethods& stream_methods(JNIEnv* env, jobject cb) {
+        return g_stream_cache.get(env, cb);
+    }
 
-            // Clean up local reference
-            env->DeleteLocalRef(jstr);
-        }
+    const EmbeddingMethods& embedding_methods(JNIEnv* env, jobject cb) {
+        return g_embedding_cache.get(env, cb);
     }
 
-    void on_error(JNIEnv* env, jobject cb, const char* msg) {
-        if (!cb) return;
+// ============================================================================
+// STREAM CALLBACK
+// ============================================================================
+
+    StreamCallback::StreamCallback(JNIEnv* env, jobject obj)
+            : env_(env), obj_(obj), methods_(stream_methods(env, obj)) {}
 
-        g_cache.init(env, cb);
-        if (!g_cache.onError) return;
+    void StreamCallback::on_token(std::string_view txt) const {
+        if (!methods_.on_token || txt.empty()) return;
 
-        jstring jmsg = env->NewStringUTF(msg ? msg : "<unknown error>");
-        env->CallVoidMethod(cb, g_cache.onError, jmsg);
-        env->DeleteLocalRef(jmsg);
+        // Vectorized transcode through a reused UTF-16 buffer
+        jstring jstr = utf8::to_jstring_immediate(env_, txt);
+        if (jstr) {
+            env_->CallVoidMethod(obj_, methods_.on_token, jstr);
+            env_->DeleteLocalRef(jstr);
+        }
     }
 
-    void on_toolcall(JNIEnv* env, jobject cb,
-                     const std::string& name,
-                     const std::string& payload) {
-        if (!cb) return;
+    void StreamCallback::on_error(const char* msg) const {
+        if (!methods_.on_error) return;
+
+        jstring jmsg = env_->NewStringUTF(msg ? msg : "<unknown error>");
+        env_->CallVoidMethod(obj_, methods_.on_error, jmsg);
+        env_->DeleteLocalRef(jmsg);
+    }
 
-        g_cache.init(env, cb);
-        if (!g_cache.onToolCall) return;
+    void StreamCallback::on_toolcall(const std::string& name, const std::string& payload) const {
+        if (!methods_.on_tool_call) return;
 
-        jstring jname = env->NewStringUTF(name.c_str());
-        jstring jpayload = utf8::to_jstring_immediate(env, payload);
+        jstring jname = env_->NewStringUTF(name.c_str());
+        jstring jpayload = utf8::to_jstring_immediate(env_, payload);
 
-        env->CallVoidMethod(cb, g_cache.onToolCall, jname, jpayload);
+        env_->CallVoidMethod(obj_, methods_.on_tool_call, jname, jpayload);
 
-        env->DeleteLocalRef(jname);
-        env->DeleteLocalRef(jpayload);
+        env_->DeleteLocalRef(jname);
+        env_->DeleteLocalRef(jpayload);
     }
 
-    void on_done(JNIEnv* env, jobject cb) {
-        if (!cb) return;
+    void StreamCallback::on_metrics(jobject metrics) const {
+        if (!methods_.on_metrics || !metrics) return;
+        env_->CallVoidMethod(obj_, methods_.on_metrics, metrics);
+    }
 
-        g_cache.init(env, cb);
-        if (!g_cache.onDone) return;
+    void StreamCallback::on_done() const {
+        if (!methods_.on_done) return;
+        env_->CallVoidMethod(obj_, methods_.on_done);
+    }
 
-        env->CallVoidMethod(cb, g_cache.onDone);
+// ============================================================================
+// EMBEDDING CALLBACK
+// ============================================================================
+
+    EmbeddingCallback::EmbeddingCallback(JNIEnv* env, jobject obj)
+            : env_(env), obj_(obj), methods_(embedding_methods(env, obj)) {}
+
+    void EmbeddingCallback::on_progress(float progress, int32_t current, int32_t total) const {
+        if (!methods_.on_progress) return;
+        env_->CallVoidMethod(obj_, methods_.on_progress, progress, current, total);
     }
 
-    void reset_cache() {
-        g_cache_reset_requested.store(true, std::memory_order_relaxed);
+    void EmbeddingCallback::on_complete(jobject result) const {
+        if (!methods_.on_complete || !result) return;
+        env_->CallVoidMethod(obj_, methods_.on_complete, result);
+    }
+
+    void EmbeddingCallback::on_error(const char* msg) const {
+        if (!methods_.on_error) return;
+
+        jstring jmsg = env_->NewStringUTF(msg ? msg : "<unknown error>");
+        env_->CallVoidMethod(obj_, methods_.on_error, jmsg);
+        env_->DeleteLocalRef(jmsg);
     }
 
-} // namespace jni
\ No newline at end of file
+} // namespace jni
@@ -1,46 +1,140 @@
 #pragma once
 
 /**
- * Optimized JNI utility functions for token streaming
- * 
+ * JNI bridge: library load hooks, native registration and callback dispatch
+ *
  * Features:
- * - Cached JNI method IDs for minimal lookup overhead
- * - Thread-safe caching
+ * - Everything class-related is resolved once in JNI_OnLoad, on the app
+ *   class loader, so any thread (including native ones) can use it
+ * - Natives are bound with RegisterNatives instead of dlsym name lookup
+ * - Callback method IDs are cached per callback class in a lock-free
+ *   table: several callback implementations can be used side by side, and
+ *   a new thread costs nothing
  * - Immediate token delivery without buffering
  */
 
 #include <jni.h>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace jni {
 
 /**
- * Send a token to the Java callback immediately
- * No buffering - each token is delivered as soon as it's decoded
+ * Library lifetime. Call from JNI_OnLoad / JNI_OnUnload.
+ * on_load() caches the JavaVM and the model classes. A model class that
+ * can't be found is logged and left null; callbacks that need it are
+ * skipped.
  */
-    void on_token(JNIEnv* env, jobject cb, const std::string& txt);
+    void on_load(JavaVM* vm, JNIEnv* env);
+    void on_unload(JNIEnv* env);
 
 /**
- * Send an error message to the Java callback
+ * JavaVM captured in on_load (nullptr before)
  */
-    void on_error(JNIEnv* env, jobject cb, const char* msg);
+    JavaVM* vm();
 
 /**
- * Send a tool call to the Java callback
+ * Global references resolved in on_load
  */
-    void on_toolcall(JNIEnv* env, jobject cb,
-                     const std::string& name,
-                     const std::string& payload);
+    struct ClassCache {
+        jclass string = nullptr;
+
+        jclass decoding_metrics = nullptr;
+        jmethodID decoding_metrics_init = nullptr;      // (IIIFJJ)V
+
+        jclass embedding_result = nullptr;
+        jmethodID embedding_result_init = nullptr;      // ([FILjava/lang/String;IJ)V
+    };
+
+    const ClassCache& classes();
 
 /**
- * Signal completion to the Java callback
+ * Bind a table of natives to a class. Logs and returns false on failure
+ * (a pending NoSuchMethodError is left for the VM to report).
  */
-    void on_done(JNIEnv* env, jobject cb);
+    bool register_natives(JNIEnv* env, const char* class_name,
+                          const JNINativeMethod* methods, size_t count);
 
 /**
- * Reset cached JNI references
- * Call this if the callback class might have changed
+ * Method IDs of a StreamCallback implementation. Missing optional
+ * methods are nullptr.
  */
-    void reset_cache();
+    struct StreamMethods {
+        jmethodID on_token = nullptr;
+        jmethodID on_error = nullptr;
+        jmethodID on_tool_call = nullptr;
+        jmethodID on_done = nullptr;
+        jmethodID on_metrics = nullptr;
+    };
+
+/**
+ * Method IDs of an EmbeddingCallback implementation
+ */
+    struct EmbeddingMethods {
+        jmethodID on_progress = nullptr;
+        jmethodID on_complete = nullptr;
+        jmethodID on_error = nullptr;
+    };
+
+/**
+ * Cached method IDs for the callback object's class. The first call for a
+ * class resolves and publishes them; later calls are a lock-free scan.
+ */
+    const StreamMethods& stream_methods(JNIEnv* env, jobject cb);
+    const EmbeddingMethods& embedding_methods(JNIEnv* env, jobject cb);
+
+/**
+ * StreamCallback bound for the duration of one native call. Resolve it
+ * once per request; each on_* is then a single JNI upcall.
+ * A null callback object is allowed - every call becomes a no-op.
+ */
+    class StreamCallback {
+    public:
+        StreamCallback(JNIEnv* env, jobject obj);
+
+        /**
+         * Send a token immediately - no buffering
+         */
+        void on_token(std::string_view txt) const;
+
+        void on_error(const char* msg) const;
+
+        void on_toolcall(const std::string& name, const std::string& payload) const;
+
+        /**
+         * `metrics` is a DecodingMetrics instance (see classes())
+         */
+        void on_metrics(jobject metrics) const;
+
+        void on_done() const;
+
+    private:
+        JNIEnv* env_;
+        jobject obj_;
+        const StreamMethods& methods_;
+    };
+
+/**
+ * EmbeddingCallback bound for the duration of one native call
+ */
+    class EmbeddingCallback {
+    public:
+        EmbeddingCallback(JNIEnv* env, jobject obj);
+
+        void on_progress(float progress, int32_t current, int32_t total) const;
+
+        /**
+         * `result` is an EmbeddingResult instance (see classes())
+         */
+        void on_complete(jobject result) const;
+
+        void on_error(const char* msg) const;
+
+    private:
+        JNIEnv* env_;
+        jobject obj_;
+        const EmbeddingMethods& methods_;
+    };
 
-} // namespace jni
\ No newline at end of file
+} // namespace jni
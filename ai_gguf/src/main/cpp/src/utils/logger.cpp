@@ -0,0 +1,495 @@
+/*=============================================================
+ *   utils/logger.cpp
+ *=============================================================
+ *
+ *  Per-thread SPSC byte rings + one formatting thread.
+ *
+ *  Ring record:  [RecordHeader][arg]...   (8-byte aligned)
+ *  arg:          tag byte + 8-byte value, or
+ *                's' + u16 length + bytes + NUL
+ *
+ *  The consumer wakes on a short timer that backs off while idle,
+ *  or immediately for errors/warnings and when a ring is half full.
+ *============================================================*/
+
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+namespace logger {
+
+    namespace {
+
+        struct RecordHeader {
+            uint32_t size;      // whole record incl. header and padding; PAD_FLAG = skip
+            uint16_t level;
+            uint16_t nargs;
+            const char* fmt;
+        };
+
+        constexpr uint32_t PAD_FLAG = 0x80000000u;
+        constexpr size_t RING_CAPACITY = 64 * 1024;  // per thread, power of two
+        constexpr size_t MAX_LINE = 2048;
+
+        constexpr size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+        /**
+         * Single-producer (owning thread) / single-consumer (log thread)
+         * byte ring. head_/tail_ are monotonically increasing byte counts.
+         */
+        class Ring {
+        public:
+            Ring() : buf_(new char[RING_CAPACITY]) {}
+
+            char* reserve(size_t n) {
+                const size_t head = head_.load(std::memory_order_relaxed);
+                const size_t tail = tail_.load(std::memory_order_acquire);
+                const size_t off = head & (RING_CAPACITY - 1);
+                const size_t contiguous = RING_CAPACITY - off;
+                const size_t pad = contiguous < n ? contiguous : 0;
+
+                if (head + pad + n - tail > RING_CAPACITY) return nullptr;
+
+                if (pad) {
+                    const uint32_t marker = static_cast<uint32_t>(pad) | PAD_FLAG;
+                    std::memcpy(buf_.get() + off, &marker, sizeof(marker));
+                }
+                pending_head_ = head + pad + n;
+                return buf_.get() + ((head + pad) & (RING_CAPACITY - 1));
+            }
+
+            void commit() {
+                head_.store(pending_head_, std::memory_order_release);
+            }
+
+            size_t used() const {
+                return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+            }
+
+            template <typename Fn>
+            bool drain(Fn&& fn) {
+                size_t tail = tail_.load(std::memory_order_relaxed);
+                const size_t head = head_.load(std::memory_order_acquire);
+                if (tail == head) return false;
+
+                while (tail != head) {
+                    const char* rec = buf_.get() + (tail & (RING_CAPACITY - 1));
+                    uint32_t size;
+                    std::memcpy(&size, rec, sizeof(size));
+                    if (!(size & PAD_FLAG)) fn(rec);
+                    tail += size & ~PAD_FLAG;
+                }
+                tail_.store(tail, std::memory_order_release);
+                return true;
+            }
+
+            void retire() { retired_.store(true, std::memory_order_release); }
+            bool retired() const { return retired_.load(std::memory_order_acquire); }
+
+        private:
+            std::unique_ptr<char[]> buf_;
+            alignas(64) std::atomic<size_t> head_{0};
+            size_t pending_head_ = 0;
+            alignas(64) std::atomic<size_t> tail_{0};
+            std::atomic<bool> retired_{false};
+        };
+
+        // ====================================================================
+        // FORMATTING (consumer side)
+        // ====================================================================
+
+        struct ArgReader {
+            const char* p;
+            const char* end;
+
+            bool next(uint8_t& tag, uint64_t& bits, const char*& str) {
+                if (p >= end) return false;
+                tag = static_cast<uint8_t>(*p++);
+                if (tag == detail::ARG_STRING) {
+                    uint16_t n;
+                    std::memcpy(&n, p, 2);
+                    str = p + 2;
+                    p += 2 + n + 1;
+                } else {
+                    std::memcpy(&bits, p, 8);
+                    p += 8;
+                }
+                return true;
+            }
+        };
+
+        inline double as_double(uint64_t bits) {
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+
+        void append(std::string& out, const char* spec, uint8_t tag, uint64_t bits,
+                    const char* str, char conv) {
+            char buf[512];
+            int n = 0;
+
+            switch (conv) {
+                case 'd': case 'i': case 'c': {
+                    long long v = tag == detail::ARG_DOUBLE
+                                  ? static_cast<long long>(as_double(bits))
+                                  : static_cast<long long>(bits);
+                    if (conv == 'c') n = std::snprintf(buf, sizeof(buf), spec, static_cast<int>(v));
+                    else n = std::snprintf(buf, sizeof(buf), spec, v);
+                    break;
+                }
+                case 'u': case 'o': case 'x': case 'X': {
+                    unsigned long long v = tag == detail::ARG_DOUBLE
+                                           ? static_cast<unsigned long long>(as_double(bits))
+                                           : static_cast<unsigned long long>(bits);
+                    n = std::snprintf(buf, sizeof(buf), spec, v);
+                    break;
+                }
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                    double v;
+                    if (tag == detail::ARG_DOUBLE) v = as_double(bits);
+                    else if (tag == detail::ARG_INT) v = static_cast<double>(static_cast<int64_t>(bits));
+                    else v = static_cast<double>(bits);
+                    n = std::snprintf(buf, sizeof(buf), spec, v);
+                    break;
+                }
+                case 's':
+                    if (tag == detail::ARG_STRING) {
+                        // Strings can exceed buf; format directly when no width/precision
+                        if (spec[1] == 's') {
+                            out += str;
+                            return;
+                        }
+                        n = std::snprintf(buf, sizeof(buf), spec, str);
+                    } else {
+                        n = std::snprintf(buf, sizeof(buf), "(?)");
+                    }
+                    break;
+                case 'p':
+                    n = std::snprintf(buf, sizeof(buf), spec,
+                                      reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+                    break;
+                default:
+                    return;
+            }
+
+            if (n > 0) out.append(buf, std::min<size_t>(static_cast<size_t>(n), sizeof(buf) - 1));
+        }
+
+        /**
+         * printf-style formatting from recorded arguments. Each conversion
+         * is rendered on its own with the length modifier normalised to the
+         * recorded 64-bit width, so no va_list has to be rebuilt.
+         */
+        void format_record(const char* rec, std::string& out) {
+            RecordHeader h;
+            std::memcpy(&h, rec, sizeof(h));
+            ArgReader args{rec + sizeof(RecordHeader), rec + (h.size & ~PAD_FLAG)};
+
+            out.clear();
+            const char* f = h.fmt;
+            while (*f) {
+                if (*f != '%') {
+                    const char* run = f;
+                    while (*f && *f != '%') ++f;
+                    out.append(run, static_cast<size_t>(f - run));
+                    continue;
+                }
+                if (f[1] == '%') {
+                    out += '%';
+                    f += 2;
+                    continue;
+                }
+
+                // %[flags][width][.precision][length]conv
+                char spec[32];
+                size_t s = 0;
+                spec[s++] = *f++;
+                while (*f && std::strchr("-+ #0", *f) && s < 8) spec[s++] = *f++;
+
+                uint8_t tag = 0;
+                uint64_t bits = 0;
+                const char* str = nullptr;
+
+                auto star = [&]() {
+                    // '*' width/precision consumes an int argument
+                    int v = 0;
+                    if (args.next(tag, bits, str)) v = static_cast<int>(static_cast<int64_t>(bits));
+                    s += static_cast<size_t>(std::snprintf(spec + s, sizeof(spec) - s - 4, "%d", v));
+                    ++f;
+                };
+
+                if (*f == '*') star();
+                while (*f >= '0' && *f <= '9' && s < 20) spec[s++] = *f++;
+                if (*f == '.') {
+                    spec[s++] = *f++;
+                    if (*f == '*') star();
+                    while (*f >= '0' && *f <= '9' && s < 26) spec[s++] = *f++;
+                }
+                while (*f && std::strchr("hlLqjzt", *f)) ++f;  // replaced below
+
+                const char conv = *f;
+                if (!conv) break;
+                ++f;
+
+                if (std::strchr("diuoxX", conv)) {
+                    spec[s++] = 'l';
+                    spec[s++] = 'l';
+                }
+                spec[s++] = conv;
+                spec[s] = '\0';
+
+                if (!args.next(tag, bits, str)) {
+                    out += "(missing)";
+                    continue;
+                }
+                append(out, spec, tag, bits, str, conv);
+            }
+
+            if (out.size() > MAX_LINE) out.resize(MAX_LINE);
+        }
+
+        void emit(Level level, const std::string& line) {
+#if defined(__ANDROID__)
+            int prio = ANDROID_LOG_INFO;
+            switch (level) {
+                case Level::Error:   prio = ANDROID_LOG_ERROR; break;
+                case Level::Warning: prio = ANDROID_LOG_WARN;  break;
+                case Level::Info:    prio = ANDROID_LOG_INFO;  break;
+                case Level::Debug:   prio = ANDROID_LOG_DEBUG; break;
+            }
+            __android_log_write(prio, "ai_core", line.c_str());
+#else
+            FILE* stream = (level == Level::Error || level == Level::Warning) ? stderr : stdout;
+            std::fwrite(line.data(), 1, line.size(), stream);
+            std::fputc('\n', stream);
+#endif
+        }
+
+        // ====================================================================
+        // BACKGROUND THREAD
+        // ====================================================================
+
+        class Backend {
+        public:
+            static Backend& instance() {
+                static Backend* backend = new Backend();  // outlives static destructors
+                return *backend;
+            }
+
+            Ring* register_thread() {
+                auto* ring = new Ring();
+                {
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    rings_.push_back(ring);
+                    if (!started_) {
+                        started_ = true;
+                        worker_ = std::thread([this] { run(); });
+                        std::atexit([] { Backend::instance().stop(); });
+                    }
+                }
+                return ring;
+            }
+
+            void wake() {
+                wake_requested_.store(true, std::memory_order_relaxed);
+                cv_.notify_one();
+            }
+
+            void flush() {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (!started_ || stopped_) return;
+                const uint64_t target = ++flush_requested_;
+                wake_requested_.store(true, std::memory_order_relaxed);
+                cv_.notify_one();
+                flushed_cv_.wait(lock, [&] { return flush_done_ >= target || stopped_; });
+            }
+
+            void stop() {
+                {
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    if (!started_ || stopped_) return;
+                    stopping_ = true;
+                }
+                cv_.notify_one();
+                if (worker_.joinable()) worker_.join();
+            }
+
+            bool stopped() const { return stopped_flag_.load(std::memory_order_acquire); }
+
+            std::atomic<uint64_t> dropped{0};
+
+        private:
+            void run() {
+                std::string line;
+                line.reserve(MAX_LINE);
+                std::vector<Ring*> snapshot;
+                auto idle_wait = std::chrono::milliseconds(10);
+                uint64_t reported_drops = 0;
+
+                for (;;) {
+                    uint64_t flush_target;
+                    bool stopping;
+                    {
+                        std::lock_guard<std::mutex> lock(mtx_);
+                        snapshot = rings_;
+                        flush_target = flush_requested_;
+                        stopping = stopping_;
+                    }
+
+                    bool any = false;
+                    for (Ring* ring : snapshot) {
+                        any |= ring->drain([&](const char* rec) {
+                            RecordHeader h;
+                            std::memcpy(&h, rec, sizeof(h));
+                            format_record(rec, line);
+                            emit(static_cast<Level>(h.level), line);
+                        });
+                    }
+
+                    const uint64_t drops = dropped.load(std::memory_order_relaxed);
+                    if (drops != reported_drops) {
+                        char msg[96];
+                        std::snprintf(msg, sizeof(msg), "logger: %llu records dropped (ring full)",
+                                      static_cast<unsigned long long>(drops - reported_drops));
+                        emit(Level::Warning, msg);
+                        reported_drops = drops;
+                    }
+
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    // Free rings of exited threads once they are empty
+                    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](Ring* r) {
+                        if (r->retired() && r->used() == 0) {
+                            delete r;
+                            return true;
+                        }
+                        return false;
+                    }), rings_.end());
+
+                    if (flush_target > flush_done_) {
+                        flush_done_ = flush_target;
+                        flushed_cv_.notify_all();
+                    }
+                    if (stopping) {
+                        stopped_ = true;
+                        stopped_flag_.store(true, std::memory_order_release);
+                        flushed_cv_.notify_all();
+                        return;
+                    }
+
+                    // Back off while idle so an idle app isn't woken 100x/s
+                    idle_wait = any ? std::chrono::milliseconds(10)
+                                    : std::min(idle_wait * 2, std::chrono::milliseconds(250));
+                    cv_.wait_for(lock, idle_wait, [&] {
+                        return wake_requested_.exchange(false, std::memory_order_relaxed) ||
+                               stopping_ || flush_requested_ > flush_done_;
+                    });
+                }
+            }
+
+            std::mutex mtx_;
+            std::condition_variable cv_;
+            std::condition_variable flushed_cv_;
+            std::vector<Ring*> rings_;
+            std::thread worker_;
+            bool started_ = false;
+            bool stopping_ = false;
+            bool stopped_ = false;
+            uint64_t flush_requested_ = 0;
+            uint64_t flush_done_ = 0;
+            std::atomic<bool> wake_requested_{false};
+            std::atomic<bool> stopped_flag_{false};
+        };
+
+        struct ThreadRing {
+            Ring* ring = nullptr;
+            ~ThreadRing() {
+                if (ring) ring->retire();
+                ring = nullptr;
+            }
+        };
+
+        thread_local ThreadRing t_ring;
+
+        // Records written after the backend stopped (static destructors)
+        // are formatted synchronously from this buffer.
+        thread_local char* t_sync_record = nullptr;
+        thread_local char t_sync_buffer[4096];
+
+        thread_local Level t_pending_level = Level::Info;
+
+    } // anonymous namespace
+
+    namespace detail {
+
+        char* begin_record(Level level, const char* fmt, uint16_t nargs, size_t payload) {
+            const size_t size = align8(sizeof(RecordHeader) + payload);
+            const RecordHeader h{static_cast<uint32_t>(size), static_cast<uint16_t>(level), nargs, fmt};
+
+            Backend& backend = Backend::instance();
+            char* rec = nullptr;
+            t_pending_level = level;
+
+            if (!backend.stopped() && size <= RING_CAPACITY / 2) {
+                if (!t_ring.ring) t_ring.ring = backend.register_thread();
+                rec = t_ring.ring->reserve(size);
+                if (!rec) {
+                    backend.dropped.fetch_add(1, std::memory_order_relaxed);
+                    backend.wake();
+                    return nullptr;
+                }
+            } else if (size <= sizeof(t_sync_buffer)) {
+                rec = t_sync_buffer;
+                t_sync_record = rec;
+            } else {
+                return nullptr;
+            }
+
+            std::memcpy(rec, &h, sizeof(h));
+            return rec + sizeof(RecordHeader);
+        }
+
+        void commit_record() {
+            if (t_sync_record) {
+                RecordHeader h;
+                std::memcpy(&h, t_sync_record, sizeof(h));
+                std::string line;
+                format_record(t_sync_record, line);
+                emit(static_cast<Level>(h.level), line);
+                t_sync_record = nullptr;
+                return;
+            }
+
+            Ring* ring = t_ring.ring;
+            ring->commit();
+
+            // Errors/warnings go out promptly; a filling ring too
+            if (t_pending_level <= Level::Warning || ring->used() > RING_CAPACITY / 2) {
+                Backend::instance().wake();
+            }
+        }
+
+    } // namespace detail
+
+    void flush() {
+        Backend::instance().flush();
+    }
+
+    uint64_t dropped() {
+        return Backend::instance().dropped.load(std::memory_order_relaxed);
+    }
+
+} // namespace logger
@@ -2,31 +2,45 @@
  *   utils/logger.h
  *=============================================================
  *
- *  Very small header‑only logger.
- *  - ANSI / Android log output depending on compilation target.
- *  - Thread‑safe on desktop, native Android log is already thread‑safe.
- *  - Runtime level control; compile‑time filtering via NDEBUG.
+ *  Small asynchronous binary logger.
+ *  - A log call copies the format-string pointer and its raw
+ *    arguments into a per-thread lock-free ring (no formatting,
+ *    no locks, no syscalls); a background thread formats and
+ *    writes to logcat / stdout.
+ *  - Compile-time minimum level (AI_GGUF_LOG_MIN_LEVEL): calls
+ *    below it compile to nothing, arguments are not evaluated.
+ *  - Runtime level (set_level / get_level) filters before any
+ *    argument is copied.
+ *  - A full ring drops the record and counts it; logging never
+ *    blocks the caller.
  *  - Exported macros:
  *        LOG_ERROR(...)
  *        LOG_WARN(...)
  *        LOG_INFO(...)
  *        LOG_DEBUG(...)
+ *
+ *  The format must be a string literal (only its address is
+ *  recorded). %s arguments are copied, up to MAX_STRING_ARG bytes.
  *============================================================*/
 
 #pragma once
 
-#include <cstdio>
-#include <cstdarg>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
-#if defined(__ANDROID__)
-#include <android/log.h>
-#define LOG_PLATFORM_ANDROID 1
+// Least severe level compiled in: 1 = Error, 2 = Warning, 3 = Info, 4 = Debug
+#ifndef AI_GGUF_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define AI_GGUF_LOG_MIN_LEVEL 3
 #else
-#define LOG_PLATFORM_ANDROID 0
+#define AI_GGUF_LOG_MIN_LEVEL 4
+#endif
 #endif
 
-namespace log {
+namespace logger {
     enum class Level : int {
         Error   = 1,
         Warning = 2,
@@ -34,54 +48,139 @@ namespace log {
         Debug   = 4
     };
 
+    namespace detail {
+        inline std::atomic<int> g_level{static_cast<int>(Level::Info)};
+    }
+
     inline Level get_level() {
-        static std::atomic<Level> lvl{Level::Info};
-        return lvl.load(std::memory_order_relaxed);
+        return static_cast<Level>(detail::g_level.load(std::memory_order_relaxed));
     }
 
     inline void set_level(Level l) {
-        static std::atomic<Level> lvl{Level::Info};
-        lvl.store(l, std::memory_order_relaxed);
+        detail::g_level.store(static_cast<int>(l), std::memory_order_relaxed);
     }
 
-    inline void logf(Level level, const char* fmt, ...) {
-        if (level > get_level()) return;
+    inline bool enabled(Level l) {
+        return static_cast<int>(l) <= detail::g_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Block until everything logged so far (by any thread) is written
+     */
+    void flush();
+
+    /**
+     * Records dropped because a thread's ring was full
+     */
+    uint64_t dropped();
+
+    namespace detail {
+
+        constexpr size_t MAX_STRING_ARG = 1024;
 
-#if LOG_PLATFORM_ANDROID
-        int android_lvl = ANDROID_LOG_INFO;
-        switch (level) {
-            case Level::Error:   android_lvl = ANDROID_LOG_ERROR;   break;
-            case Level::Warning: android_lvl = ANDROID_LOG_WARN;    break;
-            case Level::Info:    android_lvl = ANDROID_LOG_INFO;    break;
-            case Level::Debug:   android_lvl = ANDROID_LOG_DEBUG;   break;
+        enum ArgTag : uint8_t {
+            ARG_INT = 'i',
+            ARG_UINT = 'u',
+            ARG_DOUBLE = 'd',
+            ARG_STRING = 's',
+            ARG_POINTER = 'p',
+        };
+
+        // Size of an encoded argument (tag + payload)
+        template <typename T>
+        inline size_t arg_size(T) {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                          std::is_pointer<T>::value || std::is_null_pointer<T>::value,
+                          "log arguments must be scalars or C strings");
+            return 1 + 8;
         }
-        va_list ap;
-        va_start(ap, fmt);
-        __android_log_vprint(android_lvl, "ai_core", fmt, ap);
-        va_end(ap);
-#else
-        static std::mutex mtx;
-        va_list ap;
-        va_start(ap, fmt);
-        std::lock_guard<std::mutex> lock(mtx);
-        if (level == Level::Error || level == Level::Warning)
-            std::vfprintf(stderr, fmt, ap);
-        else
-            std::vfprintf(stdout, fmt, ap);
-        std::fprintf(stdout, "\n");
-        va_end(ap);
-#endif
+
+        inline size_t arg_size(const char* s) {
+            return 1 + 2 + (s ? ::strnlen(s, MAX_STRING_ARG) : 6) + 1;
+        }
+
+        inline size_t arg_size(char* s) { return arg_size(static_cast<const char*>(s)); }
+
+        // Signedness of T, or of its underlying type for enums
+        template <typename T, bool = std::is_enum<T>::value>
+        struct is_signed_arg : std::is_signed<T> {};
+
+        template <typename T>
+        struct is_signed_arg<T, true> : std::is_signed<std::underlying_type_t<T>> {};
+
+        inline void put(char*& p, uint8_t tag, const void* v, size_t n) {
+            *p++ = static_cast<char>(tag);
+            std::memcpy(p, v, n);
+            p += n;
+        }
+
+        template <typename T>
+        inline void encode(char*& p, T v) {
+            if constexpr (std::is_floating_point<T>::value) {
+                const double d = static_cast<double>(v);
+                put(p, ARG_DOUBLE, &d, 8);
+            } else if constexpr (std::is_pointer<T>::value || std::is_null_pointer<T>::value) {
+                const uint64_t u = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v));
+                put(p, ARG_POINTER, &u, 8);
+            } else if constexpr (is_signed_arg<T>::value) {
+                const int64_t i = static_cast<int64_t>(v);
+                put(p, ARG_INT, &i, 8);
+            } else {
+                const uint64_t u = static_cast<uint64_t>(v);
+                put(p, ARG_UINT, &u, 8);
+            }
+        }
+
+        inline void encode(char*& p, const char* s) {
+            if (!s) s = "(null)";
+            const uint16_t n = static_cast<uint16_t>(::strnlen(s, MAX_STRING_ARG));
+            put(p, ARG_STRING, &n, 2);
+            std::memcpy(p, s, n);
+            p += n;
+            *p++ = '\0';
+        }
+
+        inline void encode(char*& p, char* s) { encode(p, static_cast<const char*>(s)); }
+
+        inline void encode_all(char*&) {}
+
+        template <typename T, typename... Rest>
+        inline void encode_all(char*& p, T first, Rest... rest) {
+            encode(p, first);
+            encode_all(p, rest...);
+        }
+
+        /**
+         * Reserve a record of `payload` argument bytes in this thread's
+         * ring. Returns the payload pointer, or nullptr if the record was
+         * dropped. Must be followed by commit_record() on success.
+         */
+        char* begin_record(Level level, const char* fmt, uint16_t nargs, size_t payload);
+        void commit_record();
+
+    } // namespace detail
+
+    template <typename... Args>
+    inline void write(Level level, const char* fmt, Args... args) {
+        size_t payload = 0;
+        ((payload += detail::arg_size(args)), ...);
+
+        char* p = detail::begin_record(level, fmt, static_cast<uint16_t>(sizeof...(Args)), payload);
+        if (!p) return;
+        detail::encode_all(p, args...);
+        detail::commit_record();
     }
-} // namespace log
 
-#define LOG_ERROR(...)  ::log::logf(::log::Level::Error,   __VA_ARGS__)
-#define LOG_WARN(...)   ::log::logf(::log::Level::Warning, __VA_ARGS__)
-#define LOG_INFO(...)  ::log::logf(::log::Level::Info,    __VA_ARGS__)
-#define LOG_DEBUG(...)  ::log::logf(::log::Level::Debug,   __VA_ARGS__)
+} // namespace logger
 
-#ifndef NDEBUG
-// DEBUG can still be compiled in.
-#else
-#undef LOG_DEBUG
-#define LOG_DEBUG(...)
-#endif
\ No newline at end of file
+#define LOG_AT_(level, ...)                                                     \
+    do {                                                                        \
+        if constexpr (static_cast<int>(level) <= AI_GGUF_LOG_MIN_LEVEL) {       \
+            if (::logger::enabled(level)) ::logger::write(level, __VA_ARGS__);  \
+        }                                                                       \
+    } while (0)
+
+#define LOG_ERROR(...)  LOG_AT_(::logger::Level::Error,   __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT_(::logger::Level::Warning, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT_(::logger::Level::Info,    __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT_(::logger::Level::Debug,   __VA_ARGS__)
@@ -4,13 +4,14 @@
  * Optimized UTF-8 utilities for JNI string conversion
  * 
  * Key features:
- * - Fast ASCII path for common case
+ * - Vectorized ASCII fast path (NEON / SSE2 / AVX2, see utf_transcode.h)
  * - Proper surrogate pair handling for emojis/extended Unicode
  * - Immediate conversion without buffering for streaming
  */
 
 #include <jni.h>
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace utf8 {
@@ -24,9 +25,10 @@ namespace utf8 {
 /**
  * Convert UTF-8 string to jstring - IMMEDIATE (no buffering)
  * This is the optimized version for streaming - converts immediately
- * without any carry buffer logic
+ * without any carry buffer logic. Converts through a thread-local
+ * UTF-16 scratch buffer, so steady-state calls don't touch the heap.
  */
-    jstring to_jstring_immediate(JNIEnv* env, const std::string& utf8);
+    jstring to_jstring_immediate(JNIEnv* env, std::string_view utf8);
 
 /**
  * Legacy buffered conversion for backwards compatibility
@@ -0,0 +1,610 @@
+/**
+ * Vectorized UTF-8 <-> UTF-16 transcoding
+ *
+ * Each backend provides three block primitives over a fixed block size:
+ *   ascii_block(in)              - all bytes < 0x80?
+ *   widen_ascii(in, out)         - if ASCII, store bytes as UTF-16 units
+ *   narrow_ascii(in, out)        - if all units < 0x80, store as bytes
+ * and four over 8 characters of one width:
+ *   decode2_block / decode3_block - 16 / 24 bytes of 2- / 3-byte
+ *                                   sequences -> 8 units
+ *   encode2_block / encode3_block - 8 units in U+0080..U+07FF /
+ *                                   U+0800..U+FFFF (no surrogates) ->
+ *                                   16 / 24 bytes
+ * The multi-byte primitives only check the bit patterns the scalar codec
+ * checks, so their output is identical to it. The drivers below pick a
+ * primitive from the character at the current position, run blocks while
+ * they succeed and fall back to the scalar codec for a few characters
+ * when they don't, so mixed text stays linear.
+ */
+
+#include "utf_transcode.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define UTF_TRANSCODE_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define UTF_TRANSCODE_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF_TRANSCODE_SSE2 1
+#endif
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace utf8 {
+namespace transcode {
+
+    namespace {
+
+        constexpr char16_t kReplacement16 = 0xFFFD;
+
+        // Characters per multi-byte block, and the scalar step taken when
+        // no block applies
+        constexpr size_t kWide = 8;
+        constexpr size_t kScalarStep = 16;
+
+// ============================================================================
+// BLOCK PRIMITIVES
+// ============================================================================
+
+#if defined(UTF_TRANSCODE_NEON)
+
+        constexpr size_t kBlock8 = 16;   // bytes per UTF-8 block
+        constexpr size_t kBlock16 = 16;  // units per UTF-16 block
+
+        inline bool no_high_bits(uint64x2_t w, uint64_t mask) {
+            return ((vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) & mask) == 0;
+        }
+
+        inline bool ascii_block(const char* in) {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(in));
+            return no_high_bits(vreinterpretq_u64_u8(v), 0x8080808080808080ULL);
+        }
+
+        inline bool widen_ascii(const char* in, char16_t* out) {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(in));
+            if (!no_high_bits(vreinterpretq_u64_u8(v), 0x8080808080808080ULL)) return false;
+            uint16_t* o = reinterpret_cast<uint16_t*>(out);
+            vst1q_u16(o, vmovl_u8(vget_low_u8(v)));
+            vst1q_u16(o + 8, vmovl_u8(vget_high_u8(v)));
+            return true;
+        }
+
+        inline bool narrow_ascii(const char16_t* in, char* out) {
+            const uint16_t* p = reinterpret_cast<const uint16_t*>(in);
+            uint16x8_t a = vld1q_u16(p);
+            uint16x8_t b = vld1q_u16(p + 8);
+            if (!no_high_bits(vreinterpretq_u64_u16(vorrq_u16(a, b)), 0xFF80FF80FF80FF80ULL)) {
+                return false;
+            }
+            vst1q_u8(reinterpret_cast<uint8_t*>(out), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+            return true;
+        }
+
+        inline bool all_set(uint8x8_t m) {
+            return vget_lane_u64(vreinterpret_u64_u8(m), 0) == ~0ULL;
+        }
+
+        inline bool all_set(uint16x8_t m) {
+            uint64x2_t w = vreinterpretq_u64_u16(m);
+            return (vgetq_lane_u64(w, 0) & vgetq_lane_u64(w, 1)) == ~0ULL;
+        }
+
+        // ld2/ld3 de-interleave the sequences into lead and continuation lanes
+
+        inline bool decode2_block(const char* in, char16_t* out) {
+            const uint8x8x2_t v = vld2_u8(reinterpret_cast<const uint8_t*>(in));
+            const uint8x8_t ok = vand_u8(vceq_u8(vand_u8(v.val[0], vdup_n_u8(0xE0)), vdup_n_u8(0xC0)),
+                                         vceq_u8(vand_u8(v.val[1], vdup_n_u8(0xC0)), vdup_n_u8(0x80)));
+            if (!all_set(ok)) return false;
+            const uint16x8_t hi = vshlq_n_u16(vmovl_u8(vand_u8(v.val[0], vdup_n_u8(0x1F))), 6);
+            const uint16x8_t lo = vmovl_u8(vand_u8(v.val[1], vdup_n_u8(0x3F)));
+            vst1q_u16(reinterpret_cast<uint16_t*>(out), vorrq_u16(hi, lo));
+            return true;
+        }
+
+        inline bool decode3_block(const char* in, char16_t* out) {
+            const uint8x8x3_t v = vld3_u8(reinterpret_cast<const uint8_t*>(in));
+            const uint8x8_t cont = vdup_n_u8(0xC0);
+            const uint8x8_t ok = vand_u8(vceq_u8(vand_u8(v.val[0], vdup_n_u8(0xF0)), vdup_n_u8(0xE0)),
+                                         vand_u8(vceq_u8(vand_u8(v.val[1], cont), vdup_n_u8(0x80)),
+                                                 vceq_u8(vand_u8(v.val[2], cont), vdup_n_u8(0x80))));
+            if (!all_set(ok)) return false;
+            const uint8x8_t low6 = vdup_n_u8(0x3F);
+            const uint16x8_t b0 = vshlq_n_u16(vmovl_u8(vand_u8(v.val[0], vdup_n_u8(0x0F))), 12);
+            const uint16x8_t b1 = vshlq_n_u16(vmovl_u8(vand_u8(v.val[1], low6)), 6);
+            const uint16x8_t b2 = vmovl_u8(vand_u8(v.val[2], low6));
+            vst1q_u16(reinterpret_cast<uint16_t*>(out), vorrq_u16(vorrq_u16(b0, b1), b2));
+            return true;
+        }
+
+        // st2/st3 interleave the byte lanes back into sequences
+
+        inline bool encode2_block(const char16_t* in, char* out) {
+            const uint16x8_t u = vld1q_u16(reinterpret_cast<const uint16_t*>(in));
+            if (!all_set(vandq_u16(vcgeq_u16(u, vdupq_n_u16(0x80)), vcltq_u16(u, vdupq_n_u16(0x800))))) {
+                return false;
+            }
+            uint8x8x2_t b;
+            b.val[0] = vorr_u8(vmovn_u16(vshrq_n_u16(u, 6)), vdup_n_u8(0xC0));
+            b.val[1] = vorr_u8(vmovn_u16(vandq_u16(u, vdupq_n_u16(0x3F))), vdup_n_u8(0x80));
+            vst2_u8(reinterpret_cast<uint8_t*>(out), b);
+            return true;
+        }
+
+        inline bool encode3_block(const char16_t* in, char* out) {
+            const uint16x8_t u = vld1q_u16(reinterpret_cast<const uint16_t*>(in));
+            const uint16x8_t surrogate = vceqq_u16(vandq_u16(u, vdupq_n_u16(0xF800)), vdupq_n_u16(0xD800));
+            if (!all_set(vandq_u16(vcgeq_u16(u, vdupq_n_u16(0x800)), vmvnq_u16(surrogate)))) {
+                return false;
+            }
+            const uint16x8_t low6 = vdupq_n_u16(0x3F);
+            const uint8x8_t cont = vdup_n_u8(0x80);
+            uint8x8x3_t b;
+            b.val[0] = vorr_u8(vmovn_u16(vshrq_n_u16(u, 12)), vdup_n_u8(0xE0));
+            b.val[1] = vorr_u8(vmovn_u16(vandq_u16(vshrq_n_u16(u, 6), low6)), cont);
+            b.val[2] = vorr_u8(vmovn_u16(vandq_u16(u, low6)), cont);
+            vst3_u8(reinterpret_cast<uint8_t*>(out), b);
+            return true;
+        }
+
+#elif defined(UTF_TRANSCODE_AVX2)
+
+        constexpr size_t kBlock8 = 32;
+        constexpr size_t kBlock16 = 32;
+
+        inline bool ascii_block(const char* in) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            return _mm256_movemask_epi8(v) == 0;
+        }
+
+        inline bool widen_ascii(const char* in, char16_t* out) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            if (_mm256_movemask_epi8(v) != 0) return false;
+            __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+            __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16), hi);
+            return true;
+        }
+
+        inline bool narrow_ascii(const char16_t* in, char* out) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 16));
+            if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi16(static_cast<short>(0xFF80)))) {
+                return false;
+            }
+            // packus interleaves 128-bit lanes; restore order with a permute
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+            return true;
+        }
+
+#elif defined(UTF_TRANSCODE_SSE2)
+
+        constexpr size_t kBlock8 = 16;
+        constexpr size_t kBlock16 = 16;
+
+        inline bool ascii_block(const char* in) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            return _mm_movemask_epi8(v) == 0;
+        }
+
+        inline bool widen_ascii(const char* in, char16_t* out) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if (_mm_movemask_epi8(v) != 0) return false;
+            const __m128i zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(v, zero));
+            return true;
+        }
+
+        inline bool narrow_ascii(const char16_t* in, char* out) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+            __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) {
+                return false;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+            return true;
+        }
+
+#endif
+
+#if defined(UTF_TRANSCODE_AVX2) || defined(UTF_TRANSCODE_SSE2)
+
+        // 2- and 3-byte blocks are 128-bit on x86 as well: 8 characters
+        // already fill an SSE register as UTF-16
+
+        inline __m128i splat16(uint16_t v) {
+            return _mm_set1_epi16(static_cast<short>(v));
+        }
+
+        inline bool all_set(__m128i m) {
+            return _mm_movemask_epi8(m) == 0xFFFF;
+        }
+
+        inline bool decode2_block(const char* in, char16_t* out) {
+            // Little-endian 16-bit lanes hold lead | continuation << 8
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if (!all_set(_mm_cmpeq_epi16(_mm_and_si128(v, splat16(0xC0E0)), splat16(0x80C0)))) {
+                return false;
+            }
+            const __m128i hi = _mm_slli_epi16(_mm_and_si128(v, splat16(0x001F)), 6);
+            const __m128i lo = _mm_and_si128(_mm_srli_epi16(v, 8), splat16(0x003F));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(hi, lo));
+            return true;
+        }
+
+#if defined(__SSSE3__)
+
+        inline bool decode3_block(const char* in, char16_t* out) {
+            // Bytes 0-15 hold characters 0-4, bytes 8-23 characters 5-7;
+            // gather each byte of the sequence into 16-bit lanes
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+            const auto gather = [&](int k) {
+                const __m128i from_a = _mm_setr_epi8(
+                        static_cast<char>(k), -1, static_cast<char>(k + 3), -1, static_cast<char>(k + 6), -1,
+                        static_cast<char>(k + 9), -1, static_cast<char>(k + 12), -1, -1, -1, -1, -1, -1, -1);
+                const __m128i from_b = _mm_setr_epi8(
+                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                        static_cast<char>(k + 7), -1, static_cast<char>(k + 10), -1, static_cast<char>(k + 13), -1);
+                return _mm_or_si128(_mm_shuffle_epi8(a, from_a), _mm_shuffle_epi8(b, from_b));
+            };
+            const __m128i b0 = gather(0);
+            const __m128i b1 = gather(1);
+            const __m128i b2 = gather(2);
+            const __m128i cont = splat16(0xC0);
+            const __m128i ok = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(b0, splat16(0xF0)), splat16(0xE0)),
+                                             _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(b1, cont), splat16(0x80)),
+                                                           _mm_cmpeq_epi16(_mm_and_si128(b2, cont), splat16(0x80))));
+            if (!all_set(ok)) return false;
+            const __m128i low6 = splat16(0x3F);
+            const __m128i u = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(b0, 12),
+                                                        _mm_slli_epi16(_mm_and_si128(b1, low6), 6)),
+                                           _mm_and_si128(b2, low6));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), u);
+            return true;
+        }
+
+#else
+
+        inline bool decode3_block(const char* in, char16_t* out) {
+            // Without a byte shuffle: validate the 24 bytes against the
+            // lead/continuation pattern, then assemble without branches
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            const __m128i c = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 16));
+            const __m128i mask_a = _mm_setr_epi8(
+                    -16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16);
+            const __m128i want_a = _mm_setr_epi8(
+                    -32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32);
+            const __m128i mask_c = _mm_setr_epi8(-64, -64, -16, -64, -64, -16, -64, -64, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i want_c = _mm_setr_epi8(-128, -128, -32, -128, -128, -32, -128, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i ok = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(a, mask_a), want_a),
+                                             _mm_cmpeq_epi8(_mm_and_si128(c, mask_c), want_c));
+            if (!all_set(ok)) return false;
+            const unsigned char* s = reinterpret_cast<const unsigned char*>(in);
+            for (size_t k = 0; k < 8; ++k, s += 3) {
+                out[k] = static_cast<char16_t>(((s[0] & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu));
+            }
+            return true;
+        }
+
+#endif
+
+        inline bool encode2_block(const char16_t* in, char* out) {
+            const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(u, splat16(0xFF80)), zero);
+            const __m128i below_800 = _mm_cmpeq_epi16(_mm_and_si128(u, splat16(0xF800)), zero);
+            if (!all_set(_mm_andnot_si128(ascii, below_800))) return false;
+            // Lead in the low byte, continuation in the high byte
+            const __m128i lead = _mm_or_si128(_mm_srli_epi16(u, 6), splat16(0xC0));
+            const __m128i cont = _mm_or_si128(_mm_and_si128(u, splat16(0x3F)), splat16(0x80));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(lead, _mm_slli_epi16(cont, 8)));
+            return true;
+        }
+
+        inline bool encode3_block(const char16_t* in, char* out) {
+            const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            const __m128i top = _mm_and_si128(u, splat16(0xF800));
+            const __m128i bad = _mm_or_si128(_mm_cmpeq_epi16(top, _mm_setzero_si128()),
+                                             _mm_cmpeq_epi16(top, splat16(0xD800)));
+            if (_mm_movemask_epi8(bad) != 0) return false;
+            const __m128i low6 = splat16(0x3F);
+            const __m128i cont = splat16(0x80);
+            const __m128i b0 = _mm_or_si128(_mm_srli_epi16(u, 12), splat16(0xE0));
+            const __m128i b1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(u, 6), low6), cont);
+            const __m128i b2 = _mm_or_si128(_mm_and_si128(u, low6), cont);
+            // 32-bit lanes of b0 b1 b2 0, then drop every fourth byte
+            const __m128i b01 = _mm_or_si128(b0, _mm_slli_epi16(b1, 8));
+            const __m128i lo = _mm_unpacklo_epi16(b01, b2);
+            const __m128i hi = _mm_unpackhi_epi16(b01, b2);
+#if defined(__SSSE3__)
+            const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            const __m128i p0 = _mm_shuffle_epi8(lo, pack);
+            const __m128i p1 = _mm_shuffle_epi8(hi, pack);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), p0);  // Last 4 bytes rewritten below
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 12), p1);
+            const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(p1, 8));
+            std::memcpy(out + 20, &tail, sizeof(tail));
+#else
+            uint64_t pairs[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pairs), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pairs + 2), hi);
+            for (size_t k = 0; k < 4; ++k) {
+                const uint64_t packed = (pairs[k] & 0xFFFFFFULL) | ((pairs[k] >> 8) & 0xFFFFFF000000ULL);
+                std::memcpy(out + 6 * k, &packed, 6);
+            }
+#endif
+            return true;
+        }
+
+#elif !defined(UTF_TRANSCODE_NEON)
+
+        // Portable SWAR fallback: 8 bytes / 4 units per 64-bit word
+        constexpr size_t kBlock8 = 8;
+        constexpr size_t kBlock16 = 4;
+
+        inline bool ascii_block(const char* in) {
+            uint64_t w;
+            std::memcpy(&w, in, sizeof(w));
+            return (w & 0x8080808080808080ULL) == 0;
+        }
+
+        inline bool widen_ascii(const char* in, char16_t* out) {
+            if (!ascii_block(in)) return false;
+            for (size_t k = 0; k < kBlock8; ++k) {
+                out[k] = static_cast<char16_t>(static_cast<unsigned char>(in[k]));
+            }
+            return true;
+        }
+
+        inline bool narrow_ascii(const char16_t* in, char* out) {
+            uint64_t w;
+            std::memcpy(&w, in, sizeof(w));
+            if ((w & 0xFF80FF80FF80FF80ULL) != 0) return false;
+            for (size_t k = 0; k < kBlock16; ++k) {
+                out[k] = static_cast<char>(in[k]);
+            }
+            return true;
+        }
+
+        // No multi-byte blocks: the scalar codec handles them
+        inline bool decode2_block(const char*, char16_t*) { return false; }
+        inline bool decode3_block(const char*, char16_t*) { return false; }
+        inline bool encode2_block(const char16_t*, char*) { return false; }
+        inline bool encode3_block(const char16_t*, char*) { return false; }
+
+#endif
+
+// ============================================================================
+// SCALAR CODEC
+// ============================================================================
+
+        constexpr size_t lead_length(unsigned char c) {
+            if ((c & 0x80) == 0x00) return 1;      // 0xxxxxxx - ASCII
+            if ((c & 0xE0) == 0xC0) return 2;      // 110xxxxx
+            if ((c & 0xF0) == 0xE0) return 3;      // 1110xxxx
+            if ((c & 0xF8) == 0xF0) return 4;      // 11110xxx
+            return 0; // Invalid start byte
+        }
+
+        constexpr bool is_cont(unsigned char c) {
+            return (c & 0xC0) == 0x80;
+        }
+
+        /**
+         * Decode one character at s[i]. Returns false when the input ends
+         * mid-sequence (caller stops).
+         */
+        inline bool decode_one(const unsigned char* s, size_t n, size_t& i, char16_t*& o) {
+            const unsigned char c = s[i];
+            if (c < 0x80) {
+                *o++ = c;
+                ++i;
+                return true;
+            }
+
+            const size_t len = lead_length(c);
+            if (len == 0) {
+                *o++ = kReplacement16;
+                ++i;
+                return true;
+            }
+            if (i + len > n) {
+                *o++ = kReplacement16;
+                i = n;
+                return false;
+            }
+
+            uint32_t cp;
+            if (len == 2) {
+                if (!is_cont(s[i + 1])) { *o++ = kReplacement16; ++i; return true; }
+                cp = ((c & 0x1Fu) << 6) | (s[i + 1] & 0x3Fu);
+            } else if (len == 3) {
+                if (!is_cont(s[i + 1]) || !is_cont(s[i + 2])) { *o++ = kReplacement16; ++i; return true; }
+                cp = ((c & 0x0Fu) << 12) | ((s[i + 1] & 0x3Fu) << 6) | (s[i + 2] & 0x3Fu);
+            } else {
+                if (!is_cont(s[i + 1]) || !is_cont(s[i + 2]) || !is_cont(s[i + 3])) {
+                    *o++ = kReplacement16;
+                    ++i;
+                    return true;
+                }
+                cp = ((c & 0x07u) << 18) | ((s[i + 1] & 0x3Fu) << 12) |
+                     ((s[i + 2] & 0x3Fu) << 6) | (s[i + 3] & 0x3Fu);
+            }
+            i += len;
+
+            if (cp <= 0xFFFF) {
+                *o++ = static_cast<char16_t>(cp);
+            } else if (cp <= 0x10FFFF) {
+                cp -= 0x10000;
+                *o++ = static_cast<char16_t>(0xD800 + (cp >> 10));
+                *o++ = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+            } else {
+                *o++ = kReplacement16;
+            }
+            return true;
+        }
+
+        inline void put_replacement8(char*& o) {
+            *o++ = static_cast<char>(0xEF);
+            *o++ = static_cast<char>(0xBF);
+            *o++ = static_cast<char>(0xBD);
+        }
+
+        inline void encode_one(const char16_t* in, size_t n, size_t& i, char*& o) {
+            const uint32_t u = in[i];
+            if (u < 0x80) {
+                *o++ = static_cast<char>(u);
+                ++i;
+            } else if (u < 0x800) {
+                *o++ = static_cast<char>(0xC0 | (u >> 6));
+                *o++ = static_cast<char>(0x80 | (u & 0x3F));
+                ++i;
+            } else if (u >= 0xD800 && u <= 0xDBFF) {
+                if (i + 1 < n && in[i + 1] >= 0xDC00 && in[i + 1] <= 0xDFFF) {
+                    const uint32_t cp = 0x10000 + ((u - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+                    *o++ = static_cast<char>(0xF0 | (cp >> 18));
+                    *o++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    *o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+                    i += 2;
+                } else {
+                    // Unpaired high surrogate
+                    put_replacement8(o);
+                    ++i;
+                }
+            } else if (u >= 0xDC00 && u <= 0xDFFF) {
+                // Unpaired low surrogate
+                put_replacement8(o);
+                ++i;
+            } else {
+                *o++ = static_cast<char>(0xE0 | (u >> 12));
+                *o++ = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                *o++ = static_cast<char>(0x80 | (u & 0x3F));
+                ++i;
+            }
+        }
+
+    } // anonymous namespace
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+    const char* backend() {
+#if defined(UTF_TRANSCODE_NEON)
+        return "neon";
+#elif defined(UTF_TRANSCODE_AVX2)
+        return "avx2";
+#elif defined(UTF_TRANSCODE_SSE2)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+    bool is_ascii(const char* s, size_t n) {
+        size_t i = 0;
+        for (; i + kBlock8 <= n; i += kBlock8) {
+            if (!ascii_block(s + i)) return false;
+        }
+        for (; i < n; ++i) {
+            if (static_cast<unsigned char>(s[i]) >= 0x80) return false;
+        }
+        return true;
+    }
+
+    size_t utf8_to_utf16(const char* in, size_t n, char16_t* out) {
+        const unsigned char* s = reinterpret_cast<const unsigned char*>(in);
+        char16_t* o = out;
+        size_t i = 0;
+
+        while (i + kBlock8 <= n) {
+            // Only the block the next character belongs to can succeed.
+            // Runs of one width: Cyrillic, Greek, Arabic... (2 bytes),
+            // CJK, Indic... (3 bytes)
+            const unsigned char lead = s[i];
+            if (lead < 0x80) {
+                if (widen_ascii(in + i, o)) {
+                    i += kBlock8;
+                    o += kBlock8;
+                    continue;
+                }
+            } else if ((lead & 0xF0) == 0xE0) {
+                if (i + 3 * kWide <= n && decode3_block(in + i, o)) {
+                    i += 3 * kWide;
+                    o += kWide;
+                    continue;
+                }
+            } else if ((lead & 0xE0) == 0xC0) {
+                if (i + 2 * kWide <= n && decode2_block(in + i, o)) {
+                    i += 2 * kWide;
+                    o += kWide;
+                    continue;
+                }
+            }
+            // Mixed: decode a few bytes scalar (may overrun the step by up
+            // to 3 bytes to finish the last character)
+            const size_t step_end = std::min(i + kScalarStep, n);
+            while (i < step_end) {
+                if (!decode_one(s, n, i, o)) return static_cast<size_t>(o - out);
+            }
+        }
+
+        while (i < n) {
+            if (!decode_one(s, n, i, o)) break;
+        }
+        return static_cast<size_t>(o - out);
+    }
+
+    size_t utf16_to_utf8(const char16_t* in, size_t n, char* out) {
+        char* o = out;
+        size_t i = 0;
+
+        while (i + kBlock16 <= n) {
+            const char16_t unit = in[i];
+            if (unit < 0x80) {
+                if (narrow_ascii(in + i, o)) {
+                    i += kBlock16;
+                    o += kBlock16;
+                    continue;
+                }
+            } else if (i + kWide <= n) {
+                if (unit >= 0x800) {
+                    if (encode3_block(in + i, o)) {
+                        i += kWide;
+                        o += 3 * kWide;
+                        continue;
+                    }
+                } else if (encode2_block(in + i, o)) {
+                    i += kWide;
+                    o += 2 * kWide;
+                    continue;
+                }
+            }
+            const size_t step_end = std::min(i + kScalarStep, n);
+            while (i < step_end) {
+                encode_one(in, n, i, o);
+            }
+        }
+
+        while (i < n) {
+            encode_one(in, n, i, o);
+        }
+        return static_cast<size_t>(o - out);
+    }
+
+} // namespace transcode
+} // namespace utf8
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * Vectorized UTF-8 <-> UTF-16 transcoding for JNI string conversion
+ *
+ * - NEON (arm64-v8a, armeabi-v7a with NEON), AVX2 / SSE2 (x86, x86_64)
+ *   and a portable scalar path; the backend is chosen at compile time
+ *   from the ABI, so there is no dispatch cost per call.
+ * - ASCII runs are detected and widened/narrowed a vector at a time, and
+ *   runs of 8 two-byte (Cyrillic, Greek, Arabic...) or three-byte (CJK,
+ *   Indic...) characters are validated and transcoded as one block.
+ * - Anything else - 4-byte sequences, malformed input, and text that
+ *   mixes widths within a block (e.g. CJK with ASCII punctuation every few
+ *   characters) - drops to a scalar decoder for a short step, so heavily
+ *   mixed text runs at roughly scalar speed.
+ * - Malformed input is never rejected: it is repaired with U+FFFD using
+ *   the same rules the original scalar converters used (except that
+ *   4-byte sequences above U+10FFFF now give U+FFFD rather than an
+ *   invalid surrogate pair).
+ *
+ * No JNI dependency - usable from host tools and benchmarks.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utf8 {
+namespace transcode {
+
+    /**
+     * Name of the compiled-in backend ("neon", "avx2", "sse2", "scalar")
+     */
+    const char* backend();
+
+    /**
+     * True if every byte is < 0x80
+     */
+    bool is_ascii(const char* s, size_t n);
+
+    /**
+     * Worst-case output sizes (in code units) for the converters below
+     */
+    constexpr size_t max_utf16_length(size_t utf8_bytes) { return utf8_bytes; }
+    constexpr size_t max_utf8_length(size_t utf16_units) { return utf16_units * 3; }
+
+    /**
+     * UTF-8 -> UTF-16. `out` must hold max_utf16_length(n) units.
+     * Returns the number of units written.
+     *
+     * Repair rules: an invalid lead byte or a bad continuation byte emits
+     * U+FFFD and skips one byte; a sequence truncated by the end of input
+     * emits one U+FFFD and stops; code points above U+10FFFF emit U+FFFD.
+     */
+    size_t utf8_to_utf16(const char* in, size_t n, char16_t* out);
+
+    /**
+     * UTF-16 -> UTF-8. `out` must hold max_utf8_length(n) bytes.
+     * Returns the number of bytes written. Unpaired surrogates emit U+FFFD.
+     */
+    size_t utf16_to_utf8(const char16_t* in, size_t n, char* out);
+
+} // namespace transcode
+} // namespace utf8
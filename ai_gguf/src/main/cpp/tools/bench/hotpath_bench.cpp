@@ -0,0 +1,632 @@
+/*=============================================================
+ *   tools/bench/hotpath_bench.cpp
+ *=============================================================
+ *
+ *  Micro-benchmarks for the per-token streaming text path:
+ *    Utf8StreamDecoder, StopStringChecker, ToolCallState::accumulate,
+ *    ModelState::detokenize / detokenize_buffered,
+ *    utf8::to_jstring_immediate, utf8::from_jstring (per token and on
+ *    megabyte strings), and the combined arena-backed pipeline.
+ *
+ *  Inputs are synthetic token streams shaped like real detokenizer
+ *  output: word-piece English, CJK with byte-fallback splits, emoji
+ *  split into single-byte tokens, source code, and JSON tool calls.
+ *
+ *  Usage:
+ *    hotpath_bench [--filter name] [--min-time s] [--model model.gguf]
+ *
+ *  --model enables the detokenize benchmarks (they need a vocab).
+ *  Exits 1 when a benchmark exceeds its allocations/token budget.
+ *============================================================*/
+
+#include "microbench.h"
+
+#include "llama.h"
+#include "state/model_state.h"
+#include "generation/stop_string_checker.h"
+#include "generation/token_arena.h"
+#include "generation/utf8_stream_decoder.h"
+#include "tool_calling/tool_call_state.h"
+#include "utils/logger.h"
+#include "utils/utf8_utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+/* --------------------------------------------------------------------
+ *  Corpora
+ * -------------------------------------------------------------------- */
+
+    const char* kEnglish =
+            "The quick brown fox jumps over the lazy dog. Streaming generation on "
+            "low-end phones is dominated by the forward pass, but every token still "
+            "goes through detokenization, UTF-8 reassembly, stop-string scanning and "
+            "a JNI upcall. Each of those steps should be close to free. ";
+
+    const char* kCjk =
+            "\xE4\xBB\x8A\xE5\xA4\xA9\xE5\xA4\xA9\xE6\xB0\x94\xE5\xBE\x88\xE5\xA5\xBD\xEF\xBC\x8C"
+            "\xE6\x88\x91\xE4\xBB\xAC\xE5\x8E\xBB\xE5\x85\xAC\xE5\x9B\xAD\xE6\x95\xA3\xE6\xAD\xA5"
+            "\xE5\x90\xA7\xE3\x80\x82\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE6\x96\x87"
+            "\xE7\xAB\xA0\xE3\x82\x82\xE5\x90\xAB\xE3\x81\xBE\xE3\x82\x8C\xE3\x81\xBE\xE3\x81\x99"
+            "\xE3\x80\x82\xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4\xEB\x8F\x84\x20\xEC\x9E\x88\xEC\x8A"
+            "\xB5\xEB\x8B\x88\xEB\x8B\xA4\x2E\x20";
+
+    const char* kEmoji =
+            "Great job! \xF0\x9F\x8E\x89\xF0\x9F\x8E\x89 Let's ship it \xF0\x9F\x9A\x80 "
+            "family: \xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7 "
+            "thumbs \xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD weather \xE2\x98\x80\xEF\xB8\x8F ";
+
+    const char* kCode =
+            "fn main() {\n    let v: Vec<i32> = (0..10).map(|x| x * 2).collect();\n"
+            "    for (i, x) in v.iter().enumerate() {\n        println!(\"{}: {}\", i, x);\n"
+            "    }\n}\n\n#include <vector>\nint sum(const std::vector<int>& v) {\n"
+            "    int s = 0; for (int x : v) s += x; return s;\n}\n";
+
+    const char* kToolCall =
+            "{\"tool_calls\": [{\"name\": \"get_weather\", \"arguments\": {\"location\": "
+            "\"San Francisco, CA\", \"unit\": \"celsius\", \"days\": 3, "
+            "\"include\": {\"hourly\": true, \"alerts\": false}}}]}";
+
+    // Turn markers from the templates detect_stop_strings() knows about
+    const std::vector<std::string> kManyStops = {
+            "<end_of_turn>", "<start_of_turn>", "<|im_end|>", "<|im_start|>",
+            "<|eot_id|>", "<|start_header_id|>", "<|end|>", "<|user|>",
+            "<|assistant|>", "<|system|>", "</s>", "<|endoftext|>",
+            "### Instruction:", "### Response:", "\nUser:", "\nAssistant:",
+    };
+
+    const std::vector<std::string> kFewStops = {"<end_of_turn>", "<|im_end|>"};
+
+/* --------------------------------------------------------------------
+ *  Synthetic tokenizer
+ * -------------------------------------------------------------------- */
+
+    struct Lcg {
+        uint32_t s;
+        uint32_t next() { s = s * 1664525u + 1013904223u; return s >> 8; }
+    };
+
+    size_t utf8_len(unsigned char c) {
+        if (c < 0x80) return 1;
+        if ((c & 0xE0) == 0xC0) return 2;
+        if ((c & 0xF0) == 0xE0) return 3;
+        if ((c & 0xF8) == 0xF0) return 4;
+        return 1;
+    }
+
+    /**
+     * Split text into token-like pieces. ASCII runs become word pieces
+     * (leading space attached, long words split). Multi-byte characters
+     * are grouped 1-2 per token; with probability byte_fallback_pct a
+     * character is emitted as single-byte tokens instead, the way
+     * SentencePiece byte fallback does for rare characters and emoji.
+     */
+    std::vector<std::string> tokenize_like(const std::string& text, int byte_fallback_pct,
+                                           size_t min_tokens) {
+        std::vector<std::string> out;
+        Lcg rng{12345};
+
+        while (out.size() < min_tokens) {
+            size_t i = 0;
+            while (i < text.size()) {
+                const unsigned char c = static_cast<unsigned char>(text[i]);
+                if (c < 0x80) {
+                    size_t j = i + 1;
+                    const size_t max_piece = 3 + rng.next() % 6;
+                    while (j < text.size() && j - i < max_piece &&
+                           static_cast<unsigned char>(text[j]) < 0x80 && text[j] != ' ' &&
+                           ((j == i + 1 && text[i] == ' ') ||
+                            std::isalnum(static_cast<unsigned char>(text[j])) ==
+                            std::isalnum(static_cast<unsigned char>(text[j - 1])))) {
+                        ++j;
+                    }
+                    out.emplace_back(text, i, j - i);
+                    i = j;
+                    continue;
+                }
+
+                const size_t len = std::min(utf8_len(c), text.size() - i);
+                if (static_cast<int>(rng.next() % 100) < byte_fallback_pct) {
+                    for (size_t b = 0; b < len; ++b) out.emplace_back(text, i + b, 1);
+                    i += len;
+                    continue;
+                }
+
+                size_t j = i + len;
+                if (rng.next() % 2 == 0 && j < text.size() && static_cast<unsigned char>(text[j]) >= 0x80) {
+                    j += std::min(utf8_len(static_cast<unsigned char>(text[j])), text.size() - j);
+                }
+                out.emplace_back(text, i, j - i);
+                i = j;
+            }
+        }
+        return out;
+    }
+
+    constexpr size_t kStreamTokens = 4096;
+
+    const std::vector<std::string>& english_stream() {
+        static const auto s = tokenize_like(kEnglish, 0, kStreamTokens);
+        return s;
+    }
+
+    const std::vector<std::string>& cjk_stream() {
+        static const auto s = tokenize_like(kCjk, 15, kStreamTokens);
+        return s;
+    }
+
+    const std::vector<std::string>& emoji_stream() {
+        static const auto s = tokenize_like(kEmoji, 70, kStreamTokens);
+        return s;
+    }
+
+    const std::vector<std::string>& code_stream() {
+        static const auto s = tokenize_like(kCode, 0, kStreamTokens);
+        return s;
+    }
+
+    const std::vector<std::string>& tool_call_stream() {
+        static const auto s = tokenize_like(kToolCall, 0, 1);
+        return s;
+    }
+
+    const std::vector<std::string>& mixed_stream() {
+        static const auto s = [] {
+            std::string text = std::string(kEnglish) + kCjk + kEmoji + kCode;
+            return tokenize_like(text, 20, kStreamTokens);
+        }();
+        return s;
+    }
+
+/* --------------------------------------------------------------------
+ *  Fake JNIEnv: just the string functions utf8_utils uses. Strings are
+ *  copied into fixed buffers so only the conversion's own allocations
+ *  show up in the counters.
+ * -------------------------------------------------------------------- */
+
+    using JniFunctions = std::remove_const_t<std::remove_pointer_t<decltype(JNIEnv::functions)>>;
+
+    struct FakeString {
+        const jchar* chars;
+        jsize len;
+    };
+
+    // Large enough for the megabyte-string benchmarks
+    jchar g_sink16[4 << 20];
+    char g_sink8[8192];
+    FakeString g_result{g_sink16, 0};
+
+    jstring JNICALL fake_new_string(JNIEnv*, const jchar* chars, jsize len) {
+        const jsize n = std::min<jsize>(len, static_cast<jsize>(sizeof(g_sink16) / sizeof(jchar)));
+        std::memcpy(g_sink16, chars, static_cast<size_t>(n) * sizeof(jchar));
+        g_result.len = n;
+        return reinterpret_cast<jstring>(&g_result);
+    }
+
+    jstring JNICALL fake_new_string_utf(JNIEnv*, const char* utf) {
+        const size_t n = std::min(std::strlen(utf), sizeof(g_sink8));
+        std::memcpy(g_sink8, utf, n);
+        g_result.len = static_cast<jsize>(n);
+        return reinterpret_cast<jstring>(&g_result);
+    }
+
+    jsize JNICALL fake_get_string_length(JNIEnv*, jstring s) {
+        return reinterpret_cast<FakeString*>(s)->len;
+    }
+
+    const jchar* JNICALL fake_get_string_chars(JNIEnv*, jstring s, jboolean* is_copy) {
+        if (is_copy) *is_copy = JNI_FALSE;
+        return reinterpret_cast<FakeString*>(s)->chars;
+    }
+
+    void JNICALL fake_release_string_chars(JNIEnv*, jstring, const jchar*) {}
+
+    const jchar* JNICALL fake_get_string_critical(JNIEnv*, jstring s, jboolean* is_copy) {
+        if (is_copy) *is_copy = JNI_FALSE;
+        return reinterpret_cast<FakeString*>(s)->chars;
+    }
+
+    void JNICALL fake_release_string_critical(JNIEnv*, jstring, const jchar*) {}
+
+    JNIEnv* fake_env() {
+        static JniFunctions functions = [] {
+            JniFunctions f;
+            std::memset(&f, 0, sizeof(f));
+            f.NewString = fake_new_string;
+            f.NewStringUTF = fake_new_string_utf;
+            f.GetStringLength = fake_get_string_length;
+            f.GetStringChars = fake_get_string_chars;
+            f.ReleaseStringChars = fake_release_string_chars;
+            f.GetStringCritical = fake_get_string_critical;
+            f.ReleaseStringCritical = fake_release_string_critical;
+            return f;
+        }();
+        static JNIEnv env = [] {
+            JNIEnv e;
+            std::memset(&e, 0, sizeof(e));
+            e.functions = &functions;
+            return e;
+        }();
+        return &env;
+    }
+
+    /**
+     * UTF-16 copy of a UTF-8 string (setup helper for from_jstring)
+     */
+    std::vector<jchar> to_utf16(const std::string& s) {
+        std::vector<jchar> out;
+        size_t i = 0;
+        while (i < s.size()) {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            const size_t len = std::min(utf8_len(c), s.size() - i);
+            uint32_t cp = (len == 1) ? c : (c & (0xFF >> (len + 1)));
+            for (size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+            if (cp > 0xFFFF) {
+                cp -= 0x10000;
+                out.push_back(static_cast<jchar>(0xD800 + (cp >> 10)));
+                out.push_back(static_cast<jchar>(0xDC00 + (cp & 0x3FF)));
+            } else {
+                out.push_back(static_cast<jchar>(cp));
+            }
+            i += len;
+        }
+        return out;
+    }
+
+/* --------------------------------------------------------------------
+ *  Utf8StreamDecoder
+ * -------------------------------------------------------------------- */
+
+    void run_utf8_decoder(bench::State& state, const std::vector<std::string>& stream) {
+        Utf8StreamDecoder decoder;
+        TokenArena arena;
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : stream) {
+                arena.reset();
+                bytes += decoder.decode(piece, arena).size();
+            }
+            decoder.flush();
+        }
+        bench::do_not_optimize(bytes);
+        state.set_items_processed(state.iterations() * stream.size());
+    }
+
+    void BM_Utf8StreamDecoder_English(bench::State& state) { run_utf8_decoder(state, english_stream()); }
+    void BM_Utf8StreamDecoder_Cjk(bench::State& state) { run_utf8_decoder(state, cjk_stream()); }
+    void BM_Utf8StreamDecoder_Emoji(bench::State& state) { run_utf8_decoder(state, emoji_stream()); }
+
+/* --------------------------------------------------------------------
+ *  StopStringChecker
+ * -------------------------------------------------------------------- */
+
+    void run_stop_checker(bench::State& state, const std::vector<std::string>& stream,
+                          const std::vector<std::string>& stops) {
+        StopStringChecker checker;
+        checker.init(stops);
+        TokenArena arena;
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : stream) {
+                arena.reset();
+                bool stopped = false;
+                bytes += checker.feed(piece, stopped, arena).size();
+            }
+            arena.reset();
+            bytes += checker.flush(arena).size();
+        }
+        bench::do_not_optimize(bytes);
+        state.set_items_processed(state.iterations() * stream.size());
+    }
+
+    void BM_StopStringChecker_FewStops(bench::State& state) {
+        run_stop_checker(state, english_stream(), kFewStops);
+    }
+    void BM_StopStringChecker_ManyStops(bench::State& state) {
+        run_stop_checker(state, english_stream(), kManyStops);
+    }
+    void BM_StopStringChecker_ManyStops_Code(bench::State& state) {
+        run_stop_checker(state, code_stream(), kManyStops);
+    }
+
+/* --------------------------------------------------------------------
+ *  ToolCallState
+ * -------------------------------------------------------------------- */
+
+    void BM_ToolCallState_Accumulate_Json(bench::State& state) {
+        const auto& stream = tool_call_stream();
+        ToolCallState tool_state;
+        size_t completed = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : stream) {
+                if (tool_state.accumulate(piece)) {
+                    ++completed;
+                    tool_state.reset();
+                }
+            }
+        }
+        bench::do_not_optimize(completed);
+        state.set_items_processed(state.iterations() * stream.size());
+    }
+
+    void BM_ToolCallState_Accumulate_Prose(bench::State& state) {
+        const auto& stream = english_stream();
+        ToolCallState tool_state;
+        size_t completed = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : stream) {
+                completed += tool_state.accumulate(piece) ? 1 : 0;
+            }
+        }
+        bench::do_not_optimize(completed);
+        state.set_items_processed(state.iterations() * stream.size());
+    }
+
+/* --------------------------------------------------------------------
+ *  ModelState::detokenize / detokenize_buffered (need --model)
+ * -------------------------------------------------------------------- */
+
+    std::string model_path_arg() {
+        const auto& args = bench::extra_args();
+        for (size_t i = 0; i + 1 < args.size(); ++i) {
+            if (args[i] == "--model") return args[i + 1];
+        }
+        return {};
+    }
+
+    ModelState* bench_model() {
+        static ModelState* state = [] () -> ModelState* {
+            const std::string path = model_path_arg();
+            if (path.empty()) return nullptr;
+            llama_backend_init();
+            llama_model_params mparams = llama_model_default_params();
+            mparams.n_gpu_layers = 0;
+            mparams.use_mmap = true;
+            llama_model* model = llama_model_load_from_file(path.c_str(), mparams);
+            if (!model) return nullptr;
+            g_state.model = model;
+            return &g_state;
+        }();
+        return state;
+    }
+
+    std::vector<llama_token> model_tokens(ModelState* model_state, const char* text) {
+        std::string corpus;
+        while (corpus.size() < 16 * 1024) corpus += text;
+        return model_state->tokenize(corpus);
+    }
+
+    void run_detokenize(bench::State& state, const char* text) {
+        ModelState* model_state = bench_model();
+        if (!model_state) {
+            state.skip("pass --model <gguf>");
+            while (state.keep_running()) {}
+            return;
+        }
+        const std::vector<llama_token> toks = model_tokens(model_state, text);
+
+        TokenArena arena;
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            for (llama_token t : toks) {
+                arena.reset();
+                bytes += model_state->detokenize(t, arena).size();
+            }
+        }
+        bench::do_not_optimize(bytes);
+        state.set_items_processed(state.iterations() * toks.size());
+    }
+
+    void run_detokenize_buffered(bench::State& state, const char* text) {
+        ModelState* model_state = bench_model();
+        if (!model_state) {
+            state.skip("pass --model <gguf>");
+            while (state.keep_running()) {}
+            return;
+        }
+        const std::vector<llama_token> toks = model_tokens(model_state, text);
+
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            for (llama_token t : toks) {
+                bytes += model_state->detokenize_buffered(t).size();
+            }
+            model_state->flush_utf8_buffer();
+        }
+        bench::do_not_optimize(bytes);
+        state.set_items_processed(state.iterations() * toks.size());
+    }
+
+    void BM_Detokenize_English(bench::State& state) { run_detokenize(state, kEnglish); }
+    void BM_Detokenize_Cjk(bench::State& state) { run_detokenize(state, kCjk); }
+    void BM_Detokenize_Emoji(bench::State& state) { run_detokenize(state, kEmoji); }
+
+    void BM_DetokenizeBuffered_English(bench::State& state) { run_detokenize_buffered(state, kEnglish); }
+    void BM_DetokenizeBuffered_Cjk(bench::State& state) { run_detokenize_buffered(state, kCjk); }
+    void BM_DetokenizeBuffered_Emoji(bench::State& state) { run_detokenize_buffered(state, kEmoji); }
+
+/* --------------------------------------------------------------------
+ *  utf8::to_jstring_immediate / from_jstring
+ * -------------------------------------------------------------------- */
+
+    void run_to_jstring(bench::State& state, const std::vector<std::string>& stream) {
+        JNIEnv* env = fake_env();
+        // Feed only complete characters, as the generation loop does
+        std::vector<std::string> pieces;
+        Utf8StreamDecoder decoder;
+        TokenArena arena;
+        for (const auto& p : stream) {
+            arena.reset();
+            std::string_view s = decoder.decode(p, arena);
+            if (!s.empty()) pieces.emplace_back(s);
+        }
+
+        size_t n = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : pieces) {
+                n += utf8::to_jstring_immediate(env, piece) != nullptr;
+            }
+        }
+        bench::do_not_optimize(n);
+        state.set_items_processed(state.iterations() * pieces.size());
+    }
+
+    void BM_ToJstringImmediate_English(bench::State& state) { run_to_jstring(state, english_stream()); }
+    void BM_ToJstringImmediate_Cjk(bench::State& state) { run_to_jstring(state, cjk_stream()); }
+    void BM_ToJstringImmediate_Emoji(bench::State& state) { run_to_jstring(state, emoji_stream()); }
+
+    void run_from_jstring(bench::State& state, const std::string& text) {
+        JNIEnv* env = fake_env();
+        const std::vector<jchar> u16 = to_utf16(text);
+        FakeString js{u16.data(), static_cast<jsize>(u16.size())};
+
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            bytes += utf8::from_jstring(env, reinterpret_cast<jstring>(&js)).size();
+        }
+        bench::do_not_optimize(bytes);
+        // One call per prompt: report per call
+        state.set_items_processed(state.iterations());
+    }
+
+    void BM_FromJstring_English(bench::State& state) { run_from_jstring(state, kEnglish); }
+    void BM_FromJstring_Mixed(bench::State& state) {
+        run_from_jstring(state, std::string(kEnglish) + kCjk + kEmoji);
+    }
+
+/* --------------------------------------------------------------------
+ *  Megabyte strings (long prompts, tool results, RAG context) in both
+ *  directions - reported as GB/s of input
+ * -------------------------------------------------------------------- */
+
+    std::string repeat_to(const std::string& text, size_t bytes) {
+        std::string out;
+        out.reserve(bytes + text.size());
+        while (out.size() < bytes) out += text;
+        return out;
+    }
+
+    std::string large_ascii() { return repeat_to(std::string(kEnglish) + kCode, 1 << 20); }
+    std::string large_cjk() { return repeat_to(kCjk, 1 << 20); }
+    std::string large_mixed() {
+        return repeat_to(std::string(kEnglish) + kCjk + kEmoji + kToolCall, 1 << 20);
+    }
+
+    void run_to_jstring_large(bench::State& state, const std::string& text) {
+        JNIEnv* env = fake_env();
+        size_t n = 0;
+        while (state.keep_running()) {
+            n += utf8::to_jstring_immediate(env, text) != nullptr;
+        }
+        bench::do_not_optimize(n);
+        state.set_items_processed(state.iterations());
+        state.set_bytes_processed(state.iterations() * text.size());
+    }
+
+    void run_from_jstring_large(bench::State& state, const std::string& text) {
+        JNIEnv* env = fake_env();
+        const std::vector<jchar> u16 = to_utf16(text);
+        FakeString js{u16.data(), static_cast<jsize>(u16.size())};
+
+        size_t bytes = 0;
+        while (state.keep_running()) {
+            bytes += utf8::from_jstring(env, reinterpret_cast<jstring>(&js)).size();
+        }
+        bench::do_not_optimize(bytes);
+        state.set_items_processed(state.iterations());
+        state.set_bytes_processed(state.iterations() * u16.size() * sizeof(jchar));
+    }
+
+    void BM_ToJstring_1MB_Ascii(bench::State& state) { run_to_jstring_large(state, large_ascii()); }
+    void BM_ToJstring_1MB_Cjk(bench::State& state) { run_to_jstring_large(state, large_cjk()); }
+    void BM_ToJstring_1MB_Mixed(bench::State& state) { run_to_jstring_large(state, large_mixed()); }
+
+    void BM_FromJstring_1MB_Ascii(bench::State& state) { run_from_jstring_large(state, large_ascii()); }
+    void BM_FromJstring_1MB_Cjk(bench::State& state) { run_from_jstring_large(state, large_cjk()); }
+    void BM_FromJstring_1MB_Mixed(bench::State& state) { run_from_jstring_large(state, large_mixed()); }
+
+/* --------------------------------------------------------------------
+ *  Full per-token pipeline (arena piece -> decoder -> tool detection ->
+ *  stop strings -> JNI string), mirroring the nativeGenerateStream loop
+ *  body. This is the zero-allocation-per-token guarantee.
+ * -------------------------------------------------------------------- */
+
+    void BM_Pipeline_Mixed(bench::State& state) {
+        const auto& stream = mixed_stream();
+        JNIEnv* env = fake_env();
+        Utf8StreamDecoder decoder;
+        ToolCallState tool_state;
+        StopStringChecker checker;
+        checker.init(kManyStops);
+        TokenArena arena;
+
+        size_t n = 0;
+        while (state.keep_running()) {
+            for (const auto& piece : stream) {
+                arena.reset();
+                // Stands in for ModelState::detokenize writing into the arena
+                std::string_view raw = arena.copy(piece);
+                std::string_view chars = decoder.decode(raw, arena);
+                if (chars.empty()) continue;
+                if (tool_state.accumulate(chars)) tool_state.reset();
+                if (tool_state.is_collecting()) continue;
+                bool stopped = false;
+                std::string_view safe = checker.feed(chars, stopped, arena);
+                if (!safe.empty()) n += utf8::to_jstring_immediate(env, safe) != nullptr;
+            }
+            arena.reset();
+            checker.flush(arena);
+            decoder.flush();
+            tool_state.reset();
+        }
+        bench::do_not_optimize(n);
+        state.set_items_processed(state.iterations() * stream.size());
+    }
+
+} // anonymous namespace
+
+// Budgets are allocations per token. The streaming path is allocation-free
+// in steady state; anything above zero is a regression. from_jstring runs
+// once per prompt and returns an owning string, so it keeps one.
+BENCHMARK_ALLOCS(BM_Utf8StreamDecoder_English, 0.0);
+BENCHMARK_ALLOCS(BM_Utf8StreamDecoder_Cjk, 0.0);
+BENCHMARK_ALLOCS(BM_Utf8StreamDecoder_Emoji, 0.0);
+BENCHMARK_ALLOCS(BM_StopStringChecker_FewStops, 0.0);
+BENCHMARK_ALLOCS(BM_StopStringChecker_ManyStops, 0.0);
+BENCHMARK_ALLOCS(BM_StopStringChecker_ManyStops_Code, 0.0);
+BENCHMARK_ALLOCS(BM_ToolCallState_Accumulate_Json, 0.0);
+BENCHMARK_ALLOCS(BM_ToolCallState_Accumulate_Prose, 0.0);
+BENCHMARK_ALLOCS(BM_Detokenize_English, 0.0);
+BENCHMARK_ALLOCS(BM_Detokenize_Cjk, 0.0);
+BENCHMARK_ALLOCS(BM_Detokenize_Emoji, 0.0);
+BENCHMARK_ALLOCS(BM_DetokenizeBuffered_English, 0.05);
+BENCHMARK_ALLOCS(BM_DetokenizeBuffered_Cjk, 0.05);
+BENCHMARK_ALLOCS(BM_DetokenizeBuffered_Emoji, 0.05);
+BENCHMARK_ALLOCS(BM_ToJstringImmediate_English, 0.0);
+BENCHMARK_ALLOCS(BM_ToJstringImmediate_Cjk, 0.0);
+BENCHMARK_ALLOCS(BM_ToJstringImmediate_Emoji, 0.0);
+BENCHMARK_ALLOCS(BM_FromJstring_English, 1.0);
+BENCHMARK_ALLOCS(BM_FromJstring_Mixed, 1.0);
+BENCHMARK_ALLOCS(BM_ToJstring_1MB_Ascii, 0.0);
+BENCHMARK_ALLOCS(BM_ToJstring_1MB_Cjk, 0.0);
+BENCHMARK_ALLOCS(BM_ToJstring_1MB_Mixed, 0.0);
+BENCHMARK_ALLOCS(BM_FromJstring_1MB_Ascii, 1.0);
+BENCHMARK_ALLOCS(BM_FromJstring_1MB_Cjk, 1.0);
+BENCHMARK_ALLOCS(BM_FromJstring_1MB_Mixed, 1.0);
+BENCHMARK_ALLOCS(BM_Pipeline_Mixed, 0.0);
+
+int main(int argc, char** argv) {
+    logger::set_level(logger::Level::Error);
+    const int rc = bench::run_all(argc, argv);
+    if (bench_model()) {
+        g_state.release();
+        llama_backend_free();
+    }
+    return rc;
+}
@@ -0,0 +1,182 @@
+#include "microbench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/* --------------------------------------------------------------------
+ *  Allocation counting: replace the global allocation functions.
+ *  Every form of operator new funnels through counted_alloc().
+ * -------------------------------------------------------------------- */
+
+namespace {
+
+    std::atomic<uint64_t> g_allocations{0};
+
+    void* counted_alloc(std::size_t size) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0) size = 1;
+        void* p = std::malloc(size);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+
+    void* counted_alloc_aligned(std::size_t size, std::size_t align) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0) size = 1;
+        void* p = nullptr;
+        if (posix_memalign(&p, std::max(align, sizeof(void*)), size) != 0) throw std::bad_alloc();
+        return p;
+    }
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t al) {
+    return counted_alloc_aligned(size, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al) {
+    return counted_alloc_aligned(size, static_cast<std::size_t>(al));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace bench {
+
+    namespace {
+
+        struct Entry {
+            const char* name;
+            BenchmarkFn fn;
+            double max_allocs_per_item;
+        };
+
+        // Function-local so registration order across TUs doesn't matter
+        std::vector<Entry>& registry() {
+            static std::vector<Entry> r;
+            return r;
+        }
+
+        std::vector<std::string>& extra() {
+            static std::vector<std::string> e;
+            return e;
+        }
+
+        constexpr uint64_t kMaxIterations = 1000000000ULL;
+
+    } // anonymous namespace
+
+    uint64_t allocation_count() {
+        return g_allocations.load(std::memory_order_relaxed);
+    }
+
+    int register_benchmark(const char* name, BenchmarkFn fn, double max_allocs_per_item) {
+        registry().push_back({name, fn, max_allocs_per_item});
+        return static_cast<int>(registry().size());
+    }
+
+    const std::vector<std::string>& extra_args() {
+        return extra();
+    }
+
+    int run_all(int argc, char** argv) {
+        std::string filter;
+        double min_time_s = 0.5;
+
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--filter" && i + 1 < argc) {
+                filter = argv[++i];
+            } else if (arg == "--min-time" && i + 1 < argc) {
+                min_time_s = std::atof(argv[++i]);
+            } else {
+                extra().push_back(arg);
+            }
+        }
+
+        const uint64_t min_time_ns = static_cast<uint64_t>(min_time_s * 1e9);
+
+        std::printf("%-40s %12s %12s %14s %8s %10s\n",
+                    "Benchmark", "Iterations", "ns/item", "allocs/item", "GB/s", "budget");
+        std::printf("%s\n", std::string(101, '-').c_str());
+
+        int failures = 0;
+        for (const Entry& e : registry()) {
+            if (!filter.empty() && std::string(e.name).find(filter) == std::string::npos) continue;
+
+            // Grow the iteration count until a run lasts at least min_time
+            uint64_t iters = 1;
+            State state(iters);
+            for (;;) {
+                state = State(iters);
+                e.fn(state);
+                if (!state.skip_reason().empty()) break;
+                if (state.elapsed_ns() >= min_time_ns || iters >= kMaxIterations) break;
+
+                const double per_iter = std::max<double>(1.0, static_cast<double>(state.elapsed_ns()))
+                                        / static_cast<double>(iters);
+                const double wanted = 1.4 * static_cast<double>(min_time_ns) / per_iter;
+                iters = std::min<uint64_t>(kMaxIterations,
+                                           std::max<uint64_t>(iters + 1,
+                                                              std::min<uint64_t>(iters * 10,
+                                                                                 static_cast<uint64_t>(wanted))));
+            }
+
+            if (!state.skip_reason().empty()) {
+                std::printf("%-40s %12s  skipped: %s\n", e.name, "-", state.skip_reason().c_str());
+                continue;
+            }
+
+            const double items = static_cast<double>(std::max<uint64_t>(1, state.items()));
+            const double ns_per_item = static_cast<double>(state.elapsed_ns()) / items;
+            const double allocs_per_item = static_cast<double>(state.allocations()) / items;
+            const bool over_budget = e.max_allocs_per_item >= 0.0 &&
+                                     allocs_per_item > e.max_allocs_per_item + 1e-9;
+
+            char budget[32];
+            if (e.max_allocs_per_item >= 0.0) {
+                std::snprintf(budget, sizeof(budget), "%.2f", e.max_allocs_per_item);
+            } else {
+                std::snprintf(budget, sizeof(budget), "-");
+            }
+
+            char throughput[32];
+            if (state.bytes() > 0 && state.elapsed_ns() > 0) {
+                std::snprintf(throughput, sizeof(throughput), "%.2f",
+                              static_cast<double>(state.bytes()) / static_cast<double>(state.elapsed_ns()));
+            } else {
+                std::snprintf(throughput, sizeof(throughput), "-");
+            }
+
+            std::printf("%-40s %12llu %12.1f %14.3f %8s %10s%s\n",
+                        e.name, static_cast<unsigned long long>(state.iterations()),
+                        ns_per_item, allocs_per_item, throughput, budget,
+                        over_budget ? "  FAIL" : "");
+            if (over_budget) ++failures;
+        }
+
+        if (failures > 0) {
+            std::printf("\n%d benchmark%s exceeded the allocation budget\n",
+                        failures, failures == 1 ? "" : "s");
+            return 1;
+        }
+        return 0;
+    }
+
+} // namespace bench
@@ -0,0 +1,130 @@
+#pragma once
+
+/**
+ * Minimal Google-Benchmark-style harness for host micro-benchmarks.
+ *
+ * Every benchmark reports ns/item and heap allocations/item (an "item" is
+ * whatever the benchmark processes - usually one generated token), plus
+ * GB/s when it reports bytes processed. The binary replaces global
+ * operator new so allocations are counted exactly; a benchmark registered
+ * with an allocation budget fails the run when it exceeds it, so per-token
+ * heap churn can't silently creep back in.
+ *
+ *   static void BM_Foo(bench::State& state) {
+ *       auto input = make_input();           // setup: not timed/counted
+ *       while (state.keep_running()) {
+ *           for (auto& piece : input) consume(piece);
+ *       }
+ *       state.set_items_processed(state.iterations() * input.size());
+ *   }
+ *   BENCHMARK_ALLOCS(BM_Foo, 0.0);           // zero allocations per item
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    /**
+     * Number of global operator new calls so far (all threads)
+     */
+    uint64_t allocation_count();
+
+    /**
+     * Prevent the optimizer from discarding a computed value
+     */
+    template <typename T>
+    inline void do_not_optimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    class State {
+    public:
+        explicit State(uint64_t max_iterations) : max_iterations_(max_iterations) {}
+
+        /**
+         * Loop condition. The first call starts the clock and the
+         * allocation counter; the last one stops both.
+         */
+        bool keep_running() {
+            if (iterations_ == 0 && !started_) {
+                started_ = true;
+                alloc_start_ = allocation_count();
+                start_ = std::chrono::steady_clock::now();
+            }
+            if (iterations_ < max_iterations_) {
+                ++iterations_;
+                return true;
+            }
+            elapsed_ns_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count());
+            allocations_ = allocation_count() - alloc_start_;
+            return false;
+        }
+
+        uint64_t iterations() const { return iterations_; }
+
+        void set_items_processed(uint64_t items) { items_ = items; }
+
+        /**
+         * Input bytes processed; when set, throughput (GB/s) is reported
+         */
+        void set_bytes_processed(uint64_t bytes) { bytes_ = bytes; }
+
+        /**
+         * Mark the benchmark as not runnable in this environment
+         * (e.g. no model supplied). It is reported but not failed.
+         */
+        void skip(const std::string& reason) { skip_reason_ = reason; }
+
+        uint64_t items() const { return items_; }
+        uint64_t bytes() const { return bytes_; }
+        uint64_t elapsed_ns() const { return elapsed_ns_; }
+        uint64_t allocations() const { return allocations_; }
+        const std::string& skip_reason() const { return skip_reason_; }
+
+    private:
+        uint64_t max_iterations_;
+        uint64_t iterations_ = 0;
+        uint64_t items_ = 0;
+        uint64_t bytes_ = 0;
+        bool started_ = false;
+        uint64_t alloc_start_ = 0;
+        uint64_t allocations_ = 0;
+        uint64_t elapsed_ns_ = 0;
+        std::chrono::steady_clock::time_point start_;
+        std::string skip_reason_;
+    };
+
+    using BenchmarkFn = void (*)(State&);
+
+    /**
+     * Register a benchmark. max_allocs_per_item < 0 disables the budget.
+     */
+    int register_benchmark(const char* name, BenchmarkFn fn, double max_allocs_per_item);
+
+    /**
+     * Run all registered benchmarks.
+     * Flags: --filter <substring>, --min-time <seconds>
+     * Returns 0 if every budget held, 1 otherwise.
+     */
+    int run_all(int argc, char** argv);
+
+    /**
+     * Remaining command line after run_all() consumed its own flags,
+     * for benchmark-specific options (e.g. --model).
+     */
+    const std::vector<std::string>& extra_args();
+
+} // namespace bench
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+
+#define BENCHMARK_ALLOCS(fn, max_allocs_per_item)                                   \
+    static int BENCHMARK_CONCAT(bench_reg_, __LINE__) =                             \
+        ::bench::register_benchmark(#fn, fn, max_allocs_per_item)
+
+#define BENCHMARK(fn) BENCHMARK_ALLOCS(fn, -1.0)
@@ -0,0 +1,601 @@
+/*=============================================================
+ *   tools/trace_replay.cpp
+ *=============================================================
+ *
+ *  Host-side replay of generation traces recorded on device
+ *  (GGUFNativeLib.nativeStartTraceRecording).
+ *
+ *  Usage:
+ *    trace_replay <model.gguf> <trace.agtr> [options]
+ *
+ *  Options:
+ *    --forced      Teacher-force the recorded tokens and compare the
+ *                  logits hash + sampler choice at every position
+ *                  (isolates numeric drift from sampling drift).
+ *    --bench N     Replay each session N times and report prefill /
+ *                  sample / decode latency percentiles vs. the recording.
+ *    --lora-dir D  Where to find the recorded LoRA adapters when their
+ *                  device paths don't exist on the host (matched by file
+ *                  name). Sessions whose adapters can't be loaded are
+ *                  skipped and counted as diverged.
+ *    -t N          Threads (default: hardware concurrency).
+ *    -v            Verbose (llama.cpp + ai_core logs).
+ *
+ *  Free-run mode (default) re-runs the same loop as nativeGenerateStream
+ *  and diffs tokens, streamed text, tool calls and stop reason, printing
+ *  the first divergence. Exit code 0 = all sessions match, 1 = at least
+ *  one diverged, 2 = usage / IO error.
+ *============================================================*/
+
+#include "llama.h"
+#include "state/model_state.h"
+#include "generation/generation_trace.h"
+#include "generation/stop_string_checker.h"
+#include "generation/token_arena.h"
+#include "generation/utf8_stream_decoder.h"
+#include "tool_calling/tool_call_state.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Options {
+        std::string model_path;
+        std::string trace_path;
+        std::string lora_dir;
+        bool forced = false;
+        int bench_runs = 0;
+        int threads = 0;
+        bool verbose = false;
+    };
+
+    struct ReplayResult {
+        std::vector<llama_token> tokens;
+        std::string output_text;
+        std::string tool_name;
+        std::string tool_payload;
+        trace::StopReason stop_reason = trace::StopReason::MaxTokens;
+
+        // Forced mode
+        int first_logits_mismatch = -1;
+        int first_sample_mismatch = -1;
+
+        // Timing
+        uint64_t prefill_us = 0;
+        std::vector<uint32_t> sample_us;
+        std::vector<uint32_t> decode_us;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    uint32_t elapsed_us(Clock::time_point since) {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - since).count());
+    }
+
+    void print_usage(const char* argv0) {
+        std::fprintf(stderr,
+                     "usage: %s <model.gguf> <trace.agtr> [--forced] [--bench N] [--lora-dir D]\n"
+                     "          [-t N] [-v]\n",
+                     argv0);
+    }
+
+    bool parse_args(int argc, char** argv, Options& opt) {
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--forced") {
+                opt.forced = true;
+            } else if (arg == "--bench" && i + 1 < argc) {
+                opt.bench_runs = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--lora-dir" && i + 1 < argc) {
+                opt.lora_dir = argv[++i];
+            } else if (arg == "-t" && i + 1 < argc) {
+                opt.threads = std::atoi(argv[++i]);
+            } else if (arg == "-v") {
+                opt.verbose = true;
+            } else if (!arg.empty() && arg[0] == '-') {
+                return false;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+        if (positional.size() != 2) return false;
+        opt.model_path = positional[0];
+        opt.trace_path = positional[1];
+        return true;
+    }
+
+    void quiet_llama_log(ggml_log_level, const char*, void*) {}
+
+/* --------------------------------------------------------------------
+ *  Session setup
+ * -------------------------------------------------------------------- */
+
+    bool ensure_context(ModelState& state, int32_t n_ctx, int threads) {
+        if (state.ctx && state.ctx_size == n_ctx) return true;
+
+        if (state.ctx) {
+            llama_free(state.ctx);
+            state.ctx = nullptr;
+        }
+
+        // Same context shape as nativeLoadModel
+        llama_context_params cparams = llama_context_default_params();
+        cparams.n_ctx = static_cast<uint32_t>(n_ctx);
+        cparams.n_batch = 512;
+        cparams.n_ubatch = 256;
+        cparams.n_threads = threads;
+        cparams.n_threads_batch = threads;
+        cparams.offload_kqv = false;
+        cparams.n_seq_max = 1;
+        cparams.no_perf = false;
+
+        state.ctx = llama_init_from_model(state.model, cparams);
+        if (!state.ctx) return false;
+
+        state.ctx_size = n_ctx;
+        state.batch_size = static_cast<int32_t>(cparams.n_batch);
+
+        // The new context starts without adapters
+        for (auto& lora : state.lora_adapters) lora.applied_scale = 0.0f;
+        return true;
+    }
+
+    bool readable(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (f) std::fclose(f);
+        return f != nullptr;
+    }
+
+    /**
+     * Load the session's recorded adapters - from the device path if it
+     * exists here, else by file name under --lora-dir - and build the mix
+     * to apply. On failure `why` names the adapter that can't be found.
+     */
+    bool load_session_adapters(ModelState& state, const trace::SessionTrace& s,
+                               const Options& opt, LoraMix& mix, std::string& why) {
+        mix.clear();
+        for (const auto& lora : s.lora_adapters) {
+            std::string path = lora.path;
+            if (!readable(path) && !opt.lora_dir.empty()) {
+                const size_t slash = lora.path.find_last_of('/');
+                path = opt.lora_dir + "/" + lora.path.substr(slash == std::string::npos ? 0 : slash + 1);
+            }
+            if (!readable(path)) {
+                why = "'" + lora.name + "' not found (recorded at " + lora.path + ")";
+                return false;
+            }
+
+            // Same name, different file in an earlier session: reload it
+            const std::string loaded = state.lora_adapter_path(lora.name);
+            if (!loaded.empty() && loaded != path) state.unload_lora_adapter(lora.name);
+            if (!state.load_lora_adapter(lora.name, path)) {
+                why = "'" + lora.name + "' failed to load from " + path;
+                return false;
+            }
+            mix.emplace_back(lora.name, lora.scale);
+        }
+        return true;
+    }
+
+    /**
+     * Restore the recorded sampler / grammar / stop configuration and
+     * adapter mix. Mirrors what the JNI setters do on device, in the same
+     * order.
+     */
+    bool configure_session(ModelState& state, const trace::SessionTrace& s, const LoraMix& mix) {
+        state.update_config([&](GenerationConfig& c) {
+            c.sampler_params = s.sampler;
+            c.stop_strings = s.stop_strings;
+            c.tools_enabled = s.tools_enabled;
+            c.tools_json = s.tools_json;
+            c.grammar_mode = s.grammar_mode;
+            c.use_typed_grammar = s.typed_grammar;
+        });
+
+        if (!state.set_response_schema(s.response_schema)) {
+            std::fprintf(stderr, "  response schema failed to compile\n");
+            return false;
+        }
+
+        state.prepare_for_generation(*state.config());
+        state.apply_lora_adapters(mix);
+        return true;
+    }
+
+    bool accept_token(ModelState& state, const GenerationConfig& cfg, llama_token tok) {
+        try {
+            llama_sampler_accept(state.sampler, tok);
+            return true;
+        } catch (const std::runtime_error&) {
+            // Same fallback as the device loop: drop grammar for this turn
+            state.rebuild_sampler(cfg, /*with_grammar=*/false);
+            return false;
+        }
+    }
+
+/* --------------------------------------------------------------------
+ *  Replay
+ * -------------------------------------------------------------------- */
+
+    /**
+     * Re-run one session. In free-run mode this is the nativeGenerateStream
+     * loop minus JNI; in forced mode the recorded tokens are fed back
+     * instead of the sampled ones.
+     */
+    bool replay_session(ModelState& state, const trace::SessionTrace& s, bool forced,
+                        ReplayResult& out) {
+        const llama_vocab* vocab = llama_model_get_vocab(state.model);
+        const int32_t n_vocab = llama_vocab_n_tokens(vocab);
+        const std::vector<llama_token>& prompt_toks = s.prompt_tokens;
+
+        auto prefill_start = Clock::now();
+        if (!state.decode_prompt(prompt_toks)) {
+            std::fprintf(stderr, "  prompt decode failed\n");
+            return false;
+        }
+        out.prefill_us = elapsed_us(prefill_start);
+
+        const ConfigSnapshot cfg = state.config();
+        const bool detect_tool_calls = cfg->tools_enabled && !cfg->has_response_schema();
+        ToolCallState tool_state;
+        Utf8StreamDecoder utf8_decoder;
+        StopStringChecker stop_checker;
+        stop_checker.init(cfg->stop_strings);
+        TokenArena arena;
+
+        const llama_token eos = llama_vocab_eos(vocab);
+        const llama_token eot = llama_vocab_eot(vocab);
+
+        const int32_t to_generate = forced
+                ? static_cast<int32_t>(s.tokens.size())
+                : s.max_tokens;
+
+        out.sample_us.reserve(static_cast<size_t>(to_generate));
+        out.decode_us.reserve(static_cast<size_t>(to_generate));
+
+        for (int i = 0; i < to_generate; ++i) {
+            int current_pos = static_cast<int>(prompt_toks.size()) + i;
+            if (current_pos >= state.ctx_size - 1) {
+                out.stop_reason = trace::StopReason::Error;
+                break;
+            }
+
+            arena.reset();
+
+            auto sample_start = Clock::now();
+            if (forced) {
+                const uint64_t h = trace::hash_logits(llama_get_logits_ith(state.ctx, -1), n_vocab);
+                if (out.first_logits_mismatch < 0 && h != s.tokens[i].logits_hash) {
+                    out.first_logits_mismatch = i;
+                }
+            }
+            llama_token tok = llama_sampler_sample(state.sampler, state.ctx, -1);
+            if (tok < 0) {
+                out.stop_reason = trace::StopReason::Error;
+                break;
+            }
+            if (forced) {
+                if (out.first_sample_mismatch < 0 && tok != s.tokens[i].token) {
+                    out.first_sample_mismatch = i;
+                }
+                tok = s.tokens[i].token;
+            }
+            accept_token(state, *cfg, tok);
+            out.sample_us.push_back(elapsed_us(sample_start));
+            out.tokens.push_back(tok);
+
+            if (i == 0 && (tok == eos || tok == eot)) {
+                tok = state.space_token();
+            }
+            if (tok == eos || tok == eot) {
+                out.stop_reason = trace::StopReason::EndOfGeneration;
+                break;
+            }
+
+            std::string_view complete_chars = utf8_decoder.decode(state.detokenize(tok, arena), arena);
+            bool stop = false;
+            if (!complete_chars.empty()) {
+                if (detect_tool_calls && tool_state.accumulate(complete_chars)) {
+                    std::string name, payload;
+                    if (tool_state.extract_tool_call(name, payload)) {
+                        out.tool_name = name;
+                        out.tool_payload = payload;
+                        out.stop_reason = trace::StopReason::ToolCall;
+                        break;
+                    }
+                    tool_state.reset();
+                }
+
+                if (!tool_state.is_collecting()) {
+                    if (stop_checker.has_stops()) {
+                        out.output_text += stop_checker.feed(complete_chars, stop, arena);
+                    } else {
+                        out.output_text += complete_chars;
+                    }
+                }
+            }
+            if (stop) {
+                out.stop_reason = trace::StopReason::StopString;
+                break;
+            }
+
+            auto decode_start = Clock::now();
+            const int decode_result = state.decode_token(tok, current_pos);
+            out.decode_us.push_back(elapsed_us(decode_start));
+            if (decode_result != 0) {
+                out.stop_reason = trace::StopReason::Error;
+                break;
+            }
+        }
+
+        arena.reset();
+        std::string_view remaining = utf8_decoder.flush();
+        if (!remaining.empty()) {
+            if (stop_checker.has_stops()) {
+                bool stopped = false;
+                out.output_text += stop_checker.feed(remaining, stopped, arena);
+            } else {
+                out.output_text += remaining;
+            }
+        }
+        if (stop_checker.has_stops()) {
+            out.output_text += stop_checker.flush(arena);
+        }
+
+        // A forced replay ends where the recording ended
+        if (forced) {
+            out.stop_reason = s.stop_reason;
+        }
+
+        return true;
+    }
+
+/* --------------------------------------------------------------------
+ *  Reporting
+ * -------------------------------------------------------------------- */
+
+    std::string printable(const std::string& s, size_t max_len = 80) {
+        std::string out;
+        for (char c : s.substr(0, max_len)) {
+            if (c == '\n') out += "\\n";
+            else if (c == '\t') out += "\\t";
+            else out += c;
+        }
+        if (s.size() > max_len) out += "...";
+        return out;
+    }
+
+    size_t first_text_divergence(const std::string& a, const std::string& b) {
+        const size_t n = std::min(a.size(), b.size());
+        for (size_t i = 0; i < n; ++i) {
+            if (a[i] != b[i]) return i;
+        }
+        return n;
+    }
+
+    /**
+     * Compare a replay against the recording. Returns true if they match.
+     */
+    bool report_diff(ModelState& state, const trace::SessionTrace& s, const ReplayResult& r,
+                     bool forced) {
+        bool ok = true;
+
+        if (forced) {
+            if (r.first_logits_mismatch >= 0) {
+                std::printf("  logits diverge at token %d\n", r.first_logits_mismatch);
+                ok = false;
+            }
+            if (r.first_sample_mismatch >= 0) {
+                const int i = r.first_sample_mismatch;
+                std::printf("  sampler diverges at token %d: recorded %d '%s'\n",
+                            i, s.tokens[i].token,
+                            printable(state.detokenize_single(s.tokens[i].token)).c_str());
+                ok = false;
+            }
+            return ok;
+        }
+
+        const size_t n = std::min(r.tokens.size(), s.tokens.size());
+        size_t i = 0;
+        while (i < n && r.tokens[i] == s.tokens[i].token) ++i;
+        if (i < n || r.tokens.size() != s.tokens.size()) {
+            std::printf("  tokens diverge at %zu (recorded %zu, replayed %zu)\n",
+                        i, s.tokens.size(), r.tokens.size());
+            if (i < n) {
+                std::printf("    recorded %d '%s' / replayed %d '%s'\n",
+                            s.tokens[i].token,
+                            printable(state.detokenize_single(s.tokens[i].token)).c_str(),
+                            r.tokens[i],
+                            printable(state.detokenize_single(r.tokens[i])).c_str());
+            }
+            ok = false;
+        }
+
+        if (r.output_text != s.output_text) {
+            const size_t at = first_text_divergence(r.output_text, s.output_text);
+            std::printf("  text diverges at byte %zu\n    recorded: '%s'\n    replayed: '%s'\n",
+                        at,
+                        printable(s.output_text.substr(at)).c_str(),
+                        printable(r.output_text.substr(at)).c_str());
+            ok = false;
+        }
+
+        if (r.tool_name != s.tool_name || r.tool_payload != s.tool_payload) {
+            std::printf("  tool call differs: recorded '%s' / replayed '%s'\n",
+                        s.tool_name.c_str(), r.tool_name.c_str());
+            ok = false;
+        }
+
+        if (r.stop_reason != s.stop_reason) {
+            std::printf("  stop reason differs: recorded %s / replayed %s\n",
+                        trace::stop_reason_name(s.stop_reason),
+                        trace::stop_reason_name(r.stop_reason));
+            ok = false;
+        }
+        return ok;
+    }
+
+    template <typename T>
+    double percentile(std::vector<T> v, double p) {
+        if (v.empty()) return 0.0;
+        std::sort(v.begin(), v.end());
+        const size_t idx = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1) + 0.5));
+        return static_cast<double>(v[idx]);
+    }
+
+    template <typename T>
+    void print_latency_row(const char* label, const std::vector<T>& recorded,
+                           const std::vector<T>& replayed) {
+        std::printf("  %-8s  recorded p50 %8.0f p90 %8.0f p99 %8.0f | "
+                    "replayed p50 %8.0f p90 %8.0f p99 %8.0f  (us)\n",
+                    label,
+                    percentile(recorded, 0.50), percentile(recorded, 0.90), percentile(recorded, 0.99),
+                    percentile(replayed, 0.50), percentile(replayed, 0.90), percentile(replayed, 0.99));
+    }
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (opt.threads <= 0) {
+        opt.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    if (!opt.verbose) {
+        llama_log_set(quiet_llama_log, nullptr);
+        logger::set_level(logger::Level::Warning);
+    }
+
+    trace::TraceReader reader;
+    if (!reader.open(opt.trace_path)) {
+        std::fprintf(stderr, "cannot open trace '%s': %s\n",
+                     opt.trace_path.c_str(), reader.error().c_str());
+        return 2;
+    }
+
+    llama_backend_init();
+
+    ModelState& state = g_state;
+    llama_model_params mparams = llama_model_default_params();
+    mparams.n_gpu_layers = 0;
+    mparams.use_mmap = true;
+    state.model = llama_model_load_from_file(opt.model_path.c_str(), mparams);
+    if (!state.model) {
+        std::fprintf(stderr, "cannot load model '%s'\n", opt.model_path.c_str());
+        return 2;
+    }
+
+    char desc[256] = {0};
+    llama_model_desc(state.model, desc, sizeof(desc));
+    const int32_t n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(state.model));
+
+    int sessions = 0;
+    int diverged = 0;
+
+    std::vector<uint64_t> rec_prefill, rep_prefill;
+    std::vector<uint32_t> rec_sample, rep_sample, rec_decode, rep_decode;
+
+    trace::SessionTrace s;
+    while (reader.next(s)) {
+        ++sessions;
+        std::printf("session %d: %zu prompt tokens, %zu generated, stop=%s\n",
+                    sessions, s.prompt_tokens.size(), s.tokens.size(),
+                    trace::stop_reason_name(s.stop_reason));
+
+        if (s.n_vocab != n_vocab) {
+            std::printf("  vocab mismatch (trace %d, model %d) - skipped\n", s.n_vocab, n_vocab);
+            ++diverged;
+            continue;
+        }
+        if (s.model_desc != desc) {
+            std::printf("  note: recorded on '%s', replaying on '%s'\n", s.model_desc.c_str(), desc);
+        }
+        if (!ensure_context(state, s.n_ctx, opt.threads)) {
+            std::fprintf(stderr, "cannot create context (n_ctx=%d)\n", s.n_ctx);
+            return 2;
+        }
+
+        LoraMix mix;
+        std::string why;
+        if (!load_session_adapters(state, s, opt, mix, why)) {
+            std::printf("  adapter mix not reproducible: %s - skipped\n", why.c_str());
+            ++diverged;
+            continue;
+        }
+
+        if (state.tokenize(s.prompt) != s.prompt_tokens) {
+            std::printf("  prompt tokenization differs from recording (replaying recorded tokens)\n");
+        }
+
+        const int runs = std::max(1, opt.bench_runs);
+        bool session_ok = true;
+        for (int run = 0; run < runs; ++run) {
+            if (!configure_session(state, s, mix)) {
+                session_ok = false;
+                break;
+            }
+            ReplayResult r;
+            if (!replay_session(state, s, opt.forced, r)) {
+                session_ok = false;
+                break;
+            }
+            if (run == 0) {
+                session_ok = report_diff(state, s, r, opt.forced);
+            }
+            if (opt.bench_runs > 0) {
+                rep_prefill.push_back(r.prefill_us);
+                rep_sample.insert(rep_sample.end(), r.sample_us.begin(), r.sample_us.end());
+                rep_decode.insert(rep_decode.end(), r.decode_us.begin(), r.decode_us.end());
+            }
+        }
+
+        if (opt.bench_runs > 0) {
+            rec_prefill.push_back(s.prefill_us);
+            for (const auto& t : s.tokens) {
+                rec_sample.push_back(t.sample_us);
+                if (t.decode_us > 0) rec_decode.push_back(t.decode_us);
+            }
+        }
+
+        std::printf("  %s\n", session_ok ? "OK" : "DIVERGED");
+        if (!session_ok) ++diverged;
+    }
+
+    if (!reader.error().empty()) {
+        std::fprintf(stderr, "trace read error: %s\n", reader.error().c_str());
+        state.release();
+        llama_backend_free();
+        return 2;
+    }
+
+    if (opt.bench_runs > 0) {
+        std::printf("\nlatency (%d run%s per session, %d thread%s):\n",
+                    opt.bench_runs, opt.bench_runs == 1 ? "" : "s",
+                    opt.threads, opt.threads == 1 ? "" : "s");
+        print_latency_row("prefill", rec_prefill, rep_prefill);
+        print_latency_row("sample", rec_sample, rep_sample);
+        print_latency_row("decode", rec_decode, rep_decode);
+    }
+
+    std::printf("\n%d session%s, %d diverged\n", sessions, sessions == 1 ? "" : "s", diverged);
+
+    state.release();
+    llama_backend_free();
+    return diverged == 0 ? 0 : 1;
+}
@@ -2,6 +2,8 @@ package com.mp.ai_gguf
 
 import com.mp.ai_gguf.models.StreamCallback
 import com.mp.ai_gguf.models.EmbeddingCallback
+import dalvik.annotation.optimization.CriticalNative
+import dalvik.annotation.optimization.FastNative
 
 /**
  * Native library interface for GGUF model inference
@@ -33,7 +35,13 @@ class GGUFNativeLib {
     external fun nativeSetToolsJson(toolsJson: String)
     external fun nativeSetSystemPrompt(prompt: String)
     external fun nativeGetModelInfo(): String
-    external fun nativeStopGeneration()
+
+    /**
+     * Stop every generation that is running or queued right now. Safe to
+     * call from any thread. Requests started afterwards are not affected;
+     * use [nativeCancelGeneration] to stop a single async request.
+     */
+    fun nativeStopGeneration() = nativeStopGenerationCritical()
 
     /**
      * Set custom stop strings for generation.
@@ -80,6 +88,56 @@ class GGUFNativeLib {
         callback: StreamCallback
     ): Boolean
 
+    /**
+     * Start a generation on a native worker thread and return immediately.
+     *
+     * Requests run one at a time; later ones wait in a queue. Callbacks
+     * arrive on the worker thread. Each request has its own cancel flag,
+     * checked while queued, between prompt chunks and before every decode
+     * step, so cancelling it never affects other requests.
+     *
+     * @param prompt User message
+     * @param maxTokens Maximum tokens to generate
+     * @param timeoutMs Deadline counted from this call, queue time included
+     *                  (0 = none). An expired request stops like a cancelled one.
+     * @param callback StreamCallback for tokens, tool calls, metrics, done/error
+     * @return Request handle for [nativeCancelGeneration] /
+     *         [nativeGetGenerationState], or 0 if the request couldn't start
+     */
+    external fun nativeGenerateAsync(
+        prompt: String,
+        maxTokens: Int,
+        timeoutMs: Long,
+        callback: StreamCallback
+    ): Long
+
+    /**
+     * Async variant of [nativeGenerateStreamMultiTurn]. See [nativeGenerateAsync].
+     */
+    external fun nativeGenerateMultiTurnAsync(
+        messagesJson: String,
+        maxTokens: Int,
+        timeoutMs: Long,
+        callback: StreamCallback
+    ): Long
+
+    /**
+     * Cancel one async request, queued or running.
+     * @return false if the handle is unknown or the request already finished
+     */
+    fun nativeCancelGeneration(handle: Long): Boolean = nativeCancelGenerationCritical(handle)
+
+    /**
+     * Current [GenerationState] of a request, or -1 for an unknown handle.
+     * The most recent finished requests stay queryable until released.
+     */
+    fun nativeGetGenerationState(handle: Long): Int = nativeGetGenerationStateCritical(handle)
+
+    /**
+     * Forget a finished request handle
+     */
+    fun nativeReleaseGeneration(handle: Long) = nativeReleaseGenerationCritical(handle)
+
     /**
      * Load a GGUF model with full configuration
      *
@@ -181,6 +239,7 @@ class GGUFNativeLib {
      *
      * @return Model architecture (e.g., "qwen2", "llama", etc.) or empty string if no model
      */
+    @FastNative
     external fun nativeGetModelArchitecture(): String
 
     /**
@@ -191,7 +250,7 @@ class GGUFNativeLib {
      *
      * @return true if model has a chat template and can support tool calling
      */
-    external fun nativeIsToolCallingSupported(): Boolean
+    fun nativeIsToolCallingSupported(): Boolean = nativeIsToolCallingSupportedCritical()
 
     /**
      * Enable tool calling mode for the current model.
@@ -221,7 +280,7 @@ class GGUFNativeLib {
      *
      * @return true if tool calling is enabled
      */
-    external fun nativeIsToolCallingEnabled(): Boolean
+    fun nativeIsToolCallingEnabled(): Boolean = nativeIsToolCallingEnabledCritical()
 
     /**
      * Set the grammar enforcement mode for tool calling.
@@ -241,11 +300,140 @@ class GGUFNativeLib {
      */
     external fun nativeSetTypedGrammar(enabled: Boolean)
 
+    /**
+     * Constrain generated output to a JSON Schema (structured output).
+     *
+     * The schema is compiled to a GBNF grammar (cached by schema hash) and
+     * applies to every subsequent generation until cleared. Accepts a bare
+     * schema or an OpenAI `json_schema` wrapper (`{"name": ..., "schema": {...}}`).
+     * While set, tool-call detection is suspended.
+     *
+     * Supported: type, enum, const, properties/required/additionalProperties,
+     * items/prefixItems/minItems/maxItems, pattern, minLength/maxLength,
+     * format (date, time, date-time, uuid), anyOf/oneOf/allOf, local $ref.
+     *
+     * Must be called after the model is loaded; reloading clears it.
+     *
+     * @param schemaJson JSON Schema text (empty string clears the schema)
+     * @return true if the schema was compiled and applied
+     */
+    external fun nativeSetResponseSchema(schemaJson: String): Boolean
+
+    /**
+     * Remove the response schema and return to free-form output
+     */
+    external fun nativeClearResponseSchema()
+
+    /**
+     * Load a LoRA adapter (GGUF) against the currently loaded base model.
+     *
+     * Adapters stay resident until unloaded or the model is released, so one
+     * base model can serve several specialized behaviors. A newly loaded
+     * adapter is inactive until selected with [nativeSetLoraAdapters].
+     *
+     * @param path Absolute path to the adapter GGUF file
+     * @param name Name used to refer to the adapter later
+     * @return true if the adapter is loaded (or was already loaded under [name])
+     */
+    external fun nativeLoadLoraAdapter(path: String, name: String): Boolean
+
+    /**
+     * Unload a LoRA adapter and free its memory
+     *
+     * @param name Adapter name passed to [nativeLoadLoraAdapter]
+     * @return true if the adapter was found and unloaded
+     */
+    external fun nativeUnloadLoraAdapter(name: String): Boolean
+
+    /**
+     * Select the adapter mix for generations submitted after this call.
+     * Requests already queued keep the mix they were submitted with.
+     *
+     * Adapters not listed are deactivated; pass empty arrays to run the plain
+     * base model. Switching only changes the adapter list on the context, so
+     * it is cheap to do per request.
+     *
+     * @param names Adapter names to activate
+     * @param scales Scale per adapter (same length as [names]), typically 0.0-1.0
+     * @return false if the arrays differ in length or a name is not loaded
+     */
+    external fun nativeSetLoraAdapters(names: Array<String>, scales: FloatArray): Boolean
+
+    /**
+     * @return Names of all loaded LoRA adapters
+     */
+    external fun nativeGetLoraAdapters(): Array<String>
+
+    /**
+     * Start recording generation sessions to a trace file.
+     *
+     * Each generate call appends one session (prompt, sampler config, sampled
+     * tokens with logits hashes, timings, stop reason). Traces are replayed
+     * on a host with the `trace_replay` tool to catch regressions after a
+     * llama.cpp bump or sampler change. Use a fixed seed for reproducible
+     * sessions.
+     *
+     * @param path File to append sessions to (created if missing)
+     * @return true if recording started
+     */
+    external fun nativeStartTraceRecording(path: String): Boolean
+
+    /**
+     * Stop recording and close the trace file
+     */
+    external fun nativeStopTraceRecording()
+
     companion object {
         init {
+            // JNI_OnLoad registers every native of this class
             System.loadLibrary("ai_gguf")
         }
 
+        /*
+         * @CriticalNative entry points for trivial, non-blocking calls: no
+         * JNIEnv/jclass is passed and no thread state transition happens,
+         * which makes them several times cheaper than a regular JNI call.
+         * Primitive arguments/results only, so they must stay static.
+         */
+        @JvmStatic
+        @CriticalNative
+        external fun nativeStopGenerationCritical()
+
+        @JvmStatic
+        @CriticalNative
+        external fun nativeIsToolCallingSupportedCritical(): Boolean
+
+        @JvmStatic
+        @CriticalNative
+        external fun nativeIsToolCallingEnabledCritical(): Boolean
+
+        @JvmStatic
+        @CriticalNative
+        external fun nativeCancelGenerationCritical(handle: Long): Boolean
+
+        @JvmStatic
+        @CriticalNative
+        external fun nativeGetGenerationStateCritical(handle: Long): Int
+
+        @JvmStatic
+        @CriticalNative
+        external fun nativeReleaseGenerationCritical(handle: Long)
+
+        /**
+         * Values returned by [nativeGetGenerationState]
+         */
+        object GenerationState {
+            const val QUEUED = 0
+            const val PREFILLING = 1
+            const val DECODING = 2
+            const val DONE = 3
+            const val CANCELLED = 4
+            const val TIMED_OUT = 5
+            const val FAILED = 6
+
+            fun isFinished(state: Int): Boolean = state >= DONE
+        }
+
         /**
          * Recommended settings for low-end devices (< 4GB RAM)
          */
@@ -46,6 +46,9 @@ android {
             version = "3.22.1"
         }
     }
+    buildFeatures {
+        prefab = true
+    }
     compileOptions {
         sourceCompatibility = JavaVersion.VERSION_17
         targetCompatibility = JavaVersion.VERSION_17
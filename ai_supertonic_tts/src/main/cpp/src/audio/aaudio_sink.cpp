@@ -0,0 +1,144 @@
+#include "aaudio_sink.h"
+
+#include "wav_encoder.h"
+
+#include <algorithm>
+#include <string>
+
+namespace audio {
+
+namespace {
+
+// Blocking writes give up after this long (the device is stuck)
+constexpr int64_t WRITE_TIMEOUT_NS = 500LL * 1000 * 1000;
+
+} // namespace
+
+AAudioSink::~AAudioSink() {
+    close();
+}
+
+bool AAudioSink::fail_with(const char* what, aaudio_result_t result) {
+    return fail(std::string(what) + ": " + AAudio_convertResultToText(result));
+}
+
+bool AAudioSink::open() {
+    if (stream_) return true;
+
+    AAudioStreamBuilder* builder = nullptr;
+    aaudio_result_t result = AAudio_createStreamBuilder(&builder);
+    if (result != AAUDIO_OK) return fail_with("AAudio_createStreamBuilder", result);
+
+    AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
+    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
+    AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+    AAudioStreamBuilder_setChannelCount(builder, 1);
+    AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_FLOAT);
+    // Sample rate left unspecified: the device's native rate
+
+    result = AAudioStreamBuilder_openStream(builder, &stream_);
+    AAudioStreamBuilder_delete(builder);
+    if (result != AAUDIO_OK) {
+        stream_ = nullptr;
+        return fail_with("AAudioStreamBuilder_openStream", result);
+    }
+
+    sample_rate_ = AAudioStream_getSampleRate(stream_);
+    burst_ = static_cast<size_t>(std::max(AAudioStream_getFramesPerBurst(stream_), 1));
+    pcm16_ = AAudioStream_getFormat(stream_) == AAUDIO_FORMAT_PCM_I16;
+    last_xruns_ = 0;
+    if (AAudioStream_getChannelCount(stream_) != 1) {
+        close();
+        return fail("AAudio stream is not mono");
+    }
+
+    // Low latency first; tune_buffer() grows it on glitches
+    AAudioStream_setBufferSizeInFrames(stream_, static_cast<int32_t>(2 * burst_));
+    return true;
+}
+
+void AAudioSink::close() {
+    if (stream_) {
+        AAudioStream_close(stream_);
+        stream_ = nullptr;
+    }
+}
+
+bool AAudioSink::start() {
+    if (!open()) return false;
+    const aaudio_result_t result = AAudioStream_requestStart(stream_);
+    return result == AAUDIO_OK || fail_with("AAudioStream_requestStart", result);
+}
+
+void AAudioSink::tune_buffer() {
+    const int32_t xruns = AAudioStream_getXRunCount(stream_);
+    if (xruns <= last_xruns_) return;
+    last_xruns_ = xruns;
+
+    const int32_t size = AAudioStream_getBufferSizeInFrames(stream_);
+    const int32_t capacity = AAudioStream_getBufferCapacityInFrames(stream_);
+    if (size + static_cast<int32_t>(burst_) <= capacity) {
+        AAudioStream_setBufferSizeInFrames(stream_, size + static_cast<int32_t>(burst_));
+    }
+}
+
+bool AAudioSink::write(const float* data, size_t n) {
+    if (!stream_) return fail("AAudio stream not open");
+
+    while (n > 0) {
+        const size_t count = std::min(n, 4 * burst_);
+        const void* buffer = data;
+        if (pcm16_) {
+            pcm16_buffer_.resize(count * 2);
+            float_to_pcm16(data, count, pcm16_buffer_.data());
+            buffer = pcm16_buffer_.data();
+        }
+
+        const aaudio_result_t written = AAudioStream_write(
+                stream_, buffer, static_cast<int32_t>(count), WRITE_TIMEOUT_NS);
+        if (written == AAUDIO_ERROR_DISCONNECTED && !reopened_) {
+            // Route changed: carry on on the new default device once
+            reopened_ = true;
+            xruns_before_ += static_cast<uint64_t>(std::max(AAudioStream_getXRunCount(stream_), 0));
+            const int rate = sample_rate_;
+            close();
+            if (!start()) return false;
+            if (sample_rate_ != rate) {
+                return fail("AAudio device changed rate on reconnect");
+            }
+            continue;
+        }
+        if (written < 0) return fail_with("AAudioStream_write", written);
+        if (written == 0) return fail("AAudioStream_write timed out");
+
+        data += written;
+        n -= static_cast<size_t>(written);
+        tune_buffer();
+    }
+    return true;
+}
+
+size_t AAudioSink::queued() {
+    if (!stream_) return 0;
+    const int64_t pending = AAudioStream_getFramesWritten(stream_) - AAudioStream_getFramesRead(stream_);
+    return pending > 0 ? static_cast<size_t>(pending) : 0;
+}
+
+void AAudioSink::pause() {
+    if (stream_) AAudioStream_requestPause(stream_);
+}
+
+void AAudioSink::resume() {
+    if (stream_) AAudioStream_requestStart(stream_);
+}
+
+void AAudioSink::stop() {
+    if (stream_) AAudioStream_requestStop(stream_);
+}
+
+uint64_t AAudioSink::device_xruns() {
+    const int32_t xruns = stream_ ? AAudioStream_getXRunCount(stream_) : 0;
+    return xruns_before_ + static_cast<uint64_t>(std::max(xruns, 0));
+}
+
+} // namespace audio
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "audio_sink.h"
+
+#include <aaudio/AAudio.h>
+
+#include <vector>
+
+namespace audio {
+
+/**
+ * AAudio output stream in blocking-write mode (Android 8.1+).
+ *
+ * Mono, low-latency, shared, opened at the device's native rate (the
+ * feeder resamples) so the stream can take the fast mixer path. Float
+ * samples are converted to int16 if the device only offers that.
+ *
+ * The buffer starts at two bursts and grows by a burst whenever the
+ * device reports an xrun, trading a few ms of latency for glitch-free
+ * output. A disconnected device (e.g. headphones unplugged) is reopened
+ * once on the new default route.
+ */
+class AAudioSink : public AudioSink {
+public:
+    AAudioSink() = default;
+    ~AAudioSink() override;
+
+    bool start() override;
+    bool write(const float* data, size_t n) override;
+    size_t queued() override;
+    void pause() override;
+    void resume() override;
+    void stop() override;
+    int sample_rate() const override { return sample_rate_; }
+    size_t burst() const override { return burst_; }
+    uint64_t device_xruns() override;
+
+    /**
+     * Open the stream (not started yet) so sample_rate() is known.
+     * False if AAudio is unavailable.
+     */
+    bool open();
+
+private:
+    void close();
+    bool fail_with(const char* what, aaudio_result_t result);
+    void tune_buffer();
+
+    AAudioStream* stream_ = nullptr;
+    int sample_rate_ = 0;
+    size_t burst_ = 0;
+    bool pcm16_ = false;
+    bool reopened_ = false;
+    int32_t last_xruns_ = 0;
+    uint64_t xruns_before_ = 0;   // From streams replaced by a reopen
+    std::vector<uint8_t> pcm16_buffer_;
+};
+
+} // namespace audio
@@ -0,0 +1,164 @@
+#include "adpcm_encoder.h"
+#include "wav_encoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio {
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 60;  // RIFF + 20-byte fmt + fact + data header
+
+const int16_t STEP_TABLE[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+        253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+        1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+        12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const int8_t INDEX_TABLE[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+uint8_t* put_u16(uint8_t* out, uint16_t val) {
+    std::memcpy(out, &val, sizeof(val));
+    return out + sizeof(val);
+}
+
+uint8_t* put_u32(uint8_t* out, uint32_t val) {
+    std::memcpy(out, &val, sizeof(val));
+    return out + sizeof(val);
+}
+
+uint8_t* put_tag(uint8_t* out, const char* tag) {
+    std::memcpy(out, tag, 4);
+    return out + 4;
+}
+
+/**
+ * One channel's predictor, updated exactly as a decoder would
+ */
+struct ImaState {
+    int predictor = 0;
+    int index = 0;
+
+    uint8_t encode(int sample) {
+        const int step = STEP_TABLE[index];
+        int diff = sample - predictor;
+        uint8_t code = 0;
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+
+        // Successive approximation of diff / step in 3 bits, accumulating
+        // the same delta the decoder will reconstruct
+        int delta = step >> 3;
+        if (diff >= step) {
+            code |= 4;
+            diff -= step;
+            delta += step;
+        }
+        if (diff >= step >> 1) {
+            code |= 2;
+            diff -= step >> 1;
+            delta += step >> 1;
+        }
+        if (diff >= step >> 2) {
+            code |= 1;
+            delta += step >> 2;
+        }
+
+        predictor += (code & 8) ? -delta : delta;
+        predictor = std::clamp(predictor, -32768, 32767);
+        index = std::clamp(index + INDEX_TABLE[code & 7], 0, 88);
+        return code;
+    }
+};
+
+int16_t sample_at(const uint8_t* pcm, size_t i) {
+    int16_t s;
+    std::memcpy(&s, pcm + 2 * i, sizeof(s));
+    return s;
+}
+
+void write_header(uint8_t* out, uint32_t data_size, uint32_t frames, int sample_rate,
+                  int channels) {
+    const int block_align = IMA_BLOCK_ALIGN * channels;
+    const uint32_t byte_rate = static_cast<uint32_t>(
+            static_cast<uint64_t>(sample_rate) * block_align / IMA_SAMPLES_PER_BLOCK);
+
+    out = put_tag(out, "RIFF");
+    out = put_u32(out, static_cast<uint32_t>(HEADER_SIZE - 8) + data_size);
+    out = put_tag(out, "WAVE");
+
+    out = put_tag(out, "fmt ");
+    out = put_u32(out, 20);
+    out = put_u16(out, 0x0011);  // WAVE_FORMAT_IMA_ADPCM
+    out = put_u16(out, static_cast<uint16_t>(channels));
+    out = put_u32(out, static_cast<uint32_t>(sample_rate));
+    out = put_u32(out, byte_rate);
+    out = put_u16(out, static_cast<uint16_t>(block_align));
+    out = put_u16(out, 4);       // Bits per sample
+    out = put_u16(out, 2);       // Extra format bytes
+    out = put_u16(out, IMA_SAMPLES_PER_BLOCK);
+
+    out = put_tag(out, "fact");
+    out = put_u32(out, 4);
+    out = put_u32(out, frames);
+
+    out = put_tag(out, "data");
+    put_u32(out, data_size);
+}
+
+} // namespace
+
+std::vector<uint8_t> encode_wav_ima_adpcm(const float* data, int samples, int sample_rate,
+                                          int channels) {
+    if (samples < 0 || channels < 1 || channels > 8 || sample_rate <= 0) return {};
+
+    const size_t blocks = (static_cast<size_t>(samples) + IMA_SAMPLES_PER_BLOCK - 1) /
+                          IMA_SAMPLES_PER_BLOCK;
+    const size_t block_bytes = static_cast<size_t>(IMA_BLOCK_ALIGN) * channels;
+    const size_t data_size = blocks * block_bytes;
+    if (HEADER_SIZE + data_size > UINT32_MAX) return {};
+
+    // Quantize exactly like the 16-bit WAV path; the padded tail is silence
+    const size_t total = static_cast<size_t>(samples) * channels;
+    std::vector<uint8_t> pcm((blocks * IMA_SAMPLES_PER_BLOCK) * channels * 2, 0);
+    float_to_pcm16(data, total, pcm.data());
+
+    std::vector<uint8_t> out(HEADER_SIZE + data_size);
+    write_header(out.data(), static_cast<uint32_t>(data_size), static_cast<uint32_t>(samples),
+                 sample_rate, channels);
+
+    ImaState state[8];
+    uint8_t* dst = out.data() + HEADER_SIZE;
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t first = b * IMA_SAMPLES_PER_BLOCK;
+
+        // Block header per channel: the first sample verbatim and the step
+        // index carried over from the previous block
+        for (int ch = 0; ch < channels; ++ch) {
+            state[ch].predictor = sample_at(pcm.data(), first * channels + ch);
+            dst = put_u16(dst, static_cast<uint16_t>(state[ch].predictor));
+            *dst++ = static_cast<uint8_t>(state[ch].index);
+            *dst++ = 0;
+        }
+
+        // Then 8 samples per channel per 4-byte word, low nibble first
+        for (size_t s = first + 1; s < first + IMA_SAMPLES_PER_BLOCK; s += 8) {
+            for (int ch = 0; ch < channels; ++ch) {
+                for (int i = 0; i < 8; i += 2) {
+                    const uint8_t lo = state[ch].encode(sample_at(pcm.data(), (s + i) * channels + ch));
+                    const uint8_t hi = state[ch].encode(sample_at(pcm.data(), (s + i + 1) * channels + ch));
+                    *dst++ = static_cast<uint8_t>(lo | (hi << 4));
+                }
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace audio
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/**
+ * IMA-ADPCM WAV encoding (WAVE_FORMAT_IMA_ADPCM, 4 bits per sample).
+ *
+ * Lossy 4:1 against 16-bit PCM, in one serial pass with no search, so it
+ * is the fastest way to get a compact file. Samples are quantized to
+ * 16-bit exactly like encode_wav_16 before encoding.
+ *
+ * Blocks are IMA_BLOCK_ALIGN bytes per channel, each starting with the
+ * exact sample and the step index; the last block is zero padded and the
+ * real length is stored in the "fact" chunk.
+ */
+constexpr int IMA_BLOCK_ALIGN = 1024;
+
+/**
+ * Samples per channel in one block
+ */
+constexpr int IMA_SAMPLES_PER_BLOCK = (IMA_BLOCK_ALIGN - 4) * 2 + 1;
+
+/**
+ * Encode `samples` interleaved frames as a complete IMA-ADPCM WAV file.
+ * Returns an empty vector if the arguments are out of range.
+ */
+std::vector<uint8_t> encode_wav_ima_adpcm(const float* data, int samples, int sample_rate,
+                                          int channels);
+
+} // namespace audio
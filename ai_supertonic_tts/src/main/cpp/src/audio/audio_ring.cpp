@@ -0,0 +1,125 @@
+#include "audio_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace audio {
+
+namespace {
+
+size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void nap() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+} // namespace
+
+AudioRing::AudioRing(size_t min_capacity)
+        : buf_(next_pow2(std::max<size_t>(min_capacity, 2))),
+          mask_(buf_.size() - 1) {}
+
+size_t AudioRing::write(const float* data, size_t n) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    const size_t count = std::min(n, capacity() - (head - tail));
+    if (count == 0) return 0;
+
+    // At most two spans: up to the end of the buffer, then from the start
+    const size_t pos = head & mask_;
+    const size_t first = std::min(count, capacity() - pos);
+    if (data) {
+        std::memcpy(buf_.data() + pos, data, first * sizeof(float));
+        std::memcpy(buf_.data(), data + first, (count - first) * sizeof(float));
+    } else {
+        std::memset(buf_.data() + pos, 0, first * sizeof(float));
+        std::memset(buf_.data(), 0, (count - first) * sizeof(float));
+    }
+
+    head_.store(head + count, std::memory_order_release);
+    return count;
+}
+
+size_t AudioRing::write_silence(size_t n) {
+    return write(nullptr, n);
+}
+
+bool AudioRing::write_all(const float* data, size_t n) {
+    while (n > 0) {
+        if (cancelled()) return false;
+
+        const size_t written = write(data, n);
+        if (written == 0) {
+            nap();
+            continue;
+        }
+        if (data) data += written;
+        n -= written;
+    }
+    return !cancelled();
+}
+
+size_t AudioRing::read(float* out, size_t n) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    const size_t count = std::min(n, head - tail);
+    if (count == 0) return 0;
+
+    const size_t pos = tail & mask_;
+    const size_t first = std::min(count, capacity() - pos);
+    std::memcpy(out, buf_.data() + pos, first * sizeof(float));
+    std::memcpy(out + first, buf_.data(), (count - first) * sizeof(float));
+
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+long AudioRing::read_wait(float* out, size_t n, int timeout_ms) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    // Health: only once audio has started, and not for the final drain
+    if (tail_.load(std::memory_order_relaxed) > 0 && !closed()) {
+        const size_t level = available();
+        if (level == 0 && !dry_) underruns_.fetch_add(1, std::memory_order_relaxed);
+        dry_ = level == 0;
+        if (level < low_water_.load(std::memory_order_relaxed)) {
+            low_water_.store(level, std::memory_order_relaxed);
+        }
+    }
+
+    for (;;) {
+        if (cancelled()) return -1;
+
+        // Check closed before reading so samples written just before
+        // close() are never lost
+        const bool was_closed = closed();
+        const size_t count = read(out, n);
+        if (count > 0) return static_cast<long>(count);
+        if (was_closed) return -1;
+
+        if (std::chrono::steady_clock::now() >= deadline) return 0;
+        nap();
+    }
+}
+
+size_t AudioRing::available() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+AudioRing::Stats AudioRing::stats() const {
+    Stats s;
+    s.read = tail_.load(std::memory_order_acquire);
+    s.written = head_.load(std::memory_order_acquire);
+    s.underruns = underruns_.load(std::memory_order_relaxed);
+    const size_t low = low_water_.load(std::memory_order_relaxed);
+    s.low_water = low == SIZE_MAX ? 0 : low;
+    return s;
+}
+
+} // namespace audio
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Lock-free single-producer/single-consumer ring of float samples.
+ *
+ * The synthesis thread writes PCM as it is produced; the playback thread
+ * reads it. Neither side ever takes a lock: head and tail are monotonic
+ * counters published with release/acquire ordering, and the capacity is
+ * a power of two so wrapping is a mask.
+ *
+ * The blocking helpers (write_all, read_wait) only sleep when the ring
+ * is full/empty, in 1 ms naps, which is well below an audio buffer.
+ *
+ * End of stream: the producer calls close(); the consumer drains what is
+ * left and then read_wait() returns -1. cancel() (either side) makes
+ * both sides give up immediately.
+ *
+ * Buffer health is tracked on the consumer side (see Stats), so it costs
+ * the producer nothing.
+ */
+class AudioRing {
+public:
+    /**
+     * Capacity is rounded up to a power of two
+     */
+    explicit AudioRing(size_t min_capacity);
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /**
+     * Producer: copy up to `n` samples in, returns how many fit
+     */
+    size_t write(const float* data, size_t n);
+
+    /**
+     * Producer: write `n` zero samples, returns how many fit
+     */
+    size_t write_silence(size_t n);
+
+    /**
+     * Producer: write everything, waiting for space. False if cancelled.
+     * `data` nullptr writes silence.
+     */
+    bool write_all(const float* data, size_t n);
+
+    /**
+     * Consumer: copy up to `n` samples out, returns how many were read
+     */
+    size_t read(float* out, size_t n);
+
+    /**
+     * Consumer: wait up to `timeout_ms` for data, then read up to `n`.
+     * Returns the sample count, 0 on timeout, -1 once closed and drained
+     * or cancelled.
+     */
+    long read_wait(float* out, size_t n, int timeout_ms);
+
+    /**
+     * Samples ready for the consumer
+     */
+    size_t available() const;
+
+    /**
+     * Producer: no more data will be written
+     */
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    void cancel() { cancelled_.store(true, std::memory_order_release); }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+    struct Stats {
+        uint64_t written = 0;     // Samples produced so far
+        uint64_t read = 0;        // Samples consumed so far
+        uint64_t underruns = 0;   // Times the consumer found the open ring empty after the first sample (once per dry spell)
+        size_t low_water = 0;     // Fewest samples a read_wait() found after the first sample
+    };
+
+    /**
+     * Safe from any thread (values are sampled, not a snapshot)
+     */
+    Stats stats() const;
+
+private:
+    std::vector<float> buf_;
+    size_t mask_;
+
+    // Monotonic sample counters, each written by one side only
+    alignas(64) std::atomic<size_t> head_{0};  // Producer
+    alignas(64) std::atomic<size_t> tail_{0};  // Consumer
+
+    std::atomic<bool> closed_{false};
+    std::atomic<bool> cancelled_{false};
+
+    // Consumer side only
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<size_t> low_water_{SIZE_MAX};
+    bool dry_ = false;
+};
+
+} // namespace audio
@@ -0,0 +1,128 @@
+#include "audio_sink.h"
+
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+
+namespace audio {
+
+void AudioSink::drain(int timeout_ms) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (queued() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+// ============================================================================
+// NULL SINK
+// ============================================================================
+
+NullSink::NullSink(int sample_rate, size_t buffer, size_t burst)
+        : sample_rate_(std::max(sample_rate, 1)),
+          buffer_(std::max<size_t>(buffer, 1)),
+          burst_(std::max<size_t>(std::min(burst, buffer_), 1)) {}
+
+bool NullSink::start() {
+    running_ = true;
+    paused_ = false;
+    last_ = Clock::now();
+    return true;
+}
+
+void NullSink::advance() {
+    const Clock::time_point now = Clock::now();
+    if (!running_ || paused_) {
+        last_ = now;
+        return;
+    }
+    position_ += std::chrono::duration<double>(now - last_).count() * sample_rate_;
+    last_ = now;
+
+    const auto elapsed = static_cast<uint64_t>(position_);
+    position_ -= static_cast<double>(elapsed);
+    const uint64_t play = std::min(elapsed, written_ - played_);
+    played_ += play;
+    // Silence only counts once there has been audio
+    if (written_ > 0) {
+        gap_ += elapsed - play;
+        gap_total_ += elapsed - play;
+    }
+}
+
+size_t NullSink::queued() {
+    advance();
+    return static_cast<size_t>(written_ - played_);
+}
+
+bool NullSink::write(const float* data, size_t n) {
+    if (!running_) return fail("sink not started");
+    while (n > 0) {
+        const size_t room = buffer_ - queued();
+        if (room == 0 || (room < burst_ && room < n)) {
+            // Sleep until a burst has played
+            const size_t wait = std::min(n, burst_) - std::min(room, burst_);
+            std::this_thread::sleep_for(std::chrono::duration<double>(
+                    static_cast<double>(std::max<size_t>(wait, 1)) / sample_rate_));
+            continue;
+        }
+        const size_t take = std::min(room, n);
+        if (!consume(data, take, gap_)) return false;
+        gap_ = 0;
+        written_ += take;
+        data += take;
+        n -= take;
+    }
+    return true;
+}
+
+void NullSink::pause() {
+    advance();
+    paused_ = true;
+}
+
+void NullSink::resume() {
+    paused_ = false;
+    last_ = Clock::now();
+}
+
+void NullSink::stop() {
+    running_ = false;
+    played_ = written_;
+}
+
+// ============================================================================
+// WAV FILE SINK
+// ============================================================================
+
+WavFileSink::WavFileSink(int sample_rate, int fd, WavWriter::Encoding encoding)
+        : NullSink(sample_rate), fd_(fd), encoding_(encoding) {}
+
+WavFileSink::~WavFileSink() {
+    // Still ours if start() never handed it to the writer
+    if (fd_ >= 0) ::close(fd_);
+    writer_.close();
+}
+
+bool WavFileSink::start() {
+    if (!writer_.is_open()) {
+        const int fd = fd_;
+        fd_ = -1;
+        if (!writer_.open(fd, sample_rate(), 1, encoding_)) return fail(writer_.last_error());
+    }
+    return NullSink::start();
+}
+
+void WavFileSink::stop() {
+    NullSink::stop();
+    writer_.close();
+}
+
+bool WavFileSink::consume(const float* data, size_t n, uint64_t silence_before) {
+    if ((silence_before > 0 && !writer_.write_silence(static_cast<size_t>(silence_before))) ||
+        !writer_.write(data, n)) {
+        return fail(writer_.last_error());
+    }
+    return true;
+}
+
+} // namespace audio
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "wav_writer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace audio {
+
+/**
+ * Mono float output device driven by PlaybackFeeder.
+ *
+ * write() blocks until the samples are queued, so the device clock paces
+ * the feeder. queued() is what the device still has to play; it reaching
+ * 0 while audio is pending upstream is an audible underrun.
+ *
+ * Every method is called from the feeder thread only.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    virtual bool start() = 0;
+
+    /**
+     * Queue all `n` samples, waiting for room. False on a device error.
+     */
+    virtual bool write(const float* data, size_t n) = 0;
+
+    /** Samples written but not yet played */
+    virtual size_t queued() = 0;
+
+    virtual void pause() = 0;
+    virtual void resume() = 0;
+
+    /** Stop immediately, dropping queued audio */
+    virtual void stop() = 0;
+
+    /** Wait (up to `timeout_ms`) until queued audio has played */
+    void drain(int timeout_ms);
+
+    virtual int sample_rate() const = 0;
+
+    /** Preferred write size in samples */
+    virtual size_t burst() const = 0;
+
+    /** Glitches the device itself reported (0 where it can't tell) */
+    virtual uint64_t device_xruns() { return 0; }
+
+    const std::string& last_error() const { return last_error_; }
+
+protected:
+    bool fail(const std::string& what) {
+        last_error_ = what;
+        return false;
+    }
+
+    std::string last_error_;
+};
+
+/**
+ * Discards audio at real-time speed, like a device with a `buffer`-sample
+ * queue that plays silence when it runs dry. For host runs and tests.
+ */
+class NullSink : public AudioSink {
+public:
+    explicit NullSink(int sample_rate, size_t buffer = 1024, size_t burst = 256);
+
+    bool start() override;
+    bool write(const float* data, size_t n) override;
+    size_t queued() override;
+    void pause() override;
+    void resume() override;
+    void stop() override;
+    int sample_rate() const override { return sample_rate_; }
+    size_t burst() const override { return burst_; }
+
+    /** Samples of silence played because the queue was empty */
+    uint64_t gap_samples() const { return gap_total_; }
+
+protected:
+    /**
+     * Called with each block before it is queued, after any silence the
+     * device played since the previous block
+     */
+    virtual bool consume(const float* data, size_t n, uint64_t silence_before) {
+        (void) data;
+        (void) n;
+        (void) silence_before;
+        return true;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Move the device position to now
+    void advance();
+
+    int sample_rate_;
+    size_t buffer_;
+    size_t burst_;
+
+    bool running_ = false;
+    bool paused_ = false;
+    Clock::time_point last_{};
+    double position_ = 0.0;   // Samples played (audio + silence), fractional
+    uint64_t written_ = 0;
+    uint64_t played_ = 0;     // Of written_
+    uint64_t gap_ = 0;        // Silence since the last consume()
+    uint64_t gap_total_ = 0;
+};
+
+/**
+ * NullSink that also records what a listener would hear, underrun gaps
+ * included, to a WAV file (16-bit or float)
+ */
+class WavFileSink : public NullSink {
+public:
+    WavFileSink(int sample_rate, int fd, WavWriter::Encoding encoding = WavWriter::Encoding::Pcm16);
+    ~WavFileSink() override;
+
+    bool start() override;
+    void stop() override;
+
+protected:
+    bool consume(const float* data, size_t n, uint64_t silence_before) override;
+
+private:
+    WavWriter writer_;
+    int fd_;
+    WavWriter::Encoding encoding_;
+};
+
+} // namespace audio
@@ -0,0 +1,171 @@
+#include "chunk_stitcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audio {
+
+namespace {
+
+constexpr double HALF_PI = 1.57079632679489661923;
+constexpr size_t BLOCK_SAMPLES = 1024;
+
+size_t ms_to_samples(int sample_rate, int ms) {
+    return static_cast<size_t>(std::max(ms, 0)) * static_cast<size_t>(sample_rate) / 1000;
+}
+
+float mean_square(const float* pcm, size_t samples) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < samples; ++i) sum += pcm[i] * pcm[i];
+    return samples > 0 ? sum / static_cast<float>(samples) : 0.0f;
+}
+
+} // namespace
+
+StitchOptions StitchOptions::for_rate(int sample_rate, int gap_ms, int crossfade_ms, bool trim,
+                                      float gain, float ceiling) {
+    StitchOptions o;
+    o.gap_samples = ms_to_samples(sample_rate, gap_ms);
+    o.crossfade_samples = ms_to_samples(sample_rate, crossfade_ms);
+    o.trim = trim;
+    o.gate_window = std::max<size_t>(ms_to_samples(sample_rate, 10), 1);
+    o.trim_pad = ms_to_samples(sample_rate, 20);
+    o.gain = gain;
+    o.ceiling = ceiling;
+    o.release_samples = std::max<size_t>(ms_to_samples(sample_rate, 50), 1);
+    return o;
+}
+
+ChunkStitcher::ChunkStitcher(const StitchOptions& options)
+        : options_(options),
+          gate_power_(std::pow(10.0f, options.gate_db / 10.0f)),
+          release_coef_(std::exp(-1.0f / static_cast<float>(std::max<size_t>(options.release_samples, 1)))),
+          block_(BLOCK_SAMPLES) {
+    options_.gate_window = std::max<size_t>(options_.gate_window, 1);
+    options_.ceiling = std::max(options_.ceiling, 0.0f);
+}
+
+ChunkStitcher::Span ChunkStitcher::voiced_span(const float* pcm, size_t samples) const {
+    if (!options_.trim) return {0, samples};
+
+    // Scan inward from each edge; the voiced middle is never touched
+    const size_t window = options_.gate_window;
+    size_t begin = samples;
+    for (size_t pos = 0; pos < samples; pos += window) {
+        const size_t count = std::min(window, samples - pos);
+        if (mean_square(pcm + pos, count) > gate_power_) {
+            begin = pos;
+            break;
+        }
+    }
+    if (begin == samples) return {0, 0};
+
+    size_t end = begin;
+    for (size_t pos = samples; pos > begin;) {
+        const size_t count = std::min(window, pos - begin);
+        if (mean_square(pcm + pos - count, count) > gate_power_) {
+            end = pos;
+            break;
+        }
+        pos -= count;
+    }
+
+    begin = begin > options_.trim_pad ? begin - options_.trim_pad : 0;
+    end = std::min(end + options_.trim_pad, samples);
+    return {begin, end};
+}
+
+size_t ChunkStitcher::stitched_length(const std::vector<size_t>& voiced_lengths) const {
+    size_t total = 0;
+    size_t held = 0;  // Tail the previous chunk holds back for the crossfade
+    bool started = false;
+    for (size_t length : voiced_lengths) {
+        if (length == 0) continue;
+        total += length;
+        if (started) {
+            if (options_.crossfade_samples > 0) total -= std::min(held, length / 2);
+            else total += options_.gap_samples;
+        }
+        held = std::min(options_.crossfade_samples, length / 2);
+        started = true;
+    }
+    return total;
+}
+
+bool ChunkStitcher::add(const float* pcm, size_t samples, const Sink& sink) {
+    const Span span = voiced_span(pcm, samples);
+    const float* x = pcm + span.begin;
+    const size_t length = span.end - span.begin;
+    if (length == 0) return true;
+
+    size_t head = 0;
+    if (started_) {
+        if (options_.crossfade_samples > 0) {
+            const size_t overlap = std::min(tail_.size(), length / 2);
+            const size_t plain = tail_.size() - overlap;
+            if (!emit(tail_.data(), plain, sink)) return false;
+
+            mix_.resize(overlap);
+            for (size_t i = 0; i < overlap; ++i) {
+                const double theta = HALF_PI * (static_cast<double>(i) + 0.5) / static_cast<double>(overlap);
+                mix_[i] = tail_[plain + i] * static_cast<float>(std::cos(theta)) +
+                          x[i] * static_cast<float>(std::sin(theta));
+            }
+            if (!emit(mix_.data(), overlap, sink)) return false;
+            head = overlap;
+        } else if (options_.gap_samples > 0) {
+            if (!emit(nullptr, options_.gap_samples, sink)) return false;
+        }
+    }
+    started_ = true;
+
+    const size_t hold = std::min(options_.crossfade_samples, length / 2);
+    if (!emit(x + head, length - head - hold, sink)) return false;
+    tail_.assign(x + length - hold, x + length);
+    return true;
+}
+
+bool ChunkStitcher::finish(const Sink& sink) {
+    const bool ok = emit(tail_.data(), tail_.size(), sink);
+    reset();
+    return ok;
+}
+
+void ChunkStitcher::reset() {
+    started_ = false;
+    limiter_gain_ = 1.0f;
+    tail_.clear();
+}
+
+bool ChunkStitcher::emit(const float* pcm, size_t samples, const Sink& sink) {
+    const float gain = options_.gain;
+    const float ceiling = options_.ceiling;
+    const float release = release_coef_;
+    float g = limiter_gain_;
+
+    for (size_t done = 0; done < samples;) {
+        const size_t count = std::min(BLOCK_SAMPLES, samples - done);
+        float* out = block_.data();
+        for (size_t i = 0; i < count; ++i) {
+            float y = pcm ? pcm[done + i] * gain : 0.0f;
+            if (std::isnan(y)) y = 0.0f;
+
+            // Instant attack: this sample is scaled to the ceiling
+            const float peak = std::fabs(y);
+            if (peak * g > ceiling) g = ceiling / peak;
+            out[i] = std::clamp(y * g, -ceiling, ceiling);
+
+            g = 1.0f - (1.0f - g) * release;
+        }
+        if (!sink(out, count)) {
+            limiter_gain_ = g;
+            return false;
+        }
+        done += count;
+    }
+
+    limiter_gain_ = g;
+    return true;
+}
+
+} // namespace audio
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace audio {
+
+/**
+ * How synthesized chunks are joined and finished, in samples
+ */
+struct StitchOptions {
+    size_t gap_samples = 0;        // Silence between chunks
+    size_t crossfade_samples = 0;  // > 0: overlap chunks with an equal-power crossfade instead
+    bool trim = true;              // Cut each chunk's leading/trailing silence
+    float gate_db = -50.0f;        // Trim gate: window RMS in dBFS
+    size_t gate_window = 441;      // Trim gate window
+    size_t trim_pad = 882;         // Kept around the voiced part
+    float gain = 1.0f;
+    float ceiling = 1.0f;          // Peak limiter ceiling (output never exceeds it)
+    size_t release_samples = 2205; // Limiter recovery time constant
+
+    /**
+     * Options with the gate window (10 ms), padding (20 ms) and limiter
+     * release (50 ms) scaled to `sample_rate`
+     */
+    static StitchOptions for_rate(int sample_rate, int gap_ms, int crossfade_ms, bool trim,
+                                  float gain, float ceiling);
+};
+
+/**
+ * Joins mono TTS chunks into one stream in a single pass.
+ *
+ * Per chunk: leading/trailing silence is trimmed with an RMS energy gate
+ * (only the edges are scanned), then the chunk is joined to the previous
+ * one with either a silence gap or an equal-power (sin/cos) crossfade.
+ * Every output sample then gets the gain and a peak limiter (instant
+ * attack, exponential release), and goes to the sink in small blocks, so
+ * the sink can encode it while it is still in cache.
+ *
+ * Crossfades hold back the end of each chunk until the next one arrives;
+ * finish() emits it. The overlap is at most half of either chunk.
+ */
+class ChunkStitcher {
+public:
+    /**
+     * Receives finished samples. Return false to stop.
+     */
+    using Sink = std::function<bool(const float* pcm, size_t samples)>;
+
+    explicit ChunkStitcher(const StitchOptions& options);
+
+    /**
+     * [begin, end) of the chunk that survives trimming (empty if the
+     * whole chunk is below the gate)
+     */
+    struct Span {
+        size_t begin;
+        size_t end;
+    };
+    Span voiced_span(const float* pcm, size_t samples) const;
+
+    /**
+     * Output length for chunks whose voiced spans have these lengths
+     */
+    size_t stitched_length(const std::vector<size_t>& voiced_lengths) const;
+
+    /**
+     * Append one chunk. Returns false if the sink stopped.
+     */
+    bool add(const float* pcm, size_t samples, const Sink& sink);
+
+    /**
+     * End of stream: emit the held-back tail and reset
+     */
+    bool finish(const Sink& sink);
+
+    void reset();
+
+    const StitchOptions& options() const { return options_; }
+
+private:
+    // Gain + limiter into block_, then the sink; nullptr emits silence
+    bool emit(const float* pcm, size_t samples, const Sink& sink);
+
+    StitchOptions options_;
+    float gate_power_;     // Mean-square threshold
+    float release_coef_;   // Per-sample limiter recovery
+
+    bool started_ = false;     // A chunk has been emitted
+    float limiter_gain_ = 1.0f;
+    std::vector<float> tail_;  // End of the last chunk, held for the crossfade
+    std::vector<float> mix_;   // Crossfaded overlap
+    std::vector<float> block_; // Processed output block
+};
+
+} // namespace audio
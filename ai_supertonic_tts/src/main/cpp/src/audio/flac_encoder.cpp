@@ -0,0 +1,582 @@
+#include "flac_encoder.h"
+#include "wav_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace audio {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int BITS_PER_SAMPLE = 16;
+constexpr int MAX_FIXED_ORDER = 4;
+constexpr int MAX_LPC_ORDER = 32;
+constexpr int LPC_PRECISION = 12;        // Bits per quantized coefficient
+constexpr int MAX_LPC_SHIFT = 15;        // 5-bit signed field, negative shifts unused
+constexpr int MAX_PARTITION_ORDER = 8;
+constexpr int MAX_RICE_PARAM = 14;       // 15 is the escape code
+constexpr size_t STREAMINFO_SIZE = 34;
+
+// Subframe types (6 bits)
+constexpr uint32_t SUBFRAME_CONSTANT = 0x00;
+constexpr uint32_t SUBFRAME_VERBATIM = 0x01;
+constexpr uint32_t SUBFRAME_FIXED = 0x08;  // | order
+constexpr uint32_t SUBFRAME_LPC = 0x20;    // | (order - 1)
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t c8 = static_cast<uint8_t>(i);
+            uint16_t c16 = static_cast<uint16_t>(i << 8);
+            for (int b = 0; b < 8; ++b) {
+                c8 = static_cast<uint8_t>((c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1);
+                c16 = static_cast<uint16_t>((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1);
+            }
+            crc8[i] = c8;
+            crc16[i] = c16;
+        }
+    }
+};
+
+const CrcTables& crc_tables() {
+    static const CrcTables tables;
+    return tables;
+}
+
+// CRC-8 (poly 0x07) of the frame header
+uint8_t crc8(const uint8_t* data, size_t size) {
+    const CrcTables& t = crc_tables();
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) crc = t.crc8[crc ^ data[i]];
+    return crc;
+}
+
+// CRC-16 (poly 0x8005) of the whole frame
+uint16_t crc16(const uint8_t* data, size_t size) {
+    const CrcTables& t = crc_tables();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ t.crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+/**
+ * MSB-first bit packer appending to a byte vector
+ */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        acc_ = (acc_ << bits) | (value & ((uint64_t{1} << bits) - 1));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+        acc_ &= (uint64_t{1} << count_) - 1;
+    }
+
+    void put_signed(int32_t value, int bits) {
+        put(static_cast<uint32_t>(value), bits);
+    }
+
+    // Rice code of a zigzagged residual: quotient in unary, then k bits
+    void put_rice(uint32_t value, int k) {
+        uint32_t q = value >> k;
+        const uint32_t low = value & ((1u << k) - 1);
+        if (q + 1 + k <= 32) {
+            put((1u << k) | low, static_cast<int>(q) + 1 + k);
+            return;
+        }
+        for (; q >= 32; q -= 32) put(0, 32);
+        put(1, static_cast<int>(q) + 1);
+        put(low, k);
+    }
+
+    void align() {
+        if (count_ > 0) put(0, 8 - count_);
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;  // Pending bits in acc_, always < 8 between calls
+};
+
+uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+int block_size_code(int block_size) {
+    switch (block_size) {
+        case 4096: return 12;
+        case 1152: return 3;
+        case 2304: return 4;
+        case 4608: return 5;
+        default: return block_size <= 256 ? 6 : 7;  // 8/16-bit size follows
+    }
+}
+
+int sample_rate_code(int sample_rate) {
+    switch (sample_rate) {
+        case 88200: return 1;
+        case 176400: return 2;
+        case 192000: return 3;
+        case 8000: return 4;
+        case 16000: return 5;
+        case 22050: return 6;
+        case 24000: return 7;
+        case 32000: return 8;
+        case 44100: return 9;
+        case 48000: return 10;
+        case 96000: return 11;
+        default: break;
+    }
+    if (sample_rate % 1000 == 0 && sample_rate / 1000 <= 255) return 12;
+    if (sample_rate <= 65535) return 13;
+    if (sample_rate % 10 == 0 && sample_rate / 10 <= 65535) return 14;
+    return 0;  // Only in STREAMINFO
+}
+
+/**
+ * Rice partitioning of one residual: partition order and a parameter per
+ * partition
+ */
+struct RiceChoice {
+    int order = 0;
+    uint8_t params[1 << MAX_PARTITION_ORDER] = {};
+};
+
+/**
+ * Encodes frames; one per thread, buffers reused across frames
+ */
+class FrameEncoder {
+public:
+    FrameEncoder(const FlacOptions& options, int sample_rate, int channels)
+            : max_lpc_order_(std::min(std::max(options.max_lpc_order, 0), MAX_LPC_ORDER)),
+              sample_rate_(sample_rate),
+              sr_code_(sample_rate_code(sample_rate)),
+              channels_(channels) {}
+
+    void encode(const float* data, int block, uint32_t frame_number, std::vector<uint8_t>& out) {
+        pcm_.resize(static_cast<size_t>(block) * channels_ * 2);
+        float_to_pcm16(data, static_cast<size_t>(block) * channels_, pcm_.data());
+        samples_.resize(block);
+
+        BitWriter bw(out);
+        const int bs_code = block_size_code(block);
+
+        bw.put(0xFFF8, 16);  // Sync code, fixed block size
+        bw.put(static_cast<uint32_t>(bs_code), 4);
+        bw.put(static_cast<uint32_t>(sr_code_), 4);
+        bw.put(static_cast<uint32_t>(channels_ - 1), 4);  // Independent channels
+        bw.put(4, 3);                                     // 16 bits per sample
+        bw.put(0, 1);
+        put_frame_number(bw, frame_number);
+        if (bs_code == 6) bw.put(static_cast<uint32_t>(block - 1), 8);
+        if (bs_code == 7) bw.put(static_cast<uint32_t>(block - 1), 16);
+        if (sr_code_ == 12) bw.put(static_cast<uint32_t>(sample_rate_ / 1000), 8);
+        if (sr_code_ == 13) bw.put(static_cast<uint32_t>(sample_rate_), 16);
+        if (sr_code_ == 14) bw.put(static_cast<uint32_t>(sample_rate_ / 10), 16);
+        bw.put(crc8(out.data(), out.size()), 8);
+
+        for (int ch = 0; ch < channels_; ++ch) {
+            for (int i = 0; i < block; ++i) {
+                int16_t s;
+                std::memcpy(&s, pcm_.data() + 2 * (static_cast<size_t>(i) * channels_ + ch), 2);
+                samples_[i] = s;
+            }
+            encode_subframe(bw, samples_.data(), block);
+        }
+
+        bw.align();
+        bw.put(crc16(out.data(), out.size()), 16);
+    }
+
+private:
+    static void put_frame_number(BitWriter& bw, uint32_t n) {
+        if (n < 0x80) {
+            bw.put(n, 8);
+            return;
+        }
+        // UTF-8 style: lead byte holds the length, then 6 bits per byte
+        int bytes = 2;
+        while (bytes < 6 && n >= (1u << (5 * bytes + 1))) ++bytes;
+        const uint32_t lead = (0xFF00u >> bytes) & 0xFF;
+        bw.put(lead | (n >> (6 * (bytes - 1))), 8);
+        for (int i = bytes - 2; i >= 0; --i) bw.put(0x80 | ((n >> (6 * i)) & 0x3F), 8);
+    }
+
+    void encode_subframe(BitWriter& bw, const int32_t* s, int n) {
+        if (std::all_of(s + 1, s + n, [&](int32_t v) { return v == s[0]; })) {
+            put_subframe_header(bw, SUBFRAME_CONSTANT);
+            bw.put_signed(s[0], BITS_PER_SAMPLE);
+            return;
+        }
+
+        const uint64_t verbatim_bits = 8 + static_cast<uint64_t>(n) * BITS_PER_SAMPLE;
+
+        // Fixed polynomial predictor
+        uint64_t fixed_bits = UINT64_MAX;
+        int fixed_order = 0;
+        RiceChoice fixed_rice;
+        if (n > MAX_FIXED_ORDER) {
+            fixed_order = best_fixed_order(s, n);
+            fixed_residual(s, n, fixed_order, residual_);
+            fixed_bits = 8 + static_cast<uint64_t>(fixed_order) * BITS_PER_SAMPLE +
+                         choose_rice(residual_.data(), n, fixed_order, fixed_rice);
+        }
+
+        // LPC
+        uint64_t lpc_bits = UINT64_MAX;
+        int lpc_order = 0;
+        int lpc_shift = 0;
+        RiceChoice lpc_rice;
+        if (max_lpc_order_ > 0 && n > 2 * max_lpc_order_) {
+            lpc_order = lpc_coefficients(s, n, lpc_shift);
+            if (lpc_order > 0) {
+                lpc_residual(s, n, lpc_order, lpc_shift, lpc_residual_);
+                lpc_bits = 8 + static_cast<uint64_t>(lpc_order) * (BITS_PER_SAMPLE + LPC_PRECISION) +
+                           4 + 5 + choose_rice(lpc_residual_.data(), n, lpc_order, lpc_rice);
+            }
+        }
+
+        if (lpc_bits < fixed_bits && lpc_bits < verbatim_bits) {
+            put_subframe_header(bw, SUBFRAME_LPC | static_cast<uint32_t>(lpc_order - 1));
+            for (int i = 0; i < lpc_order; ++i) bw.put_signed(s[i], BITS_PER_SAMPLE);
+            bw.put(LPC_PRECISION - 1, 4);
+            bw.put_signed(lpc_shift, 5);
+            for (int i = 0; i < lpc_order; ++i) bw.put_signed(qlp_[i], LPC_PRECISION);
+            put_residual(bw, lpc_residual_.data(), n, lpc_order, lpc_rice);
+        } else if (fixed_bits < verbatim_bits) {
+            put_subframe_header(bw, SUBFRAME_FIXED | static_cast<uint32_t>(fixed_order));
+            for (int i = 0; i < fixed_order; ++i) bw.put_signed(s[i], BITS_PER_SAMPLE);
+            put_residual(bw, residual_.data(), n, fixed_order, fixed_rice);
+        } else {
+            put_subframe_header(bw, SUBFRAME_VERBATIM);
+            for (int i = 0; i < n; ++i) bw.put_signed(s[i], BITS_PER_SAMPLE);
+        }
+    }
+
+    static void put_subframe_header(BitWriter& bw, uint32_t type) {
+        bw.put(0, 1);
+        bw.put(type, 6);
+        bw.put(0, 1);  // No wasted bits
+    }
+
+    // Order whose residual has the smallest magnitude sum
+    static int best_fixed_order(const int32_t* s, int n) {
+        uint64_t sum[MAX_FIXED_ORDER + 1] = {};
+        for (int i = MAX_FIXED_ORDER; i < n; ++i) {
+            const int32_t e0 = s[i];
+            const int32_t e1 = e0 - s[i - 1];
+            const int32_t e2 = e1 - (s[i - 1] - s[i - 2]);
+            const int32_t e3 = e2 - (s[i - 1] - 2 * s[i - 2] + s[i - 3]);
+            const int32_t e4 = e3 - (s[i - 1] - 3 * s[i - 2] + 3 * s[i - 3] - s[i - 4]);
+            sum[0] += static_cast<uint32_t>(std::abs(e0));
+            sum[1] += static_cast<uint32_t>(std::abs(e1));
+            sum[2] += static_cast<uint32_t>(std::abs(e2));
+            sum[3] += static_cast<uint32_t>(std::abs(e3));
+            sum[4] += static_cast<uint32_t>(std::abs(e4));
+        }
+        return static_cast<int>(std::min_element(sum, sum + MAX_FIXED_ORDER + 1) - sum);
+    }
+
+    // residual[i] for i in [order, n); the first `order` entries are unused
+    static void fixed_residual(const int32_t* s, int n, int order, std::vector<int32_t>& residual) {
+        residual.resize(n);
+        int32_t* r = residual.data();
+        switch (order) {
+            case 0:
+                for (int i = 0; i < n; ++i) r[i] = s[i];
+                break;
+            case 1:
+                for (int i = 1; i < n; ++i) r[i] = s[i] - s[i - 1];
+                break;
+            case 2:
+                for (int i = 2; i < n; ++i) r[i] = s[i] - 2 * s[i - 1] + s[i - 2];
+                break;
+            case 3:
+                for (int i = 3; i < n; ++i) r[i] = s[i] - 3 * s[i - 1] + 3 * s[i - 2] - s[i - 3];
+                break;
+            default:
+                for (int i = 4; i < n; ++i) {
+                    r[i] = s[i] - 4 * s[i - 1] + 6 * s[i - 2] - 4 * s[i - 3] + s[i - 4];
+                }
+                break;
+        }
+    }
+
+    /**
+     * Windowed autocorrelation -> Levinson-Durbin -> the order with the
+     * fewest expected bits, quantized into qlp_. Returns the order, or 0
+     * if LPC does not apply.
+     */
+    int lpc_coefficients(const int32_t* s, int n, int& shift) {
+        const int max_order = max_lpc_order_;
+
+        // Tukey(0.5) window: raised-cosine tapers over the outer quarters
+        if (static_cast<int>(window_.size()) != n) {
+            window_.assign(n, 1.0);
+            const int taper = n / 4;
+            for (int i = 0; i < taper; ++i) {
+                const double w = 0.5 - 0.5 * std::cos(PI * (i + 0.5) / taper);
+                window_[i] = w;
+                window_[n - 1 - i] = w;
+            }
+        }
+        windowed_.resize(n);
+        for (int i = 0; i < n; ++i) windowed_[i] = s[i] * window_[i];
+
+        double autoc[MAX_LPC_ORDER + 1] = {};
+        for (int lag = 0; lag <= max_order; ++lag) {
+            double sum = 0.0;
+            for (int i = lag; i < n; ++i) sum += windowed_[i] * windowed_[i - lag];
+            autoc[lag] = sum;
+        }
+        if (autoc[0] <= 0.0) return 0;
+
+        // lp[o - 1][j]: order-o predictor, s[i] ~ sum_j lp[j] * s[i - 1 - j]
+        double lp[MAX_LPC_ORDER][MAX_LPC_ORDER];
+        double error[MAX_LPC_ORDER];
+        double a[MAX_LPC_ORDER] = {};
+        double err = autoc[0];
+        int orders = 0;
+        for (int i = 0; i < max_order; ++i) {
+            double acc = autoc[i + 1];
+            for (int j = 0; j < i; ++j) acc -= a[j] * autoc[i - j];
+            const double k = acc / err;
+
+            double next[MAX_LPC_ORDER];
+            for (int j = 0; j < i; ++j) next[j] = a[j] - k * a[i - 1 - j];
+            next[i] = k;
+            std::copy(next, next + i + 1, a);
+
+            err *= 1.0 - k * k;
+            std::copy(a, a + i + 1, lp[i]);
+            error[i] = err;
+            ++orders;
+            if (err <= 0.0) break;
+        }
+
+        // Expected residual bits per sample from the prediction error
+        int best = 0;
+        double best_bits = 0.0;
+        for (int o = 1; o <= orders; ++o) {
+            const double scaled = error[o - 1] * 0.5 / n;
+            const double per_sample = scaled > 1.0 ? 0.5 * std::log2(scaled) : 0.0;
+            const double bits = per_sample * (n - o) + o * (BITS_PER_SAMPLE + LPC_PRECISION);
+            if (best == 0 || bits < best_bits) {
+                best = o;
+                best_bits = bits;
+            }
+        }
+        return quantize(lp[best - 1], best, shift) ? best : 0;
+    }
+
+    // Quantize to LPC_PRECISION bits, carrying the rounding error forward
+    bool quantize(const double* lp, int order, int& shift) {
+        double cmax = 0.0;
+        for (int j = 0; j < order; ++j) cmax = std::max(cmax, std::fabs(lp[j]));
+        if (cmax <= 0.0) return false;
+
+        int log2cmax;
+        std::frexp(cmax, &log2cmax);  // cmax < 2^log2cmax
+        shift = std::min(LPC_PRECISION - 1 - log2cmax, MAX_LPC_SHIFT);
+        if (shift < 0) return false;
+
+        const int32_t qmax = (1 << (LPC_PRECISION - 1)) - 1;
+        const int32_t qmin = -(1 << (LPC_PRECISION - 1));
+        double carry = 0.0;
+        for (int j = 0; j < order; ++j) {
+            carry += lp[j] * (1 << shift);
+            const int32_t q = std::clamp(static_cast<int32_t>(std::lround(carry)), qmin, qmax);
+            carry -= q;
+            qlp_[j] = q;
+        }
+        return true;
+    }
+
+    void lpc_residual(const int32_t* s, int n, int order, int shift,
+                      std::vector<int32_t>& residual) const {
+        residual.resize(n);
+        for (int i = order; i < n; ++i) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; ++j) sum += static_cast<int64_t>(qlp_[j]) * s[i - 1 - j];
+            residual[i] = s[i] - static_cast<int32_t>(sum >> shift);
+        }
+    }
+
+    // Bits of a Rice partition with magnitude sum `sum` over `count` samples
+    static uint64_t rice_bits(uint64_t sum, uint32_t count, int& param) {
+        if (count == 0) {
+            param = 0;
+            return 4;
+        }
+        int k = 0;
+        for (uint64_t mean = sum / count; k < MAX_RICE_PARAM && (mean >> (k + 1)) > 0;) ++k;
+
+        uint64_t best = UINT64_MAX;
+        for (int p = std::max(k - 1, 0); p <= std::min(k + 1, MAX_RICE_PARAM); ++p) {
+            const uint64_t bits = static_cast<uint64_t>(count) * (p + 1) + (sum >> p);
+            if (bits < best) {
+                best = bits;
+                param = p;
+            }
+        }
+        return 4 + best;
+    }
+
+    /**
+     * Pick the partition order and Rice parameters for residual[order, n).
+     * Returns the estimated size of the residual section in bits.
+     */
+    uint64_t choose_rice(const int32_t* residual, int n, int pred_order, RiceChoice& choice) {
+        int max_order = 0;
+        while (max_order < MAX_PARTITION_ORDER && n % (2 << max_order) == 0 &&
+               (n >> (max_order + 1)) > pred_order) {
+            ++max_order;
+        }
+
+        // Magnitude sums at the finest partitioning, merged pairwise below
+        const int parts = 1 << max_order;
+        const int part_size = n >> max_order;
+        sums_.assign(parts, 0);
+        for (int p = 0; p < parts; ++p) {
+            const int begin = p == 0 ? pred_order : p * part_size;
+            uint64_t sum = 0;
+            for (int i = begin; i < (p + 1) * part_size; ++i) sum += zigzag(residual[i]);
+            sums_[p] = sum;
+        }
+
+        uint64_t best = UINT64_MAX;
+        for (int order = max_order; order >= 0; --order) {
+            const int count = 1 << order;
+            const uint32_t size = static_cast<uint32_t>(n >> order);
+            uint64_t bits = 2 + 4;
+            uint8_t params[1 << MAX_PARTITION_ORDER];
+            for (int p = 0; p < count; ++p) {
+                int param = 0;
+                bits += rice_bits(sums_[p], p == 0 ? size - pred_order : size, param);
+                params[p] = static_cast<uint8_t>(param);
+            }
+            if (bits < best) {
+                best = bits;
+                choice.order = order;
+                std::copy(params, params + count, choice.params);
+            }
+            for (int p = 0; p < count / 2; ++p) sums_[p] = sums_[2 * p] + sums_[2 * p + 1];
+        }
+        return best;
+    }
+
+    static void put_residual(BitWriter& bw, const int32_t* residual, int n, int pred_order,
+                             const RiceChoice& choice) {
+        bw.put(0, 2);  // 4-bit Rice parameters
+        bw.put(static_cast<uint32_t>(choice.order), 4);
+        const int part_size = n >> choice.order;
+        for (int p = 0; p < (1 << choice.order); ++p) {
+            const int k = choice.params[p];
+            bw.put(static_cast<uint32_t>(k), 4);
+            const int begin = p == 0 ? pred_order : p * part_size;
+            for (int i = begin; i < (p + 1) * part_size; ++i) bw.put_rice(zigzag(residual[i]), k);
+        }
+    }
+
+    const int max_lpc_order_;
+    const int sample_rate_;
+    const int sr_code_;
+    const int channels_;
+
+    std::vector<uint8_t> pcm_;          // Interleaved 16-bit block
+    std::vector<int32_t> samples_;      // One channel of the block
+    std::vector<int32_t> residual_;     // Fixed predictor residual
+    std::vector<int32_t> lpc_residual_;
+    std::vector<double> window_;
+    std::vector<double> windowed_;
+    std::vector<uint64_t> sums_;
+    int32_t qlp_[MAX_LPC_ORDER] = {};
+};
+
+void put_streaminfo(BitWriter& bw, int min_block, int max_block, uint32_t min_frame,
+                    uint32_t max_frame, int sample_rate, int channels, uint64_t total) {
+    bw.put(static_cast<uint32_t>(min_block), 16);
+    bw.put(static_cast<uint32_t>(max_block), 16);
+    bw.put(min_frame, 24);
+    bw.put(max_frame, 24);
+    bw.put(static_cast<uint32_t>(sample_rate), 20);
+    bw.put(static_cast<uint32_t>(channels - 1), 3);
+    bw.put(BITS_PER_SAMPLE - 1, 5);
+    bw.put(static_cast<uint32_t>(total >> 32), 4);
+    bw.put(static_cast<uint32_t>(total), 32);
+    for (int i = 0; i < 4; ++i) bw.put(0, 32);  // MD5 not computed
+}
+
+} // namespace
+
+std::vector<uint8_t> encode_flac(const float* data, int samples, int sample_rate, int channels,
+                                 const FlacOptions& options) {
+    const int block_size = options.block_size;
+    if (samples < 0 || channels < 1 || channels > 8 || sample_rate <= 0 ||
+        sample_rate > 655350 || block_size < 16 || block_size > 65535) {
+        return {};
+    }
+
+    const int frame_count = (samples + block_size - 1) / block_size;
+    std::vector<std::vector<uint8_t>> frames(frame_count);
+
+    // Frames are independent: workers pull the next frame index
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        FrameEncoder encoder(options, sample_rate, channels);
+        for (int f; (f = next.fetch_add(1)) < frame_count;) {
+            const int begin = f * block_size;
+            const int block = std::min(block_size, samples - begin);
+            encoder.encode(data + static_cast<size_t>(begin) * channels, block,
+                           static_cast<uint32_t>(f), frames[f]);
+        }
+    };
+
+    int threads = options.threads > 0
+            ? options.threads
+            : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, frame_count));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    size_t total = 4 + 4 + STREAMINFO_SIZE;
+    uint32_t min_frame = frame_count > 0 ? UINT32_MAX : 0;
+    uint32_t max_frame = 0;
+    for (const auto& frame : frames) {
+        total += frame.size();
+        min_frame = std::min(min_frame, static_cast<uint32_t>(frame.size()));
+        max_frame = std::max(max_frame, static_cast<uint32_t>(frame.size()));
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(total);
+    for (const char c : {'f', 'L', 'a', 'C'}) out.push_back(static_cast<uint8_t>(c));
+
+    BitWriter bw(out);
+    bw.put(0x80, 8);  // Last metadata block, type STREAMINFO
+    bw.put(static_cast<uint32_t>(STREAMINFO_SIZE), 24);
+    const int max_block = frame_count > 1 ? block_size : std::max(samples, 16);
+    put_streaminfo(bw, max_block, max_block, min_frame, max_frame, sample_rate, channels,
+                   static_cast<uint64_t>(samples));
+
+    for (const auto& frame : frames) out.insert(out.end(), frame.begin(), frame.end());
+    return out;
+}
+
+} // namespace audio
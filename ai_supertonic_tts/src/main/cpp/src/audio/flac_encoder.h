@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Lossless FLAC encoding of float32 audio (quantized to 16-bit first,
+ * exactly like encode_wav_16, so a FLAC export decodes to the same
+ * samples as the WAV_16 one).
+ *
+ * Each channel of each block picks the cheapest of constant, verbatim,
+ * fixed (order 0-4) and LPC (Levinson-Durbin on a Tukey-windowed block,
+ * 12-bit quantized coefficients) prediction. Residuals are Rice coded
+ * with the partition order and per-partition parameters chosen from
+ * their magnitude sums.
+ *
+ * Frames are independent, so they are encoded in parallel across
+ * threads and concatenated. Channels are coded independently (no
+ * mid/side) and STREAMINFO carries no MD5 (all zero: "not computed").
+ */
+struct FlacOptions {
+    int block_size = 4096;   // Samples per frame, 16..65535
+    int max_lpc_order = 8;   // 0 = fixed predictors only, at most 32
+    int threads = 0;         // 0 = one per core
+};
+
+/**
+ * Encode `samples` interleaved frames as a complete .flac file.
+ * Returns an empty vector if the arguments are out of range.
+ */
+std::vector<uint8_t> encode_flac(const float* data, int samples, int sample_rate, int channels,
+                                 const FlacOptions& options = FlacOptions());
+
+} // namespace audio
@@ -0,0 +1,183 @@
+#include "playback_feeder.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace audio {
+
+namespace {
+
+// How long an empty ring is waited on before the sink level is checked
+constexpr int POLL_MS = 2;
+
+constexpr int PAUSE_NAP_MS = 5;
+constexpr size_t MIN_READ = 64;
+
+// Upper bound on the final drain, beyond what is queued
+constexpr int DRAIN_SLACK_MS = 200;
+
+double ms_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+} // namespace
+
+PlaybackFeeder::PlaybackFeeder(AudioRing& ring, std::unique_ptr<AudioSink> sink, int source_rate)
+        : ring_(ring), sink_(std::move(sink)), source_rate_(source_rate) {
+    if (sink_ && source_rate_ > 0 && sink_->sample_rate() != source_rate_) {
+        resampler_ = std::make_unique<Resampler>(source_rate_, sink_->sample_rate());
+    }
+}
+
+PlaybackFeeder::~PlaybackFeeder() {
+    stop();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool PlaybackFeeder::start() {
+    if (!sink_ || source_rate_ <= 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = "no sink";
+        return false;
+    }
+    if (thread_.joinable()) return true;
+    if (!sink_->start()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = sink_->last_error();
+        return false;
+    }
+    started_at_ = Clock::now();
+    thread_ = std::thread(&PlaybackFeeder::run, this);
+    return true;
+}
+
+bool PlaybackFeeder::wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return done_.wait_for(lock, std::chrono::milliseconds(std::max(timeout_ms, 0)),
+                          [this] { return finished(); });
+}
+
+void PlaybackFeeder::stop() {
+    stop_.store(true, std::memory_order_release);
+}
+
+void PlaybackFeeder::set_gain(float gain) {
+    gain_.store(std::min(1.0f, std::max(0.0f, gain)), std::memory_order_relaxed);
+}
+
+bool PlaybackFeeder::feed(const float* data, size_t n) {
+    thread_local std::vector<float> scaled;
+    thread_local std::vector<float> resampled;
+
+    const float gain = gain_.load(std::memory_order_relaxed);
+    if (gain != 1.0f) {
+        scaled.assign(data, data + n);
+        for (float& s : scaled) s *= gain;
+        data = scaled.data();
+    }
+    if (resampler_) {
+        resampled.resize(resampler_->max_output(n));
+        n = resampler_->process(data, n, resampled.data());
+        data = resampled.data();
+    }
+    if (n == 0) return true;
+    if (!sink_->write(data, n)) return false;
+
+    played_.fetch_add(n, std::memory_order_relaxed);
+    if (first_audio_ms_.load(std::memory_order_relaxed) < 0.0) {
+        first_audio_ms_.store(ms_since(started_at_), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void PlaybackFeeder::run() {
+    // One device burst per read, in source samples
+    const size_t burst = sink_->burst() * static_cast<size_t>(source_rate_) /
+                         static_cast<size_t>(sink_->sample_rate());
+    std::vector<float> block(std::max(burst, MIN_READ));
+
+    bool ok = true;
+    bool audio_started = false;
+    bool sink_paused = false;
+    bool dry = false;
+    Clock::time_point dry_since{};
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (paused()) {
+            if (!sink_paused) sink_->pause();
+            sink_paused = true;
+            dry = false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(PAUSE_NAP_MS));
+            continue;
+        }
+        if (sink_paused) {
+            sink_->resume();
+            sink_paused = false;
+        }
+
+        const long count = ring_.read_wait(block.data(), block.size(), POLL_MS);
+        if (count < 0) break;
+        if (count == 0) {
+            if (audio_started && !dry && sink_->queued() == 0) {
+                dry = true;
+                dry_since = Clock::now();
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        if (dry) {
+            starved_ms_.store(starved_ms_.load(std::memory_order_relaxed) + ms_since(dry_since),
+                              std::memory_order_relaxed);
+            dry = false;
+        }
+        if (!feed(block.data(), static_cast<size_t>(count))) {
+            ok = false;
+            break;
+        }
+        audio_started = true;
+        device_xruns_.store(sink_->device_xruns(), std::memory_order_relaxed);
+    }
+
+    // Played to the end: push the resampler tail and let the device finish
+    if (ok && !stop_.load(std::memory_order_acquire) && !ring_.cancelled()) {
+        if (resampler_) {
+            std::vector<float> tail(resampler_->max_output(block.size()) + block.size());
+            const size_t n = resampler_->flush(tail.data());
+            if (n > 0) ok = sink_->write(tail.data(), n);
+            if (ok) played_.fetch_add(n, std::memory_order_relaxed);
+        }
+        if (ok) {
+            const size_t queued = sink_->queued();
+            sink_->drain(static_cast<int>(queued * 1000 / static_cast<size_t>(sink_->sample_rate())) +
+                         DRAIN_SLACK_MS);
+        }
+    }
+    device_xruns_.store(sink_->device_xruns(), std::memory_order_relaxed);
+    sink_->stop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) error_ = sink_->last_error();
+    finished_.store(true, std::memory_order_release);
+    done_.notify_all();
+}
+
+PlaybackFeeder::Stats PlaybackFeeder::stats() const {
+    Stats s;
+    s.samples_played = played_.load(std::memory_order_relaxed);
+    s.underruns = underruns_.load(std::memory_order_relaxed);
+    s.starved_ms = starved_ms_.load(std::memory_order_relaxed);
+    s.first_audio_ms = first_audio_ms_.load(std::memory_order_relaxed);
+    const AudioRing::Stats ring = ring_.stats();
+    s.ring_underruns = ring.underruns;
+    s.ring_low_water = ring.low_water;
+    s.device_xruns = device_xruns_.load(std::memory_order_relaxed);
+    s.sink_rate = sink_ ? sink_->sample_rate() : 0;
+    return s;
+}
+
+std::string PlaybackFeeder::last_error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+} // namespace audio
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "audio_ring.h"
+#include "audio_sink.h"
+#include "resampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace audio {
+
+/**
+ * Dedicated playback thread: drains an AudioRing into an AudioSink.
+ *
+ * Synthesis writes the ring at its own pace (chunk N+1 is synthesized
+ * while chunk N plays); the feeder pulls a device burst at a time,
+ * resamples to the sink rate when they differ, applies the volume and
+ * blocks in the sink's write(), so the device clock paces it.
+ *
+ * Buffer health: an underrun is the sink running dry (queued() == 0)
+ * while the ring is still open, i.e. an audible gap because synthesis
+ * fell behind. The feeder counts them and how long they lasted, next to
+ * the ring's own low-water mark and the device's xrun count.
+ *
+ * The ring must outlive the feeder.
+ */
+class PlaybackFeeder {
+public:
+    struct Stats {
+        uint64_t samples_played = 0;   // At the sink rate
+        uint64_t underruns = 0;
+        double starved_ms = 0.0;       // Time the sink spent dry
+        double first_audio_ms = -1.0;  // start() -> first sample queued; -1 before that
+        uint64_t ring_underruns = 0;
+        size_t ring_low_water = 0;     // Samples at the source rate
+        uint64_t device_xruns = 0;
+        int sink_rate = 0;
+    };
+
+    PlaybackFeeder(AudioRing& ring, std::unique_ptr<AudioSink> sink, int source_rate);
+    PlaybackFeeder(const PlaybackFeeder&) = delete;
+    PlaybackFeeder& operator=(const PlaybackFeeder&) = delete;
+
+    /** Stops and joins the thread */
+    ~PlaybackFeeder();
+
+    /**
+     * Start the sink and the thread. False (see last_error()) if the sink
+     * failed to start.
+     */
+    bool start();
+
+    /**
+     * Wait up to `timeout_ms` for the ring to be closed and drained and
+     * the sink to finish playing. True once done (or stopped/failed).
+     */
+    bool wait(int timeout_ms);
+
+    /** Stop playback now, dropping whatever is queued */
+    void stop();
+
+    void pause() { paused_.store(true, std::memory_order_release); }
+    void resume() { paused_.store(false, std::memory_order_release); }
+    bool paused() const { return paused_.load(std::memory_order_acquire); }
+
+    /** Linear gain applied before the sink, clamped to [0, 1] */
+    void set_gain(float gain);
+
+    bool finished() const { return finished_.load(std::memory_order_acquire); }
+
+    Stats stats() const;
+
+    /** Sink error that ended playback early, if any */
+    std::string last_error() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    bool feed(const float* data, size_t n);
+
+    AudioRing& ring_;
+    std::unique_ptr<AudioSink> sink_;
+    std::unique_ptr<Resampler> resampler_;  // Null when the rates match
+    int source_rate_;
+
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> paused_{false};
+    std::atomic<float> gain_{1.0f};
+    std::atomic<bool> finished_{false};
+
+    Clock::time_point started_at_{};
+    std::atomic<uint64_t> played_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<double> starved_ms_{0.0};
+    std::atomic<double> first_audio_ms_{-1.0};
+    std::atomic<uint64_t> device_xruns_{0};
+
+    mutable std::mutex mutex_;
+    std::condition_variable done_;
+    std::string error_;
+};
+
+} // namespace audio
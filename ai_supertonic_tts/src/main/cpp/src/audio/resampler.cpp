@@ -0,0 +1,196 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace audio {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double KAISER_BETA = 8.6;  // ~-80 dB stopband at 32 taps
+constexpr double ROLLOFF = 0.94;     // Passband edge as a fraction of the lower Nyquist
+
+// Zeroth-order modified Bessel function of the first kind (series)
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= q / (static_cast<double>(k) * k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// n is a multiple of 4
+float dot(const float* a, const float* b, int n) {
+#if defined(__aarch64__)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    if (i < n) acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(__SSE2__)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    if (i < n) acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    __m128 sum = _mm_add_ps(acc0, acc1);
+    sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(sum);
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+} // namespace
+
+/**
+ * Phase p holds the taps for output instants p/L of an input sample
+ * after an input index i, applied to inputs i - taps/2 + 1 .. i + taps/2
+ */
+struct Resampler::PhaseTable {
+    int taps;
+    std::vector<float> coeffs;  // [L][taps]
+
+    const float* phase(int p) const { return coeffs.data() + static_cast<size_t>(p) * taps; }
+};
+
+std::shared_ptr<const Resampler::PhaseTable> Resampler::table_for(int up, int down, int taps) {
+    static std::mutex mtx;
+    static std::map<std::tuple<int, int, int>, std::shared_ptr<const PhaseTable>> cache;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto& cached = cache[std::make_tuple(up, down, taps)];
+    if (cached) return cached;
+
+    auto table = std::make_shared<PhaseTable>();
+    table->taps = taps;
+    table->coeffs.resize(static_cast<size_t>(up) * taps);
+
+    // Low-pass below the lower of the two Nyquist rates, in input samples
+    const double cutoff = 0.5 * std::min(1.0, static_cast<double>(up) / down) * ROLLOFF;
+    const double half = taps / 2.0;
+    const double i0_beta = bessel_i0(KAISER_BETA);
+
+    for (int p = 0; p < up; ++p) {
+        float* c = table->coeffs.data() + static_cast<size_t>(p) * taps;
+        const double frac = static_cast<double>(p) / up;
+        double sum = 0.0;
+        for (int j = 0; j < taps; ++j) {
+            const double t = (j - taps / 2 + 1) - frac;  // Distance from the output instant
+            const double x = 2.0 * cutoff * t;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+            const double r = t / half;
+            const double window = r * r < 1.0
+                    ? bessel_i0(KAISER_BETA * std::sqrt(1.0 - r * r)) / i0_beta : 0.0;
+            c[j] = static_cast<float>(sinc * window);
+            sum += c[j];
+        }
+        // Unity DC gain for every phase
+        for (int j = 0; j < taps; ++j) c[j] = static_cast<float>(c[j] / sum);
+    }
+
+    cached = std::move(table);
+    return cached;
+}
+
+Resampler::Resampler(int in_rate, int out_rate, int taps)
+        : in_rate_(in_rate), out_rate_(out_rate), taps_(std::max(8, (taps + 3) & ~3)) {
+    if (in_rate_ > 0 && out_rate_ > 0 && in_rate_ != out_rate_) {
+        const int g = std::gcd(in_rate_, out_rate_);
+        up_ = out_rate_ / g;
+        down_ = in_rate_ / g;
+        table_ = table_for(up_, down_, taps_);
+    }
+    reset();
+}
+
+size_t Resampler::max_output(size_t in_samples) const {
+    if (!table_) return in_samples;
+    // At most taps - 1 samples stay buffered between calls
+    return (in_samples + static_cast<size_t>(taps_)) * static_cast<size_t>(up_) /
+           static_cast<size_t>(down_) + 2;
+}
+
+size_t Resampler::process(const float* in, size_t count, float* out) {
+    if (!table_) {
+        std::memcpy(out, in, count * sizeof(float));
+        return count;
+    }
+
+    buf_.insert(buf_.end(), in, in + count);
+    const int64_t end = base_ + static_cast<int64_t>(buf_.size());
+    const int half = taps_ / 2;
+
+    size_t produced = 0;
+    while (pos_ + half < end) {
+        const float* window = buf_.data() + (pos_ - half + 1 - base_);
+        out[produced++] = dot(table_->phase(phase_), window, taps_);
+
+        phase_ += down_;
+        pos_ += phase_ / up_;
+        phase_ %= up_;
+    }
+
+    // Drop input no future output can reach
+    const auto consumed = static_cast<size_t>(
+            std::clamp<int64_t>(pos_ - half + 1 - base_, 0, static_cast<int64_t>(buf_.size())));
+    buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(consumed));
+    base_ += static_cast<int64_t>(consumed);
+    return produced;
+}
+
+size_t Resampler::flush(float* out) {
+    size_t produced = 0;
+    if (table_) {
+        // Zeros after the end let the last inputs reach the filter centre
+        const std::vector<float> zeros(static_cast<size_t>(taps_ / 2), 0.0f);
+        produced = process(zeros.data(), zeros.size(), out);
+    }
+    reset();
+    return produced;
+}
+
+void Resampler::reset() {
+    // Zeros before the start: the first output is centred on input 0
+    buf_.assign(static_cast<size_t>(taps_ / 2 - 1), 0.0f);
+    base_ = -(taps_ / 2 - 1);
+    pos_ = 0;
+    phase_ = 0;
+}
+
+std::vector<float> resample(const float* data, size_t samples, int in_rate, int out_rate) {
+    Resampler resampler(in_rate, out_rate);
+    std::vector<float> out(resampler.max_output(samples) + resampler.max_output(32));
+    size_t produced = resampler.process(data, samples, out.data());
+    produced += resampler.flush(out.data() + produced);
+    out.resize(produced);
+    return out;
+}
+
+} // namespace audio
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Polyphase windowed-sinc sample rate converter.
+ *
+ * The rate ratio is reduced to L/M (44.1k -> 48k is 160/147, 24k -> 48k
+ * is 2/1) and one Kaiser-windowed sinc filter is precomputed per output
+ * phase. Phase tables are cached per (L, M, taps), so creating a
+ * resampler for a rate pair seen before costs nothing. Each output sample
+ * is one SIMD dot product (NEON on arm64, SSE on x86_64) of a phase filter
+ * with the input.
+ *
+ * Streaming: process() carries the filter history and phase between
+ * calls, so feeding audio in any block sizes gives the same output as one
+ * call. The filter is centred (no added delay); flush() emits the last
+ * taps/2 input samples' worth of output.
+ */
+class Resampler {
+public:
+    /**
+     * @param taps Filter taps per phase (multiple of 4; 32 = ~-80 dB stopband)
+     */
+    Resampler(int in_rate, int out_rate, int taps = 32);
+
+    int in_rate() const { return in_rate_; }
+    int out_rate() const { return out_rate_; }
+
+    /**
+     * Upper bound on the output of process() for `in_samples` input
+     */
+    size_t max_output(size_t in_samples) const;
+
+    /**
+     * Resample a block. `out` must hold max_output(count) samples.
+     * Returns the number of samples written.
+     */
+    size_t process(const float* in, size_t count, float* out);
+
+    /**
+     * End of stream: write the remaining output (at most max_output(taps/2))
+     * and reset for a new stream.
+     */
+    size_t flush(float* out);
+
+    /**
+     * Forget all history (start of a new stream)
+     */
+    void reset();
+
+private:
+    struct PhaseTable;
+
+    static std::shared_ptr<const PhaseTable> table_for(int up, int down, int taps);
+
+    int in_rate_;
+    int out_rate_;
+    int up_ = 1;    // L
+    int down_ = 1;  // M
+    int taps_;
+    std::shared_ptr<const PhaseTable> table_;
+
+    std::vector<float> buf_;  // Input not yet fully consumed, from index base_
+    int64_t base_ = 0;        // Absolute input index of buf_[0]
+    int64_t pos_ = 0;         // Input index of the next output (integer part)
+    int phase_ = 0;           // Fractional part, in 1/L steps
+};
+
+/**
+ * Resample a whole buffer in one go (mono or any single stream)
+ */
+std::vector<float> resample(const float* data, size_t samples, int in_rate, int out_rate);
+
+} // namespace audio
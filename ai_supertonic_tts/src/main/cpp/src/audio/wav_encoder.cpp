@@ -1,29 +1,36 @@
 #include "wav_encoder.h"
 
 #include <cmath>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace audio {
 
-// Write a little-endian uint16
-static void write_u16(std::vector<uint8_t>& buf, uint16_t val) {
-    buf.push_back(static_cast<uint8_t>(val & 0xFF));
-    buf.push_back(static_cast<uint8_t>((val >> 8) & 0xFF));
+// Both supported ABIs (arm64-v8a, x86_64) are little-endian, so header
+// fields and samples are stored with memcpy, never byte by byte.
+static uint8_t* put_u16(uint8_t* out, uint16_t val) {
+    std::memcpy(out, &val, sizeof(val));
+    return out + sizeof(val);
+}
+
+static uint8_t* put_u32(uint8_t* out, uint32_t val) {
+    std::memcpy(out, &val, sizeof(val));
+    return out + sizeof(val);
 }
 
-// Write a little-endian uint32
-static void write_u32(std::vector<uint8_t>& buf, uint32_t val) {
-    buf.push_back(static_cast<uint8_t>(val & 0xFF));
-    buf.push_back(static_cast<uint8_t>((val >> 8) & 0xFF));
-    buf.push_back(static_cast<uint8_t>((val >> 16) & 0xFF));
-    buf.push_back(static_cast<uint8_t>((val >> 24) & 0xFF));
+static uint8_t* put_tag(uint8_t* out, const char* tag) {
+    std::memcpy(out, tag, 4);
+    return out + 4;
 }
 
-// Write 4-byte ASCII tag
-static void write_tag(std::vector<uint8_t>& buf, const char* tag) {
-    buf.push_back(static_cast<uint8_t>(tag[0]));
-    buf.push_back(static_cast<uint8_t>(tag[1]));
-    buf.push_back(static_cast<uint8_t>(tag[2]));
-    buf.push_back(static_cast<uint8_t>(tag[3]));
+static int16_t to_pcm16(float sample) {
+    float clamped = std::fmax(-1.0f, std::fmin(1.0f, sample));
+    return static_cast<int16_t>(clamped * 32767.0f);
 }
 
 void clip_audio(float* data, int samples) {
@@ -32,93 +39,110 @@ void clip_audio(float* data, int samples) {
     }
 }
 
-std::vector<uint8_t> encode_wav_16(const float* data, int samples, int sample_rate, int channels) {
-    const int bits_per_sample = 16;
-    const int byte_rate = sample_rate * channels * (bits_per_sample / 8);
-    const int block_align = channels * (bits_per_sample / 8);
-    const uint32_t data_size = static_cast<uint32_t>(samples * channels * (bits_per_sample / 8));
+void float_to_pcm16(const float* data, size_t count, uint8_t* out) {
+    size_t i = 0;
+
+#if defined(__aarch64__)
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        // minnm/maxnm pick the number over NaN, matching fmin/fmax
+        float32x4_t a = vmaxnmq_f32(vminnmq_f32(vld1q_f32(data + i), hi), lo);
+        float32x4_t b = vmaxnmq_f32(vminnmq_f32(vld1q_f32(data + i + 4), hi), lo);
+        int32x4_t ia = vcvtq_s32_f32(vmulq_f32(a, scale));
+        int32x4_t ib = vcvtq_s32_f32(vmulq_f32(b, scale));
+        int16x8_t packed = vcombine_s16(vqmovn_s32(ia), vqmovn_s32(ib));
+        vst1q_u8(out + 2 * i, vreinterpretq_u8_s16(packed));
+    }
+#elif defined(__SSE2__)
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        // minps returns its second operand for NaN, matching fmin
+        __m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(data + i), hi), lo);
+        __m128 b = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(data + i + 4), hi), lo);
+        __m128i ia = _mm_cvttps_epi32(_mm_mul_ps(a, scale));
+        __m128i ib = _mm_cvttps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_packs_epi32(ia, ib));
+    }
+#endif
 
-    // Header = 44 bytes, total = 44 + data_size
-    std::vector<uint8_t> buf;
-    buf.reserve(44 + data_size);
+    for (; i < count; ++i) {
+        put_u16(out + 2 * i, static_cast<uint16_t>(to_pcm16(data[i])));
+    }
+}
+
+void write_wav_header(uint8_t* out, uint32_t data_size, int sample_rate, int channels,
+                      uint16_t format, uint16_t bits_per_sample) {
+    const int block_align = channels * (bits_per_sample / 8);
+    const int byte_rate = sample_rate * block_align;
 
     // RIFF header
-    write_tag(buf, "RIFF");
-    write_u32(buf, 36 + data_size);  // file size - 8
-    write_tag(buf, "WAVE");
+    out = put_tag(out, "RIFF");
+    out = put_u32(out, 36 + data_size);  // file size - 8
+    out = put_tag(out, "WAVE");
 
     // fmt chunk
-    write_tag(buf, "fmt ");
-    write_u32(buf, 16);              // chunk size
-    write_u16(buf, 1);               // PCM format
-    write_u16(buf, static_cast<uint16_t>(channels));
-    write_u32(buf, static_cast<uint32_t>(sample_rate));
-    write_u32(buf, static_cast<uint32_t>(byte_rate));
-    write_u16(buf, static_cast<uint16_t>(block_align));
-    write_u16(buf, static_cast<uint16_t>(bits_per_sample));
+    out = put_tag(out, "fmt ");
+    out = put_u32(out, 16);              // chunk size
+    out = put_u16(out, format);
+    out = put_u16(out, static_cast<uint16_t>(channels));
+    out = put_u32(out, static_cast<uint32_t>(sample_rate));
+    out = put_u32(out, static_cast<uint32_t>(byte_rate));
+    out = put_u16(out, static_cast<uint16_t>(block_align));
+    out = put_u16(out, bits_per_sample);
 
     // data chunk
-    write_tag(buf, "data");
-    write_u32(buf, data_size);
-
-    // Convert float -> int16 and write
-    for (int i = 0; i < samples * channels; ++i) {
-        float clamped = std::fmax(-1.0f, std::fmin(1.0f, data[i]));
-        int16_t val = static_cast<int16_t>(clamped * 32767.0f);
-        buf.push_back(static_cast<uint8_t>(val & 0xFF));
-        buf.push_back(static_cast<uint8_t>((val >> 8) & 0xFF));
-    }
-
-    return buf;
+    out = put_tag(out, "data");
+    put_u32(out, data_size);
 }
 
-std::vector<uint8_t> encode_wav_32f(const float* data, int samples, int sample_rate, int channels) {
-    const int bits_per_sample = 32;
-    const int byte_rate = sample_rate * channels * (bits_per_sample / 8);
-    const int block_align = channels * (bits_per_sample / 8);
-    const uint32_t data_size = static_cast<uint32_t>(samples * channels * (bits_per_sample / 8));
+size_t wav_16_size(int samples, int channels) {
+    return WAV_HEADER_SIZE + static_cast<size_t>(samples) * channels * 2;
+}
 
-    // Header = 44 bytes, total = 44 + data_size
-    std::vector<uint8_t> buf;
-    buf.reserve(44 + data_size);
+size_t encode_wav_16_into(const float* data, int samples, int sample_rate, int channels,
+                          uint8_t* out, size_t capacity) {
+    const size_t total = wav_16_size(samples, channels);
+    if (capacity < total) return 0;
 
-    // RIFF header
-    write_tag(buf, "RIFF");
-    write_u32(buf, 36 + data_size);
-    write_tag(buf, "WAVE");
-
-    // fmt chunk (IEEE float format = 3)
-    write_tag(buf, "fmt ");
-    write_u32(buf, 16);
-    write_u16(buf, 3);               // IEEE float format
-    write_u16(buf, static_cast<uint16_t>(channels));
-    write_u32(buf, static_cast<uint32_t>(sample_rate));
-    write_u32(buf, static_cast<uint32_t>(byte_rate));
-    write_u16(buf, static_cast<uint16_t>(block_align));
-    write_u16(buf, static_cast<uint16_t>(bits_per_sample));
+    write_wav_header(out, static_cast<uint32_t>(total - WAV_HEADER_SIZE), sample_rate, channels,
+                     1, 16);
+    float_to_pcm16(data, static_cast<size_t>(samples) * channels, out + WAV_HEADER_SIZE);
+    return total;
+}
 
-    // data chunk
-    write_tag(buf, "data");
-    write_u32(buf, data_size);
+size_t encode_pcm_16_into(const float* data, int samples, uint8_t* out, size_t capacity) {
+    const size_t total = static_cast<size_t>(samples) * 2;
+    if (capacity < total) return 0;
 
-    // Write float32 samples directly (little-endian, which ARM/x86 are natively)
-    const auto* raw = reinterpret_cast<const uint8_t*>(data);
-    buf.insert(buf.end(), raw, raw + data_size);
+    float_to_pcm16(data, static_cast<size_t>(samples), out);
+    return total;
+}
 
+std::vector<uint8_t> encode_wav_16(const float* data, int samples, int sample_rate, int channels) {
+    std::vector<uint8_t> buf(wav_16_size(samples, channels));
+    encode_wav_16_into(data, samples, sample_rate, channels, buf.data(), buf.size());
     return buf;
 }
 
-std::vector<uint8_t> encode_pcm_16(const float* data, int samples) {
-    std::vector<uint8_t> buf;
-    buf.reserve(samples * 2);
+std::vector<uint8_t> encode_wav_32f(const float* data, int samples, int sample_rate, int channels) {
+    const uint32_t data_size = static_cast<uint32_t>(samples * channels * 4);
 
-    for (int i = 0; i < samples; ++i) {
-        float clamped = std::fmax(-1.0f, std::fmin(1.0f, data[i]));
-        int16_t val = static_cast<int16_t>(clamped * 32767.0f);
-        buf.push_back(static_cast<uint8_t>(val & 0xFF));
-        buf.push_back(static_cast<uint8_t>((val >> 8) & 0xFF));
-    }
+    // Header = 44 bytes, total = 44 + data_size
+    std::vector<uint8_t> buf(WAV_HEADER_SIZE + data_size);
+    write_wav_header(buf.data(), data_size, sample_rate, channels, 3, 32);  // IEEE float
 
+    // Float32 samples are already little-endian
+    std::memcpy(buf.data() + WAV_HEADER_SIZE, data, data_size);
+    return buf;
+}
+
+std::vector<uint8_t> encode_pcm_16(const float* data, int samples) {
+    std::vector<uint8_t> buf(static_cast<size_t>(samples) * 2);
+    encode_pcm_16_into(data, samples, buf.data(), buf.size());
     return buf;
 }
 
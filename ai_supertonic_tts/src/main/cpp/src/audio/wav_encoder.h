@@ -1,15 +1,55 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
 namespace audio {
 
+/**
+ * Size of the canonical RIFF/WAVE header written by the encoders
+ */
+constexpr size_t WAV_HEADER_SIZE = 44;
+
 /**
  * Clip float audio samples in-place to [-1.0, 1.0]
  */
 void clip_audio(float* data, int samples);
 
+/**
+ * Convert float samples to little-endian 16-bit PCM: clamp to [-1, 1],
+ * scale by 32767, truncate (NaN becomes full scale, as with fmin/fmax).
+ * NEON on arm64, SSE2 on x86_64. `out` needs 2 * count bytes and may be
+ * unaligned.
+ */
+void float_to_pcm16(const float* data, size_t count, uint8_t* out);
+
+/**
+ * Write the 44-byte WAV header for `data_size` bytes of sample data.
+ *
+ * @param format 1 = PCM, 3 = IEEE float
+ */
+void write_wav_header(uint8_t* out, uint32_t data_size, int sample_rate, int channels,
+                      uint16_t format, uint16_t bits_per_sample);
+
+/**
+ * Bytes needed by encode_wav_16_into for `samples` frames
+ */
+size_t wav_16_size(int samples, int channels);
+
+/**
+ * Encode as a 16-bit PCM WAV file into caller memory.
+ * Returns bytes written, or 0 if `capacity` is too small.
+ */
+size_t encode_wav_16_into(const float* data, int samples, int sample_rate, int channels,
+                          uint8_t* out, size_t capacity);
+
+/**
+ * Encode as raw 16-bit PCM into caller memory.
+ * Returns bytes written, or 0 if `capacity` is too small.
+ */
+size_t encode_pcm_16_into(const float* data, int samples, uint8_t* out, size_t capacity);
+
 /**
  * Encode float32 audio as 16-bit PCM WAV file bytes.
  * Returns complete WAV file (RIFF header + data).
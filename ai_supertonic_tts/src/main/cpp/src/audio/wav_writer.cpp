@@ -0,0 +1,218 @@
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace audio {
+
+namespace {
+
+constexpr size_t STAGING_SIZE = 128 * 1024;
+constexpr uint32_t UNKNOWN_SIZE = 0xFFFFFFFFu;
+constexpr size_t DS64_SIZE = 28;  // riffSize, dataSize, sampleCount (u64), tableLength (u32)
+
+uint8_t* put(uint8_t* out, const void* data, size_t size) {
+    std::memcpy(out, data, size);
+    return out + size;
+}
+
+template <typename T>
+uint8_t* put(uint8_t* out, T value) {
+    return put(out, &value, sizeof(value));
+}
+
+/**
+ * RIFF/RF64 header with a 28-byte JUNK/ds64 chunk before "fmt ".
+ * `rf64` selects the RF64 form; otherwise 32-bit sizes are used
+ * (UNKNOWN_SIZE when they overflow or are not known yet).
+ */
+void build_header(uint8_t* out, bool rf64, uint64_t data_bytes, uint64_t frames,
+                  int sample_rate, int channels, WavWriter::Encoding encoding) {
+    const bool pcm16 = encoding == WavWriter::Encoding::Pcm16;
+    const uint16_t bits = pcm16 ? 16 : 32;
+    const uint16_t block_align = static_cast<uint16_t>(channels * bits / 8);
+    const uint64_t riff_bytes = WavWriter::HEADER_SIZE - 8 + data_bytes;
+
+    const auto size32 = [rf64](uint64_t size) {
+        return rf64 || size > UNKNOWN_SIZE ? UNKNOWN_SIZE : static_cast<uint32_t>(size);
+    };
+
+    out = put(out, rf64 ? "RF64" : "RIFF", 4);
+    out = put<uint32_t>(out, size32(riff_bytes));
+    out = put(out, "WAVE", 4);
+
+    // Reserved for ds64
+    out = put(out, rf64 ? "ds64" : "JUNK", 4);
+    out = put<uint32_t>(out, DS64_SIZE);
+    uint8_t ds64[DS64_SIZE] = {};
+    if (rf64) {
+        uint8_t* p = put<uint64_t>(ds64, riff_bytes);
+        p = put<uint64_t>(p, data_bytes);
+        put<uint64_t>(p, frames);
+    }
+    out = put(out, ds64, DS64_SIZE);
+
+    out = put(out, "fmt ", 4);
+    out = put<uint32_t>(out, 16);
+    out = put<uint16_t>(out, pcm16 ? 1 : 3);  // PCM / IEEE float
+    out = put<uint16_t>(out, static_cast<uint16_t>(channels));
+    out = put<uint32_t>(out, static_cast<uint32_t>(sample_rate));
+    out = put<uint32_t>(out, static_cast<uint32_t>(sample_rate) * block_align);
+    out = put<uint16_t>(out, block_align);
+    out = put<uint16_t>(out, bits);
+
+    out = put(out, "data", 4);
+    put<uint32_t>(out, size32(data_bytes));
+}
+
+} // namespace
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(int fd, int sample_rate, int channels, Encoding encoding) {
+    close();
+    last_error_.clear();
+    if (fd < 0 || sample_rate <= 0 || channels <= 0) {
+        if (fd >= 0) ::close(fd);
+        last_error_ = "Invalid WAV writer arguments";
+        return false;
+    }
+
+    fd_ = fd;
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    encoding_ = encoding;
+    frames_ = 0;
+    data_bytes_ = 0;
+    staging_.resize(STAGING_SIZE);
+
+    // Placeholder: sizes unknown until close()
+    build_header(staging_.data(), false, UNKNOWN_SIZE, 0, sample_rate_, channels_, encoding_);
+    staged_ = HEADER_SIZE;
+    return true;
+}
+
+bool WavWriter::write(const float* data, size_t frames) {
+    if (fd_ < 0) return false;
+
+    const size_t samples = frames * static_cast<size_t>(channels_);
+    if (encoding_ == Encoding::Float32) {
+        // Float32 is already little-endian: copy into the staging buffer,
+        // or for large blocks hand the caller's memory to writev directly
+        const size_t bytes = samples * sizeof(float);
+        if (staged_ + bytes <= staging_.size()) {
+            std::memcpy(staging_.data() + staged_, data, bytes);
+            staged_ += bytes;
+        } else if (!flush(reinterpret_cast<const uint8_t*>(data), bytes)) {
+            return false;
+        }
+    } else {
+        size_t done = 0;
+        while (done < samples) {
+            if (staged_ + 2 > staging_.size() && !flush()) return false;
+            const size_t n = std::min(samples - done, (staging_.size() - staged_) / 2);
+            float_to_pcm16(data + done, n, staging_.data() + staged_);
+            staged_ += n * 2;
+            done += n;
+        }
+    }
+
+    frames_ += frames;
+    data_bytes_ += samples * (encoding_ == Encoding::Pcm16 ? 2 : 4);
+    return true;
+}
+
+bool WavWriter::write_silence(size_t frames) {
+    if (fd_ < 0) return false;
+
+    size_t bytes = frames * static_cast<size_t>(channels_) * (encoding_ == Encoding::Pcm16 ? 2 : 4);
+    frames_ += frames;
+    data_bytes_ += bytes;
+    while (bytes > 0) {
+        if (staged_ == staging_.size() && !flush()) return false;
+        const size_t n = std::min(bytes, staging_.size() - staged_);
+        std::memset(staging_.data() + staged_, 0, n);
+        staged_ += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool WavWriter::close() {
+    if (fd_ < 0) return last_error_.empty();
+
+    // A failed write() / flush() leaves a gap in the data, so don't
+    // report the file as complete even if the final flush succeeds
+    bool ok = last_error_.empty() && flush() && patch_header();
+    if (::close(fd_) != 0 && ok) ok = fail("close");
+    fd_ = -1;
+
+    std::vector<uint8_t>().swap(staging_);
+    staged_ = 0;
+    return ok;
+}
+
+bool WavWriter::flush(const uint8_t* extra, size_t extra_size) {
+    iovec iov[2];
+    int count = 0;
+    if (staged_ > 0) iov[count++] = {staging_.data(), staged_};
+    if (extra_size > 0) iov[count++] = {const_cast<uint8_t*>(extra), extra_size};
+    if (count == 0) return true;
+
+    staged_ = 0;
+    return write_all(iov, count);
+}
+
+bool WavWriter::write_all(iovec* iov, int count) {
+    while (count > 0) {
+        const ssize_t written = ::writev(fd_, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return fail("writev");
+        }
+
+        // Skip what was written, resume a partially written buffer
+        auto left = static_cast<size_t>(written);
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+bool WavWriter::patch_header() {
+    const bool rf64 = HEADER_SIZE - 8 + data_bytes_ > UNKNOWN_SIZE;
+    uint8_t header[HEADER_SIZE];
+    build_header(header, rf64, data_bytes_, frames_, sample_rate_, channels_, encoding_);
+
+    size_t done = 0;
+    while (done < HEADER_SIZE) {
+        const ssize_t written = ::pwrite(fd_, header + done, HEADER_SIZE - done,
+                                         static_cast<off_t>(done));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            // Pipes and sockets keep the "unknown size" header
+            if (errno == ESPIPE) return true;
+            return fail("pwrite");
+        }
+        done += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool WavWriter::fail(const char* what) {
+    last_error_ = std::string(what) + " failed: " + std::strerror(errno);
+    return false;
+}
+
+} // namespace audio
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "wav_encoder.h"
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Streaming WAV sink writing straight to a file descriptor.
+ *
+ * open() writes a placeholder header, write() appends audio as synthesis
+ * produces it, and close() patches the sizes in place, so memory use is
+ * one staging buffer however long the file gets. Encoded samples are
+ * batched in the staging buffer and flushed with writev(); float32 input
+ * too large for the buffer is written from the caller's memory in the
+ * same writev() call, without a copy.
+ *
+ * The header reserves a JUNK chunk the size of an RF64 ds64 chunk
+ * (EBU Tech 3306). Files that end up over 4 GB are turned into RF64 on
+ * close by renaming RIFF/JUNK to RF64/ds64 and filling in the 64-bit sizes;
+ * smaller files stay plain WAV, which every reader skips JUNK in.
+ *
+ * The sizes are written as 0xFFFFFFFF ("unknown") until close(), so a
+ * non-seekable fd (pipe, socket) still yields a stream players accept.
+ */
+class WavWriter {
+public:
+    enum class Encoding { Pcm16, Float32 };
+
+    WavWriter() = default;
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+    ~WavWriter();
+
+    /**
+     * Start a file on `fd` (positioned at its start; owned from now on).
+     * Returns false and sets last_error() on failure.
+     */
+    bool open(int fd, int sample_rate, int channels, Encoding encoding);
+
+    /**
+     * Append `frames` frames of interleaved float audio. PCM16 output is
+     * clamped to [-1, 1]; float32 is written as is.
+     */
+    bool write(const float* data, size_t frames);
+
+    /**
+     * Append `frames` frames of silence
+     */
+    bool write_silence(size_t frames);
+
+    /**
+     * Flush, patch the header sizes and close the fd. Safe to call twice.
+     * Returns false if this or any earlier write failed (see last_error()).
+     */
+    bool close();
+
+    bool is_open() const { return fd_ >= 0; }
+    int channels() const { return channels_; }
+    uint64_t frames_written() const { return frames_; }
+    const std::string& last_error() const { return last_error_; }
+
+    /** Header bytes before the sample data */
+    static constexpr size_t HEADER_SIZE = 80;
+
+private:
+    bool flush(const uint8_t* extra = nullptr, size_t extra_size = 0);
+    bool write_all(iovec* iov, int count);
+    bool patch_header();
+    bool fail(const char* what);
+
+    int fd_ = -1;
+    int sample_rate_ = 0;
+    int channels_ = 1;
+    Encoding encoding_ = Encoding::Pcm16;
+    uint64_t frames_ = 0;
+    uint64_t data_bytes_ = 0;
+
+    std::vector<uint8_t> staging_;  // Encoded, not yet written
+    size_t staged_ = 0;
+
+    std::string last_error_;
+};
+
+} // namespace audio
@@ -0,0 +1,547 @@
+#include "audio_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tts {
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'T', 'A', 'C'};
+constexpr uint32_t VERSION = 2;  // 2: noise drawn per batch item
+constexpr uint32_t FRAME_SIZE = 4096;
+constexpr char SUFFIX[] = ".stac";
+constexpr size_t SUFFIX_LEN = sizeof(SUFFIX) - 1;
+constexpr size_t NAME_LEN = 32 + SUFFIX_LEN;
+
+// Rice codes: a quotient this long is replaced by an escape and the raw value
+constexpr uint32_t ESCAPE = 24;
+constexpr uint32_t RAW_BITS = 18;     // Zigzagged order-2 residuals of int16 fit
+constexpr uint32_t MAX_ORDER = 2;
+constexpr uint32_t MAX_RICE_K = RAW_BITS - 1;
+
+struct EntryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t frame_size;
+    uint64_t samples;
+    float scale;          // Sample = code * scale / 32767
+    uint32_t frame_count;
+};
+static_assert(sizeof(EntryHeader) == 32, "entry header layout");
+// Followed by uint32 offsets[frame_count + 1] (relative to the frame data),
+// then each frame: u8 predictor order, u8 Rice k, Rice-coded residual bits
+
+// ============================================================================
+// HASHING
+// ============================================================================
+
+constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// ============================================================================
+// FRAME CODEC
+// ============================================================================
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, uint32_t bits) {
+        acc_ = (acc_ << bits) | (value & ((1ULL << bits) - 1));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+    }
+
+    void ones(uint32_t n) {
+        for (; n >= 16; n -= 16) put(0xFFFF, 16);
+        if (n) put((1u << n) - 1, n);
+    }
+
+    void flush() {
+        if (count_) out_.push_back(static_cast<uint8_t>(acc_ << (8 - count_)));
+        count_ = 0;
+        acc_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    uint32_t count_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+    bool get(uint32_t bits, uint32_t& value) {
+        while (count_ < bits) {
+            if (p_ == end_) return false;
+            acc_ = (acc_ << 8) | *p_++;
+            count_ += 8;
+        }
+        count_ -= bits;
+        value = static_cast<uint32_t>(acc_ >> count_) & ((1u << bits) - 1);
+        return true;
+    }
+
+    // Unary run of ones, stopping at `limit` or after the terminating zero
+    bool unary(uint32_t limit, uint32_t& q) {
+        q = 0;
+        uint32_t bit = 0;
+        while (q < limit) {
+            if (!get(1, bit)) return false;
+            if (!bit) return true;
+            ++q;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_ = 0;
+    uint32_t count_ = 0;
+};
+
+inline uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+inline int32_t unzigzag(uint32_t u) { return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1); }
+
+// Fixed polynomial predictors, lower order at the start of a frame
+inline int32_t predict(const int16_t* x, size_t i, uint32_t order) {
+    const uint32_t o = std::min<uint32_t>(order, static_cast<uint32_t>(i));
+    if (o == 0) return 0;
+    if (o == 1) return x[i - 1];
+    return 2 * x[i - 1] - x[i - 2];
+}
+
+void encode_frame(const int16_t* x, size_t n, std::vector<uint8_t>& out) {
+    // Order with the smallest total |residual|
+    uint64_t cost[MAX_ORDER + 1] = {};
+    for (size_t i = 0; i < n; ++i) {
+        for (uint32_t o = 0; o <= MAX_ORDER; ++o) cost[o] += zigzag(x[i] - predict(x, i, o));
+    }
+    uint32_t order = 0;
+    for (uint32_t o = 1; o <= MAX_ORDER; ++o) {
+        if (cost[o] < cost[order]) order = o;
+    }
+    // Rice parameter ~ log2(mean residual)
+    const uint64_t mean = n ? cost[order] / n : 0;
+    uint32_t k = 0;
+    while (k < MAX_RICE_K && (2ULL << k) <= mean) ++k;
+
+    out.push_back(static_cast<uint8_t>(order));
+    out.push_back(static_cast<uint8_t>(k));
+    BitWriter bits(out);
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t u = zigzag(x[i] - predict(x, i, order));
+        const uint32_t q = u >> k;
+        if (q >= ESCAPE) {
+            bits.ones(ESCAPE);
+            bits.put(u, RAW_BITS);
+        } else {
+            bits.ones(q);
+            bits.put(0, 1);
+            if (k) bits.put(u, k);
+        }
+    }
+    bits.flush();
+}
+
+bool decode_frame(const uint8_t* data, size_t size, int16_t* x, size_t n) {
+    if (size < 2 || data[0] > MAX_ORDER || data[1] > MAX_RICE_K) return false;
+    const uint32_t order = data[0];
+    const uint32_t k = data[1];
+    BitReader bits(data + 2, size - 2);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t q = 0;
+        uint32_t u = 0;
+        if (!bits.unary(ESCAPE, q)) return false;
+        if (q == ESCAPE) {
+            if (!bits.get(RAW_BITS, u)) return false;
+        } else {
+            uint32_t low = 0;
+            if (k && !bits.get(k, low)) return false;
+            u = (q << k) | low;
+        }
+        const int32_t v = predict(x, i, order) + unzigzag(u);
+        if (v < INT16_MIN || v > INT16_MAX) return false;
+        x[i] = static_cast<int16_t>(v);
+    }
+    return true;
+}
+
+// ============================================================================
+// FILES
+// ============================================================================
+
+bool write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    // A unique temporary per write: two threads storing the same key must
+    // not interleave into one file before it is renamed into place
+    std::string tmp = path + ".tmp.XXXXXX";
+    const int fd = ::mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd < 0) return false;
+    ::fchmod(fd, 0644);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        const ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if (::close(fd) != 0 || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool is_entry_name(const char* name) {
+    if (std::strlen(name) != NAME_LEN || std::strcmp(name + 32, SUFFIX) != 0) return false;
+    for (size_t i = 0; i < 32; ++i) {
+        const char c = name[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ============================================================================
+// KEY / HASHER
+// ============================================================================
+
+std::string AudioCacheKey::hex() const {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string s(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        s[15 - i] = DIGITS[(hi >> (4 * i)) & 0xF];
+        s[31 - i] = DIGITS[(lo >> (4 * i)) & 0xF];
+    }
+    return s;
+}
+
+void AudioCacheHasher::word(uint64_t w) {
+    a_ = rotl(a_ ^ (w * P2), 31) * P1 + P3;
+    b_ = rotl(b_ ^ (w * P3), 27) * P2 + a_;
+}
+
+AudioCacheHasher& AudioCacheHasher::update(const void* data, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    length_ += bytes;
+    if (tail_size_) {
+        const size_t take = std::min(bytes, sizeof(tail_) - tail_size_);
+        std::memcpy(tail_ + tail_size_, p, take);
+        tail_size_ += take;
+        p += take;
+        bytes -= take;
+        if (tail_size_ < sizeof(tail_)) return *this;
+        uint64_t w = 0;
+        std::memcpy(&w, tail_, sizeof(w));
+        word(w);
+        tail_size_ = 0;
+    }
+    for (; bytes >= 8; p += 8, bytes -= 8) {
+        uint64_t w = 0;
+        std::memcpy(&w, p, sizeof(w));
+        word(w);
+    }
+    std::memcpy(tail_, p, bytes);
+    tail_size_ = bytes;
+    return *this;
+}
+
+AudioCacheKey AudioCacheHasher::digest() const {
+    AudioCacheHasher h = *this;
+    uint64_t w = 0;
+    std::memcpy(&w, h.tail_, h.tail_size_);
+    h.word(w);
+    h.word(length_);
+    AudioCacheKey key;
+    key.hi = fmix64(h.a_ + rotl(h.b_, 17));
+    key.lo = fmix64(h.b_ ^ (h.a_ * P1));
+    return key;
+}
+
+// ============================================================================
+// CODEC
+// ============================================================================
+
+std::vector<uint8_t> encode_cache_entry(const float* pcm, size_t samples, int sample_rate) {
+    // Peak-normalize anything louder than full scale so the limiter applied
+    // after a hit sees the same signal as after synthesis
+    float peak = 0.0f;
+    for (size_t i = 0; i < samples; ++i) peak = std::max(peak, std::fabs(pcm[i]));
+    const float scale = std::isfinite(peak) && peak > 1.0f ? peak : 1.0f;
+    const float gain = 32767.0f / scale;
+
+    EntryHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sample_rate = static_cast<uint32_t>(sample_rate);
+    header.frame_size = FRAME_SIZE;
+    header.samples = samples;
+    header.scale = scale;
+    header.frame_count = static_cast<uint32_t>((samples + FRAME_SIZE - 1) / FRAME_SIZE);
+
+    const size_t table_bytes = (header.frame_count + 1) * sizeof(uint32_t);
+    std::vector<uint8_t> out(sizeof(header) + table_bytes);
+    std::memcpy(out.data(), &header, sizeof(header));
+    out.reserve(out.size() + samples + samples / 2);
+
+    std::vector<uint32_t> offsets;
+    offsets.reserve(header.frame_count + 1);
+    int16_t frame[FRAME_SIZE];
+    const size_t data_start = out.size();
+    for (size_t start = 0; start < samples; start += FRAME_SIZE) {
+        const size_t n = std::min<size_t>(FRAME_SIZE, samples - start);
+        for (size_t i = 0; i < n; ++i) {
+            const float v = std::isfinite(pcm[start + i]) ? pcm[start + i] * gain : 0.0f;
+            frame[i] = static_cast<int16_t>(std::lrint(std::min(32767.0f, std::max(-32767.0f, v))));
+        }
+        offsets.push_back(static_cast<uint32_t>(out.size() - data_start));
+        encode_frame(frame, n, out);
+    }
+    offsets.push_back(static_cast<uint32_t>(out.size() - data_start));
+    std::memcpy(out.data() + sizeof(header), offsets.data(), table_bytes);
+    return out;
+}
+
+bool decode_cache_entry(const uint8_t* data, size_t size, int sample_rate, std::vector<float>& pcm) {
+    EntryHeader header{};
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.sample_rate != static_cast<uint32_t>(sample_rate) || header.frame_size != FRAME_SIZE ||
+        header.frame_count != (header.samples + FRAME_SIZE - 1) / FRAME_SIZE ||
+        !(header.scale >= 1.0f) || !std::isfinite(header.scale)) {
+        return false;
+    }
+    const size_t table_bytes = (static_cast<size_t>(header.frame_count) + 1) * sizeof(uint32_t);
+    if (size - sizeof(header) < table_bytes) return false;
+    const uint8_t* table = data + sizeof(header);
+    const uint8_t* frames = table + table_bytes;
+    const size_t frames_size = size - sizeof(header) - table_bytes;
+
+    pcm.resize(header.samples);
+    const float gain = header.scale / 32767.0f;
+    int16_t frame[FRAME_SIZE];
+    for (uint32_t f = 0; f < header.frame_count; ++f) {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        std::memcpy(&begin, table + f * sizeof(uint32_t), sizeof(begin));
+        std::memcpy(&end, table + (f + 1) * sizeof(uint32_t), sizeof(end));
+        if (begin > end || end > frames_size) return false;
+        const size_t start = static_cast<size_t>(f) * FRAME_SIZE;
+        const size_t n = std::min<size_t>(FRAME_SIZE, header.samples - start);
+        if (!decode_frame(frames + begin, end - begin, frame, n)) return false;
+        for (size_t i = 0; i < n; ++i) pcm[start + i] = frame[i] * gain;
+    }
+    return true;
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+
+AudioCache::AudioCache(const AudioCacheOptions& options) : options_(options) {
+    seed_.values(std::vector<char>(options_.model_id.begin(), options_.model_id.end()));
+    seed_.value(static_cast<int32_t>(options_.sample_rate));
+    if (!options_.directory.empty()) {
+        ::mkdir(options_.directory.c_str(), 0755);
+        scan_disk();
+    }
+}
+
+std::string AudioCache::path_for(const AudioCacheKey& key) const {
+    return options_.directory + "/" + key.hex() + SUFFIX;
+}
+
+void AudioCache::scan_disk() {
+    DIR* dir = ::opendir(options_.directory.c_str());
+    if (!dir) return;
+    struct Found {
+        std::string name;
+        uint64_t bytes;
+        int64_t mtime;
+    };
+    std::vector<Found> found;
+    while (const dirent* e = ::readdir(dir)) {
+        const std::string path = options_.directory + "/" + e->d_name;
+        if (!is_entry_name(e->d_name)) {
+            // Leftovers of an interrupted write
+            if (std::strstr(e->d_name, ".tmp.") != nullptr) ::unlink(path.c_str());
+            continue;
+        }
+        struct stat st {};
+        if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        found.push_back({e->d_name, static_cast<uint64_t>(st.st_size),
+                         static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec});
+    }
+    ::closedir(dir);
+
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.mtime > b.mtime; });
+    for (Found& f : found) {
+        disk_.push_back({std::move(f.name), f.bytes});
+        disk_index_[disk_.back().name] = std::prev(disk_.end());
+        disk_used_ += f.bytes;
+    }
+    trim_disk();
+}
+
+void AudioCache::trim_disk() {
+    while (disk_used_ > options_.disk_bytes && !disk_.empty()) {
+        const DiskEntry& oldest = disk_.back();
+        ::unlink((options_.directory + "/" + oldest.name).c_str());
+        disk_used_ -= oldest.bytes;
+        disk_index_.erase(oldest.name);
+        disk_.pop_back();
+    }
+}
+
+void AudioCache::remember(const AudioCacheKey& key, std::vector<float> pcm) {
+    const size_t bytes = pcm.size() * sizeof(float);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        memory_used_ -= it->second->pcm.size() * sizeof(float);
+        memory_.erase(it->second);
+        index_.erase(it);
+    }
+    if (bytes > options_.memory_bytes) return;
+
+    memory_.push_front({key, std::move(pcm)});
+    index_[key] = memory_.begin();
+    memory_used_ += bytes;
+    while (memory_used_ > options_.memory_bytes) {
+        const MemoryEntry& oldest = memory_.back();
+        memory_used_ -= oldest.pcm.size() * sizeof(float);
+        index_.erase(oldest.key);
+        memory_.pop_back();
+    }
+}
+
+bool AudioCache::get(const AudioCacheKey& key, std::vector<float>& pcm) {
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            memory_.splice(memory_.begin(), memory_, it->second);
+            pcm = it->second->pcm;
+            ++stats_.memory_hits;
+            return true;
+        }
+        name = key.hex() + SUFFIX;
+        if (disk_index_.find(name) == disk_index_.end()) {
+            ++stats_.misses;
+            return false;
+        }
+    }
+
+    // Decode outside the lock; a file evicted meanwhile is just a miss
+    const std::string path = options_.directory + "/" + name;
+    bool ok = false;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            const size_t size = static_cast<size_t>(st.st_size);
+            void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                ok = decode_cache_entry(static_cast<const uint8_t*>(map), size, options_.sample_rate, pcm);
+                ::munmap(map, size);
+            }
+        }
+        if (ok) ::futimens(fd, nullptr);  // mtime orders the LRU across runs
+        ::close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = disk_index_.find(name);
+    if (!ok) {
+        if (it != disk_index_.end()) {
+            ::unlink(path.c_str());
+            disk_used_ -= it->second->bytes;
+            disk_.erase(it->second);
+            disk_index_.erase(it);
+        }
+        ++stats_.misses;
+        return false;
+    }
+    if (it != disk_index_.end()) disk_.splice(disk_.begin(), disk_, it->second);
+    remember(key, pcm);
+    ++stats_.disk_hits;
+    return true;
+}
+
+void AudioCache::put(const AudioCacheKey& key, const float* pcm, size_t samples) {
+    if (!pcm || samples == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remember(key, std::vector<float>(pcm, pcm + samples));
+    }
+    if (options_.directory.empty() || options_.disk_bytes == 0) return;
+
+    const std::vector<uint8_t> bytes = encode_cache_entry(pcm, samples, options_.sample_rate);
+    if (bytes.size() > options_.disk_bytes || !write_file(path_for(key), bytes)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string name = key.hex() + SUFFIX;
+    auto it = disk_index_.find(name);
+    if (it != disk_index_.end()) {
+        disk_used_ -= it->second->bytes;
+        disk_.erase(it->second);
+    }
+    disk_.push_front({name, bytes.size()});
+    disk_index_[name] = disk_.begin();
+    disk_used_ += bytes.size();
+    trim_disk();
+}
+
+void AudioCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_.clear();
+    index_.clear();
+    memory_used_ = 0;
+    for (const DiskEntry& e : disk_) ::unlink((options_.directory + "/" + e.name).c_str());
+    disk_.clear();
+    disk_index_.clear();
+    disk_used_ = 0;
+}
+
+AudioCache::Stats AudioCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.memory_bytes = memory_used_;
+    s.disk_bytes = disk_used_;
+    return s;
+}
+
+} // namespace tts
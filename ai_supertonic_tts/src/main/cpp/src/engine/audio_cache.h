@@ -0,0 +1,148 @@
+#pragma once
+
+/**
+ * Content-addressed cache of synthesized utterances.
+ *
+ * Entries are keyed by a 128-bit hash of everything that determines the
+ * audio (indexed text, voice style tensors, steps, speed, seed and the
+ * model), so a repeated phrase skips the diffusion loop and vocoder.
+ *
+ * Two tiers:
+ * - memory: LRU of float PCM, bounded in bytes
+ * - disk (optional): one file per entry, 16-bit samples scaled to the
+ *   entry's peak and coded losslessly per 4096-sample frame (fixed
+ *   predictor + Rice codes). Files are mmapped and decoded on a hit;
+ *   the directory is an LRU by mtime, bounded in bytes.
+ *
+ * Thread-safe. JNI-free.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tts {
+
+struct AudioCacheKey {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const AudioCacheKey& o) const { return hi == o.hi && lo == o.lo; }
+    std::string hex() const;
+};
+
+/**
+ * Streaming 128-bit hash (not cryptographic)
+ */
+class AudioCacheHasher {
+public:
+    AudioCacheHasher& update(const void* data, size_t bytes);
+
+    template <typename T>
+    AudioCacheHasher& value(const T& v) { return update(&v, sizeof(v)); }
+
+    template <typename T>
+    AudioCacheHasher& values(const std::vector<T>& v) {
+        value(static_cast<uint64_t>(v.size()));
+        return update(v.data(), v.size() * sizeof(T));
+    }
+
+    AudioCacheKey digest() const;
+
+private:
+    void word(uint64_t w);
+
+    uint64_t a_ = 0x9E3779B97F4A7C15ULL;
+    uint64_t b_ = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t length_ = 0;
+    uint8_t tail_[8] = {};
+    size_t tail_size_ = 0;
+};
+
+struct AudioCacheOptions {
+    int sample_rate = 44100;
+    size_t memory_bytes = 16u << 20;
+    std::string directory;           // Empty: memory only
+    uint64_t disk_bytes = 64u << 20;
+    std::string model_id;            // Mixed into every key
+};
+
+class AudioCache {
+public:
+    explicit AudioCache(const AudioCacheOptions& options);
+    AudioCache(const AudioCache&) = delete;
+    AudioCache& operator=(const AudioCache&) = delete;
+
+    /**
+     * A hasher already seeded with the model id and sample rate; add the
+     * synthesis inputs and digest() it
+     */
+    AudioCacheHasher hasher() const { return seed_; }
+
+    /**
+     * Memory, then disk (a disk hit is promoted to memory)
+     */
+    bool get(const AudioCacheKey& key, std::vector<float>& pcm);
+
+    void put(const AudioCacheKey& key, const float* pcm, size_t samples);
+
+    /** Drop every entry, including the files */
+    void clear();
+
+    struct Stats {
+        uint64_t memory_hits = 0;
+        uint64_t disk_hits = 0;
+        uint64_t misses = 0;
+        size_t memory_bytes = 0;
+        uint64_t disk_bytes = 0;
+    };
+    Stats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const AudioCacheKey& k) const { return static_cast<size_t>(k.lo); }
+    };
+
+    struct MemoryEntry {
+        AudioCacheKey key;
+        std::vector<float> pcm;
+    };
+
+    struct DiskEntry {
+        std::string name;
+        uint64_t bytes;
+    };
+
+    // Callers hold mutex_
+    void remember(const AudioCacheKey& key, std::vector<float> pcm);
+    void trim_disk();
+    void scan_disk();
+    std::string path_for(const AudioCacheKey& key) const;
+
+    AudioCacheOptions options_;
+    AudioCacheHasher seed_;
+
+    mutable std::mutex mutex_;
+    std::list<MemoryEntry> memory_;  // Most recent first
+    std::unordered_map<AudioCacheKey, std::list<MemoryEntry>::iterator, KeyHash> index_;
+    size_t memory_used_ = 0;
+
+    std::list<DiskEntry> disk_;      // Most recent first
+    std::unordered_map<std::string, std::list<DiskEntry>::iterator> disk_index_;
+    uint64_t disk_used_ = 0;
+
+    Stats stats_;
+};
+
+/**
+ * Disk entry codec, exposed for tools: file bytes for `pcm`, and back
+ * (false if `data` is malformed or not at `sample_rate`)
+ */
+std::vector<uint8_t> encode_cache_entry(const float* pcm, size_t samples, int sample_rate);
+bool decode_cache_entry(const uint8_t* data, size_t size, int sample_rate, std::vector<float>& pcm);
+
+} // namespace tts
@@ -0,0 +1,359 @@
+#include "gaussian_noise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tts {
+
+namespace {
+
+// Philox4x32 multipliers and Weyl key increments
+constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+constexpr int PHILOX_ROUNDS = 10;
+
+constexpr size_t GROUP_VALUES = 16;  // 4 blocks of 4 words, one per SIMD lane
+constexpr float TWO_POW_M24 = 1.0f / 16777216.0f;
+
+// logf on [sqrt(1/2), sqrt(2)) (Cephes), ~1 ulp
+constexpr float LOG_P[9] = {
+        7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+        -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+        2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f,
+};
+constexpr float SQRT_HALF = 0.707106781186547524f;
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+
+// sinf/cosf on [-pi/4, pi/4] (Cephes)
+constexpr float SIN_P0 = -1.9515295891e-4f;
+constexpr float SIN_P1 = 8.3321608736e-3f;
+constexpr float SIN_P2 = -1.6666654611e-1f;
+constexpr float COS_P0 = 2.443315711809948e-5f;
+constexpr float COS_P1 = -1.388731625493765e-3f;
+constexpr float COS_P2 = 4.166664568298827e-2f;
+constexpr float HALF_PI = 1.57079632679489661923f;
+
+#if defined(__aarch64__)
+
+// 32x32 -> 64-bit products of every lane with m, split into halves
+inline void mul_hilo(uint32x4_t a, uint32_t m, uint32x4_t& hi, uint32x4_t& lo) {
+    const uint32x4_t p01 = vreinterpretq_u32_u64(vmull_n_u32(vget_low_u32(a), m));
+    const uint32x4_t p23 = vreinterpretq_u32_u64(vmull_high_n_u32(a, m));
+    lo = vuzp1q_u32(p01, p23);
+    hi = vuzp2q_u32(p01, p23);
+}
+
+inline float32x4_t log_ps(float32x4_t x) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+    int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(126));
+    float32x4_t m = vreinterpretq_f32_u32(
+            vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x807FFFFF)), vdupq_n_u32(0x3F000000)));
+
+    // Mantissa into [sqrt(1/2), sqrt(2)): m < sqrt(1/2) doubles it
+    const uint32x4_t small = vcltq_f32(m, vdupq_n_f32(SQRT_HALF));
+    e = vsubq_s32(e, vreinterpretq_s32_u32(vandq_u32(small, vdupq_n_u32(1))));
+    const float32x4_t extra = vreinterpretq_f32_u32(vandq_u32(small, vreinterpretq_u32_f32(m)));
+    m = vsubq_f32(vaddq_f32(m, extra), one);
+    const float32x4_t fe = vcvtq_f32_s32(e);
+
+    const float32x4_t z = vmulq_f32(m, m);
+    float32x4_t y = vdupq_n_f32(LOG_P[0]);
+    for (int i = 1; i < 9; ++i) y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(LOG_P[i]));
+    y = vmulq_f32(m, vmulq_f32(z, y));
+    y = vaddq_f32(y, vmulq_f32(fe, vdupq_n_f32(LN2_LO)));
+    y = vsubq_f32(y, vmulq_f32(z, vdupq_n_f32(0.5f)));
+    return vaddq_f32(vaddq_f32(m, y), vmulq_f32(fe, vdupq_n_f32(LN2_HI)));
+}
+
+// sin and cos of 2 pi u, u in [0, 1)
+inline void sincos_2pi_ps(float32x4_t u, float32x4_t& s_out, float32x4_t& c_out) {
+    const float32x4_t v = vmulq_f32(u, vdupq_n_f32(4.0f));
+    const int32x4_t k = vcvtq_s32_f32(vaddq_f32(v, vdupq_n_f32(0.5f)));
+    const float32x4_t x = vmulq_f32(vsubq_f32(v, vcvtq_f32_s32(k)), vdupq_n_f32(HALF_PI));
+    const float32x4_t z = vmulq_f32(x, x);
+
+    float32x4_t s = vaddq_f32(vmulq_f32(vdupq_n_f32(SIN_P0), z), vdupq_n_f32(SIN_P1));
+    s = vaddq_f32(vmulq_f32(s, z), vdupq_n_f32(SIN_P2));
+    s = vaddq_f32(vmulq_f32(vmulq_f32(s, z), x), x);
+
+    float32x4_t c = vaddq_f32(vmulq_f32(vdupq_n_f32(COS_P0), z), vdupq_n_f32(COS_P1));
+    c = vaddq_f32(vmulq_f32(c, z), vdupq_n_f32(COS_P2));
+    c = vmulq_f32(vmulq_f32(c, z), z);
+    c = vaddq_f32(vsubq_f32(c, vmulq_f32(z, vdupq_n_f32(0.5f))), vdupq_n_f32(1.0f));
+
+    // Quadrant k: odd swaps sin/cos, then sign flips
+    const uint32x4_t swap = vtstq_s32(k, vdupq_n_s32(1));
+    const uint32x4_t sin_sign = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(k), vdupq_n_u32(2)), 30);
+    const uint32x4_t cos_sign = vshlq_n_u32(
+            vandq_u32(vreinterpretq_u32_s32(vaddq_s32(k, vdupq_n_s32(1))), vdupq_n_u32(2)), 30);
+    s_out = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, c, s)), sin_sign));
+    c_out = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, s, c)), cos_sign));
+}
+
+// Blocks 4g .. 4g+3, one per lane, as 16 normals in block order
+void normals16(const Philox& philox, uint64_t group, float* out) {
+    const uint64_t first = group * 4;
+    const uint32_t base[4] = {0, 1, 2, 3};
+    uint32x4_t c0 = vaddq_u32(vdupq_n_u32(static_cast<uint32_t>(first)), vld1q_u32(base));
+    uint32x4_t c1 = vdupq_n_u32(static_cast<uint32_t>(first >> 32));
+    uint32x4_t c2 = vdupq_n_u32(static_cast<uint32_t>(philox.stream()));
+    uint32x4_t c3 = vdupq_n_u32(static_cast<uint32_t>(philox.stream() >> 32));
+    uint32_t k0 = static_cast<uint32_t>(philox.seed());
+    uint32_t k1 = static_cast<uint32_t>(philox.seed() >> 32);
+
+    for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+        uint32x4_t hi0, lo0, hi1, lo1;
+        mul_hilo(c0, PHILOX_M0, hi0, lo0);
+        mul_hilo(c2, PHILOX_M1, hi1, lo1);
+        c0 = veorq_u32(veorq_u32(hi1, c1), vdupq_n_u32(k0));
+        c1 = lo1;
+        c2 = veorq_u32(veorq_u32(hi0, c3), vdupq_n_u32(k1));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Word pairs (0, 1) and (2, 3) -> Box-Muller; u1 in (0, 1], u2 in [0, 1)
+    const float32x4_t scale = vdupq_n_f32(TWO_POW_M24);
+    const uint32x4_t one = vdupq_n_u32(1);
+    float32x4x4_t z;
+    const uint32x4_t words[4] = {c0, c1, c2, c3};
+    for (int p = 0; p < 2; ++p) {
+        const float32x4_t u1 = vmulq_f32(
+                vcvtq_f32_u32(vaddq_u32(vshrq_n_u32(words[2 * p], 8), one)), scale);
+        const float32x4_t u2 = vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(words[2 * p + 1], 8)), scale);
+        const float32x4_t r = vsqrtq_f32(vmulq_f32(vdupq_n_f32(-2.0f), log_ps(u1)));
+        float32x4_t s, c;
+        sincos_2pi_ps(u2, s, c);
+        z.val[2 * p] = vmulq_f32(r, c);
+        z.val[2 * p + 1] = vmulq_f32(r, s);
+    }
+    vst4q_f32(out, z);  // Interleave: lane j's four values are block 4g+j
+}
+
+#elif defined(__SSE2__)
+
+inline void mul_hilo(__m128i a, uint32_t m, __m128i& hi, __m128i& lo) {
+    const __m128i mv = _mm_set1_epi32(static_cast<int>(m));
+    const __m128i p02 = _mm_mul_epu32(a, mv);
+    const __m128i p13 = _mm_mul_epu32(_mm_srli_epi64(a, 32), mv);
+    lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(p02, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(p13, _MM_SHUFFLE(0, 0, 2, 0)));
+    hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(p02, _MM_SHUFFLE(0, 0, 3, 1)),
+                            _mm_shuffle_epi32(p13, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 log_ps(__m128 x) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i bits = _mm_castps_si128(x);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x807FFFFF)),
+                                             _mm_set1_epi32(0x3F000000)));
+
+    // Mantissa into [sqrt(1/2), sqrt(2)): m < sqrt(1/2) doubles it
+    const __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(SQRT_HALF));
+    e = _mm_add_epi32(e, _mm_castps_si128(small));  // -1 where small
+    m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(small, m)), one);
+    const __m128 fe = _mm_cvtepi32_ps(e);
+
+    const __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(LOG_P[0]);
+    for (int i = 1; i < 9; ++i) y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P[i]));
+    y = _mm_mul_ps(m, _mm_mul_ps(z, y));
+    y = _mm_add_ps(y, _mm_mul_ps(fe, _mm_set1_ps(LN2_LO)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(fe, _mm_set1_ps(LN2_HI)));
+}
+
+inline void sincos_2pi_ps(__m128 u, __m128& s_out, __m128& c_out) {
+    const __m128 v = _mm_mul_ps(u, _mm_set1_ps(4.0f));
+    const __m128i k = _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+    const __m128 x = _mm_mul_ps(_mm_sub_ps(v, _mm_cvtepi32_ps(k)), _mm_set1_ps(HALF_PI));
+    const __m128 z = _mm_mul_ps(x, x);
+
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_P2));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_P2));
+    c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // Quadrant k: odd swaps sin/cos, then sign flips
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, one), one));
+    const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(k, two), 30));
+    const __m128 cos_sign = _mm_castsi128_ps(
+            _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(k, one), two), 30));
+    s_out = _mm_xor_ps(select_ps(swap, c, s), sin_sign);
+    c_out = _mm_xor_ps(select_ps(swap, s, c), cos_sign);
+}
+
+void normals16(const Philox& philox, uint64_t group, float* out) {
+    const uint64_t first = group * 4;
+    __m128i c0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(first))),
+                               _mm_setr_epi32(0, 1, 2, 3));
+    __m128i c1 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(first >> 32)));
+    __m128i c2 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(philox.stream())));
+    __m128i c3 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(philox.stream() >> 32)));
+    uint32_t k0 = static_cast<uint32_t>(philox.seed());
+    uint32_t k1 = static_cast<uint32_t>(philox.seed() >> 32);
+
+    for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+        __m128i hi0, lo0, hi1, lo1;
+        mul_hilo(c0, PHILOX_M0, hi0, lo0);
+        mul_hilo(c2, PHILOX_M1, hi1, lo1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(static_cast<int>(k0)));
+        c1 = lo1;
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(static_cast<int>(k1)));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Word pairs (0, 1) and (2, 3) -> Box-Muller; u1 in (0, 1], u2 in [0, 1).
+    // 24-bit values convert exactly as signed ints.
+    const __m128 scale = _mm_set1_ps(TWO_POW_M24);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i words[4] = {c0, c1, c2, c3};
+    __m128 z[4];
+    for (int p = 0; p < 2; ++p) {
+        const __m128 u1 = _mm_mul_ps(
+                _mm_cvtepi32_ps(_mm_add_epi32(_mm_srli_epi32(words[2 * p], 8), one)), scale);
+        const __m128 u2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(words[2 * p + 1], 8)), scale);
+        const __m128 r = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), log_ps(u1)));
+        __m128 s, c;
+        sincos_2pi_ps(u2, s, c);
+        z[2 * p] = _mm_mul_ps(r, c);
+        z[2 * p + 1] = _mm_mul_ps(r, s);
+    }
+
+    // Transpose so each block's four values are contiguous
+    _MM_TRANSPOSE4_PS(z[0], z[1], z[2], z[3]);
+    for (int j = 0; j < 4; ++j) _mm_storeu_ps(out + 4 * j, z[j]);
+}
+
+#else
+
+float log_scalar(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int e = static_cast<int>(bits >> 23) - 126;
+    bits = (bits & 0x807FFFFF) | 0x3F000000;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if (m < SQRT_HALF) {
+        e -= 1;
+        m = m + m - 1.0f;
+    } else {
+        m = m - 1.0f;
+    }
+    const float fe = static_cast<float>(e);
+
+    const float z = m * m;
+    float y = LOG_P[0];
+    for (int i = 1; i < 9; ++i) y = y * m + LOG_P[i];
+    y = m * (z * y);
+    y += fe * LN2_LO;
+    y -= z * 0.5f;
+    return m + y + fe * LN2_HI;
+}
+
+void sincos_2pi_scalar(float u, float& s_out, float& c_out) {
+    const float v = u * 4.0f;
+    const int k = static_cast<int>(v + 0.5f);
+    const float x = (v - static_cast<float>(k)) * HALF_PI;
+    const float z = x * x;
+    const float s = ((SIN_P0 * z + SIN_P1) * z + SIN_P2) * z * x + x;
+    const float c = ((COS_P0 * z + COS_P1) * z + COS_P2) * z * z - z * 0.5f + 1.0f;
+    s_out = (k & 1) ? c : s;
+    c_out = (k & 1) ? s : c;
+    if (k & 2) s_out = -s_out;
+    if ((k + 1) & 2) c_out = -c_out;
+}
+
+void normals16(const Philox& philox, uint64_t group, float* out) {
+    for (int j = 0; j < 4; ++j) {
+        uint32_t w[4];
+        philox.block(group * 4 + j, w);
+        for (int p = 0; p < 2; ++p) {
+            const float u1 = static_cast<float>((w[2 * p] >> 8) + 1) * TWO_POW_M24;
+            const float u2 = static_cast<float>(w[2 * p + 1] >> 8) * TWO_POW_M24;
+            const float r = std::sqrt(-2.0f * log_scalar(u1));
+            float s, c;
+            sincos_2pi_scalar(u2, s, c);
+            out[4 * j + 2 * p] = r * c;
+            out[4 * j + 2 * p + 1] = r * s;
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+void Philox::block(uint64_t index, uint32_t out[4]) const {
+    uint32_t c0 = static_cast<uint32_t>(index);
+    uint32_t c1 = static_cast<uint32_t>(index >> 32);
+    uint32_t c2 = static_cast<uint32_t>(stream_);
+    uint32_t c3 = static_cast<uint32_t>(stream_ >> 32);
+    uint32_t k0 = static_cast<uint32_t>(seed_);
+    uint32_t k1 = static_cast<uint32_t>(seed_ >> 32);
+
+    for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+        const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0;
+        const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2;
+        c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        c1 = static_cast<uint32_t>(p1);
+        c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c3 = static_cast<uint32_t>(p0);
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void fill_gaussian(float* data, size_t count, uint64_t seed, uint64_t stream, uint64_t offset) {
+    const Philox philox(seed, stream);
+    float partial[GROUP_VALUES];
+
+    size_t done = 0;
+    while (done < count) {
+        const uint64_t pos = offset + done;
+        const uint64_t group = pos / GROUP_VALUES;
+        const size_t skip = static_cast<size_t>(pos % GROUP_VALUES);
+        const size_t take = std::min(GROUP_VALUES - skip, count - done);
+
+        if (take == GROUP_VALUES) {
+            normals16(philox, group, data + done);
+        } else {
+            // Unaligned head or short tail: same kernel, copy the part needed
+            normals16(philox, group, partial);
+            std::memcpy(data + done, partial + skip, take * sizeof(float));
+        }
+        done += take;
+    }
+}
+
+} // namespace tts
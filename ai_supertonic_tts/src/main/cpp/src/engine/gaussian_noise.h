@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * Reproducible standard normal noise for latent initialization.
+ *
+ * Philox4x32-10 is a counter-based generator: block n of a stream is a
+ * pure function of (key, n), so any value can be produced without
+ * generating the ones before it, and blocks are independent (4 run side
+ * by side in SIMD lanes). Each block's four 32-bit words give two
+ * Box-Muller pairs, computed with polynomial log/sin/cos and a hardware
+ * square root, 16 values per iteration with NEON (arm64) or SSE2
+ * (x86_64).
+ *
+ * Value i of (seed, stream) is always the same, however the buffer is
+ * split across calls. JNI-free: usable by any native diffusion loop.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tts {
+
+/**
+ * Philox4x32-10 with a 64-bit key (the seed) and 128-bit counter
+ * (64-bit stream id, 64-bit block index)
+ */
+class Philox {
+public:
+    explicit Philox(uint64_t seed, uint64_t stream = 0) : seed_(seed), stream_(stream) {}
+
+    /**
+     * The four words of block `index`
+     */
+    void block(uint64_t index, uint32_t out[4]) const;
+
+    uint64_t seed() const { return seed_; }
+    uint64_t stream() const { return stream_; }
+
+private:
+    uint64_t seed_;
+    uint64_t stream_;
+};
+
+/**
+ * Fill data[0, count) with N(0, 1) values `offset` to `offset + count`
+ * of (seed, stream).
+ */
+void fill_gaussian(float* data, size_t count, uint64_t seed, uint64_t stream = 0,
+                   uint64_t offset = 0);
+
+} // namespace tts
@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * Thin RAII layer over the ONNX Runtime C API.
+ *
+ * Every ORT object is held in an OrtHandle<T> that calls the matching
+ * Release function. ort_check() turns a failed OrtStatus into a
+ * std::runtime_error; the pipeline catches it at its public boundary, so
+ * nothing throws across JNI.
+ */
+
+#include <onnxruntime_c_api.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace tts {
+
+inline const OrtApi* ort_api() {
+    static const OrtApi* api = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+    return api;
+}
+
+inline void ort_check(OrtStatus* status) {
+    if (!status) return;
+    std::string message = ort_api()->GetErrorMessage(status);
+    ort_api()->ReleaseStatus(status);
+    throw std::runtime_error(message);
+}
+
+template <typename T> struct OrtRelease;
+
+#define TTS_ORT_RELEASE(Type, Fn)                                       \
+    template <> struct OrtRelease<Type> {                               \
+        void operator()(Type* p) const { if (p) ort_api()->Fn(p); }     \
+    };
+
+TTS_ORT_RELEASE(OrtEnv, ReleaseEnv)
+TTS_ORT_RELEASE(OrtSession, ReleaseSession)
+TTS_ORT_RELEASE(OrtSessionOptions, ReleaseSessionOptions)
+TTS_ORT_RELEASE(OrtValue, ReleaseValue)
+TTS_ORT_RELEASE(OrtMemoryInfo, ReleaseMemoryInfo)
+TTS_ORT_RELEASE(OrtIoBinding, ReleaseIoBinding)
+TTS_ORT_RELEASE(OrtRunOptions, ReleaseRunOptions)
+TTS_ORT_RELEASE(OrtTensorTypeAndShapeInfo, ReleaseTensorTypeAndShapeInfo)
+
+#undef TTS_ORT_RELEASE
+
+template <typename T>
+using OrtHandle = std::unique_ptr<T, OrtRelease<T>>;
+
+/**
+ * Wrap caller-owned memory as a CPU tensor (no copy). The memory must
+ * outlive the returned value and must not be reallocated while bound.
+ */
+template <typename T>
+OrtHandle<OrtValue> make_tensor(const OrtMemoryInfo* mem, T* data, size_t count,
+                                const int64_t* shape, size_t rank,
+                                ONNXTensorElementDataType type) {
+    OrtValue* value = nullptr;
+    ort_check(ort_api()->CreateTensorWithDataAsOrtValue(
+            mem, data, count * sizeof(T), shape, rank, type, &value));
+    return OrtHandle<OrtValue>(value);
+}
+
+inline size_t tensor_element_count(const OrtValue* value) {
+    OrtTensorTypeAndShapeInfo* raw = nullptr;
+    ort_check(ort_api()->GetTensorTypeAndShape(value, &raw));
+    OrtHandle<OrtTensorTypeAndShapeInfo> info(raw);
+
+    size_t count = 0;
+    ort_check(ort_api()->GetTensorShapeElementCount(info.get(), &count));
+    return count;
+}
+
+inline float* tensor_data(OrtValue* value) {
+    void* data = nullptr;
+    ort_check(ort_api()->GetTensorMutableData(value, &data));
+    return static_cast<float*>(data);
+}
+
+} // namespace tts
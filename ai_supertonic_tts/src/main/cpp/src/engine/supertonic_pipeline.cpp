@@ -0,0 +1,570 @@
+#include "supertonic_pipeline.h"
+#include "../utils/logger.h"
+
+#ifdef __ANDROID__
+#include <nnapi_provider_factory.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace tts {
+
+namespace {
+
+constexpr float PI = 3.14159265358979323846f;
+
+void clear_binding(OrtIoBinding* binding) {
+    if (!binding) return;
+    ort_api()->ClearBoundInputs(binding);
+    ort_api()->ClearBoundOutputs(binding);
+}
+
+void bind_input(OrtIoBinding* binding, const char* name, const OrtHandle<OrtValue>& value) {
+    ort_check(ort_api()->BindInput(binding, name, value.get()));
+}
+
+OrtHandle<OrtIoBinding> create_binding(OrtSession* session) {
+    OrtIoBinding* binding = nullptr;
+    ort_check(ort_api()->CreateIoBinding(session, &binding));
+    return OrtHandle<OrtIoBinding>(binding);
+}
+
+template <typename T>
+void release_vector(std::vector<T>& v) {
+    std::vector<T>().swap(v);
+}
+
+// Philox stream id of one utterance: FNV-1a over its text ids, so its noise
+// depends on what it says rather than where it sits in a batch
+uint64_t noise_stream(const TextInput& text) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < text.len; ++i) {
+        h = (h ^ static_cast<uint64_t>(text.ids[i])) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+// ============================================================================
+// LOADING
+// ============================================================================
+
+bool SupertonicPipeline::load(const std::string& onnx_dir, const ModelConfig& config,
+                              const SessionSettings& settings) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    reset_locked();
+
+    const OrtApi* api = ort_api();
+    try {
+        config_ = config;
+
+        OrtEnv* env = nullptr;
+        ort_check(api->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "supertonic", &env));
+        env_.reset(env);
+
+        OrtMemoryInfo* cpu = nullptr;
+        ort_check(api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &cpu));
+        cpu_.reset(cpu);
+
+        OrtRunOptions* run_options = nullptr;
+        ort_check(api->CreateRunOptions(&run_options));
+        run_options_.reset(run_options);
+
+        ort_check(api->GetAllocatorWithDefaultOptions(&allocator_));
+
+        OrtSessionOptions* raw_options = nullptr;
+        ort_check(api->CreateSessionOptions(&raw_options));
+        OrtHandle<OrtSessionOptions> options(raw_options);
+
+        ort_check(api->SetSessionGraphOptimizationLevel(options.get(), ORT_ENABLE_ALL));
+        if (settings.intra_op_threads > 0) {
+            ort_check(api->SetIntraOpNumThreads(options.get(), settings.intra_op_threads));
+        }
+        if (settings.use_nnapi) {
+#ifdef __ANDROID__
+            OrtStatus* status = OrtSessionOptionsAppendExecutionProvider_Nnapi(options.get(), 0);
+            if (status) {
+                // NNAPI not available, fall back to CPU
+                LOGW("NNAPI unavailable: %s", api->GetErrorMessage(status));
+                api->ReleaseStatus(status);
+            }
+#else
+            LOGW("NNAPI is Android only, using CPU");
+#endif
+        }
+
+        load_model(dp_, onnx_dir + "/duration_predictor.onnx", options.get());
+        load_model(te_, onnx_dir + "/text_encoder.onnx", options.get());
+        load_model(ve_, onnx_dir + "/vector_estimator.onnx", options.get());
+        load_model(voc_, onnx_dir + "/vocoder.onnx", options.get());
+
+        dp_bind_ = create_binding(dp_.session.get());
+        te_bind_ = create_binding(te_.session.get());
+        ve_bind_[0] = create_binding(ve_.session.get());
+        ve_bind_[1] = create_binding(ve_.session.get());
+        voc_bind_ = create_binding(voc_.session.get());
+
+        loaded_ = true;
+        last_error_.clear();
+        LOGI("Supertonic pipeline loaded (sr=%d, latent=%dx%d)",
+             config_.sample_rate, config_.latent_dim, config_.chunk_compress_factor);
+        return true;
+    } catch (const std::exception& e) {
+        reset_locked();
+        last_error_ = std::string("Failed to load model: ") + e.what();
+        LOGE("%s", last_error_.c_str());
+        return false;
+    }
+}
+
+void SupertonicPipeline::load_model(Model& model, const std::string& path,
+                                    const OrtSessionOptions* options) {
+    const OrtApi* api = ort_api();
+
+    OrtSession* session = nullptr;
+    ort_check(api->CreateSession(env_.get(), path.c_str(), options, &session));
+    model.session.reset(session);
+
+    char* name = nullptr;
+    ort_check(api->SessionGetOutputName(session, 0, allocator_, &name));
+    model.output_name = name;
+    ort_check(api->AllocatorFree(allocator_, name));
+}
+
+void SupertonicPipeline::release() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    reset_locked();
+}
+
+void SupertonicPipeline::reset_locked() {
+    loaded_ = false;
+
+    // Bindings reference sessions, sessions reference the env
+    dp_bind_.reset();
+    te_bind_.reset();
+    ve_bind_[0].reset();
+    ve_bind_[1].reset();
+    voc_bind_.reset();
+    dp_ = Model{};
+    te_ = Model{};
+    ve_ = Model{};
+    voc_ = Model{};
+    run_options_.reset();
+    cpu_.reset();
+    env_.reset();
+    allocator_ = nullptr;
+
+    release_vector(text_ids_);
+    release_vector(text_mask_);
+    release_vector(style_ttl_);
+    release_vector(style_dp_);
+    release_vector(latent_mask_);
+    release_vector(latent_[0]);
+    release_vector(latent_[1]);
+    release_vector(wav_lens_);
+    release_vector(step_values_);
+    release_vector(window_);
+    release_vector(tail_);
+}
+
+// ============================================================================
+// SYNTHESIS
+// ============================================================================
+
+bool SupertonicPipeline::synthesize(const int64_t* text_ids, size_t seq_len,
+                                    const VoiceStyle& style, int steps, float speed,
+                                    uint64_t seed, std::vector<float>& pcm) {
+    std::vector<std::vector<float>> out;
+    const bool ok = synthesize_batch({TextInput{text_ids, seq_len}}, style, steps, speed, seed, out);
+    if (ok) {
+        pcm = std::move(out[0]);
+    } else {
+        pcm.clear();
+    }
+    return ok;
+}
+
+bool SupertonicPipeline::synthesize_batch(const std::vector<TextInput>& texts,
+                                          const VoiceStyle& style, int steps, float speed,
+                                          uint64_t seed, std::vector<std::vector<float>>& pcm) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    pcm.clear();
+
+    if (!loaded_) {
+        last_error_ = "Model not loaded";
+        return false;
+    }
+    if (texts.empty()) {
+        last_error_ = "Empty batch";
+        return false;
+    }
+    for (const TextInput& t : texts) {
+        if (!t.ids || t.len == 0) {
+            last_error_ = "Empty text";
+            return false;
+        }
+    }
+    if (style.ttl_shape.empty() || style.dp_shape.empty()) {
+        last_error_ = "Invalid voice style";
+        return false;
+    }
+
+    try {
+        start_timings(std::max(steps, 1));
+        const int latent = denoise(texts, style, std::max(steps, 1), speed > 0.0f ? speed : 1.0f, seed);
+        vocode(latent, texts.size(), pcm);
+        timings_.vocoder_ms = lap();
+        timings_.first_audio_ms = timings_.total_ms =
+                std::chrono::duration<double, std::milli>(Clock::now() - call_start_).count();
+        return true;
+    } catch (const std::exception& e) {
+        last_error_ = std::string("Synthesis failed: ") + e.what();
+        LOGE("%s", last_error_.c_str());
+        clear_bindings();
+        pcm.clear();
+        return false;
+    }
+}
+
+int SupertonicPipeline::denoise(const std::vector<TextInput>& texts, const VoiceStyle& style,
+                                int steps, float speed, uint64_t seed) {
+    const OrtApi* api = ort_api();
+    const OrtMemoryInfo* mem = cpu_.get();
+    constexpr auto F32 = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+    constexpr auto I64 = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64;
+
+    const size_t batch = texts.size();
+    size_t seq_len = 0;
+    for (const TextInput& t : texts) seq_len = std::max(seq_len, t.len);
+
+    // Text [B, L], padded with id 0 / mask 0 (copied into reused storage;
+    // ORT reads them in place)
+    text_ids_.assign(batch * seq_len, 0);
+    text_mask_.assign(batch * seq_len, 0.0f);
+    for (size_t b = 0; b < batch; ++b) {
+        std::copy(texts[b].ids, texts[b].ids + texts[b].len, text_ids_.begin() + b * seq_len);
+        std::fill_n(text_mask_.begin() + b * seq_len, texts[b].len, 1.0f);
+    }
+
+    // Style [1, N, D] repeated along the batch axis
+    auto tile = [batch](const std::vector<float>& src, std::vector<float>& dst) {
+        dst.resize(batch * src.size());
+        for (size_t b = 0; b < batch; ++b) std::copy(src.begin(), src.end(), dst.begin() + b * src.size());
+    };
+    tile(style.ttl, style_ttl_);
+    tile(style.dp, style_dp_);
+    std::vector<int64_t> ttl_shape = style.ttl_shape;
+    std::vector<int64_t> dp_shape = style.dp_shape;
+    ttl_shape[0] = static_cast<int64_t>(batch);
+    dp_shape[0] = static_cast<int64_t>(batch);
+
+    const auto batch_dim = static_cast<int64_t>(batch);
+    const auto len = static_cast<int64_t>(seq_len);
+    const int64_t ids_shape[] = {batch_dim, len};
+    const int64_t text_mask_shape[] = {batch_dim, 1, len};
+
+    auto ids = make_tensor(mem, text_ids_.data(), text_ids_.size(), ids_shape, 2, I64);
+    auto text_mask = make_tensor(mem, text_mask_.data(), text_mask_.size(), text_mask_shape, 3, F32);
+    auto style_ttl = make_tensor(mem, style_ttl_.data(), style_ttl_.size(),
+                                 ttl_shape.data(), ttl_shape.size(), F32);
+    auto style_dp = make_tensor(mem, style_dp_.data(), style_dp_.size(),
+                                dp_shape.data(), dp_shape.size(), F32);
+
+    // 1. Duration prediction ([B] seconds)
+    OrtIoBinding* b = dp_bind_.get();
+    clear_binding(b);
+    bind_input(b, "text_ids", ids);
+    bind_input(b, "style_dp", style_dp);
+    bind_input(b, "text_mask", text_mask);
+    OrtHandle<OrtValue> duration_out = run_to_device(dp_, b);
+    if (tensor_element_count(duration_out.get()) < batch) {
+        throw std::runtime_error("duration predictor returned too few values");
+    }
+    const float* durations = tensor_data(duration_out.get());
+    timings_.duration_ms = lap();
+
+    // 2. Text encoding
+    b = te_bind_.get();
+    clear_binding(b);
+    bind_input(b, "text_ids", ids);
+    bind_input(b, "style_ttl", style_ttl);
+    bind_input(b, "text_mask", text_mask);
+    OrtHandle<OrtValue> text_emb = run_to_device(te_, b);
+    timings_.text_encoder_ms = lap();
+
+    // 3. Noisy latent [B, D, T], T = longest utterance; padding masked out
+    const int64_t chunk = config_.samples_per_latent();
+    const int64_t dim = config_.latent_dim_total();
+
+    wav_lens_.resize(batch);
+    int64_t latent_len = 1;
+    for (size_t i = 0; i < batch; ++i) {
+        const float seconds = durations[i] / speed;
+        wav_lens_[i] = std::max<int64_t>(0, static_cast<int64_t>(seconds * config_.sample_rate));
+        latent_len = std::max(latent_len, (wav_lens_[i] + chunk - 1) / chunk);
+    }
+
+    const auto row = static_cast<size_t>(dim * latent_len);
+    const size_t latent_size = batch * row;
+    latent_[0].resize(latent_size);
+    latent_[1].resize(latent_size);
+    latent_mask_.assign(batch * static_cast<size_t>(latent_len), 0.0f);
+
+    // Each item's noise covers only its own frames and is laid out as if it
+    // were synthesized alone, so batch position, padding and batched vs
+    // streamed synthesis never change an utterance's audio
+    const uint64_t noise_seed = seed != 0 ? seed : rng_();
+    for (size_t i = 0; i < batch; ++i) {
+        const auto valid = static_cast<size_t>(std::max<int64_t>(1, (wav_lens_[i] + chunk - 1) / chunk));
+        float* mask = latent_mask_.data() + i * static_cast<size_t>(latent_len);
+        std::fill_n(mask, valid, 1.0f);
+
+        fill_noise(latent_[0].data() + i * row, static_cast<size_t>(dim), valid,
+                   static_cast<size_t>(latent_len), noise_seed, noise_stream(texts[i]));
+    }
+
+    const int64_t latent_shape[] = {batch_dim, dim, latent_len};
+    const int64_t latent_mask_shape[] = {batch_dim, 1, latent_len};
+    const int64_t step_shape[] = {batch_dim};
+
+    // Step counters are per batch item
+    step_values_.resize(2 * batch);
+    float* current_step_values = step_values_.data();
+    float* total_step_values = step_values_.data() + batch;
+    std::fill_n(total_step_values, batch, static_cast<float>(steps));
+
+    OrtHandle<OrtValue> latent[2] = {
+            make_tensor(mem, latent_[0].data(), latent_size, latent_shape, 3, F32),
+            make_tensor(mem, latent_[1].data(), latent_size, latent_shape, 3, F32),
+    };
+    auto latent_mask = make_tensor(mem, latent_mask_.data(), latent_mask_.size(),
+                                   latent_mask_shape, 3, F32);
+    auto current_step = make_tensor(mem, current_step_values, batch, step_shape, 1, F32);
+    auto total_step = make_tensor(mem, total_step_values, batch, step_shape, 1, F32);
+
+    // 4. Denoising: bind both directions once, then only the step values change
+    for (int k = 0; k < 2; ++k) {
+        b = ve_bind_[k].get();
+        clear_binding(b);
+        bind_input(b, "noisy_latent", latent[k]);
+        bind_input(b, "text_emb", text_emb);
+        bind_input(b, "style_ttl", style_ttl);
+        bind_input(b, "latent_mask", latent_mask);
+        bind_input(b, "text_mask", text_mask);
+        bind_input(b, "current_step", current_step);
+        bind_input(b, "total_step", total_step);
+        ort_check(api->BindOutput(b, ve_.output_name.c_str(), latent[1 - k].get()));
+    }
+    timings_.noise_ms = lap();
+
+    for (int step = 0; step < steps; ++step) {
+        std::fill_n(current_step_values, batch, static_cast<float>(step));
+        ort_check(api->RunWithBinding(ve_.session.get(), run_options_.get(), ve_bind_[step & 1].get()));
+        timings_.step_ms[static_cast<size_t>(step)] = lap();
+    }
+    latent_len_ = latent_len;
+
+    // Drop references to this batch's inputs and text embedding
+    clear_bindings();
+    return steps & 1;
+}
+
+void SupertonicPipeline::vocode(int latent_index, size_t batch,
+                                std::vector<std::vector<float>>& pcm) {
+    const int64_t dim = config_.latent_dim_total();
+    const int64_t latent_shape[] = {static_cast<int64_t>(batch), dim, latent_len_};
+    auto latent = make_tensor(cpu_.get(), latent_[latent_index].data(),
+                              batch * static_cast<size_t>(dim * latent_len_),
+                              latent_shape, 3, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+
+    // [B, samples]
+    OrtIoBinding* b = voc_bind_.get();
+    clear_binding(b);
+    bind_input(b, "latent", latent);
+    OrtHandle<OrtValue> wav = run_to_device(voc_, b);
+    clear_binding(b);
+
+    // Split per utterance and trim to each predicted duration
+    const size_t per_item = tensor_element_count(wav.get()) / batch;
+    const float* samples = tensor_data(wav.get());
+    pcm.resize(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        const size_t actual = std::min(per_item, static_cast<size_t>(wav_lens_[i]));
+        const float* begin = samples + i * per_item;
+        pcm[i].assign(begin, begin + actual);
+    }
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+
+bool SupertonicPipeline::synthesize_stream(const int64_t* text_ids, size_t seq_len,
+                                           const VoiceStyle& style, int steps, float speed,
+                                           uint64_t seed, const StreamOptions& options,
+                                           const PcmSink& sink) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    if (!loaded_) {
+        last_error_ = "Model not loaded";
+        return false;
+    }
+    if (!text_ids || seq_len == 0) {
+        last_error_ = "Empty text";
+        return false;
+    }
+    if (style.ttl_shape.empty() || style.dp_shape.empty()) {
+        last_error_ = "Invalid voice style";
+        return false;
+    }
+
+    try {
+        start_timings(std::max(steps, 1));
+        const int latent = denoise({TextInput{text_ids, seq_len}}, style, std::max(steps, 1),
+                                   speed > 0.0f ? speed : 1.0f, seed);
+        if (!vocode_stream(latent, options, sink)) {
+            last_error_ = "Cancelled";
+            return false;
+        }
+        timings_.total_ms = std::chrono::duration<double, std::milli>(Clock::now() - call_start_).count();
+        return true;
+    } catch (const std::exception& e) {
+        last_error_ = std::string("Synthesis failed: ") + e.what();
+        LOGE("%s", last_error_.c_str());
+        clear_bindings();
+        return false;
+    }
+}
+
+/**
+ * Vocode the latent in windows of latent frames. Consecutive windows share
+ * `overlap_frames` frames: both decode them (so each window has context at
+ * its seams) and the two versions are crossfaded with a raised cosine.
+ * Everything before the shared frames is final and goes to the sink as
+ * soon as its window is decoded.
+ */
+bool SupertonicPipeline::vocode_stream(int latent_index, const StreamOptions& options,
+                                       const PcmSink& sink) {
+    const int64_t dim = config_.latent_dim_total();
+    const int64_t frames = latent_len_;
+    const int64_t overlap = std::max(0, options.overlap_frames);
+    const int64_t total = wav_lens_[0];
+    const float* latent = latent_[latent_index].data();
+
+    int64_t emitted = 0;
+    int64_t start = 0;
+    bool first = true;
+    tail_.clear();
+    timings_.vocoder_ms = 0.0;
+
+    while (start < frames && emitted < total) {
+        const int64_t window = std::max<int64_t>(
+                first ? options.first_window_frames : options.window_frames, overlap + 1);
+        int64_t end = std::min(start + window, frames);
+        if (frames - end <= overlap) end = frames;  // Never leave an all-overlap window
+        const int64_t n = end - start;
+        const bool last = end == frames;
+
+        // Gather the [1, D, n] slice of the [1, D, T] latent
+        window_.resize(static_cast<size_t>(dim * n));
+        for (int64_t d = 0; d < dim; ++d) {
+            std::copy(latent + d * frames + start, latent + d * frames + end, window_.data() + d * n);
+        }
+
+        const int64_t window_shape[] = {1, dim, n};
+        auto input = make_tensor(cpu_.get(), window_.data(), window_.size(), window_shape, 3,
+                                 ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+
+        OrtIoBinding* b = voc_bind_.get();
+        clear_binding(b);
+        bind_input(b, "latent", input);
+        OrtHandle<OrtValue> wav = run_to_device(voc_, b);
+        clear_binding(b);
+        timings_.vocoder_ms += lap();
+
+        const size_t count = tensor_element_count(wav.get());
+        const size_t samples_per_frame = count / static_cast<size_t>(n);
+        const size_t hold = last ? 0 : static_cast<size_t>(overlap) * samples_per_frame;
+        float* y = tensor_data(wav.get());
+
+        // Crossfade with the previous window's version of the shared frames
+        const size_t fade = std::min(tail_.size(), count - hold);
+        for (size_t i = 0; i < fade; ++i) {
+            const float w = 0.5f - 0.5f * std::cos(PI * (static_cast<float>(i) + 0.5f) / static_cast<float>(fade));
+            y[i] = tail_[i] * (1.0f - w) + y[i] * w;
+        }
+
+        const size_t ready = std::min(count - hold, static_cast<size_t>(total - emitted));
+        if (emitted == 0 && ready > 0) {
+            timings_.first_audio_ms = std::chrono::duration<double, std::milli>(Clock::now() - call_start_).count();
+        }
+        if (ready > 0 && !sink(y, ready)) return false;
+        lap();  // The sink's time is not the vocoder's
+        emitted += static_cast<int64_t>(ready);
+
+        tail_.assign(y + (count - hold), y + count);
+        start = last ? end : end - overlap;
+        first = false;
+    }
+    return true;
+}
+
+void SupertonicPipeline::start_timings(int steps) {
+    timings_.duration_ms = timings_.text_encoder_ms = timings_.noise_ms = 0.0;
+    timings_.vocoder_ms = timings_.first_audio_ms = timings_.total_ms = 0.0;
+    timings_.step_ms.assign(static_cast<size_t>(steps), 0.0);
+    call_start_ = lap_start_ = Clock::now();
+}
+
+double SupertonicPipeline::lap() {
+    const Clock::time_point now = Clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(now - lap_start_).count();
+    lap_start_ = now;
+    return ms;
+}
+
+void SupertonicPipeline::clear_bindings() {
+    clear_binding(dp_bind_.get());
+    clear_binding(te_bind_.get());
+    clear_binding(ve_bind_[0].get());
+    clear_binding(ve_bind_[1].get());
+    clear_binding(voc_bind_.get());
+}
+
+OrtHandle<OrtValue> SupertonicPipeline::run_to_device(const Model& model, OrtIoBinding* binding) {
+    const OrtApi* api = ort_api();
+
+    ort_check(api->BindOutputToDevice(binding, model.output_name.c_str(), cpu_.get()));
+    ort_check(api->RunWithBinding(model.session.get(), run_options_.get(), binding));
+
+    OrtValue** outputs = nullptr;
+    size_t count = 0;
+    ort_check(api->GetBoundOutputValues(binding, allocator_, &outputs, &count));
+
+    OrtHandle<OrtValue> first(count > 0 ? outputs[0] : nullptr);
+    for (size_t i = 1; i < count; ++i) api->ReleaseValue(outputs[i]);
+    if (outputs) ort_check(api->AllocatorFree(allocator_, outputs));
+    api->ClearBoundOutputs(binding);
+
+    if (!first) throw std::runtime_error(model.output_name + ": no output");
+    return first;
+}
+
+/**
+ * Standard normal noise for one item's latent: Philox/Box-Muller, so a fixed
+ * seed gives the same noise (and audio) on every device and ABI. Channel d
+ * takes values [d * frames, (d + 1) * frames) of the stream - the unpadded
+ * [D, frames] layout - and frames past `frames` in each row are zeroed.
+ */
+void SupertonicPipeline::fill_noise(float* data, size_t dim, size_t frames, size_t stride,
+                                    uint64_t seed, uint64_t stream) {
+    for (size_t d = 0; d < dim; ++d) {
+        float* row = data + d * stride;
+        fill_gaussian(row, frames, seed, stream, d * frames);
+        std::fill(row + frames, row + stride, 0.0f);
+    }
+}
+
+} // namespace tts
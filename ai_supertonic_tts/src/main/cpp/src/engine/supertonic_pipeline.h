@@ -0,0 +1,236 @@
+#pragma once
+
+/**
+ * Native Supertonic inference pipeline.
+ *
+ * duration predictor -> text encoder -> vector estimator (Euler loop)
+ * -> vocoder, all on the ONNX Runtime C API.
+ *
+ * The denoising loop never leaves native code:
+ * - the noisy latent lives in two pipeline-owned buffers that alternate
+ *   as input and output (ping-pong), bound to the vector estimator once
+ *   per utterance through two IoBindings
+ * - the step counter, masks, style and text embedding are bound once; a
+ *   step only rewrites the step value and runs the session
+ * - latent and input buffers only grow, so a denoising step allocates
+ *   nothing and the latent is never copied out until the vocoder output
+ *
+ * Several utterances can run as one batch: text is padded to the longest
+ * one and masked with text_mask, latents are padded to the longest
+ * predicted duration and masked with latent_mask, and each utterance's
+ * audio is trimmed back to its own duration.
+ *
+ * A single utterance can also be streamed: the vocoder then runs over
+ * overlapping windows of the latent and hands out crossfaded PCM as each
+ * window finishes, so playback starts before the whole utterance is
+ * vocoded.
+ */
+
+#include "gaussian_noise.h"
+#include "ort_handle.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tts {
+
+/**
+ * Model constants from tts.json
+ */
+struct ModelConfig {
+    int sample_rate = 44100;
+    int base_chunk_size = 512;
+    int chunk_compress_factor = 6;
+    int latent_dim = 24;
+
+    int latent_dim_total() const { return latent_dim * chunk_compress_factor; }
+    int64_t samples_per_latent() const {
+        return static_cast<int64_t>(base_chunk_size) * chunk_compress_factor;
+    }
+};
+
+struct SessionSettings {
+    int intra_op_threads = 0;  // 0 = ORT default
+    bool use_nnapi = false;
+};
+
+/**
+ * Voice style embeddings ([1, N, D] each), as stored in the voice JSON
+ */
+struct VoiceStyle {
+    std::vector<float> ttl;
+    std::vector<int64_t> ttl_shape;
+    std::vector<float> dp;
+    std::vector<int64_t> dp_shape;
+};
+
+/**
+ * One utterance of a batch (Unicode-indexer ids, not owned)
+ */
+struct TextInput {
+    const int64_t* ids;
+    size_t len;
+};
+
+/**
+ * Window layout for streamed vocoding, in latent frames
+ * (one frame = base_chunk_size * chunk_compress_factor samples)
+ */
+struct StreamOptions {
+    int first_window_frames = 8;  // Small first window: audio starts sooner
+    int window_frames = 24;
+    int overlap_frames = 2;       // Decoded by both neighbours and crossfaded
+};
+
+/**
+ * Wall time of each stage of the last synthesis call, in ms. Taken around
+ * the session runs, so it includes ORT's own input/output handling.
+ */
+struct StageTimings {
+    double duration_ms = 0.0;      // Duration predictor
+    double text_encoder_ms = 0.0;
+    double noise_ms = 0.0;         // Noise and masks for the latent
+    std::vector<double> step_ms;   // One per vector estimator step
+    double vocoder_ms = 0.0;       // All windows when streamed
+    double first_audio_ms = 0.0;   // Call start -> first PCM out (the whole batch if not streamed)
+    double total_ms = 0.0;
+};
+
+/**
+ * Receives streamed PCM (may modify it in place). Return false to stop.
+ */
+using PcmSink = std::function<bool(float* pcm, size_t samples)>;
+
+class SupertonicPipeline {
+public:
+    SupertonicPipeline() = default;
+    SupertonicPipeline(const SupertonicPipeline&) = delete;
+    SupertonicPipeline& operator=(const SupertonicPipeline&) = delete;
+
+    /**
+     * Load the four models from `onnx_dir`. Returns false and sets
+     * last_error() on failure.
+     */
+    bool load(const std::string& onnx_dir, const ModelConfig& config,
+              const SessionSettings& settings);
+
+    bool is_loaded() const { return loaded_; }
+
+    /**
+     * Synthesize one utterance.
+     *
+     * @param text_ids Unicode-indexer ids (TextProcessor output)
+     * @param steps    Denoising steps
+     * @param speed    Speed factor (duration is divided by it)
+     * @param seed     Noise seed (0 = random)
+     * @param pcm      Receives mono float32 audio at config().sample_rate
+     */
+    bool synthesize(const int64_t* text_ids, size_t seq_len, const VoiceStyle& style,
+                    int steps, float speed, uint64_t seed, std::vector<float>& pcm);
+
+    /**
+     * Synthesize several utterances as one batch (same voice). Inputs of
+     * similar length batch best: every step costs as much as the longest.
+     * Each item's noise depends only on the seed and its own text ids, so
+     * it sounds the same as when synthesized (or streamed) on its own.
+     *
+     * @param pcm Receives one audio buffer per input, in input order
+     */
+    bool synthesize_batch(const std::vector<TextInput>& texts, const VoiceStyle& style,
+                          int steps, float speed, uint64_t seed,
+                          std::vector<std::vector<float>>& pcm);
+
+    /**
+     * Synthesize one utterance and stream its audio to `sink` window by
+     * window. Returns false on error or when the sink stops early
+     * (last_error() is then "Cancelled").
+     */
+    bool synthesize_stream(const int64_t* text_ids, size_t seq_len, const VoiceStyle& style,
+                           int steps, float speed, uint64_t seed,
+                           const StreamOptions& options, const PcmSink& sink);
+
+    void release();
+
+    const ModelConfig& config() const { return config_; }
+    const std::string& last_error() const { return last_error_; }
+
+    /**
+     * Stage times of the last successful synthesis. Only meaningful on the
+     * thread that ran it, before the next call.
+     */
+    const StageTimings& last_timings() const { return timings_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Model {
+        OrtHandle<OrtSession> session;
+        std::string output_name;  // First output
+    };
+
+    void reset_locked();
+
+    void load_model(Model& model, const std::string& path, const OrtSessionOptions* options);
+
+    // Run `binding` on `model` and return its first output (ORT-allocated)
+    OrtHandle<OrtValue> run_to_device(const Model& model, OrtIoBinding* binding);
+
+    // One item's [dim, stride] latent rows: `frames` noise values, then zeros
+    void fill_noise(float* data, size_t dim, size_t frames, size_t stride,
+                    uint64_t seed, uint64_t stream);
+
+    // Duration, text encoding and the Euler loop. Fills wav_lens_ and
+    // latent_len_; returns which latent_ buffer holds the result.
+    int denoise(const std::vector<TextInput>& texts, const VoiceStyle& style,
+                int steps, float speed, uint64_t seed);
+
+    void vocode(int latent_index, size_t batch, std::vector<std::vector<float>>& pcm);
+
+    bool vocode_stream(int latent_index, const StreamOptions& options, const PcmSink& sink);
+
+    void clear_bindings();
+
+    // Start timings_ for a new call; lap() returns ms since the last lap
+    void start_timings(int steps);
+    double lap();
+
+    ModelConfig config_;
+    bool loaded_ = false;
+    std::string last_error_;
+    std::mutex mtx_;  // One synthesis at a time: buffers and bindings are shared
+
+    OrtHandle<OrtEnv> env_;
+    OrtHandle<OrtMemoryInfo> cpu_;
+    OrtHandle<OrtRunOptions> run_options_;
+    OrtAllocator* allocator_ = nullptr;  // ORT default allocator, not owned
+
+    Model dp_, te_, ve_, voc_;
+    OrtHandle<OrtIoBinding> dp_bind_, te_bind_, voc_bind_;
+    OrtHandle<OrtIoBinding> ve_bind_[2];  // [0]: latent_[0] -> latent_[1], [1]: the reverse
+
+    // Reused input/output storage (grown, never shrunk), batch-major
+    std::vector<int64_t> text_ids_;
+    std::vector<float> text_mask_;
+    std::vector<float> style_ttl_;
+    std::vector<float> style_dp_;
+    std::vector<float> latent_mask_;
+    std::vector<float> latent_[2];
+    std::vector<int64_t> wav_lens_;
+    int64_t latent_len_ = 0;
+    std::vector<float> window_;  // Streamed vocoder input slice
+    std::vector<float> tail_;    // Overlap held back for the next crossfade
+    std::vector<float> step_values_;  // [current_step x B, total_step x B]
+
+    StageTimings timings_;
+    Clock::time_point call_start_{};
+    Clock::time_point lap_start_{};
+
+    std::mt19937_64 rng_{std::random_device{}()};
+};
+
+} // namespace tts
@@ -0,0 +1,476 @@
+#include "tensor_cache.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tts {
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'T', 'T', 'C'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGN = 64;
+constexpr int MAX_DEPTH = 64;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint8_t pad[32];
+};
+static_assert(sizeof(FileHeader) == ALIGN, "header must be one record");
+
+struct TensorRecord {
+    uint32_t type;
+    uint32_t rank;
+    int64_t dims[TensorCache::MAX_RANK];
+    uint64_t offset;
+    uint64_t count;
+    uint8_t pad[8];
+};
+static_assert(sizeof(TensorRecord) == ALIGN, "records are 64 bytes");
+
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+SourceStamp stamp_of(const struct stat& st) {
+    SourceStamp s;
+    s.size = static_cast<uint64_t>(st.st_size);
+    s.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return s;
+}
+
+size_t align_up(size_t n) { return (n + ALIGN - 1) & ~(ALIGN - 1); }
+
+std::string errno_text(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// A tensor parsed from JSON, stored as raw 32-bit words
+struct HostTensor {
+    TensorType type = TensorType::Float32;
+    std::vector<int64_t> shape;
+    std::vector<uint32_t> words;
+};
+
+/**
+ * Just enough JSON for the model assets: objects, arrays, numbers;
+ * strings and literals are recognized so they can be skipped
+ */
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : p_(text.c_str()), end_(p_ + text.size()) {}
+
+    const std::string& error() const { return error_; }
+
+    bool consume(char c) {
+        skip_space();
+        if (p_ < end_ && *p_ == c) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(char c) {
+        if (consume(c)) return true;
+        return fail(std::string("expected '") + c + "'");
+    }
+
+    bool at_end() {
+        skip_space();
+        return p_ == end_;
+    }
+
+    bool string(std::string* out) {
+        if (!expect('"')) return false;
+        out->clear();
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\' && p_ + 1 < end_) ++p_;  // Keys are ASCII; escapes are not decoded
+            out->push_back(*p_++);
+        }
+        if (p_ == end_) return fail("unterminated string");
+        ++p_;
+        return true;
+    }
+
+    bool number(double* out) {
+        skip_space();
+        char* next = nullptr;
+        *out = std::strtod(p_, &next);
+        if (next == p_ || next > end_) return fail("expected a number");
+        p_ = next;
+        return true;
+    }
+
+    /**
+     * Any number or nesting of number arrays, flattened in order.
+     * `convert` turns each value into a 32-bit word.
+     */
+    template <typename Convert>
+    bool numbers(std::vector<uint32_t>& out, Convert convert, int depth = 0) {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+        if (!consume('[')) {
+            double v;
+            if (!number(&v)) return false;
+            uint32_t word;
+            if (!convert(v, &word)) return fail("value out of range");
+            out.push_back(word);
+            return true;
+        }
+        if (consume(']')) return true;
+        do {
+            if (!numbers(out, convert, depth + 1)) return false;
+        } while (consume(','));
+        return expect(']');
+    }
+
+    bool skip_value(int depth = 0) {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+        skip_space();
+        if (p_ == end_) return fail("unexpected end");
+        const char c = *p_;
+        if (c == '"') {
+            std::string ignored;
+            return string(&ignored);
+        }
+        if (c == '[' || c == '{') {
+            const char close = c == '[' ? ']' : '}';
+            ++p_;
+            if (consume(close)) return true;
+            do {
+                if (c == '{') {
+                    std::string key;
+                    if (!string(&key) || !expect(':')) return false;
+                }
+                if (!skip_value(depth + 1)) return false;
+            } while (consume(','));
+            return expect(close);
+        }
+        for (const char* literal : {"true", "false", "null"}) {
+            const size_t n = std::strlen(literal);
+            if (static_cast<size_t>(end_ - p_) >= n && std::memcmp(p_, literal, n) == 0) {
+                p_ += n;
+                return true;
+            }
+        }
+        double ignored;
+        return number(&ignored);
+    }
+
+    bool fail(const std::string& what) {
+        if (error_.empty()) error_ = what;
+        return false;
+    }
+
+private:
+    void skip_space() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    const char* p_;
+    const char* end_;
+    std::string error_;
+};
+
+bool to_float_word(double v, uint32_t* out) {
+    const float f = static_cast<float>(v);
+    std::memcpy(out, &f, sizeof(f));
+    return true;
+}
+
+bool to_int_word(double v, uint32_t* out) {
+    if (!(v >= INT32_MIN && v <= INT32_MAX) || v != std::floor(v)) return false;
+    *out = static_cast<uint32_t>(static_cast<int32_t>(v));
+    return true;
+}
+
+bool parse_indexer(JsonReader& r, std::vector<HostTensor>& tensors) {
+    HostTensor t;
+    t.type = TensorType::Int32;
+    if (!r.numbers(t.words, to_int_word)) return false;
+    t.shape = {static_cast<int64_t>(t.words.size())};
+    tensors.push_back(std::move(t));
+    return true;
+}
+
+// { "data": [[...]], "dims": [...] } (other keys ignored)
+bool parse_style_tensor(JsonReader& r, HostTensor& t) {
+    bool has_data = false;
+    bool has_dims = false;
+    if (!r.expect('{')) return false;
+    if (!r.consume('}')) {
+        do {
+            std::string key;
+            if (!r.string(&key) || !r.expect(':')) return false;
+            if (key == "data") {
+                if (!r.numbers(t.words, to_float_word)) return false;
+                has_data = true;
+            } else if (key == "dims") {
+                std::vector<uint32_t> dims;
+                if (!r.numbers(dims, to_int_word)) return false;
+                for (uint32_t d : dims) t.shape.push_back(static_cast<int32_t>(d));
+                has_dims = true;
+            } else if (!r.skip_value()) {
+                return false;
+            }
+        } while (r.consume(','));
+        if (!r.expect('}')) return false;
+    }
+    if (!has_data || !has_dims) return r.fail("style tensor needs data and dims");
+
+    int64_t count = 1;
+    for (int64_t d : t.shape) {
+        if (d < 0) return r.fail("negative dim");
+        count *= d;
+    }
+    if (t.shape.empty() || static_cast<int>(t.shape.size()) > TensorCache::MAX_RANK ||
+        static_cast<size_t>(count) != t.words.size()) {
+        return r.fail("dims do not match data");
+    }
+    return true;
+}
+
+bool parse_style(JsonReader& r, std::vector<HostTensor>& tensors) {
+    HostTensor ttl, dp;
+    bool has_ttl = false;
+    bool has_dp = false;
+    if (!r.expect('{')) return false;
+    if (!r.consume('}')) {
+        do {
+            std::string key;
+            if (!r.string(&key) || !r.expect(':')) return false;
+            if (key == "style_ttl") {
+                if (!parse_style_tensor(r, ttl)) return false;
+                has_ttl = true;
+            } else if (key == "style_dp") {
+                if (!parse_style_tensor(r, dp)) return false;
+                has_dp = true;
+            } else if (!r.skip_value()) {
+                return false;
+            }
+        } while (r.consume(','));
+        if (!r.expect('}')) return false;
+    }
+    if (!has_ttl || !has_dp) return r.fail("missing style_ttl or style_dp");
+    tensors.push_back(std::move(ttl));
+    tensors.push_back(std::move(dp));
+    return true;
+}
+
+bool read_file(const std::string& path, std::string& out, SourceStamp& stamp, std::string* error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = errno_text("open " + path);
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        *error = errno_text("stat " + path);
+        ::close(fd);
+        return false;
+    }
+    stamp = stamp_of(st);
+
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        const ssize_t n = ::read(fd, &out[done], out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            *error = n < 0 ? errno_text("read " + path) : "short read: " + path;
+            ::close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return true;
+}
+
+bool write_file(const std::string& path, const std::vector<uint8_t>& bytes, std::string* error) {
+    // Unique per write, so two processes/threads converting the same file
+    // can't interleave into one temporary before the rename
+    std::string tmp = path + ".tmp.XXXXXX";
+    const int fd = ::mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd < 0) {
+        *error = errno_text("create " + path + ".tmp");
+        return false;
+    }
+    ::fchmod(fd, 0644);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        const ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            *error = errno_text("write " + tmp);
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if (::close(fd) != 0 || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        *error = errno_text("finish " + path);
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8_t> serialize(const std::vector<HostTensor>& tensors, const SourceStamp& stamp) {
+    size_t data_start = align_up(sizeof(FileHeader) + tensors.size() * sizeof(TensorRecord));
+    size_t total = data_start;
+    for (const HostTensor& t : tensors) total = align_up(total + t.words.size() * 4);
+
+    std::vector<uint8_t> bytes(total, 0);
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = static_cast<uint32_t>(tensors.size());
+    header.source_size = stamp.size;
+    header.source_mtime = stamp.mtime;
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    size_t offset = data_start;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        const HostTensor& t = tensors[i];
+        TensorRecord record{};
+        record.type = static_cast<uint32_t>(t.type);
+        record.rank = static_cast<uint32_t>(t.shape.size());
+        for (size_t d = 0; d < t.shape.size(); ++d) record.dims[d] = t.shape[d];
+        record.offset = offset;
+        record.count = t.words.size();
+        std::memcpy(bytes.data() + sizeof(FileHeader) + i * sizeof(TensorRecord), &record, sizeof(record));
+
+        if (!t.words.empty()) std::memcpy(bytes.data() + offset, t.words.data(), t.words.size() * 4);
+        offset = align_up(offset + t.words.size() * 4);
+    }
+    return bytes;
+}
+
+} // namespace
+
+TensorCache::~TensorCache() {
+    close();
+}
+
+bool TensorCache::open(const std::string& path, const std::string& source_path) {
+    close();
+    last_error_.clear();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return fail(errno_text("open " + path));
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return fail(errno_text("stat " + path));
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(FileHeader)) {
+        ::close(fd);
+        return fail("truncated cache: " + path);
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return fail(errno_text("mmap " + path));
+    map_ = map;
+    map_size_ = size;
+
+    const auto* base = static_cast<const uint8_t*>(map_);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        close();
+        return fail("not a tensor cache: " + path);
+    }
+
+    struct stat source {};
+    if (!source_path.empty() && ::stat(source_path.c_str(), &source) == 0) {
+        const SourceStamp now = stamp_of(source);
+        if (now.size != header.source_size || now.mtime != header.source_mtime) {
+            close();
+            return fail("stale cache: " + path);
+        }
+    }
+
+    if (header.count > (size - sizeof(FileHeader)) / sizeof(TensorRecord)) {
+        close();
+        return fail("truncated cache: " + path);
+    }
+    tensors_.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        TensorRecord record;
+        std::memcpy(&record, base + sizeof(FileHeader) + i * sizeof(TensorRecord), sizeof(record));
+
+        bool valid = record.type <= static_cast<uint32_t>(TensorType::Int32) &&
+                     record.rank >= 1 && record.rank <= MAX_RANK &&
+                     record.offset % ALIGN == 0 && record.offset <= size &&
+                     record.count <= (size - record.offset) / 4;
+        uint64_t count = 1;
+        for (uint32_t d = 0; valid && d < record.rank; ++d) {
+            valid = record.dims[d] >= 0;
+            count *= static_cast<uint64_t>(record.dims[d]);
+        }
+        if (!valid || count != record.count) {
+            close();
+            return fail("corrupt tensor record in " + path);
+        }
+
+        TensorView view;
+        view.type = static_cast<TensorType>(record.type);
+        view.shape.assign(record.dims, record.dims + record.rank);
+        view.data = base + record.offset;
+        view.count = static_cast<size_t>(record.count);
+        tensors_.push_back(std::move(view));
+    }
+    return true;
+}
+
+void TensorCache::close() {
+    tensors_.clear();
+    if (map_) {
+        ::munmap(map_, map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+    }
+}
+
+bool TensorCache::convert(const std::string& source_path, const std::string& path,
+                          CacheSource kind, std::string* error) {
+    std::string ignored;
+    if (!error) error = &ignored;
+
+    std::string text;
+    SourceStamp stamp;
+    if (!read_file(source_path, text, stamp, error)) return false;
+
+    JsonReader reader(text);
+    std::vector<HostTensor> tensors;
+    const bool parsed = kind == CacheSource::UnicodeIndexer ? parse_indexer(reader, tensors)
+                                                            : parse_style(reader, tensors);
+    if (!parsed || !reader.at_end()) {
+        *error = source_path + ": " + (reader.error().empty() ? "trailing data" : reader.error());
+        return false;
+    }
+
+    return write_file(path, serialize(tensors, stamp), error);
+}
+
+bool TensorCache::fail(const std::string& what) {
+    last_error_ = what;
+    return false;
+}
+
+} // namespace tts
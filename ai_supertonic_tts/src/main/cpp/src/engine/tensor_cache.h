@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+ * Binary, memory-mapped copies of the model's JSON assets.
+ *
+ * unicode_indexer.json (a codepoint -> token id array) and the voice style
+ * JSONs (nested float arrays with dims) are parsed once and written as a
+ * flat little-endian file; later loads mmap it and hand out pointers into
+ * the mapping, so nothing is parsed or copied and pages are read on first
+ * touch.
+ *
+ * Layout (64-byte aligned records and data):
+ *   0   "STTC", version (u32), tensor count (u32), reserved (u32)
+ *   16  source JSON size (u64), source mtime in ns (i64)
+ *   32  reserved to 64
+ *   64  one 64-byte record per tensor: type (u32), rank (u32),
+ *       dims[4] (i64), data offset (u64), element count (u64)
+ *   ... tensor data, each at a 64-byte aligned offset
+ *
+ * The source size/mtime stamp makes a cache go stale when its JSON
+ * changes. JNI-free: usable by host tools.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tts {
+
+enum class TensorType : uint32_t { Float32 = 0, Int32 = 1 };
+
+/** What a source JSON holds */
+enum class CacheSource : int {
+    UnicodeIndexer = 0,  // One Int32 tensor [n]
+    VoiceStyle = 1,      // Float32 style_ttl, then Float32 style_dp
+};
+
+/**
+ * One tensor inside a mapped cache (valid while the cache is open)
+ */
+struct TensorView {
+    TensorType type = TensorType::Float32;
+    std::vector<int64_t> shape;
+    const void* data = nullptr;
+    size_t count = 0;
+
+    size_t bytes() const { return count * 4; }
+};
+
+class TensorCache {
+public:
+    TensorCache() = default;
+    TensorCache(const TensorCache&) = delete;
+    TensorCache& operator=(const TensorCache&) = delete;
+    ~TensorCache();
+
+    /**
+     * Map the cache at `path`. With a non-empty `source_path` that exists,
+     * the cache must carry its size and mtime. Returns false and sets
+     * last_error() if the file is missing, stale or malformed.
+     */
+    bool open(const std::string& path, const std::string& source_path);
+
+    void close();
+
+    size_t size() const { return tensors_.size(); }
+    const TensorView& tensor(size_t index) const { return tensors_[index]; }
+    const std::string& last_error() const { return last_error_; }
+
+    /**
+     * Parse `source_path` as `kind` and write its cache to `path`
+     * (through a temporary file and rename, so readers never see a
+     * partial one). Returns false and fills `error` on failure.
+     */
+    static bool convert(const std::string& source_path, const std::string& path,
+                        CacheSource kind, std::string* error);
+
+    static constexpr int MAX_RANK = 4;
+
+private:
+    bool fail(const std::string& what);
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    std::vector<TensorView> tensors_;
+    std::string last_error_;
+};
+
+} // namespace tts
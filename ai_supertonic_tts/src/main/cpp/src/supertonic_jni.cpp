@@ -1,6 +1,20 @@
 #include <jni.h>
+#include <algorithm>
 #include <string>
+#include "audio/aaudio_sink.h"
+#include "audio/adpcm_encoder.h"
+#include "audio/audio_ring.h"
+#include "audio/chunk_stitcher.h"
+#include "audio/flac_encoder.h"
+#include "audio/playback_feeder.h"
+#include "audio/resampler.h"
 #include "audio/wav_encoder.h"
+#include "audio/wav_writer.h"
+#include "engine/audio_cache.h"
+#include "engine/supertonic_pipeline.h"
+#include "engine/tensor_cache.h"
+#include "text/sentence_stream.h"
+#include "text/text_processor.h"
 #include "utils/logger.h"
 
 // JNI package: com.mp.ai_supertonic_tts.SupertonicNativeLib
@@ -8,22 +22,93 @@
 
 extern "C" {
 
+// ============================================================================
+// AUDIO ENCODING
+// ============================================================================
+// 16-bit encoders write straight into Java memory: the result array is
+// allocated once and filled inside a critical section (no native buffer,
+// no SetByteArrayRegion copy), or the caller passes a direct ByteBuffer.
+
+static jint encode_16_into(JNIEnv* env, jfloatArray jaudio, jint sampleRate, jint channels,
+                           bool wav, uint8_t* out, size_t capacity) {
+    const jint len = env->GetArrayLength(jaudio);
+    const int frames = wav ? len / std::max(channels, 1) : len;
+
+    auto* audio = static_cast<const float*>(env->GetPrimitiveArrayCritical(jaudio, nullptr));
+    if (!audio) return -1;
+    const size_t written = wav
+            ? audio::encode_wav_16_into(audio, frames, sampleRate, channels, out, capacity)
+            : audio::encode_pcm_16_into(audio, frames, out, capacity);
+    env->ReleasePrimitiveArrayCritical(jaudio, const_cast<float*>(audio), JNI_ABORT);
+
+    return written > 0 || frames == 0 ? static_cast<jint>(written) : -1;
+}
+
+static jbyteArray encode_16(JNIEnv* env, jfloatArray jaudio, jint sampleRate, jint channels,
+                            bool wav) {
+    const jint len = env->GetArrayLength(jaudio);
+    const size_t size = wav ? audio::wav_16_size(len / std::max(channels, 1), channels)
+                            : static_cast<size_t>(len) * 2;
+
+    jbyteArray result = env->NewByteArray(static_cast<jsize>(size));
+    if (!result) return nullptr;
+
+    auto* out = static_cast<uint8_t*>(env->GetPrimitiveArrayCritical(result, nullptr));
+    if (!out) return nullptr;
+    auto* audio = static_cast<const float*>(env->GetPrimitiveArrayCritical(jaudio, nullptr));
+    if (audio) {
+        if (wav) {
+            audio::encode_wav_16_into(audio, len / std::max(channels, 1), sampleRate, channels,
+                                      out, size);
+        } else {
+            audio::encode_pcm_16_into(audio, len, out, size);
+        }
+        env->ReleasePrimitiveArrayCritical(jaudio, const_cast<float*>(audio), JNI_ABORT);
+    }
+    env->ReleasePrimitiveArrayCritical(result, out, 0);
+    return audio ? result : nullptr;
+}
+
+static jint encode_16_direct(JNIEnv* env, jfloatArray jaudio, jint sampleRate, jint channels,
+                             bool wav, jobject jout) {
+    auto* out = static_cast<uint8_t*>(env->GetDirectBufferAddress(jout));
+    const jlong capacity = env->GetDirectBufferCapacity(jout);
+    if (!out || capacity < 0) return -1;
+    return encode_16_into(env, jaudio, sampleRate, channels, wav, out, static_cast<size_t>(capacity));
+}
+
+static jint encode_16_array(JNIEnv* env, jfloatArray jaudio, jint sampleRate, jint channels,
+                            bool wav, jbyteArray jout) {
+    const size_t capacity = static_cast<size_t>(env->GetArrayLength(jout));
+    auto* out = static_cast<uint8_t*>(env->GetPrimitiveArrayCritical(jout, nullptr));
+    if (!out) return -1;
+    const jint written = encode_16_into(env, jaudio, sampleRate, channels, wav, out, capacity);
+    env->ReleasePrimitiveArrayCritical(jout, out, written > 0 ? 0 : JNI_ABORT);
+    return written;
+}
+
 JNIEXPORT jbyteArray JNICALL
 Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeWav16(
         JNIEnv* env, jobject /* this */,
         jfloatArray jaudio, jint sampleRate, jint channels) {
 
-    jfloat* audio = env->GetFloatArrayElements(jaudio, nullptr);
-    jint len = env->GetArrayLength(jaudio);
+    return encode_16(env, jaudio, sampleRate, channels, true);
+}
 
-    auto wav = audio::encode_wav_16(audio, len, sampleRate, channels);
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeWav16Direct(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jint sampleRate, jint channels, jobject jout) {
 
-    env->ReleaseFloatArrayElements(jaudio, audio, JNI_ABORT);
+    return encode_16_direct(env, jaudio, sampleRate, channels, true, jout);
+}
 
-    jbyteArray result = env->NewByteArray(static_cast<jsize>(wav.size()));
-    env->SetByteArrayRegion(result, 0, static_cast<jsize>(wav.size()),
-                            reinterpret_cast<const jbyte*>(wav.data()));
-    return result;
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeWav16Into(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jint sampleRate, jint channels, jbyteArray jout) {
+
+    return encode_16_array(env, jaudio, sampleRate, channels, true, jout);
 }
 
 JNIEXPORT jbyteArray JNICALL
@@ -44,22 +129,67 @@ Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeWav32f(
     return result;
 }
 
+// Compressed encoders run long (FLAC on several threads), so the input is
+// not held in a critical section
+static jbyteArray to_byte_array(JNIEnv* env, const std::vector<uint8_t>& bytes) {
+    if (bytes.empty()) return nullptr;
+    jbyteArray result = env->NewByteArray(static_cast<jsize>(bytes.size()));
+    if (!result) return nullptr;
+    env->SetByteArrayRegion(result, 0, static_cast<jsize>(bytes.size()),
+                            reinterpret_cast<const jbyte*>(bytes.data()));
+    return result;
+}
+
 JNIEXPORT jbyteArray JNICALL
-Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodePcm16(
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeFlac(
         JNIEnv* env, jobject /* this */,
-        jfloatArray jaudio) {
+        jfloatArray jaudio, jint sampleRate, jint channels) {
 
     jfloat* audio = env->GetFloatArrayElements(jaudio, nullptr);
-    jint len = env->GetArrayLength(jaudio);
+    const int frames = env->GetArrayLength(jaudio) / std::max(channels, 1);
 
-    auto pcm = audio::encode_pcm_16(audio, len);
+    auto flac = audio::encode_flac(audio, frames, sampleRate, channels);
 
     env->ReleaseFloatArrayElements(jaudio, audio, JNI_ABORT);
+    return to_byte_array(env, flac);
+}
 
-    jbyteArray result = env->NewByteArray(static_cast<jsize>(pcm.size()));
-    env->SetByteArrayRegion(result, 0, static_cast<jsize>(pcm.size()),
-                            reinterpret_cast<const jbyte*>(pcm.data()));
-    return result;
+JNIEXPORT jbyteArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodeWavAdpcm(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jint sampleRate, jint channels) {
+
+    jfloat* audio = env->GetFloatArrayElements(jaudio, nullptr);
+    const int frames = env->GetArrayLength(jaudio) / std::max(channels, 1);
+
+    auto wav = audio::encode_wav_ima_adpcm(audio, frames, sampleRate, channels);
+
+    env->ReleaseFloatArrayElements(jaudio, audio, JNI_ABORT);
+    return to_byte_array(env, wav);
+}
+
+JNIEXPORT jbyteArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodePcm16(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio) {
+
+    return encode_16(env, jaudio, 0, 1, false);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodePcm16Direct(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jobject jout) {
+
+    return encode_16_direct(env, jaudio, 0, 1, false, jout);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeEncodePcm16Into(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jbyteArray jout) {
+
+    return encode_16_array(env, jaudio, 0, 1, false, jout);
 }
 
 JNIEXPORT void JNICALL
@@ -76,4 +206,1042 @@ Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeClipAudio(
     env->ReleaseFloatArrayElements(jaudio, audio, 0);
 }
 
+// ============================================================================
+// RESAMPLING
+// ============================================================================
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResample(
+        JNIEnv* env, jobject /* this */,
+        jfloatArray jaudio, jint inRate, jint outRate) {
+
+    const jint len = env->GetArrayLength(jaudio);
+    auto* audio = static_cast<const float*>(env->GetPrimitiveArrayCritical(jaudio, nullptr));
+    if (!audio) return nullptr;
+    const auto out = audio::resample(audio, static_cast<size_t>(len), inRate, outRate);
+    env->ReleasePrimitiveArrayCritical(jaudio, const_cast<float*>(audio), JNI_ABORT);
+
+    jfloatArray result = env->NewFloatArray(static_cast<jsize>(out.size()));
+    if (result) {
+        env->SetFloatArrayRegion(result, 0, static_cast<jsize>(out.size()), out.data());
+    }
+    return result;
+}
+
+static audio::Resampler* to_resampler(jlong handle) {
+    return reinterpret_cast<audio::Resampler*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResamplerCreate(
+        JNIEnv* /* env */, jobject /* this */,
+        jint inRate, jint outRate) {
+
+    if (inRate <= 0 || outRate <= 0) return 0;
+    return reinterpret_cast<jlong>(new audio::Resampler(inRate, outRate));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResamplerMaxOutput(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jint count) {
+
+    auto* resampler = to_resampler(handle);
+    if (!resampler || count < 0) return 0;
+    return static_cast<jint>(resampler->max_output(static_cast<size_t>(count)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResamplerProcess(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray jinput, jint length, jfloatArray joutput) {
+
+    auto* resampler = to_resampler(handle);
+    if (!resampler || length < 0 || length > env->GetArrayLength(jinput)) return -1;
+    const auto count = static_cast<size_t>(length);
+    if (static_cast<size_t>(env->GetArrayLength(joutput)) < resampler->max_output(count)) return -1;
+
+    // Both arrays pinned: the filter loop is short and never blocks
+    auto* in = static_cast<const float*>(env->GetPrimitiveArrayCritical(jinput, nullptr));
+    auto* out = static_cast<float*>(env->GetPrimitiveArrayCritical(joutput, nullptr));
+    jint produced = -1;
+    if (in && out) produced = static_cast<jint>(resampler->process(in, count, out));
+    if (out) env->ReleasePrimitiveArrayCritical(joutput, out, 0);
+    if (in) env->ReleasePrimitiveArrayCritical(jinput, const_cast<float*>(in), JNI_ABORT);
+    return produced;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResamplerFlush(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray joutput) {
+
+    auto* resampler = to_resampler(handle);
+    if (!resampler) return -1;
+
+    std::vector<float> tail(resampler->max_output(0));
+    const size_t produced = resampler->flush(tail.data());
+    if (static_cast<size_t>(env->GetArrayLength(joutput)) < produced) return -1;
+    env->SetFloatArrayRegion(joutput, 0, static_cast<jsize>(produced), tail.data());
+    return static_cast<jint>(produced);
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeResamplerDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_resampler(handle);
+}
+
+// ============================================================================
+// STREAMING WAV SINK
+// ============================================================================
+
+static audio::WavWriter* to_wav_writer(jlong handle) {
+    return reinterpret_cast<audio::WavWriter*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterOpen(
+        JNIEnv* /* env */, jobject /* this */,
+        jint fd, jint sampleRate, jint channels, jboolean float32) {
+
+    auto* writer = new audio::WavWriter();
+    const auto encoding = float32 == JNI_TRUE ? audio::WavWriter::Encoding::Float32
+                                              : audio::WavWriter::Encoding::Pcm16;
+    if (!writer->open(fd, sampleRate, channels, encoding)) {
+        LOGE("WAV sink: %s", writer->last_error().c_str());
+        delete writer;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(writer);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterWrite(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray jaudio, jint offset, jint length) {
+
+    auto* writer = to_wav_writer(handle);
+    if (!writer || !jaudio || offset < 0 || length < 0 ||
+        offset + length > env->GetArrayLength(jaudio)) {
+        return JNI_FALSE;
+    }
+
+    // Copy out rather than pin: write() may block in writev()
+    thread_local std::vector<float> scratch;
+    scratch.resize(static_cast<size_t>(length));
+    env->GetFloatArrayRegion(jaudio, offset, length, scratch.data());
+
+    const size_t frames = scratch.size() / static_cast<size_t>(writer->channels());
+    return writer->write(scratch.data(), frames) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterWriteSilence(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jint frames) {
+
+    auto* writer = to_wav_writer(handle);
+    if (!writer || frames < 0) return JNI_FALSE;
+    return writer->write_silence(static_cast<size_t>(frames)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterClose(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    auto* writer = to_wav_writer(handle);
+    return writer && writer->close() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterLastError(
+        JNIEnv* env, jobject /* this */,
+        jlong handle) {
+
+    auto* writer = to_wav_writer(handle);
+    if (!writer || writer->last_error().empty()) return nullptr;
+    return env->NewStringUTF(writer->last_error().c_str());
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeWavWriterDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_wav_writer(handle);
+}
+
+// ============================================================================
+// CHUNK POST-PROCESSING
+// ============================================================================
+// Trim, join, gain and limit in one pass, written straight into the result
+// array or encoded by a WAV sink.
+
+static audio::ChunkStitcher* to_stitcher(jlong handle) {
+    return reinterpret_cast<audio::ChunkStitcher*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeStitcherCreate(
+        JNIEnv* /* env */, jobject /* this */,
+        jint sampleRate, jint gapMs, jint crossfadeMs, jboolean trim, jfloat gain,
+        jfloat ceiling) {
+
+    if (sampleRate <= 0) return 0;
+    const auto options = audio::StitchOptions::for_rate(sampleRate, gapMs, crossfadeMs,
+                                                        trim == JNI_TRUE, gain, ceiling);
+    return reinterpret_cast<jlong>(new audio::ChunkStitcher(options));
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeStitcherStitch(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jobjectArray jchunks) {
+
+    auto* stitcher = to_stitcher(handle);
+    if (!stitcher || !jchunks) return nullptr;
+    const jsize count = env->GetArrayLength(jchunks);
+
+    // Size the result first: trimming only reads each chunk's edges
+    std::vector<jfloatArray> chunks(static_cast<size_t>(count));
+    std::vector<size_t> voiced(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; ++i) {
+        chunks[i] = static_cast<jfloatArray>(env->GetObjectArrayElement(jchunks, i));
+        if (!chunks[i]) return nullptr;
+        const jsize len = env->GetArrayLength(chunks[i]);
+        auto* pcm = static_cast<const float*>(env->GetPrimitiveArrayCritical(chunks[i], nullptr));
+        if (!pcm) return nullptr;
+        const auto span = stitcher->voiced_span(pcm, static_cast<size_t>(len));
+        env->ReleasePrimitiveArrayCritical(chunks[i], const_cast<float*>(pcm), JNI_ABORT);
+        voiced[i] = span.end - span.begin;
+    }
+
+    const size_t total = stitcher->stitched_length(voiced);
+    jfloatArray result = env->NewFloatArray(static_cast<jsize>(total));
+    if (!result) return nullptr;
+
+    auto* out = static_cast<float*>(env->GetPrimitiveArrayCritical(result, nullptr));
+    if (!out) return nullptr;
+    size_t written = 0;
+    const audio::ChunkStitcher::Sink sink = [&](const float* pcm, size_t samples) {
+        if (written + samples > total) return false;
+        std::copy(pcm, pcm + samples, out + written);
+        written += samples;
+        return true;
+    };
+
+    bool ok = true;
+    for (jsize i = 0; i < count && ok; ++i) {
+        const jsize len = env->GetArrayLength(chunks[i]);
+        auto* pcm = static_cast<const float*>(env->GetPrimitiveArrayCritical(chunks[i], nullptr));
+        if (!pcm) {
+            ok = false;
+            break;
+        }
+        ok = stitcher->add(pcm, static_cast<size_t>(len), sink);
+        env->ReleasePrimitiveArrayCritical(chunks[i], const_cast<float*>(pcm), JNI_ABORT);
+    }
+    ok = ok && stitcher->finish(sink) && written == total;
+    env->ReleasePrimitiveArrayCritical(result, out, 0);
+    stitcher->reset();
+
+    for (jfloatArray chunk : chunks) env->DeleteLocalRef(chunk);
+    return ok ? result : nullptr;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeStitcherWrite(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray jaudio, jlong wavHandle) {
+
+    auto* stitcher = to_stitcher(handle);
+    auto* writer = to_wav_writer(wavHandle);
+    if (!stitcher || !writer || writer->channels() != 1 || !jaudio) return -1;
+
+    // Copy out rather than pin: the sink blocks in writev()
+    thread_local std::vector<float> scratch;
+    scratch.resize(static_cast<size_t>(env->GetArrayLength(jaudio)));
+    env->GetFloatArrayRegion(jaudio, 0, static_cast<jsize>(scratch.size()), scratch.data());
+
+    jlong frames = 0;
+    const bool ok = stitcher->add(scratch.data(), scratch.size(),
+                                  [&](const float* pcm, size_t samples) {
+                                      frames += static_cast<jlong>(samples);
+                                      return writer->write(pcm, samples);
+                                  });
+    return ok ? frames : -1;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeStitcherFinish(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jlong wavHandle) {
+
+    auto* stitcher = to_stitcher(handle);
+    auto* writer = to_wav_writer(wavHandle);
+    if (!stitcher || !writer || writer->channels() != 1) return -1;
+
+    jlong frames = 0;
+    const bool ok = stitcher->finish([&](const float* pcm, size_t samples) {
+        frames += static_cast<jlong>(samples);
+        return writer->write(pcm, samples);
+    });
+    return ok ? frames : -1;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeStitcherDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_stitcher(handle);
+}
+
+// ============================================================================
+// SYNTHESIS PIPELINE (native ONNX Runtime)
+// ============================================================================
+
+static tts::SupertonicPipeline* to_pipeline(jlong handle) {
+    return reinterpret_cast<tts::SupertonicPipeline*>(handle);
+}
+
+static std::vector<jlong> copy_longs(JNIEnv* env, jlongArray array) {
+    std::vector<jlong> out(array ? static_cast<size_t>(env->GetArrayLength(array)) : 0);
+    if (!out.empty()) env->GetLongArrayRegion(array, 0, static_cast<jsize>(out.size()), out.data());
+    return out;
+}
+
+static std::vector<float> copy_floats(JNIEnv* env, jfloatArray array) {
+    std::vector<float> out(array ? static_cast<size_t>(env->GetArrayLength(array)) : 0);
+    if (!out.empty()) env->GetFloatArrayRegion(array, 0, static_cast<jsize>(out.size()), out.data());
+    return out;
+}
+
+static tts::AudioCache* to_audio_cache(jlong handle) {
+    return reinterpret_cast<tts::AudioCache*>(handle);
+}
+
+// Everything that decides the audio of one utterance (the voice by content,
+// not by name, so an edited style file never hits stale entries). Batch
+// position and padded length are deliberately left out: the pipeline draws
+// each item's noise from its own text, so batched, single and streamed
+// synthesis of the same text give the same audio.
+static tts::AudioCacheKey audio_cache_key(const tts::AudioCache& cache, const int64_t* text_ids, size_t count,
+                                          const tts::VoiceStyle& style, jint steps, jfloat speed, jlong seed) {
+    return cache.hasher()
+            .value(static_cast<uint64_t>(count))
+            .update(text_ids, count * sizeof(int64_t))
+            .values(style.ttl).values(style.ttl_shape)
+            .values(style.dp).values(style.dp_shape)
+            .value(static_cast<int32_t>(steps))
+            .value(speed)
+            .value(static_cast<int64_t>(seed))
+            .digest();
+}
+
+static jfloatArray to_float_array(JNIEnv* env, const std::vector<float>& pcm) {
+    jfloatArray result = env->NewFloatArray(static_cast<jsize>(pcm.size()));
+    if (result) {
+        env->SetFloatArrayRegion(result, 0, static_cast<jsize>(pcm.size()), pcm.data());
+    }
+    return result;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineCreate(
+        JNIEnv* /* env */, jobject /* this */) {
+
+    return reinterpret_cast<jlong>(new tts::SupertonicPipeline());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineLoad(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jstring jonnxDir,
+        jint sampleRate, jint baseChunkSize, jint chunkCompressFactor, jint latentDim,
+        jint numThreads, jboolean useNNAPI) {
+
+    auto* pipeline = to_pipeline(handle);
+    if (!pipeline || !jonnxDir) return JNI_FALSE;
+
+    const char* dir = env->GetStringUTFChars(jonnxDir, nullptr);
+    std::string onnx_dir(dir);
+    env->ReleaseStringUTFChars(jonnxDir, dir);
+
+    tts::ModelConfig config;
+    config.sample_rate = sampleRate;
+    config.base_chunk_size = baseChunkSize;
+    config.chunk_compress_factor = chunkCompressFactor;
+    config.latent_dim = latentDim;
+
+    tts::SessionSettings settings;
+    settings.intra_op_threads = numThreads;
+    settings.use_nnapi = useNNAPI == JNI_TRUE;
+
+    return pipeline->load(onnx_dir, config, settings) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineSynthesize(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jlong cacheHandle, jlongArray jtextIds,
+        jfloatArray jstyleTtl, jlongArray jstyleTtlShape,
+        jfloatArray jstyleDp, jlongArray jstyleDpShape,
+        jint steps, jfloat speed, jlong seed) {
+
+    auto* pipeline = to_pipeline(handle);
+    auto* cache = to_audio_cache(cacheHandle);
+    if (!pipeline) return nullptr;
+
+    // jlong is int64_t on every supported ABI
+    static_assert(sizeof(jlong) == sizeof(int64_t), "jlong must be 64-bit");
+
+    const auto text_ids = copy_longs(env, jtextIds);
+
+    tts::VoiceStyle style;
+    style.ttl = copy_floats(env, jstyleTtl);
+    style.dp = copy_floats(env, jstyleDp);
+    const auto ttl_shape = copy_longs(env, jstyleTtlShape);
+    const auto dp_shape = copy_longs(env, jstyleDpShape);
+    style.ttl_shape.assign(ttl_shape.begin(), ttl_shape.end());
+    style.dp_shape.assign(dp_shape.begin(), dp_shape.end());
+
+    const auto* ids = reinterpret_cast<const int64_t*>(text_ids.data());
+    std::vector<float> pcm;
+    tts::AudioCacheKey key;
+    if (cache) {
+        key = audio_cache_key(*cache, ids, text_ids.size(), style, steps, speed, seed);
+        if (cache->get(key, pcm)) return to_float_array(env, pcm);
+    }
+
+    if (!pipeline->synthesize(ids, text_ids.size(), style, steps, speed, static_cast<uint64_t>(seed), pcm)) {
+        return nullptr;
+    }
+    if (cache) cache->put(key, pcm.data(), pcm.size());
+    return to_float_array(env, pcm);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineSynthesizeBatch(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jlong cacheHandle, jobjectArray jtextIds,
+        jfloatArray jstyleTtl, jlongArray jstyleTtlShape,
+        jfloatArray jstyleDp, jlongArray jstyleDpShape,
+        jint steps, jfloat speed, jlong seed) {
+
+    auto* pipeline = to_pipeline(handle);
+    auto* cache = to_audio_cache(cacheHandle);
+    if (!pipeline || !jtextIds) return nullptr;
+
+    const jsize count = env->GetArrayLength(jtextIds);
+    std::vector<std::vector<jlong>> text_ids(static_cast<size_t>(count));
+    std::vector<tts::TextInput> texts(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; ++i) {
+        auto jids = static_cast<jlongArray>(env->GetObjectArrayElement(jtextIds, i));
+        text_ids[i] = copy_longs(env, jids);
+        env->DeleteLocalRef(jids);
+        texts[i] = {reinterpret_cast<const int64_t*>(text_ids[i].data()), text_ids[i].size()};
+    }
+
+    tts::VoiceStyle style;
+    style.ttl = copy_floats(env, jstyleTtl);
+    style.dp = copy_floats(env, jstyleDp);
+    const auto ttl_shape = copy_longs(env, jstyleTtlShape);
+    const auto dp_shape = copy_longs(env, jstyleDpShape);
+    style.ttl_shape.assign(ttl_shape.begin(), ttl_shape.end());
+    style.dp_shape.assign(dp_shape.begin(), dp_shape.end());
+
+    // Only the texts the cache doesn't have go through the models, as one
+    // smaller batch (which doesn't change their audio, see audio_cache_key)
+    std::vector<std::vector<float>> pcm(static_cast<size_t>(count));
+    std::vector<tts::AudioCacheKey> keys(static_cast<size_t>(count));
+    std::vector<size_t> misses;
+    std::vector<tts::TextInput> miss_texts;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (cache) {
+            keys[i] = audio_cache_key(*cache, texts[i].ids, texts[i].len, style, steps, speed, seed);
+            if (cache->get(keys[i], pcm[i])) continue;
+        }
+        misses.push_back(i);
+        miss_texts.push_back(texts[i]);
+    }
+
+    if (!miss_texts.empty()) {
+        std::vector<std::vector<float>> synthesized;
+        if (!pipeline->synthesize_batch(miss_texts, style, steps, speed, static_cast<uint64_t>(seed),
+                                        synthesized)) {
+            return nullptr;
+        }
+        for (size_t j = 0; j < misses.size(); ++j) {
+            auto& audio = pcm[misses[j]];
+            audio = std::move(synthesized[j]);
+            if (cache) cache->put(keys[misses[j]], audio.data(), audio.size());
+        }
+    }
+
+    jclass float_array_class = env->FindClass("[F");
+    jobjectArray result = env->NewObjectArray(count, float_array_class, nullptr);
+    env->DeleteLocalRef(float_array_class);
+    if (!result) return nullptr;
+
+    for (jsize i = 0; i < count; ++i) {
+        const auto& audio = pcm[static_cast<size_t>(i)];
+        jfloatArray item = env->NewFloatArray(static_cast<jsize>(audio.size()));
+        if (!item) return nullptr;
+        env->SetFloatArrayRegion(item, 0, static_cast<jsize>(audio.size()), audio.data());
+        env->SetObjectArrayElement(result, i, item);
+        env->DeleteLocalRef(item);
+    }
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineSynthesizeToRing(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jlong cacheHandle, jlong ringHandle, jlongArray jtextIds,
+        jfloatArray jstyleTtl, jlongArray jstyleTtlShape,
+        jfloatArray jstyleDp, jlongArray jstyleDpShape,
+        jint steps, jfloat speed, jlong seed) {
+
+    auto* pipeline = to_pipeline(handle);
+    auto* cache = to_audio_cache(cacheHandle);
+    auto* ring = reinterpret_cast<audio::AudioRing*>(ringHandle);
+    if (!pipeline || !ring) return JNI_FALSE;
+
+    const auto text_ids = copy_longs(env, jtextIds);
+
+    tts::VoiceStyle style;
+    style.ttl = copy_floats(env, jstyleTtl);
+    style.dp = copy_floats(env, jstyleDp);
+    const auto ttl_shape = copy_longs(env, jstyleTtlShape);
+    const auto dp_shape = copy_longs(env, jstyleDpShape);
+    style.ttl_shape.assign(ttl_shape.begin(), ttl_shape.end());
+    style.dp_shape.assign(dp_shape.begin(), dp_shape.end());
+
+    const auto* ids = reinterpret_cast<const int64_t*>(text_ids.data());
+    tts::AudioCacheKey key;
+    std::vector<float> whole;
+    if (cache) {
+        key = audio_cache_key(*cache, ids, text_ids.size(), style, steps, speed, seed);
+        if (cache->get(key, whole)) {
+            audio::clip_audio(whole.data(), static_cast<int>(whole.size()));
+            return ring->write_all(whole.data(), whole.size()) ? JNI_TRUE : JNI_FALSE;
+        }
+    }
+
+    // Clip in place and hand each vocoder window to the player as it lands;
+    // the cache keeps the unclipped utterance like the other paths do
+    const auto sink = [ring, cache, &whole](float* pcm, size_t samples) {
+        if (cache) whole.insert(whole.end(), pcm, pcm + samples);
+        audio::clip_audio(pcm, static_cast<int>(samples));
+        return ring->write_all(pcm, samples);
+    };
+
+    const bool ok = pipeline->synthesize_stream(ids, text_ids.size(), style,
+            steps, speed, static_cast<uint64_t>(seed), tts::StreamOptions(), sink);
+    if (ok && cache) cache->put(key, whole.data(), whole.size());
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineLastError(
+        JNIEnv* env, jobject /* this */,
+        jlong handle) {
+
+    auto* pipeline = to_pipeline(handle);
+    if (!pipeline || pipeline->last_error().empty()) return nullptr;
+    return env->NewStringUTF(pipeline->last_error().c_str());
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePipelineDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_pipeline(handle);
+}
+
+// ============================================================================
+// MODEL ASSET CACHE (binary, mmapped unicode indexer / voice styles)
+// ============================================================================
+
+static tts::TensorCache* to_tensor_cache(jlong handle) {
+    return reinterpret_cast<tts::TensorCache*>(handle);
+}
+
+static std::string to_std_string(JNIEnv* env, jstring jstr) {
+    if (!jstr) return {};
+    const char* chars = env->GetStringUTFChars(jstr, nullptr);
+    std::string out(chars);
+    env->ReleaseStringUTFChars(jstr, chars);
+    return out;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheConvert(
+        JNIEnv* env, jobject /* this */,
+        jstring jsourcePath, jstring jpath, jint kind) {
+
+    if (!jsourcePath || !jpath || kind < 0 || kind > static_cast<jint>(tts::CacheSource::VoiceStyle)) {
+        return JNI_FALSE;
+    }
+    std::string error;
+    if (!tts::TensorCache::convert(to_std_string(env, jsourcePath), to_std_string(env, jpath),
+                                   static_cast<tts::CacheSource>(kind), &error)) {
+        LOGE("Tensor cache: %s", error.c_str());
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheOpen(
+        JNIEnv* env, jobject /* this */,
+        jstring jpath, jstring jsourcePath) {
+
+    if (!jpath) return 0;
+    auto* cache = new tts::TensorCache();
+    if (!cache->open(to_std_string(env, jpath), to_std_string(env, jsourcePath))) {
+        LOGD("Tensor cache: %s", cache->last_error().c_str());
+        delete cache;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(cache);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheCount(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    auto* cache = to_tensor_cache(handle);
+    return cache ? static_cast<jint>(cache->size()) : 0;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheShape(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jint index) {
+
+    auto* cache = to_tensor_cache(handle);
+    if (!cache || index < 0 || static_cast<size_t>(index) >= cache->size()) return nullptr;
+
+    const std::vector<int64_t>& shape = cache->tensor(static_cast<size_t>(index)).shape;
+    jlongArray out = env->NewLongArray(static_cast<jsize>(shape.size()));
+    if (!out) return nullptr;
+    static_assert(sizeof(jlong) == sizeof(int64_t), "jlong is 64-bit");
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(shape.size()),
+                            reinterpret_cast<const jlong*>(shape.data()));
+    return out;
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheBuffer(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jint index) {
+
+    auto* cache = to_tensor_cache(handle);
+    if (!cache || index < 0 || static_cast<size_t>(index) >= cache->size()) return nullptr;
+
+    // Read-only mapping: the Kotlin side only hands out read-only views
+    const tts::TensorView& view = cache->tensor(static_cast<size_t>(index));
+    return env->NewDirectByteBuffer(const_cast<void*>(view.data), static_cast<jlong>(view.bytes()));
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTensorCacheDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_tensor_cache(handle);
+}
+
+// ============================================================================
+// SYNTHESIS CACHE (content-addressed utterance audio)
+// ============================================================================
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioCacheCreate(
+        JNIEnv* env, jobject /* this */,
+        jstring jdirectory, jlong memoryBytes, jlong diskBytes,
+        jint sampleRate, jstring jmodelId) {
+
+    if (sampleRate <= 0 || memoryBytes < 0 || diskBytes < 0) return 0;
+
+    tts::AudioCacheOptions options;
+    options.sample_rate = sampleRate;
+    options.memory_bytes = static_cast<size_t>(memoryBytes);
+    options.directory = to_std_string(env, jdirectory);
+    options.disk_bytes = static_cast<uint64_t>(diskBytes);
+    options.model_id = to_std_string(env, jmodelId);
+    return reinterpret_cast<jlong>(new tts::AudioCache(options));
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioCacheClear(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    auto* cache = to_audio_cache(handle);
+    if (cache) cache->clear();
+}
+
+// [memory hits, disk hits, misses, memory bytes, disk bytes]
+JNIEXPORT jlongArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioCacheStats(
+        JNIEnv* env, jobject /* this */,
+        jlong handle) {
+
+    auto* cache = to_audio_cache(handle);
+    if (!cache) return nullptr;
+
+    const tts::AudioCache::Stats stats = cache->stats();
+    const jlong values[] = {
+            static_cast<jlong>(stats.memory_hits), static_cast<jlong>(stats.disk_hits),
+            static_cast<jlong>(stats.misses), static_cast<jlong>(stats.memory_bytes),
+            static_cast<jlong>(stats.disk_bytes),
+    };
+    jlongArray result = env->NewLongArray(5);
+    if (result) env->SetLongArrayRegion(result, 0, 5, values);
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioCacheDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_audio_cache(handle);
+}
+
+// ============================================================================
+// AUDIO RING (streamed synthesis -> playback)
+// ============================================================================
+
+static audio::AudioRing* to_ring(jlong handle) {
+    return reinterpret_cast<audio::AudioRing*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingCreate(
+        JNIEnv* /* env */, jobject /* this */,
+        jint capacity) {
+
+    return reinterpret_cast<jlong>(new audio::AudioRing(static_cast<size_t>(std::max(capacity, 1))));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingRead(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray jout, jint timeoutMs) {
+
+    auto* ring = to_ring(handle);
+    if (!ring || !jout) return -1;
+
+    // Read into a native scratch buffer, then one region copy: the wait
+    // must not happen while holding the Java array
+    thread_local std::vector<float> scratch;
+    scratch.resize(static_cast<size_t>(env->GetArrayLength(jout)));
+
+    const long count = ring->read_wait(scratch.data(), scratch.size(), timeoutMs);
+    if (count > 0) {
+        env->SetFloatArrayRegion(jout, 0, static_cast<jsize>(count), scratch.data());
+    }
+    return static_cast<jint>(count);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingWrite(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jfloatArray jaudio, jint offset, jint length) {
+
+    auto* ring = to_ring(handle);
+    if (!ring || !jaudio || offset < 0 || length < 0 ||
+        offset > env->GetArrayLength(jaudio) - length) {
+        return JNI_FALSE;
+    }
+
+    // Same as reads: copy out first, never wait while holding the array
+    thread_local std::vector<float> scratch;
+    scratch.resize(static_cast<size_t>(length));
+    env->GetFloatArrayRegion(jaudio, offset, length, scratch.data());
+    return ring->write_all(scratch.data(), scratch.size()) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingWriteSilence(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jint samples) {
+
+    auto* ring = to_ring(handle);
+    if (!ring || samples <= 0) return ring ? JNI_TRUE : JNI_FALSE;
+    return ring->write_all(nullptr, static_cast<size_t>(samples)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingClose(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* ring = to_ring(handle)) ring->close();
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingCancel(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* ring = to_ring(handle)) ring->cancel();
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeAudioRingDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_ring(handle);
+}
+
+// ============================================================================
+// PLAYBACK FEEDER (ring -> AAudio on a native thread)
+// ============================================================================
+
+static audio::PlaybackFeeder* to_feeder(jlong handle) {
+    return reinterpret_cast<audio::PlaybackFeeder*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackStart(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong ringHandle, jint sampleRate) {
+
+    auto* ring = to_ring(ringHandle);
+    if (!ring || sampleRate <= 0) return 0;
+
+    // Opened first so the feeder knows the device rate
+    auto sink = std::make_unique<audio::AAudioSink>();
+    if (!sink->open()) {
+        LOGW("AAudio unavailable: %s", sink->last_error().c_str());
+        return 0;
+    }
+
+    auto feeder = std::make_unique<audio::PlaybackFeeder>(*ring, std::move(sink), sampleRate);
+    if (!feeder->start()) {
+        LOGW("Playback start failed: %s", feeder->last_error().c_str());
+        return 0;
+    }
+    return reinterpret_cast<jlong>(feeder.release());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackWait(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jint timeoutMs) {
+
+    auto* feeder = to_feeder(handle);
+    return !feeder || feeder->wait(timeoutMs) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackPause(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* feeder = to_feeder(handle)) feeder->pause();
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackResume(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* feeder = to_feeder(handle)) feeder->resume();
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackSetGain(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle, jfloat gain) {
+
+    if (auto* feeder = to_feeder(handle)) feeder->set_gain(gain);
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackStop(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* feeder = to_feeder(handle)) feeder->stop();
+}
+
+// [samples played, underruns, starved ms, first audio ms, ring underruns,
+//  ring low water (samples), device xruns, device rate]
+JNIEXPORT jdoubleArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackStats(
+        JNIEnv* env, jobject /* this */,
+        jlong handle) {
+
+    auto* feeder = to_feeder(handle);
+    if (!feeder) return nullptr;
+
+    const audio::PlaybackFeeder::Stats stats = feeder->stats();
+    const jdouble values[] = {
+            static_cast<jdouble>(stats.samples_played), static_cast<jdouble>(stats.underruns),
+            stats.starved_ms, stats.first_audio_ms,
+            static_cast<jdouble>(stats.ring_underruns), static_cast<jdouble>(stats.ring_low_water),
+            static_cast<jdouble>(stats.device_xruns), static_cast<jdouble>(stats.sink_rate),
+    };
+    jdoubleArray result = env->NewDoubleArray(8);
+    if (result) env->SetDoubleArrayRegion(result, 0, 8, values);
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativePlaybackDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_feeder(handle);
+}
+
+// ============================================================================
+// TEXT PROCESSING (normalization + unicode indexing)
+// ============================================================================
+
+static text::TextProcessor* to_text_processor(jlong handle) {
+    return reinterpret_cast<text::TextProcessor*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTextProcessorCreate(
+        JNIEnv* env, jobject /* this */,
+        jobject jindexer) {
+
+    // Not copied: the Kotlin side keeps the buffer (often a mapped cache) alive
+    const auto* table = jindexer ? static_cast<const int32_t*>(env->GetDirectBufferAddress(jindexer)) : nullptr;
+    const jlong bytes = jindexer ? env->GetDirectBufferCapacity(jindexer) : -1;
+    if (!table || bytes < 0) return 0;
+    return reinterpret_cast<jlong>(new text::TextProcessor(table, static_cast<size_t>(bytes) / sizeof(int32_t)));
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTextProcessorProcess(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jstring jtext, jstring jlanguageTag) {
+
+    auto* processor = to_text_processor(handle);
+    if (!processor || !jtext || !jlanguageTag) return nullptr;
+
+    const std::string tag = to_std_string(env, jlanguageTag);
+    thread_local std::vector<int64_t> ids;
+
+    // UTF-16 straight from the string; processing never blocks
+    const jsize length = env->GetStringLength(jtext);
+    const jchar* chars = env->GetStringCritical(jtext, nullptr);
+    if (!chars) return nullptr;
+    processor->process(reinterpret_cast<const char16_t*>(chars), static_cast<size_t>(length), tag, ids);
+    env->ReleaseStringCritical(jtext, chars);
+
+    jlongArray out = env->NewLongArray(static_cast<jsize>(ids.size()));
+    if (!out) return nullptr;
+    static_assert(sizeof(jlong) == sizeof(int64_t), "jlong is 64-bit");
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(ids.size()), reinterpret_cast<const jlong*>(ids.data()));
+    return out;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeTextProcessorDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    delete to_text_processor(handle);
+}
+
+// ============================================================================
+// SENTENCE STREAM (LLM token stream -> TTS segments)
+// ============================================================================
+// Strings cross the boundary as modified UTF-8; the segmenter only looks at
+// ASCII and BMP punctuation, so supplementary characters pass through intact.
+
+static text::SentenceStream* to_stream(jlong handle) {
+    return reinterpret_cast<text::SentenceStream*>(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamCreate(
+        JNIEnv* /* env */, jobject /* this */,
+        jint language, jint maxLen, jint firstClauseMin) {
+
+    auto* stream = new text::SentenceStream(
+            static_cast<text::Language>(language),
+            static_cast<size_t>(maxLen > 0 ? maxLen : 0),
+            static_cast<size_t>(firstClauseMin > 0 ? firstClauseMin : 0));
+    return reinterpret_cast<jlong>(stream);
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamFeed(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jstring jtext) {
+
+    auto* stream = to_stream(handle);
+    if (!stream || !jtext) return;
+
+    const char* chars = env->GetStringUTFChars(jtext, nullptr);
+    if (!chars) return;
+    stream->feed(chars, static_cast<size_t>(env->GetStringUTFLength(jtext)));
+    env->ReleaseStringUTFChars(jtext, chars);
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamFinish(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* stream = to_stream(handle)) stream->finish();
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamCancel(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    if (auto* stream = to_stream(handle)) stream->cancel();
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamPoll(
+        JNIEnv* env, jobject /* this */,
+        jlong handle, jint timeoutMs) {
+
+    auto* stream = to_stream(handle);
+    if (!stream) return nullptr;
+
+    std::string segment;
+    switch (stream->poll(segment, timeoutMs)) {
+        case text::SentenceStream::PollResult::Segment:
+            return env->NewStringUTF(segment.c_str());
+        case text::SentenceStream::PollResult::Timeout:
+            return env->NewStringUTF("");
+        case text::SentenceStream::PollResult::Closed:
+            break;
+    }
+    return nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_com_mp_ai_1supertonic_1tts_SupertonicNativeLib_nativeSentenceStreamDestroy(
+        JNIEnv* /* env */, jobject /* this */,
+        jlong handle) {
+
+    auto* stream = to_stream(handle);
+    if (!stream) return;
+    LOGD("Sentence stream closed after %zu segments", stream->segments_emitted());
+    delete stream;
+}
+
 } // extern "C"
@@ -0,0 +1,310 @@
+#include "sentence_segmenter.h"
+
+#include <cstring>
+
+namespace text {
+
+namespace {
+
+constexpr size_t DEFAULT_MAX_LEN = 300;
+constexpr size_t KOREAN_MAX_LEN = 120;
+
+// Abbreviations that never end a sentence (matched case-sensitively,
+// including the trailing dot)
+const char* const COMMON_ABBREVIATIONS[] = {
+        "Dr.", "Mr.", "Mrs.", "Ms.", "Prof.", "Sr.", "Jr.",
+        "St.", "Ave.", "Rd.", "Blvd.", "Dept.", "Inc.", "Ltd.",
+        "Co.", "Corp.", "etc.", "vs.", "No.", "approx.", nullptr
+};
+
+const char* const ES_ABBREVIATIONS[] = {
+        "Sra.", "Srta.", "Dra.", "Ud.", "Uds.", "Lic.", "Ing.",
+        "pág.", "núm.", "aprox.", nullptr
+};
+
+const char* const PT_ABBREVIATIONS[] = {
+        "Sra.", "Srta.", "Dra.", "Exmo.", "Exma.", "pág.", "núm.",
+        "aprox.", nullptr
+};
+
+const char* const FR_ABBREVIATIONS[] = {
+        "Mme.", "Mlle.", "Mmes.", "Mlles.", "Pr.", "Ste.", "av.", "env.",
+        nullptr
+};
+
+size_t utf8_len(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xE0) == 0xC0) return 2;
+    if ((lead & 0xF0) == 0xE0) return 3;
+    if ((lead & 0xF8) == 0xF0) return 4;
+    return 1;  // Stray continuation byte: step over it alone
+}
+
+uint32_t decode(const std::string& s, size_t i, size_t n) {
+    auto b = [&](size_t k) { return static_cast<uint32_t>(static_cast<unsigned char>(s[i + k])); };
+    switch (n) {
+        case 2: return ((b(0) & 0x1F) << 6) | (b(1) & 0x3F);
+        case 3: return ((b(0) & 0x0F) << 12) | ((b(1) & 0x3F) << 6) | (b(2) & 0x3F);
+        case 4: return ((b(0) & 0x07) << 18) | ((b(1) & 0x3F) << 12) | ((b(2) & 0x3F) << 6) | (b(3) & 0x3F);
+        default: return b(0);
+    }
+}
+
+size_t count_code_points(const std::string& s, size_t from, size_t to) {
+    size_t n = 0;
+    for (size_t i = from; i < to; ++i) {
+        if ((static_cast<unsigned char>(s[i]) & 0xC0) != 0x80) ++n;
+    }
+    return n;
+}
+
+bool is_space(uint32_t cp) {
+    return cp == ' ' || cp == '\t' || cp == '\r' || cp == '\n' ||
+           cp == 0x00A0 || cp == 0x202F || cp == 0x3000;
+}
+
+bool is_cjk_terminator(uint32_t cp) {
+    return cp == 0x3002 || cp == 0xFF01 || cp == 0xFF1F || cp == 0xFF0E;  // 。！？．
+}
+
+bool is_terminator(uint32_t cp) {
+    return cp == '.' || cp == '!' || cp == '?' || cp == 0x2026 || is_cjk_terminator(cp);
+}
+
+// Characters that stay attached to the sentence they close
+bool is_closer(uint32_t cp) {
+    switch (cp) {
+        case '"': case '\'': case ')': case ']': case '}':
+        case '*': case '_': case '`':                        // Markdown emphasis
+        case 0x2019: case 0x201D:                            // ’ ”
+        case 0x00BB: case 0x203A:                            // » ›
+        case 0x3009: case 0x300B: case 0x300D: case 0x300F:  // 〉 》 」 』
+        case 0x3011: case 0xFF09:                            // 】 ）
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_clause_break(uint32_t cp) {
+    return cp == ',' || cp == ';' || cp == ':' ||
+           cp == 0x2013 || cp == 0x2014 ||                    // – —
+           cp == 0x3001 || cp == 0xFF0C || cp == 0xFF1A || cp == 0xFF1B;  // 、，：；
+}
+
+bool is_speakable(uint32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= '0' && cp <= '9') || (cp >= 'A' && cp <= 'Z') || (cp >= 'a' && cp <= 'z');
+    }
+    if (cp >= 0x2000 && cp <= 0x206F) return false;  // General punctuation
+    if (cp >= 0x3000 && cp <= 0x303F) return false;  // CJK symbols and punctuation
+    return !is_space(cp) && !is_closer(cp) && !is_clause_break(cp) && !is_terminator(cp) &&
+           cp != 0x00A1 && cp != 0x00BF && cp != 0x00AB;  // ¡ ¿ «
+}
+
+bool in_list(const char* const* list, const char* word, size_t len) {
+    for (; *list; ++list) {
+        if (std::strlen(*list) == len && std::memcmp(*list, word, len) == 0) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+size_t default_max_len(Language lang) {
+    return lang == Language::KO ? KOREAN_MAX_LEN : DEFAULT_MAX_LEN;
+}
+
+SentenceSegmenter::SentenceSegmenter(Language lang, size_t max_len, size_t first_clause_min)
+        : lang_(lang),
+          max_len_(max_len > 0 ? max_len : default_max_len(lang)),
+          first_clause_min_(first_clause_min) {}
+
+void SentenceSegmenter::feed(const char* data, size_t len, std::vector<std::string>& out) {
+    if (!data || len == 0) return;
+    buf_.append(data, len);
+
+    size_t end;
+    while ((end = find_boundary()) != npos) {
+        cut(end, out);
+    }
+}
+
+void SentenceSegmenter::flush(std::vector<std::string>& out) {
+    if (!buf_.empty()) cut(buf_.size(), out);
+}
+
+void SentenceSegmenter::reset() {
+    buf_.clear();
+    scan_ = 0;
+    cp_count_ = 0;
+    last_clause_ = 0;
+    last_space_ = 0;
+    emitted_ = 0;
+}
+
+size_t SentenceSegmenter::find_boundary() {
+    const size_t size = buf_.size();
+    size_t i = scan_;
+
+    while (i < size) {
+        const size_t n = utf8_len(static_cast<unsigned char>(buf_[i]));
+        if (i + n > size) break;  // Incomplete character, wait for the rest
+        const uint32_t cp = decode(buf_, i, n);
+
+        if (cp == '\n') {
+            scan_ = i;
+            return i + 1;
+        }
+
+        if (is_terminator(cp)) {
+            // Take the whole run of terminators and closers ("?!", "...", ".\"")
+            size_t j = i;
+            bool cjk = false;
+            bool complete = true;
+            while (j < size) {
+                const size_t m = utf8_len(static_cast<unsigned char>(buf_[j]));
+                if (j + m > size) { complete = false; break; }
+                const uint32_t c = decode(buf_, j, m);
+                if (is_terminator(c)) {
+                    cjk |= is_cjk_terminator(c);
+                } else if (!is_closer(c)) {
+                    break;
+                }
+                j += m;
+            }
+            if (!complete || j == size) {
+                // Whether this ends the sentence depends on what follows
+                scan_ = i;
+                return npos;
+            }
+            if (cjk) {
+                scan_ = i;
+                return j;
+            }
+
+            const size_t m = utf8_len(static_cast<unsigned char>(buf_[j]));
+            if (j + m > size) {
+                scan_ = i;
+                return npos;
+            }
+            const uint32_t next = decode(buf_, j, m);
+            if (is_space(next) && !(buf_[i] == '.' && j == i + 1 && is_abbreviation(i))) {
+                // French sets a space before the closing guillemet: « Oui ! »
+                if (lang_ == Language::FR && next != '\n') {
+                    const size_t k = j + m;
+                    const size_t kn = k < size ? utf8_len(static_cast<unsigned char>(buf_[k])) : 1;
+                    if (k + kn > size) {
+                        scan_ = i;
+                        return npos;
+                    }
+                    if (decode(buf_, k, kn) == 0x00BB) j = k + kn;
+                }
+                scan_ = i;
+                return j;
+            }
+
+            // Decimal, file name, abbreviation...: ordinary text
+            cp_count_ += count_code_points(buf_, i, j);
+            i = j;
+        } else {
+            if (is_clause_break(cp)) {
+                last_clause_ = i + n;
+            } else if (is_space(cp)) {
+                if (last_clause_ == i && emitted_ == 0 && first_clause_min_ > 0 &&
+                    cp_count_ >= first_clause_min_) {
+                    scan_ = i;
+                    return i;
+                }
+                last_space_ = i;
+            }
+            ++cp_count_;
+            i += n;
+        }
+
+        if (cp_count_ >= max_len_) {
+            scan_ = i;
+            if (last_clause_ > 0) return last_clause_;
+            if (last_space_ > 0) return last_space_;
+            return i;
+        }
+    }
+
+    scan_ = i;
+    return npos;
+}
+
+bool SentenceSegmenter::is_abbreviation(size_t dot_pos) const {
+    // Word before the dot, without leading whitespace or opening punctuation
+    size_t start = dot_pos;
+    while (start > 0 && !is_space(static_cast<unsigned char>(buf_[start - 1]))) --start;
+    while (start < dot_pos && std::strchr("(\"'[", buf_[start])) ++start;
+    const size_t len = dot_pos + 1 - start;
+    if (len < 2) return false;
+
+    const char* word = buf_.data() + start;
+
+    // List number at the start of a segment ("1. First step")
+    bool digits = true;
+    for (size_t k = 0; k + 1 < len; ++k) {
+        if (word[k] < '0' || word[k] > '9') { digits = false; break; }
+    }
+    if (digits) {
+        for (size_t k = 0; k < start; ++k) {
+            if (!is_space(static_cast<unsigned char>(buf_[k]))) return false;
+        }
+        return true;
+    }
+
+    // Initial ("J. Smith", French "M. Dupont")
+    if (len == 2 && word[0] >= 'A' && word[0] <= 'Z') return true;
+
+    // Dotted abbreviation ("e.g.", "U.S.", "p.ej.")
+    if (len <= 6 && std::memchr(word, '.', len - 1) != nullptr) return true;
+
+    if (in_list(COMMON_ABBREVIATIONS, word, len)) return true;
+    switch (lang_) {
+        case Language::ES: return in_list(ES_ABBREVIATIONS, word, len);
+        case Language::PT: return in_list(PT_ABBREVIATIONS, word, len);
+        case Language::FR: return in_list(FR_ABBREVIATIONS, word, len);
+        default:           return false;
+    }
+}
+
+void SentenceSegmenter::cut(size_t end, std::vector<std::string>& out) {
+    std::string segment = buf_.substr(0, end);
+    buf_.erase(0, end);
+    scan_ = 0;
+    cp_count_ = 0;
+    last_clause_ = 0;
+    last_space_ = 0;
+
+    // Trim ASCII and non-breaking whitespace
+    size_t b = 0;
+    size_t e = segment.size();
+    while (b < e) {
+        const size_t n = utf8_len(static_cast<unsigned char>(segment[b]));
+        if (b + n > e || !is_space(decode(segment, b, n))) break;
+        b += n;
+    }
+    while (e > b) {
+        size_t s = e - 1;
+        while (s > b && (static_cast<unsigned char>(segment[s]) & 0xC0) == 0x80) --s;
+        if (!is_space(decode(segment, s, e - s))) break;
+        e = s;
+    }
+
+    bool speakable = false;
+    for (size_t i = b; i < e && !speakable;) {
+        const size_t n = utf8_len(static_cast<unsigned char>(segment[i]));
+        if (i + n > e) break;
+        speakable = is_speakable(decode(segment, i, n));
+        i += n;
+    }
+    if (!speakable) return;
+
+    out.push_back(segment.substr(b, e - b));
+    ++emitted_;
+}
+
+} // namespace text
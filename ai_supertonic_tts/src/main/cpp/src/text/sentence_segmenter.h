@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace text {
+
+/**
+ * Synthesis language. Values match the ordinal of the Kotlin `Language` enum.
+ */
+enum class Language : int32_t {
+    EN = 0,
+    KO = 1,
+    ES = 2,
+    PT = 3,
+    FR = 4,
+};
+
+/**
+ * Default maximum segment length in code points (same as TextChunker)
+ */
+size_t default_max_len(Language lang);
+
+/**
+ * Incremental sentence/clause splitter for streamed text.
+ *
+ * Text arrives in arbitrary pieces (LLM tokens). A segment is emitted as
+ * soon as its boundary is certain:
+ * - sentence end: `.`, `!`, `?`, `…` (plus closing quotes/brackets) followed
+ *   by whitespace, unless the word is a known abbreviation for the language
+ *   or a list number ("1.") at the start of a segment
+ * - CJK sentence end (`。`, `！`, `？`) immediately
+ * - line break
+ * - clause break (`,`, `;`, `:`, dash) once the segment is longer than
+ *   `max_len` - or, for the first segment only, once it is longer than
+ *   `first_clause_min`, so the first audio starts as early as possible
+ * - the last space (or a hard cut) when no clause break exists
+ *
+ * Emitted segments are trimmed; segments without any letter or digit
+ * (markdown rules, stray punctuation) are dropped. Incomplete UTF-8
+ * sequences at the end of a piece are held until the next one.
+ */
+class SentenceSegmenter {
+public:
+    /**
+     * `max_len` 0 = language default. `first_clause_min` 0 = first segment
+     * waits for a full sentence like the others.
+     */
+    explicit SentenceSegmenter(Language lang, size_t max_len = 0, size_t first_clause_min = 0);
+
+    /**
+     * Append text; every segment closed by it is appended to `out`
+     */
+    void feed(const char* data, size_t len, std::vector<std::string>& out);
+
+    /**
+     * End of input: emit whatever is left as a final segment
+     */
+    void flush(std::vector<std::string>& out);
+
+    /**
+     * Drop pending text and start over (keeps the options)
+     */
+    void reset();
+
+    size_t segments_emitted() const { return emitted_; }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Byte offset where the next segment ends, or npos if more input is needed
+    size_t find_boundary();
+
+    bool is_abbreviation(size_t dot_pos) const;
+    void cut(size_t end, std::vector<std::string>& out);
+
+    Language lang_;
+    size_t max_len_;
+    size_t first_clause_min_;
+
+    std::string buf_;        // Open segment (bytes not yet emitted)
+    size_t scan_ = 0;        // Bytes of buf_ already classified
+    size_t cp_count_ = 0;    // Code points in buf_[0, scan_)
+    size_t last_clause_ = 0; // End of last clause break in buf_ (0 = none)
+    size_t last_space_ = 0;  // Position of last whitespace in buf_ (0 = none)
+    size_t emitted_ = 0;
+};
+
+} // namespace text
@@ -0,0 +1,69 @@
+#include "sentence_stream.h"
+
+#include <chrono>
+
+namespace text {
+
+SentenceStream::SentenceStream(Language lang, size_t max_len, size_t first_clause_min)
+        : segmenter_(lang, max_len, first_clause_min) {}
+
+void SentenceStream::feed(const char* data, size_t len) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (closed_) return;
+
+    segmenter_.feed(data, len, scratch_);
+    push_locked(scratch_);
+}
+
+void SentenceStream::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) return;
+
+        segmenter_.flush(scratch_);
+        push_locked(scratch_);
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+void SentenceStream::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        segmenter_.reset();
+        queue_.clear();
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+SentenceStream::PollResult SentenceStream::poll(std::string& out, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto ready = [this] { return !queue_.empty() || closed_; };
+
+    if (timeout_ms < 0) {
+        cv_.wait(lock, ready);
+    } else if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+        return PollResult::Timeout;
+    }
+
+    if (queue_.empty()) return PollResult::Closed;
+
+    out = std::move(queue_.front());
+    queue_.pop_front();
+    return PollResult::Segment;
+}
+
+size_t SentenceStream::segments_emitted() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return segmenter_.segments_emitted();
+}
+
+void SentenceStream::push_locked(std::vector<std::string>& segments) {
+    if (segments.empty()) return;
+    for (auto& s : segments) queue_.push_back(std::move(s));
+    segments.clear();
+    cv_.notify_one();
+}
+
+} // namespace text
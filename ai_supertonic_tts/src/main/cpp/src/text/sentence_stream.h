@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sentence_segmenter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace text {
+
+/**
+ * Bridge between a text producer (LLM token callback) and a TTS consumer.
+ *
+ * The producer feeds generated text as it arrives; every segment the
+ * SentenceSegmenter closes goes onto a work queue right away, so synthesis
+ * of the first sentence starts while the rest of the reply is still being
+ * generated. The consumer blocks in poll() until a segment is ready.
+ *
+ * All methods are thread-safe. feed/finish normally run on the generation
+ * thread and poll on the synthesis thread; cancel may come from anywhere.
+ */
+class SentenceStream {
+public:
+    enum class PollResult {
+        Segment,   // `out` holds the next segment
+        Timeout,   // Nothing ready yet
+        Closed,    // finish() or cancel() was called and the queue is drained
+    };
+
+    SentenceStream(Language lang, size_t max_len, size_t first_clause_min);
+
+    /**
+     * Feed generated text (any split, UTF-8). Ignored after finish/cancel.
+     */
+    void feed(const char* data, size_t len);
+
+    /**
+     * End of generation: the pending text becomes the last segment
+     */
+    void finish();
+
+    /**
+     * Drop pending text and queued segments, wake the consumer
+     */
+    void cancel();
+
+    /**
+     * Wait up to `timeout_ms` for the next segment (< 0 = wait forever)
+     */
+    PollResult poll(std::string& out, int timeout_ms);
+
+    size_t segments_emitted() const;
+
+private:
+    void push_locked(std::vector<std::string>& segments);
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    SentenceSegmenter segmenter_;
+    std::deque<std::string> queue_;
+    std::vector<std::string> scratch_;  // Reused per feed
+    bool closed_ = false;
+};
+
+} // namespace text
@@ -0,0 +1,298 @@
+#include "text_processor.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+namespace text {
+
+namespace {
+
+enum CharAction : uint8_t { KEEP = 0, DROP, MAP };
+
+struct CharRule {
+    uint32_t first;
+    uint32_t last;
+    CharAction action;
+    uint32_t to;
+};
+
+// Per-code-point cleanup, sorted by range; anything not listed is kept
+constexpr CharRule RULES[] = {
+        {'#', '#', MAP, ' '},
+        {'/', '/', MAP, ' '},
+        {'[', '[', MAP, ' '},
+        {'\\', '\\', DROP, 0},
+        {']', ']', MAP, ' '},
+        {'_', '_', MAP, ' '},
+        {'`', '`', MAP, '\''},
+        {'|', '|', MAP, ' '},
+        {0x00A9, 0x00A9, DROP, 0},     // ©
+        {0x00B4, 0x00B4, MAP, '\''},   // Acute accent
+        {0x2011, 0x2011, MAP, '-'},    // Non-breaking hyphen
+        {0x2013, 0x2014, MAP, '-'},    // En/em dash
+        {0x2018, 0x2019, MAP, '\''},   // Single quotes
+        {0x201C, 0x201D, MAP, '"'},    // Double quotes
+        {0x2190, 0x2190, MAP, ' '},    // Left arrow
+        {0x2192, 0x2192, MAP, ' '},    // Right arrow
+        {0x2600, 0x27BF, DROP, 0},     // Misc symbols (incl. ♥ ☆ ♡), dingbats
+        {0x1F1E6, 0x1F1FF, DROP, 0},   // Regional indicators
+        {0x1F300, 0x1F64F, DROP, 0},   // Pictographs, emoticons
+        {0x1F680, 0x1FAFF, DROP, 0},   // Transport ... symbols & pictographs ext-A
+};
+
+struct AsciiRule {
+    CharAction action = KEEP;
+    uint32_t to = 0;
+};
+
+constexpr std::array<AsciiRule, 128> make_ascii_rules() {
+    std::array<AsciiRule, 128> table{};
+    for (const CharRule& rule : RULES) {
+        for (uint32_t c = rule.first; c <= rule.last && c < 128; ++c) table[c] = {rule.action, rule.to};
+    }
+    return table;
+}
+
+constexpr std::array<AsciiRule, 128> ASCII_RULES = make_ascii_rules();
+
+// Apply the rule for cp; false if it is dropped
+bool apply_rule(uint32_t& cp) {
+    CharAction action = KEEP;
+    uint32_t to = 0;
+    if (cp < 128) {
+        action = ASCII_RULES[cp].action;
+        to = ASCII_RULES[cp].to;
+    } else if (cp >= 0xA9) {
+        const CharRule* end = std::end(RULES);
+        const CharRule* rule = std::upper_bound(std::begin(RULES), end, cp,
+                [](uint32_t c, const CharRule& r) { return c < r.first; });
+        if (rule != std::begin(RULES) && cp <= (rule - 1)->last) {
+            action = (rule - 1)->action;
+            to = (rule - 1)->to;
+        }
+    }
+    if (action == DROP) return false;
+    if (action == MAP) cp = to;
+    return true;
+}
+
+// Java's \s
+bool is_space(uint32_t cp) {
+    return cp == ' ' || (cp >= '\t' && cp <= '\r');
+}
+
+// Also removed by trim() at either end (Kotlin isWhitespace)
+bool is_trimmed(uint32_t cp) {
+    return is_space(cp) || (cp >= 0x1C && cp <= 0x1F) || cp == 0xA0 || cp == 0x1680 ||
+           (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 || cp == 0x202F ||
+           cp == 0x205F || cp == 0x3000;
+}
+
+// Lose the space in front of them
+bool is_tight_punct(uint32_t cp) {
+    return cp == ',' || cp == '.' || cp == '!' || cp == '?' || cp == ';' || cp == ':' || cp == '\'';
+}
+
+// Not matched by the reference's `.`, so a text containing one always gets a final "."
+bool is_line_break(uint32_t cp) {
+    return cp == 0x85 || cp == 0x2028 || cp == 0x2029;
+}
+
+constexpr uint32_t SENTENCE_END[] = {
+        '!', '"', '\'', ')', ',', '.', ':', ';', '?', ']', '}', 0xBB, 0x2018, 0x2019,
+        0x201C, 0x201D, 0x2026, 0x203A, 0x3009, 0x300B, 0x300D, 0x300F, 0x3011, 0x3002,
+};
+
+bool ends_sentence(uint32_t cp) {
+    return std::find(std::begin(SENTENCE_END), std::end(SENTENCE_END), cp) != std::end(SENTENCE_END);
+}
+
+struct Expansion {
+    const char* from;
+    const char* to;
+};
+
+constexpr Expansion EXPANSIONS[] = {
+        {"e.g.,", "for example, "},
+        {"i.e.,", "that is, "},
+};
+constexpr size_t MAX_EXPANSION_FROM = 5;
+
+/**
+ * The cleanup stages, each feeding the next one code point at a time:
+ * rules/"@" -> abbreviations -> space before punctuation -> quote runs ->
+ * whitespace -> out
+ */
+class Normalizer {
+public:
+    explicit Normalizer(std::vector<uint32_t>& out) : out_(out) {}
+
+    void feed(uint32_t cp) {
+        if (!apply_rule(cp)) return;
+        if (cp == '@') {
+            for (char c : {' ', 'a', 't', ' '}) abbreviations(static_cast<uint32_t>(c));
+            return;
+        }
+        abbreviations(cp);
+    }
+
+    void finish() {
+        for (size_t i = 0; i < pending_count_; ++i) tight_punct(pending_[i]);
+        pending_count_ = 0;
+        if (held_space_) quote_runs(' ');
+        held_space_ = false;
+
+        // Trim: drop the trailing run (leading ones were never emitted)
+        while (out_.size() > body_start_ && is_trimmed(out_.back())) out_.pop_back();
+    }
+
+    void set_body_start() { body_start_ = out_.size(); }
+
+private:
+    // "e.g.," / "i.e.,": hold a possible match until it completes or breaks
+    void abbreviations(uint32_t cp) {
+        pending_[pending_count_++] = cp;
+        while (pending_count_ > 0) {
+            bool prefix = false;
+            for (const Expansion& e : EXPANSIONS) {
+                const size_t len = std::strlen(e.from);
+                if (pending_count_ > len) continue;
+                bool match = true;
+                for (size_t i = 0; i < pending_count_ && match; ++i) {
+                    match = pending_[i] == static_cast<uint32_t>(static_cast<unsigned char>(e.from[i]));
+                }
+                if (!match) continue;
+                if (pending_count_ == len) {
+                    pending_count_ = 0;
+                    for (const char* p = e.to; *p; ++p) tight_punct(static_cast<uint32_t>(*p));
+                    return;
+                }
+                prefix = true;
+            }
+            if (prefix) return;
+
+            tight_punct(pending_[0]);
+            std::copy(pending_ + 1, pending_ + pending_count_, pending_);
+            --pending_count_;
+        }
+    }
+
+    // " ," -> "," etc: exactly one space before the mark goes
+    void tight_punct(uint32_t cp) {
+        if (held_space_) {
+            held_space_ = false;
+            if (is_tight_punct(cp)) {
+                quote_runs(cp);
+                return;
+            }
+            quote_runs(' ');
+        }
+        if (cp == ' ') {
+            held_space_ = true;
+            return;
+        }
+        quote_runs(cp);
+    }
+
+    void quote_runs(uint32_t cp) {
+        if ((cp == '"' || cp == '\'') && cp == last_quote_stage_) return;
+        last_quote_stage_ = cp;
+        whitespace(cp);
+    }
+
+    // \s runs -> one space; leading trim-only characters are skipped
+    void whitespace(uint32_t cp) {
+        if (is_space(cp)) {
+            space_run_ = true;
+            return;
+        }
+        const bool empty = out_.size() == body_start_;
+        if (empty && is_trimmed(cp)) {
+            space_run_ = false;
+            return;
+        }
+        if (space_run_ && !empty) out_.push_back(' ');
+        space_run_ = false;
+        out_.push_back(cp);
+    }
+
+    std::vector<uint32_t>& out_;
+    size_t body_start_ = 0;
+
+    uint32_t pending_[MAX_EXPANSION_FROM] = {};
+    size_t pending_count_ = 0;
+    bool held_space_ = false;
+    uint32_t last_quote_stage_ = 0;
+    bool space_run_ = false;
+};
+
+void append_ascii(std::vector<uint32_t>& out, const char* s) {
+    for (; *s; ++s) out.push_back(static_cast<uint32_t>(static_cast<unsigned char>(*s)));
+}
+
+} // namespace
+
+TextProcessor::TextProcessor(const int32_t* indexer, size_t size)
+        : indexer_(indexer), size_(indexer ? size : 0) {}
+
+void TextProcessor::normalize(const char16_t* text, size_t length, const std::string& language_tag,
+                              std::vector<uint32_t>& out) {
+    out.clear();
+    out.reserve(length + 2 * language_tag.size() + 8);
+    out.push_back('<');
+    append_ascii(out, language_tag.c_str());
+    out.push_back('>');
+
+    Normalizer normalizer(out);
+    normalizer.set_body_start();
+    const size_t body_start = out.size();
+
+    for (size_t i = 0; i < length; ++i) {
+        // Surrogate pairs -> code points; unpaired halves pass through as is
+        uint32_t cp = text[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < length && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<uint32_t>(text[i + 1]) - 0xDC00);
+            ++i;
+        }
+        normalizer.feed(cp);
+    }
+    normalizer.finish();
+
+    if (out.size() == body_start || !ends_sentence(out.back()) ||
+        std::any_of(out.begin() + static_cast<std::ptrdiff_t>(body_start), out.end(), is_line_break)) {
+        out.push_back('.');
+    }
+
+    out.push_back('<');
+    out.push_back('/');
+    append_ascii(out, language_tag.c_str());
+    out.push_back('>');
+}
+
+void TextProcessor::lookup(const uint32_t* code_points, size_t count, int64_t* ids) const {
+    if (size_ == 0) {
+        std::fill(ids, ids + count, 0);
+        return;
+    }
+    // Clamped load + select instead of a branch per element
+    const int32_t* table = indexer_;
+    const uint32_t size = static_cast<uint32_t>(std::min<size_t>(size_, UINT32_MAX));
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t cp = code_points[i];
+        const bool inside = cp < size;
+        const int32_t id = table[inside ? cp : 0];
+        ids[i] = inside ? id : 0;
+    }
+}
+
+void TextProcessor::process(const char16_t* text, size_t length, const std::string& language_tag,
+                            std::vector<int64_t>& ids) const {
+    thread_local std::vector<uint32_t> code_points;
+    normalize(text, length, language_tag, code_points);
+    ids.resize(code_points.size());
+    lookup(code_points.data(), code_points.size(), ids.data());
+}
+
+} // namespace text
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace text {
+
+/**
+ * TTS text preprocessing after NFKD: cleanup and unicode indexing.
+ *
+ * One pass over the UTF-16 input does everything the reference does with
+ * successive string replacements, in the same order and with the same
+ * result: emoji and symbol removal, dash/quote/bracket mapping (per-code-
+ * point rule table), "@" / "e.g.," / "i.e.," expansion, no space before
+ * , . ! ? ; : ', collapsed quote runs, collapsed and trimmed whitespace,
+ * a final "." when the text doesn't end in punctuation, and the
+ * <lang>...</lang> tags. Each stage is a small state machine feeding the
+ * next, so no intermediate strings are built.
+ *
+ * Code points are then mapped through the indexer table (codepoint ->
+ * vocab id, 0 past its end) without branches. NFKD itself stays with the
+ * platform normalizer.
+ */
+class TextProcessor {
+public:
+    /**
+     * `indexer` is not copied and must outlive the processor (typically a
+     * mapped TensorCache tensor).
+     */
+    TextProcessor(const int32_t* indexer, size_t size);
+
+    /**
+     * Normalize UTF-16 `text`, wrap it in `language_tag` and write its vocab
+     * ids to `ids` (replaced)
+     */
+    void process(const char16_t* text, size_t length, const std::string& language_tag,
+                 std::vector<int64_t>& ids) const;
+
+    /**
+     * The normalized code points alone
+     */
+    static void normalize(const char16_t* text, size_t length, const std::string& language_tag,
+                          std::vector<uint32_t>& out);
+
+    /**
+     * ids[i] = indexer[code_points[i]], or 0 outside the table
+     */
+    void lookup(const uint32_t* code_points, size_t count, int64_t* ids) const;
+
+    size_t indexer_size() const { return size_; }
+
+private:
+    const int32_t* indexer_;
+    size_t size_;
+};
+
+} // namespace text
@@ -1,9 +1,26 @@
 #pragma once
 
+#define LOG_TAG "SupertonicTTS"
+
+#ifdef __ANDROID__
+
 #include <android/log.h>
 
-#define LOG_TAG "SupertonicTTS"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO,  LOG_TAG, __VA_ARGS__)
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN,  LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+#else
+
+// Host tools: warnings and errors to stderr, the rest dropped
+#include <cstdio>
+
+#define LOG_STDERR_(level, ...) \
+    (std::fprintf(stderr, "%s %s: ", level, LOG_TAG), std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#define LOGI(...) ((void)0)
+#define LOGW(...) LOG_STDERR_("W", __VA_ARGS__)
+#define LOGE(...) LOG_STDERR_("E", __VA_ARGS__)
+#define LOGD(...) ((void)0)
+
+#endif
@@ -0,0 +1,181 @@
+/*=============================================================
+ *   tools/bench/playback_bench.cpp
+ *=============================================================
+ *
+ *  Buffer health of the playback path (AudioRing -> PlaybackFeeder ->
+ *  sink) under a simulated synthesizer, on a real-time NullSink or a
+ *  WavFileSink that records what a listener would hear.
+ *
+ *  The synthesizer produces `--chunks` chunks of `--chunk-ms` audio,
+ *  each in vocoder windows, taking `--rtf` times the audio duration.
+ *  Two schedules are run:
+ *
+ *    serial     each chunk is synthesized, then played to the end before
+ *               the next one starts (the old playStreaming behaviour)
+ *    pipelined  synthesis runs ahead into the ring while the feeder
+ *               plays, so chunk N+1 overlaps chunk N
+ *
+ *  Usage:
+ *    playback_bench [--chunks n] [--chunk-ms ms] [--rtf r] [--windows n]
+ *                   [--rate hz] [--sink-rate hz] [--ring-ms ms] [--wav path]
+ *
+ *  Prints one JSON object; --wav records the pipelined run.
+ *============================================================*/
+
+#include "audio/audio_ring.h"
+#include "audio/audio_sink.h"
+#include "audio/playback_feeder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int chunks = 4;
+    int chunk_ms = 1200;
+    double rtf = 0.35;
+    int windows = 4;
+    int rate = 44100;
+    int sink_rate = 48000;
+    int ring_ms = 4000;
+    std::string wav;
+};
+
+struct Result {
+    double wall_ms = 0.0;
+    double audio_ms = 0.0;
+    double gap_ms = 0.0;
+    audio::PlaybackFeeder::Stats stats;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// NullSink's default device queue
+constexpr double SINK_BUFFER = 1024.0;
+
+double ms_since(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+void sleep_ms(double ms) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+// Vocode one chunk window by window into the ring, at the given speed
+bool synthesize_chunk(audio::AudioRing& ring, const Options& o, int chunk) {
+    const size_t samples = static_cast<size_t>(o.rate) * o.chunk_ms / 1000;
+    const size_t window = (samples + o.windows - 1) / o.windows;
+    std::vector<float> pcm(window);
+    for (size_t start = 0; start < samples; start += window) {
+        const size_t n = std::min(window, samples - start);
+        sleep_ms(o.rtf * 1000.0 * static_cast<double>(n) / o.rate);
+        for (size_t i = 0; i < n; ++i) {
+            const double t = static_cast<double>(start + i) / o.rate;
+            pcm[i] = 0.3f * static_cast<float>(std::sin(2.0 * M_PI * (180.0 + 40.0 * chunk) * t));
+        }
+        if (!ring.write_all(pcm.data(), n)) return false;
+    }
+    return true;
+}
+
+std::unique_ptr<audio::NullSink> make_sink(const Options& o, bool record) {
+    if (record && !o.wav.empty()) {
+        const int fd = ::open(o.wav.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::fprintf(stderr, "cannot create %s\n", o.wav.c_str());
+            std::exit(1);
+        }
+        return std::make_unique<audio::WavFileSink>(o.sink_rate, fd);
+    }
+    return std::make_unique<audio::NullSink>(o.sink_rate);
+}
+
+Result run(const Options& o, bool pipelined) {
+    audio::AudioRing ring(static_cast<size_t>(o.rate) * o.ring_ms / 1000);
+    auto sink = make_sink(o, pipelined);
+    audio::NullSink* null_sink = sink.get();
+    audio::PlaybackFeeder feeder(ring, std::move(sink), o.rate);
+
+    const Clock::time_point start = Clock::now();
+    if (!feeder.start()) {
+        std::fprintf(stderr, "sink failed: %s\n", feeder.last_error().c_str());
+        std::exit(1);
+    }
+
+    for (int c = 0; c < o.chunks; ++c) {
+        if (!pipelined && c > 0) {
+            // Wait until the previous chunks have been played out: all
+            // handed to the sink (less the resampler delay), then its queue
+            const double handed = static_cast<double>(c) * o.chunk_ms / 1000.0 * o.sink_rate - 64.0;
+            while (static_cast<double>(feeder.stats().samples_played) < handed) sleep_ms(1);
+            sleep_ms(1000.0 * SINK_BUFFER / o.sink_rate);
+        }
+        synthesize_chunk(ring, o, c);
+    }
+    ring.close();
+    while (!feeder.wait(100)) {}
+
+    Result r;
+    r.wall_ms = ms_since(start);
+    r.audio_ms = 1000.0 * o.chunks * o.chunk_ms / 1000.0;
+    r.gap_ms = 1000.0 * static_cast<double>(null_sink->gap_samples()) / o.sink_rate;
+    r.stats = feeder.stats();
+    return r;
+}
+
+void print(const char* name, const Result& r, const Options& o, bool last) {
+    const auto& s = r.stats;
+    std::printf("  \"%s\": {\"wall_ms\": %.1f, \"audio_ms\": %.1f, \"first_audio_ms\": %.1f, "
+                "\"underruns\": %llu, \"starved_ms\": %.1f, \"gap_ms\": %.1f, "
+                "\"ring_underruns\": %llu, \"ring_low_water_ms\": %.1f, \"samples_played\": %llu}%s\n",
+                name, r.wall_ms, r.audio_ms, s.first_audio_ms,
+                static_cast<unsigned long long>(s.underruns), s.starved_ms, r.gap_ms,
+                static_cast<unsigned long long>(s.ring_underruns),
+                1000.0 * static_cast<double>(s.ring_low_water) / o.rate,
+                static_cast<unsigned long long>(s.samples_played), last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        const auto arg = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+        if (arg("--chunks")) o.chunks = std::atoi(argv[++i]);
+        else if (arg("--chunk-ms")) o.chunk_ms = std::atoi(argv[++i]);
+        else if (arg("--rtf")) o.rtf = std::atof(argv[++i]);
+        else if (arg("--windows")) o.windows = std::atoi(argv[++i]);
+        else if (arg("--rate")) o.rate = std::atoi(argv[++i]);
+        else if (arg("--sink-rate")) o.sink_rate = std::atoi(argv[++i]);
+        else if (arg("--ring-ms")) o.ring_ms = std::atoi(argv[++i]);
+        else if (arg("--wav")) o.wav = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [--chunks n] [--chunk-ms ms] [--rtf r] [--windows n] "
+                                 "[--rate hz] [--sink-rate hz] [--ring-ms ms] [--wav path]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (o.chunks < 1 || o.chunk_ms < 1 || o.windows < 1 || o.rate < 1 || o.sink_rate < 1 || o.ring_ms < 1) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    const Result serial = run(o, false);
+    const Result pipelined = run(o, true);
+
+    std::printf("{\n  \"chunks\": %d, \"chunk_ms\": %d, \"rtf\": %.3f, \"rate\": %d, \"sink_rate\": %d,\n",
+                o.chunks, o.chunk_ms, o.rtf, o.rate, o.sink_rate);
+    print("serial", serial, o, false);
+    print("pipelined", pipelined, o, true);
+    std::printf("}\n");
+    return 0;
+}
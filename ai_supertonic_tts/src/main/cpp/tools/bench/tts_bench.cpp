@@ -0,0 +1,431 @@
+/*=============================================================
+ *   tools/bench/tts_bench.cpp
+ *=============================================================
+ *
+ *  Stage-level latency and real-time factor of the native Supertonic
+ *  pipeline on a fixed text corpus, through the same code the JNI layer
+ *  calls: TensorCache (indexer, voice) -> TextProcessor ->
+ *  SupertonicPipeline -> wav_encoder.
+ *
+ *  For every combination of --threads, --steps and --batch the models are
+ *  run on the whole corpus (`--warmup` untimed passes, then `--runs`
+ *  timed ones) and per-call stage times are collected from
+ *  SupertonicPipeline::last_timings():
+ *
+ *    duration_ms, text_encoder_ms, noise_ms, step_ms (every step of every
+ *    call), vocoder_ms, wav_encode_ms (16-bit WAV of each result),
+ *    total_ms
+ *
+ *  reported as p50/p90/p99/mean, plus the mean of each denoising step by
+ *  index. RTF is synthesis wall time over audio duration. With batch 1,
+ *  each text is also streamed (synthesize_stream, default windows) for
+ *  first-audio latency, and its RTF is reported per text so the scaling
+ *  with length is visible. Peak RSS is the process high-water mark after
+ *  each configuration.
+ *
+ *  The corpus is ASCII, so it is already NFKD; a --corpus file (UTF-8,
+ *  one text per line) should be too.
+ *
+ *  Usage:
+ *    tts_bench --models dir [--voice M1] [--lang en] [--threads 1,2,4]
+ *              [--steps 2,5] [--batch 1,4] [--runs n] [--warmup n]
+ *              [--speed s] [--corpus file]
+ *
+ *  `dir` holds onnx/ and voice_styles/ as for TTSEngine.load(). Model
+ *  constants are the tts.json defaults in ModelConfig. Prints one JSON
+ *  object.
+ *============================================================*/
+
+#include "audio/wav_encoder.h"
+#include "engine/supertonic_pipeline.h"
+#include "engine/tensor_cache.h"
+#include "text/text_processor.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Short to long, so RTF per text shows the fixed per-call cost
+const char* const CORPUS[] = {
+        "Hello there.",
+        "The quick brown fox jumps over the lazy dog.",
+        "Please remind me to call the pharmacy tomorrow morning before nine.",
+        "Streaming speech synthesis lets an assistant start talking while the rest of the answer "
+        "is still being generated, which hides most of the model latency.",
+        "On a phone, every millisecond spent in the denoising loop is a millisecond the listener "
+        "waits in silence. Measuring each stage separately tells us whether the duration predictor, "
+        "the text encoder, the vector estimator or the vocoder deserves the next optimization.",
+        "The weather service expects scattered showers through the afternoon, clearing by evening, "
+        "with temperatures falling to around twelve degrees overnight. Winds will be light and "
+        "variable, and tomorrow should start dry and sunny before clouds build again from the west "
+        "later in the day, so plan outdoor errands for the morning if you can.",
+};
+
+constexpr uint64_t SEED = 42;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string models;
+    std::string voice = "M1";
+    std::string lang = "en";
+    std::vector<int> threads{0};
+    std::vector<int> steps{2, 5};
+    std::vector<int> batch{1};
+    int runs = 3;
+    int warmup = 1;
+    float speed = 1.05f;
+    std::string corpus;
+};
+
+struct Text {
+    std::string utf8;
+    std::vector<int64_t> ids;
+};
+
+struct Summary {
+    double p50 = 0.0, p90 = 0.0, p99 = 0.0, mean = 0.0;
+};
+
+Summary summarize(std::vector<double> v) {
+    Summary s;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    const auto rank = [&](double q) {
+        const size_t i = static_cast<size_t>(q * static_cast<double>(v.size() - 1) + 0.5);
+        return v[std::min(i, v.size() - 1)];
+    };
+    s.p50 = rank(0.50);
+    s.p90 = rank(0.90);
+    s.p99 = rank(0.99);
+    s.mean = std::accumulate(v.begin(), v.end(), 0.0) / static_cast<double>(v.size());
+    return s;
+}
+
+double ms_since(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+double peak_rss_mb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#endif
+}
+
+std::vector<int> parse_list(const char* arg) {
+    std::vector<int> out;
+    for (const char* p = arg; *p;) {
+        char* end = nullptr;
+        out.push_back(static_cast<int>(std::strtol(p, &end, 10)));
+        if (end == p) return {};
+        p = *end == ',' ? end + 1 : end;
+    }
+    return out;
+}
+
+std::u16string utf8_to_utf16(const std::string& in) {
+    std::u16string out;
+    for (size_t i = 0; i < in.size();) {
+        const auto c = static_cast<unsigned char>(in[i]);
+        const int extra = c < 0x80 ? 0 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+        uint32_t cp = extra == 0 ? c : c & (0x3F >> extra);
+        for (int k = 1; k <= extra && i + k < in.size(); ++k) {
+            cp = (cp << 6) | (static_cast<unsigned char>(in[i + k]) & 0x3F);
+        }
+        i += static_cast<size_t>(extra) + 1;
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        } else {
+            out.push_back(static_cast<char16_t>(cp));
+        }
+    }
+    return out;
+}
+
+[[noreturn]] void die(const std::string& what) {
+    std::fprintf(stderr, "tts_bench: %s\n", what.c_str());
+    std::exit(1);
+}
+
+// `s` as a quoted JSON string (paths and names come from the command line)
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + '"';
+}
+
+// Map the binary cache of `json` the way TensorCache.load() does, falling
+// back to a temporary file when the model directory is read-only
+void map_json(const std::string& json, tts::CacheSource kind, tts::TensorCache& cache) {
+    const std::string bin = json.substr(0, json.size() - 5) + ".bin";
+    if (cache.open(bin, json)) return;
+
+    std::string error;
+    if (tts::TensorCache::convert(json, bin, kind, &error) && cache.open(bin, json)) return;
+
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string fallback = std::string(tmp ? tmp : "/tmp") + "/tts_bench_" +
+                                 std::to_string(static_cast<int>(kind)) + ".bin";
+    if (!tts::TensorCache::convert(json, fallback, kind, &error)) die(json + ": " + error);
+    if (!cache.open(fallback, json)) die(fallback + ": " + cache.last_error());
+}
+
+tts::VoiceStyle load_voice(const tts::TensorCache& cache) {
+    if (cache.size() < 2) die("voice style cache has no tensors");
+    const auto copy = [](const tts::TensorView& t, std::vector<float>& data, std::vector<int64_t>& shape) {
+        const auto* f = static_cast<const float*>(t.data);
+        data.assign(f, f + t.count);
+        shape = t.shape;
+    };
+    tts::VoiceStyle style;
+    copy(cache.tensor(0), style.ttl, style.ttl_shape);
+    copy(cache.tensor(1), style.dp, style.dp_shape);
+    return style;
+}
+
+std::vector<Text> load_corpus(const Options& o, const text::TextProcessor& processor) {
+    std::vector<Text> texts;
+    if (o.corpus.empty()) {
+        for (const char* t : CORPUS) texts.push_back({t, {}});
+    } else {
+        std::ifstream in(o.corpus);
+        if (!in) die("cannot read " + o.corpus);
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) texts.push_back({line, {}});
+        }
+    }
+    if (texts.empty()) die("empty corpus");
+    for (Text& t : texts) {
+        const std::u16string u16 = utf8_to_utf16(t.utf8);
+        processor.process(u16.data(), u16.size(), o.lang, t.ids);
+    }
+    return texts;
+}
+
+void print_summary(const char* name, const std::vector<double>& values, bool last) {
+    const Summary s = summarize(values);
+    std::printf("      \"%s\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"mean\": %.2f}%s\n",
+                name, s.p50, s.p90, s.p99, s.mean, last ? "" : ",");
+}
+
+void print_array(const char* name, const std::vector<double>& values, const char* indent, bool last) {
+    std::printf("%s\"%s\": [", indent, name);
+    for (size_t i = 0; i < values.size(); ++i) std::printf("%s%.3f", i ? ", " : "", values[i]);
+    std::printf("]%s\n", last ? "" : ",");
+}
+
+/**
+ * One threads x steps x batch configuration on a loaded pipeline
+ */
+void run_config(tts::SupertonicPipeline& pipeline, const tts::VoiceStyle& style,
+                const std::vector<Text>& texts, const Options& o,
+                int threads, int steps, int batch, double load_ms, bool last) {
+    const int rate = pipeline.config().sample_rate;
+
+    // Length-sorted groups, as TTSEngine batches chunks of similar length
+    std::vector<size_t> order(texts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return texts[a].ids.size() < texts[b].ids.size(); });
+
+    std::vector<double> duration, encoder, noise, step, vocoder, wav, total;
+    std::vector<double> step_sum(static_cast<size_t>(steps), 0.0);
+    std::vector<double> text_ms(texts.size(), 0.0), text_audio_ms(texts.size(), 0.0);
+    double wall_ms = 0.0;
+    double audio_ms = 0.0;
+    size_t calls = 0;
+
+    std::vector<std::vector<float>> pcm;
+    for (int pass = 0; pass < o.warmup + o.runs; ++pass) {
+        const bool timed = pass >= o.warmup;
+        for (size_t first = 0; first < order.size(); first += static_cast<size_t>(batch)) {
+            const size_t end = std::min(order.size(), first + static_cast<size_t>(batch));
+            std::vector<tts::TextInput> inputs;
+            for (size_t i = first; i < end; ++i) {
+                const Text& t = texts[order[i]];
+                inputs.push_back({t.ids.data(), t.ids.size()});
+            }
+
+            if (!pipeline.synthesize_batch(inputs, style, steps, o.speed, SEED, pcm)) {
+                die(pipeline.last_error());
+            }
+            if (!timed) continue;
+
+            const tts::StageTimings& t = pipeline.last_timings();
+            duration.push_back(t.duration_ms);
+            encoder.push_back(t.text_encoder_ms);
+            noise.push_back(t.noise_ms);
+            for (size_t k = 0; k < t.step_ms.size(); ++k) {
+                step.push_back(t.step_ms[k]);
+                step_sum[k] += t.step_ms[k];
+            }
+            vocoder.push_back(t.vocoder_ms);
+            total.push_back(t.total_ms);
+            wall_ms += t.total_ms;
+            ++calls;
+
+            for (size_t i = 0; i < pcm.size(); ++i) {
+                const Clock::time_point start = Clock::now();
+                const std::vector<uint8_t> encoded =
+                        audio::encode_wav_16(pcm[i].data(), static_cast<int>(pcm[i].size()), rate, 1);
+                wav.push_back(ms_since(start));
+                if (encoded.empty() && !pcm[i].empty()) die("WAV encoding failed");
+
+                const double ms = 1000.0 * static_cast<double>(pcm[i].size()) / rate;
+                audio_ms += ms;
+                if (batch == 1) {
+                    text_ms[order[first + i]] += t.total_ms;
+                    text_audio_ms[order[first + i]] += ms;
+                }
+            }
+        }
+    }
+
+    // Streamed first audio, one text at a time
+    std::vector<double> first_audio;
+    if (batch == 1) {
+        const tts::PcmSink sink = [](float*, size_t) { return true; };
+        for (int run = 0; run < o.runs; ++run) {
+            for (const Text& t : texts) {
+                if (!pipeline.synthesize_stream(t.ids.data(), t.ids.size(), style, steps, o.speed,
+                                                SEED, tts::StreamOptions(), sink)) {
+                    die(pipeline.last_error());
+                }
+                first_audio.push_back(pipeline.last_timings().first_audio_ms);
+            }
+        }
+    }
+
+    for (double& s : step_sum) s /= static_cast<double>(std::max<size_t>(calls, 1));
+
+    std::printf("    {\"threads\": %d, \"steps\": %d, \"batch\": %d, \"load_ms\": %.1f, \"calls\": %zu,\n",
+                threads, steps, batch, load_ms, calls);
+    std::printf("     \"audio_s\": %.3f, \"synth_s\": %.3f, \"rtf\": %.4f, \"peak_rss_mb\": %.1f,\n",
+                audio_ms / 1000.0, wall_ms / 1000.0, audio_ms > 0.0 ? wall_ms / audio_ms : 0.0, peak_rss_mb());
+    std::printf("     \"stages\": {\n");
+    print_summary("duration_ms", duration, false);
+    print_summary("text_encoder_ms", encoder, false);
+    print_summary("noise_ms", noise, false);
+    print_summary("step_ms", step, false);
+    print_summary("vocoder_ms", vocoder, false);
+    print_summary("wav_encode_ms", wav, false);
+    print_summary("total_ms", total, true);
+    std::printf("     },\n");
+    if (batch == 1) {
+        std::vector<double> rtf(texts.size());
+        for (size_t i = 0; i < texts.size(); ++i) {
+            rtf[i] = text_audio_ms[i] > 0.0 ? text_ms[i] / text_audio_ms[i] : 0.0;
+        }
+        const Summary fa = summarize(first_audio);
+        std::printf("     \"stream_first_audio_ms\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"mean\": %.2f},\n",
+                    fa.p50, fa.p90, fa.p99, fa.mean);
+        print_array("rtf_by_text", rtf, "     ", false);
+    }
+    print_array("step_mean_ms", step_sum, "     ", true);
+    std::printf("    }%s\n", last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        const auto arg = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+        if (arg("--models")) o.models = argv[++i];
+        else if (arg("--voice")) o.voice = argv[++i];
+        else if (arg("--lang")) o.lang = argv[++i];
+        else if (arg("--threads")) o.threads = parse_list(argv[++i]);
+        else if (arg("--steps")) o.steps = parse_list(argv[++i]);
+        else if (arg("--batch")) o.batch = parse_list(argv[++i]);
+        else if (arg("--runs")) o.runs = std::atoi(argv[++i]);
+        else if (arg("--warmup")) o.warmup = std::atoi(argv[++i]);
+        else if (arg("--speed")) o.speed = static_cast<float>(std::atof(argv[++i]));
+        else if (arg("--corpus")) o.corpus = argv[++i];
+        else {
+            o.models.clear();
+            break;
+        }
+    }
+    const auto positive = [](const std::vector<int>& v, int min) {
+        return !v.empty() && std::all_of(v.begin(), v.end(), [min](int x) { return x >= min; });
+    };
+    if (o.models.empty() || !positive(o.threads, 0) || !positive(o.steps, 1) ||
+        !positive(o.batch, 1) || o.runs < 1 || o.warmup < 0 || o.speed <= 0.0f) {
+        std::fprintf(stderr, "usage: %s --models dir [--voice M1] [--lang en] [--threads 1,2,4] "
+                             "[--steps 2,5] [--batch 1,4] [--runs n] [--warmup n] [--speed s] "
+                             "[--corpus file]\n", argv[0]);
+        return 2;
+    }
+
+    const std::string onnx_dir = o.models + "/onnx";
+
+    tts::TensorCache indexer;
+    map_json(onnx_dir + "/unicode_indexer.json", tts::CacheSource::UnicodeIndexer, indexer);
+    if (indexer.size() < 1) die("unicode indexer cache has no tensors");
+    const text::TextProcessor processor(static_cast<const int32_t*>(indexer.tensor(0).data),
+                                        indexer.tensor(0).count);
+
+    tts::TensorCache voice;
+    map_json(o.models + "/voice_styles/" + o.voice + ".json", tts::CacheSource::VoiceStyle, voice);
+    const tts::VoiceStyle style = load_voice(voice);
+
+    const std::vector<Text> texts = load_corpus(o, processor);
+
+    std::printf("{\n  \"models\": %s, \"voice\": %s, \"lang\": %s, \"speed\": %.2f, "
+                "\"runs\": %d, \"warmup\": %d,\n",
+                json_string(o.models).c_str(), json_string(o.voice).c_str(), json_string(o.lang).c_str(),
+                o.speed, o.runs, o.warmup);
+    std::printf("  \"corpus\": [");
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::printf("%s{\"bytes\": %zu, \"ids\": %zu}", i ? ", " : "", texts[i].utf8.size(), texts[i].ids.size());
+    }
+    std::printf("],\n  \"configs\": [\n");
+
+    const size_t configs = o.threads.size() * o.steps.size() * o.batch.size();
+    size_t done = 0;
+    for (const int threads : o.threads) {
+        tts::SessionSettings settings;
+        settings.intra_op_threads = threads;
+
+        tts::SupertonicPipeline pipeline;
+        const Clock::time_point start = Clock::now();
+        if (!pipeline.load(onnx_dir, tts::ModelConfig(), settings)) die(pipeline.last_error());
+        const double load_ms = ms_since(start);
+
+        for (const int steps : o.steps) {
+            for (const int batch : o.batch) {
+                run_config(pipeline, style, texts, o, threads, steps, batch, load_ms, ++done == configs);
+                std::fflush(stdout);
+            }
+        }
+    }
+    std::printf("  ],\n  \"peak_rss_mb\": %.1f\n}\n", peak_rss_mb());
+    return 0;
+}
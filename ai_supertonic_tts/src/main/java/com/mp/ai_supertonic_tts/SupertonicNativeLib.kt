@@ -1,18 +1,314 @@
 package com.mp.ai_supertonic_tts
 
 import androidx.annotation.Keep
+import com.mp.ai_supertonic_tts.models.VoiceStyle
+import java.nio.ByteBuffer
 
 /**
  * JNI bridge for native audio processing operations.
  *
  * Provides high-performance C++ implementations for:
+ * - The Supertonic ONNX pipeline (duration → text encoder → denoising → vocoder)
  * - WAV file encoding (16-bit PCM and 32-bit float)
+ * - FLAC (lossless, frame-parallel) and IMA-ADPCM encoding
  * - Raw PCM encoding
  * - Audio clipping
+ * - Fused chunk post-processing (trim, crossfade/gap, gain, peak limiting)
+ * - Polyphase sample rate conversion
+ * - TTS text normalization and unicode indexing
+ * - Incremental sentence segmentation of streamed LLM output
+ * - The lock-free ring that carries streamed audio to playback
+ * - A native playback thread draining that ring into AAudio
+ * - Streaming WAV export straight to a file descriptor
+ * - Memory-mapped binary caches of the unicode indexer and voice styles
+ * - A content-addressed cache of synthesized utterances (memory + disk)
  */
 @Keep
 class SupertonicNativeLib {
 
+    // Native synthesis pipeline owned by this instance (0 = not created).
+    // Load, synthesize and release are synchronized so release never frees
+    // a pipeline that is still running.
+    private var pipelineHandle = 0L
+
+    // Synthesis cache consulted by the synthesize calls (0 = none)
+    private var audioCacheHandle = 0L
+
+    @Volatile
+    private var loadedPipeline = false
+
+    // ========================================================================
+    // SYNTHESIS PIPELINE
+    // ========================================================================
+
+    /**
+     * Load the four Supertonic ONNX models into the native pipeline.
+     * Replaces any previously loaded models.
+     *
+     * @param onnxDir Directory containing the .onnx files
+     * @param sampleRate tts.json `ae.sample_rate`
+     * @param baseChunkSize tts.json `ae.base_chunk_size`
+     * @param chunkCompressFactor tts.json `ttl.chunk_compress_factor`
+     * @param latentDim tts.json `ttl.latent_dim`
+     * @param numThreads ONNX Runtime intra-op threads (0 = default)
+     * @param useNNAPI Enable NNAPI acceleration (falls back to CPU)
+     * @return true on success, otherwise see [pipelineError]
+     */
+    @Synchronized
+    fun loadPipeline(
+        onnxDir: String,
+        sampleRate: Int,
+        baseChunkSize: Int,
+        chunkCompressFactor: Int,
+        latentDim: Int,
+        numThreads: Int = 0,
+        useNNAPI: Boolean = false
+    ): Boolean {
+        if (pipelineHandle == 0L) pipelineHandle = nativePipelineCreate()
+        loadedPipeline = nativePipelineLoad(
+            pipelineHandle, onnxDir, sampleRate, baseChunkSize, chunkCompressFactor,
+            latentDim, numThreads, useNNAPI
+        )
+        return loadedPipeline
+    }
+
+    fun isPipelineLoaded(): Boolean = loadedPipeline
+
+    /**
+     * Synthesize one utterance with the native pipeline.
+     *
+     * @param textIds Unicode-indexer ids from TextProcessor
+     * @param style Voice style embeddings
+     * @param steps Denoising steps
+     * @param speed Speed factor (1.0 = model duration)
+     * @param seed Noise seed (0 = random)
+     * @return Float32 PCM at the model sample rate
+     * @throws IllegalStateException if the pipeline is not loaded or inference fails
+     */
+    @Synchronized
+    fun synthesize(
+        textIds: LongArray,
+        style: VoiceStyle,
+        steps: Int,
+        speed: Float = 1.0f,
+        seed: Long = 0L
+    ): FloatArray {
+        check(loadedPipeline && pipelineHandle != 0L) { "Model not loaded. Call loadModel() first." }
+        return nativePipelineSynthesize(
+            pipelineHandle, audioCacheHandle, textIds,
+            style.styleTtl, style.styleTtlShape,
+            style.styleDp, style.styleDpShape,
+            steps, speed, seed
+        ) ?: throw IllegalStateException(pipelineError() ?: "Synthesis failed")
+    }
+
+    /**
+     * Synthesize several utterances as one batch with the native pipeline.
+     * Inputs are padded to the longest one, so batch texts of similar length.
+     *
+     * @param textIds Unicode-indexer ids, one array per utterance
+     * @return Float32 PCM per utterance, in input order
+     * @throws IllegalStateException if the pipeline is not loaded or inference fails
+     */
+    @Synchronized
+    fun synthesizeBatch(
+        textIds: Array<LongArray>,
+        style: VoiceStyle,
+        steps: Int,
+        speed: Float = 1.0f,
+        seed: Long = 0L
+    ): Array<FloatArray> {
+        check(loadedPipeline && pipelineHandle != 0L) { "Model not loaded. Call loadModel() first." }
+        if (textIds.isEmpty()) return emptyArray()
+        return nativePipelineSynthesizeBatch(
+            pipelineHandle, audioCacheHandle, textIds,
+            style.styleTtl, style.styleTtlShape,
+            style.styleDp, style.styleDpShape,
+            steps, speed, seed
+        ) ?: throw IllegalStateException(pipelineError() ?: "Synthesis failed")
+    }
+
+    /**
+     * Synthesize one utterance and stream its audio into a ring
+     * ([com.mp.ai_supertonic_tts.audio.AudioRing]) window by window, so
+     * playback can start before the vocoder has finished.
+     *
+     * @param ringHandle Native ring handle
+     * @return true when all audio was written, false if the ring was
+     *         cancelled or inference failed (see [pipelineError])
+     * @throws IllegalStateException if the pipeline is not loaded
+     */
+    @Synchronized
+    fun synthesizeToRing(
+        textIds: LongArray,
+        style: VoiceStyle,
+        steps: Int,
+        ringHandle: Long,
+        speed: Float = 1.0f,
+        seed: Long = 0L
+    ): Boolean {
+        check(loadedPipeline && pipelineHandle != 0L) { "Model not loaded. Call loadModel() first." }
+        return nativePipelineSynthesizeToRing(
+            pipelineHandle, audioCacheHandle, ringHandle, textIds,
+            style.styleTtl, style.styleTtlShape,
+            style.styleDp, style.styleDpShape,
+            steps, speed, seed
+        )
+    }
+
+    /** Last pipeline load/synthesis error, if any */
+    @Synchronized
+    fun pipelineError(): String? =
+        pipelineHandle.takeIf { it != 0L }?.let { nativePipelineLastError(it) }
+
+    /**
+     * Look utterances up in a content-addressed cache before synthesizing,
+     * and add what was synthesized. Keys cover the text ids, the voice
+     * style tensors, steps, speed, seed and [modelId]; a seed of 0 is
+     * cached like any other, so a repeated phrase replays its first take.
+     * Replaces the current cache.
+     *
+     * @param directory Disk tier (created if missing), or null for memory only
+     * @param memoryBytes Budget for decoded PCM in memory
+     * @param diskBytes Budget for the compressed files in [directory]
+     * @param sampleRate Model sample rate (entries at another rate are ignored)
+     * @param modelId Identifies the loaded models, so swapping them misses
+     * @return false if the cache could not be created
+     */
+    @Synchronized
+    fun setAudioCache(
+        directory: String?,
+        memoryBytes: Long,
+        diskBytes: Long,
+        sampleRate: Int,
+        modelId: String
+    ): Boolean {
+        removeAudioCache()
+        audioCacheHandle = nativeAudioCacheCreate(directory, memoryBytes, diskBytes, sampleRate, modelId)
+        return audioCacheHandle != 0L
+    }
+
+    /** Stop caching (files on disk are kept for the next [setAudioCache]) */
+    @Synchronized
+    fun removeAudioCache() {
+        if (audioCacheHandle != 0L) {
+            nativeAudioCacheDestroy(audioCacheHandle)
+            audioCacheHandle = 0L
+        }
+    }
+
+    /** Drop every cached utterance, including the files on disk */
+    @Synchronized
+    fun clearAudioCache() {
+        if (audioCacheHandle != 0L) nativeAudioCacheClear(audioCacheHandle)
+    }
+
+    /** [memory hits, disk hits, misses, memory bytes, disk bytes], or null without a cache */
+    @Synchronized
+    fun audioCacheStats(): LongArray? =
+        audioCacheHandle.takeIf { it != 0L }?.let { nativeAudioCacheStats(it) }
+
+    /** Free the native pipeline and its ONNX sessions (and the synthesis cache) */
+    @Synchronized
+    fun releasePipeline() {
+        loadedPipeline = false
+        removeAudioCache()
+        if (pipelineHandle != 0L) {
+            nativePipelineDestroy(pipelineHandle)
+            pipelineHandle = 0L
+        }
+    }
+
+    external fun nativePipelineCreate(): Long
+
+    external fun nativePipelineLoad(
+        handle: Long, onnxDir: String,
+        sampleRate: Int, baseChunkSize: Int, chunkCompressFactor: Int, latentDim: Int,
+        numThreads: Int, useNNAPI: Boolean
+    ): Boolean
+
+    /** @return PCM, or null on failure ([nativePipelineLastError]) */
+    external fun nativePipelineSynthesize(
+        handle: Long, cacheHandle: Long, textIds: LongArray,
+        styleTtl: FloatArray, styleTtlShape: LongArray,
+        styleDp: FloatArray, styleDpShape: LongArray,
+        steps: Int, speed: Float, seed: Long
+    ): FloatArray?
+
+    /** @return PCM per utterance, or null on failure ([nativePipelineLastError]) */
+    external fun nativePipelineSynthesizeBatch(
+        handle: Long, cacheHandle: Long, textIds: Array<LongArray>,
+        styleTtl: FloatArray, styleTtlShape: LongArray,
+        styleDp: FloatArray, styleDpShape: LongArray,
+        steps: Int, speed: Float, seed: Long
+    ): Array<FloatArray>?
+
+    /** @return true when all audio was written to the ring */
+    external fun nativePipelineSynthesizeToRing(
+        handle: Long, cacheHandle: Long, ringHandle: Long, textIds: LongArray,
+        styleTtl: FloatArray, styleTtlShape: LongArray,
+        styleDp: FloatArray, styleDpShape: LongArray,
+        steps: Int, speed: Float, seed: Long
+    ): Boolean
+
+    external fun nativePipelineLastError(handle: Long): String?
+
+    external fun nativePipelineDestroy(handle: Long)
+
+    // ========================================================================
+    // MODEL ASSET CACHE
+    // ========================================================================
+
+    /**
+     * Parse a model JSON asset and write its binary cache to [path].
+     *
+     * @param kind [com.mp.ai_supertonic_tts.engine.TensorCache.KIND_UNICODE_INDEXER] or
+     *             [com.mp.ai_supertonic_tts.engine.TensorCache.KIND_VOICE_STYLE]
+     */
+    external fun nativeTensorCacheConvert(sourcePath: String, path: String, kind: Int): Boolean
+
+    /**
+     * Memory-map the cache at [path]; it must match [sourcePath]'s size and
+     * mtime when that file exists.
+     *
+     * @return Native handle, released with [nativeTensorCacheDestroy]; 0 if missing or stale
+     */
+    external fun nativeTensorCacheOpen(path: String, sourcePath: String?): Long
+
+    external fun nativeTensorCacheCount(handle: Long): Int
+
+    external fun nativeTensorCacheShape(handle: Long, index: Int): LongArray?
+
+    /** Direct buffer over the mapped tensor data; must only be read */
+    external fun nativeTensorCacheBuffer(handle: Long, index: Int): ByteBuffer?
+
+    /** Unmap the cache; buffers from it must no longer be used */
+    external fun nativeTensorCacheDestroy(handle: Long)
+
+    // ========================================================================
+    // SYNTHESIS CACHE
+    // ========================================================================
+
+    /**
+     * @param directory Disk tier, or null/empty for memory only
+     * @return Native handle for the synthesize calls, released with
+     *         [nativeAudioCacheDestroy]; 0 on invalid arguments
+     */
+    external fun nativeAudioCacheCreate(
+        directory: String?, memoryBytes: Long, diskBytes: Long,
+        sampleRate: Int, modelId: String
+    ): Long
+
+    external fun nativeAudioCacheClear(handle: Long)
+
+    external fun nativeAudioCacheStats(handle: Long): LongArray?
+
+    external fun nativeAudioCacheDestroy(handle: Long)
+
+    // ========================================================================
+    // AUDIO ENCODING
+    // ========================================================================
+
     /**
      * Encode float32 audio as 16-bit PCM WAV file bytes.
      *
@@ -23,6 +319,25 @@ class SupertonicNativeLib {
      */
     external fun nativeEncodeWav16(audio: FloatArray, sampleRate: Int, channels: Int): ByteArray
 
+    /**
+     * Encode as a 16-bit PCM WAV file straight into a direct ByteBuffer
+     * (from its start, ignoring position/limit). Needs 44 + 2 × samples bytes.
+     *
+     * @return Bytes written, or -1 if [out] is not direct or too small
+     */
+    external fun nativeEncodeWav16Direct(
+        audio: FloatArray, sampleRate: Int, channels: Int, out: ByteBuffer
+    ): Int
+
+    /**
+     * Encode as a 16-bit PCM WAV file into the start of [out].
+     *
+     * @return Bytes written, or -1 if [out] is too small
+     */
+    external fun nativeEncodeWav16Into(
+        audio: FloatArray, sampleRate: Int, channels: Int, out: ByteArray
+    ): Int
+
     /**
      * Encode float32 audio as 32-bit IEEE float WAV file bytes.
      *
@@ -33,6 +348,27 @@ class SupertonicNativeLib {
      */
     external fun nativeEncodeWav32f(audio: FloatArray, sampleRate: Int, channels: Int): ByteArray
 
+    /**
+     * Encode as a lossless FLAC file (16-bit, same samples as WAV_16).
+     * Frames are encoded in parallel on all cores.
+     *
+     * @param audio Float32 audio samples, interleaved
+     * @param sampleRate Sample rate in Hz
+     * @param channels Number of audio channels (at most 8)
+     * @return Complete .flac file, or null if the arguments are out of range
+     */
+    external fun nativeEncodeFlac(audio: FloatArray, sampleRate: Int, channels: Int): ByteArray?
+
+    /**
+     * Encode as a 4-bit IMA-ADPCM WAV file (lossy, a quarter of WAV_16).
+     *
+     * @param audio Float32 audio samples, interleaved
+     * @param sampleRate Sample rate in Hz
+     * @param channels Number of audio channels (at most 8)
+     * @return Complete WAV file, or null if the arguments are out of range
+     */
+    external fun nativeEncodeWavAdpcm(audio: FloatArray, sampleRate: Int, channels: Int): ByteArray?
+
     /**
      * Encode float32 audio as raw 16-bit PCM bytes (no WAV header).
      *
@@ -41,6 +377,21 @@ class SupertonicNativeLib {
      */
     external fun nativeEncodePcm16(audio: FloatArray): ByteArray
 
+    /**
+     * Encode as raw 16-bit PCM straight into a direct ByteBuffer (from its
+     * start). Needs 2 × samples bytes.
+     *
+     * @return Bytes written, or -1 if [out] is not direct or too small
+     */
+    external fun nativeEncodePcm16Direct(audio: FloatArray, out: ByteBuffer): Int
+
+    /**
+     * Encode as raw 16-bit PCM into the start of [out].
+     *
+     * @return Bytes written, or -1 if [out] is too small
+     */
+    external fun nativeEncodePcm16Into(audio: FloatArray, out: ByteArray): Int
+
     /**
      * Clip audio samples in-place to [-1.0, 1.0] range.
      * Modifies the input array directly.
@@ -49,6 +400,222 @@ class SupertonicNativeLib {
      */
     external fun nativeClipAudio(audio: FloatArray)
 
+    // ========================================================================
+    // RESAMPLING
+    // ========================================================================
+
+    /**
+     * Resample a whole buffer (polyphase windowed sinc).
+     *
+     * @param audio Float32 mono audio at [inRate]
+     * @return Audio at [outRate]; a copy when the rates are equal
+     */
+    external fun nativeResample(audio: FloatArray, inRate: Int, outRate: Int): FloatArray
+
+    /**
+     * Create a streaming resampler (see [com.mp.ai_supertonic_tts.audio.Resampler]).
+     *
+     * @return Native handle, released with [nativeResamplerDestroy]; 0 for invalid rates
+     */
+    external fun nativeResamplerCreate(inRate: Int, outRate: Int): Long
+
+    /** Output array size [nativeResamplerProcess] needs for [count] input samples */
+    external fun nativeResamplerMaxOutput(handle: Long, count: Int): Int
+
+    /**
+     * Resample the first [length] samples of [input] into [output].
+     *
+     * @return Samples written, or -1 if [output] is smaller than [nativeResamplerMaxOutput]
+     */
+    external fun nativeResamplerProcess(handle: Long, input: FloatArray, length: Int, output: FloatArray): Int
+
+    /** End of stream: write the remaining output and reset */
+    external fun nativeResamplerFlush(handle: Long, output: FloatArray): Int
+
+    external fun nativeResamplerDestroy(handle: Long)
+
+    // ========================================================================
+    // STREAMING WAV SINK
+    // ========================================================================
+
+    /**
+     * Start a streaming WAV file on [fd] (see [com.mp.ai_supertonic_tts.audio.WavSink]).
+     * The writer takes ownership of the fd, also on failure.
+     *
+     * @param float32 32-bit float samples instead of 16-bit PCM
+     * @return Native handle, or 0 on failure
+     */
+    external fun nativeWavWriterOpen(fd: Int, sampleRate: Int, channels: Int, float32: Boolean): Long
+
+    /** Append [length] interleaved samples of [audio] from [offset] */
+    external fun nativeWavWriterWrite(handle: Long, audio: FloatArray, offset: Int, length: Int): Boolean
+
+    /** Append [frames] frames of silence */
+    external fun nativeWavWriterWriteSilence(handle: Long, frames: Int): Boolean
+
+    /** Flush, patch the header sizes and close the fd */
+    external fun nativeWavWriterClose(handle: Long): Boolean
+
+    external fun nativeWavWriterLastError(handle: Long): String?
+
+    /** Free the writer (closes the fd if still open) */
+    external fun nativeWavWriterDestroy(handle: Long)
+
+    // ========================================================================
+    // CHUNK POST-PROCESSING
+    // ========================================================================
+
+    /**
+     * Create a chunk stitcher (see [com.mp.ai_supertonic_tts.audio.ChunkStitcher]).
+     *
+     * @param gapMs Silence between chunks
+     * @param crossfadeMs > 0: equal-power crossfade between chunks instead of the gap
+     * @param trim Trim each chunk's leading/trailing silence
+     * @param ceiling Peak limiter ceiling
+     * @return Native handle, released with [nativeStitcherDestroy]; 0 for an invalid rate
+     */
+    external fun nativeStitcherCreate(
+        sampleRate: Int, gapMs: Int, crossfadeMs: Int, trim: Boolean, gain: Float, ceiling: Float
+    ): Long
+
+    /** Stitch whole [chunks] into one buffer, or null on failure */
+    external fun nativeStitcherStitch(handle: Long, chunks: Array<FloatArray>): FloatArray?
+
+    /**
+     * Stitch one more chunk into a WAV writer.
+     *
+     * @return Frames written, or -1 on failure
+     */
+    external fun nativeStitcherWrite(handle: Long, audio: FloatArray, wavHandle: Long): Long
+
+    /** End of stream: write the held-back tail. Frames written, or -1. */
+    external fun nativeStitcherFinish(handle: Long, wavHandle: Long): Long
+
+    external fun nativeStitcherDestroy(handle: Long)
+
+    // ========================================================================
+    // TEXT PROCESSING
+    // ========================================================================
+
+    /**
+     * Native text cleanup + unicode indexing over [indexer] (direct, native-order
+     * int32 codepoint -> id table). The buffer is not copied and must stay
+     * alive until [nativeTextProcessorDestroy].
+     *
+     * @return Native handle; 0 if [indexer] is not a direct buffer
+     */
+    external fun nativeTextProcessorCreate(indexer: ByteBuffer): Long
+
+    /** Vocab ids of NFKD-normalized [text] wrapped in [languageTag] */
+    external fun nativeTextProcessorProcess(handle: Long, text: String, languageTag: String): LongArray?
+
+    external fun nativeTextProcessorDestroy(handle: Long)
+
+    // ========================================================================
+    // SENTENCE STREAM
+    // ========================================================================
+
+    /**
+     * Create a native sentence stream (see [com.mp.ai_supertonic_tts.engine.SentenceStream]).
+     *
+     * @param language [com.mp.ai_supertonic_tts.models.Language] ordinal
+     * @param maxLen Maximum segment length in characters (0 = language default)
+     * @param firstClauseMin Length after which the first segment may close at
+     *                       a clause break (0 = wait for a full sentence)
+     * @return Native handle, released with [nativeSentenceStreamDestroy]
+     */
+    external fun nativeSentenceStreamCreate(language: Int, maxLen: Int, firstClauseMin: Int): Long
+
+    /** Feed generated text; completed segments are queued immediately */
+    external fun nativeSentenceStreamFeed(handle: Long, text: String)
+
+    /** End of input: pending text becomes the last segment */
+    external fun nativeSentenceStreamFinish(handle: Long)
+
+    /** Drop pending text and queued segments, wake the consumer */
+    external fun nativeSentenceStreamCancel(handle: Long)
+
+    /**
+     * Wait for the next segment.
+     *
+     * @param timeoutMs Maximum wait (< 0 = forever)
+     * @return The segment, "" on timeout, or null once the stream is
+     *         finished/cancelled and every segment has been taken
+     */
+    external fun nativeSentenceStreamPoll(handle: Long, timeoutMs: Int): String?
+
+    /** Free the stream. No other call may be in flight. */
+    external fun nativeSentenceStreamDestroy(handle: Long)
+
+    // ========================================================================
+    // AUDIO RING
+    // ========================================================================
+
+    /**
+     * Create a single-producer/single-consumer float sample ring.
+     *
+     * @param capacity Size in samples (rounded up to a power of two)
+     * @return Native handle, released with [nativeAudioRingDestroy]
+     */
+    external fun nativeAudioRingCreate(capacity: Int): Long
+
+    /**
+     * Read up to `out.size` samples, waiting at most [timeoutMs] for data.
+     *
+     * @return Samples read, 0 on timeout, -1 once closed and drained or cancelled
+     */
+    external fun nativeAudioRingRead(handle: Long, out: FloatArray, timeoutMs: Int): Int
+
+    /** Write `audio[offset, offset + length)`, waiting for space. False if the ring was cancelled. */
+    external fun nativeAudioRingWrite(handle: Long, audio: FloatArray, offset: Int, length: Int): Boolean
+
+    /** Write silence, waiting for space. False if the ring was cancelled. */
+    external fun nativeAudioRingWriteSilence(handle: Long, samples: Int): Boolean
+
+    /** End of stream: the reader drains the ring, then gets -1 */
+    external fun nativeAudioRingClose(handle: Long)
+
+    /** Stop both sides immediately */
+    external fun nativeAudioRingCancel(handle: Long)
+
+    /** Free the ring. No other call may be in flight. */
+    external fun nativeAudioRingDestroy(handle: Long)
+
+    // ========================================================================
+    // PLAYBACK FEEDER
+    // ========================================================================
+
+    /**
+     * Start playing a ring on a native thread through an AAudio stream at
+     * the device rate. The ring must outlive the returned handle.
+     *
+     * @param sampleRate Rate of the audio in the ring
+     * @return Native handle, released with [nativePlaybackDestroy]; 0 if AAudio is unavailable
+     */
+    external fun nativePlaybackStart(ringHandle: Long, sampleRate: Int): Long
+
+    /** @return true once the ring was drained and played out (or playback stopped) */
+    external fun nativePlaybackWait(handle: Long, timeoutMs: Int): Boolean
+
+    external fun nativePlaybackPause(handle: Long)
+
+    external fun nativePlaybackResume(handle: Long)
+
+    /** Volume, 0..1 */
+    external fun nativePlaybackSetGain(handle: Long, gain: Float)
+
+    /** Stop now, dropping queued audio (does not cancel the ring) */
+    external fun nativePlaybackStop(handle: Long)
+
+    /**
+     * @return [samples played, underruns, starved ms, first audio ms, ring
+     *         underruns, ring low water (samples), device xruns, device rate]
+     */
+    external fun nativePlaybackStats(handle: Long): DoubleArray?
+
+    /** Stop, join the thread and free the feeder */
+    external fun nativePlaybackDestroy(handle: Long)
+
     companion object {
         init {
             System.loadLibrary("ai_supertonic_tts")
@@ -3,13 +3,21 @@ package com.mp.ai_supertonic_tts
 import android.content.Context
 import android.net.Uri
 import com.mp.ai_supertonic_tts.audio.AudioPlayer
+import com.mp.ai_supertonic_tts.audio.AudioRing
 import com.mp.ai_supertonic_tts.audio.AudioSaver
+import com.mp.ai_supertonic_tts.audio.WavSink
 import com.mp.ai_supertonic_tts.callback.TTSCallback
+import com.mp.ai_supertonic_tts.engine.SentenceStream
 import com.mp.ai_supertonic_tts.engine.TTSEngine
 import com.mp.ai_supertonic_tts.models.AudioFormat
+import com.mp.ai_supertonic_tts.models.PlaybackStats
 import com.mp.ai_supertonic_tts.models.SynthesisResult
 import com.mp.ai_supertonic_tts.models.TTSConfig
+import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 import java.io.BufferedReader
 import java.io.File
@@ -23,6 +31,7 @@ import java.io.InputStreamReader
  * - Loading Supertonic ONNX models from any path
  * - Text-to-speech synthesis with configurable voice, speed, and quality
  * - Real-time audio playback via AudioTrack
+ * - Speaking LLM output while it is still being generated
  * - Saving audio in multiple formats (WAV 16-bit, WAV 32-float, PCM, raw)
  * - Reading text from strings, files, URIs, or InputStreams
  *
@@ -38,6 +47,9 @@ import java.io.InputStreamReader
  * val result = tts.synthesize("Hello world")
  * tts.saveAudio(result, "/path/output.wav")
  *
+ * // Long-form export, streamed to disk
+ * tts.synthesizeToFile(bookText, "/path/book.wav")
+ *
  * // Custom config
  * tts.speak("Bonjour", TTSConfig(
  *     voice = "F2",
@@ -54,12 +66,16 @@ class SupertonicTTS(private val context: Context? = null) {
 
     private val nativeLib = SupertonicNativeLib()
     private val engine = TTSEngine(nativeLib)
-    private val player = AudioPlayer()
+    private val player = AudioPlayer(nativeLib)
 
     /** Last error message if an operation failed */
     var lastError: String? = null
         private set
 
+    init {
+        setAudioCache(true)
+    }
+
     // ========================================================================
     // MODEL MANAGEMENT
     // ========================================================================
@@ -103,6 +119,31 @@ class SupertonicTTS(private val context: Context? = null) {
      */
     fun getAvailableVoices(): List<String> = engine.getAvailableVoices()
 
+    /**
+     * Configure the cache of synthesized phrases. It is on by default: a
+     * repeated chunk (same text, voice, steps, speed and seed) replays
+     * without running the models. With a [Context], entries also persist
+     * under the app cache directory.
+     *
+     * @param enabled false stops caching (persisted entries are kept)
+     * @param memoryBytes In-memory budget
+     * @param diskBytes On-disk budget (ignored without a Context)
+     */
+    fun setAudioCache(
+        enabled: Boolean,
+        memoryBytes: Long = TTSEngine.DEFAULT_CACHE_MEMORY_BYTES,
+        diskBytes: Long = TTSEngine.DEFAULT_CACHE_DISK_BYTES
+    ) {
+        if (enabled) {
+            engine.setAudioCache(context?.let { File(it.cacheDir, AUDIO_CACHE_DIR) }, memoryBytes, diskBytes)
+        } else {
+            engine.disableAudioCache()
+        }
+    }
+
+    /** Delete every cached phrase, in memory and on disk */
+    fun clearAudioCache() = engine.clearAudioCache()
+
     /**
      * Release all resources (ONNX sessions, audio player).
      * Call this when you're done with the TTS engine.
@@ -159,18 +200,35 @@ class SupertonicTTS(private val context: Context? = null) {
     /**
      * Synthesize and play speech.
      *
+     * Audio is streamed: playback starts as soon as the first vocoder
+     * window of the first chunk is decoded and continues while the rest is
+     * synthesized.
+     *
      * @param text Input text to speak
      * @param config Synthesis configuration
      */
-    suspend fun speak(text: String, config: TTSConfig = TTSConfig()) {
-        val result = synthesize(text, config)
-        withContext(Dispatchers.IO) {
-            player.playStreaming(result)
+    suspend fun speak(text: String, config: TTSConfig = TTSConfig()) = coroutineScope {
+        AudioRing(nativeLib, engine.sampleRate * RING_SECONDS).use { ring ->
+            val playback = launch(Dispatchers.IO) { player.playRing(ring, engine.sampleRate) }
+
+            try {
+                engine.synthesizeToRing(text, config, ring)
+            } catch (e: CancellationException) {
+                ring.cancel()
+                throw e
+            } catch (e: Exception) {
+                ring.cancel()
+                lastError = e.message
+                throw e
+            }
+            playback.join()
         }
     }
 
     /**
-     * Synthesize and play speech with a progress callback.
+     * Synthesize and play speech with a progress callback. The whole text
+     * is synthesized first so [TTSCallback.onAudioReady] gets the complete
+     * result; use [speak] without a callback for the lowest latency.
      *
      * @param text Input text to speak
      * @param config Synthesis configuration
@@ -187,6 +245,71 @@ class SupertonicTTS(private val context: Context? = null) {
         }
     }
 
+    /**
+     * Open a stream that turns LLM output into speech segments as it is
+     * generated. Feed it tokens and pass it to [speakStream].
+     *
+     * ```kotlin
+     * val stream = tts.openSentenceStream(config)
+     * launch { tts.speakStream(stream, config) }
+     * llm.generate(prompt, object : StreamCallback {
+     *     override fun onToken(token: String) = stream.feed(token)
+     *     override fun onToolCall(name: String, argsJson: String) {}
+     *     override fun onDone() = stream.finish()
+     *     override fun onError(message: String) = stream.cancel()
+     * })
+     * ```
+     *
+     * @param config Synthesis configuration (its language drives segmentation)
+     * @param firstClauseMinLength Length after which the first segment may
+     *        end at a clause break; 0 waits for the first full sentence
+     * @return A stream to [SentenceStream.close] once speaking is done
+     */
+    fun openSentenceStream(
+        config: TTSConfig = TTSConfig(),
+        firstClauseMinLength: Int = SentenceStream.DEFAULT_FIRST_CLAUSE_MIN
+    ): SentenceStream {
+        return SentenceStream(nativeLib, config.language, 0, firstClauseMinLength)
+    }
+
+    /**
+     * Speak segments from [stream] as they are produced.
+     *
+     * Each segment is synthesized as soon as it closes and played while the
+     * next one is synthesized, so time to first audio is one sentence of
+     * generation plus one segment of synthesis. Returns when the stream is
+     * finished and all audio has been played. Cancelling the caller cancels
+     * the stream.
+     *
+     * @param stream Stream from [openSentenceStream]
+     * @param config Synthesis configuration
+     * @param callback Optional progress callback ([TTSCallback.onSegmentReady])
+     */
+    suspend fun speakStream(
+        stream: SentenceStream,
+        config: TTSConfig = TTSConfig(),
+        callback: TTSCallback? = null
+    ) = coroutineScope {
+        // Room for one segment queued behind the one playing
+        val ready = Channel<SynthesisResult>(capacity = 1)
+        val playback = launch(Dispatchers.IO) { player.playAll(ready) }
+
+        try {
+            engine.synthesizeStream(stream, config, callback) { ready.send(it) }
+        } catch (e: CancellationException) {
+            stream.cancel()
+            throw e
+        } catch (e: Exception) {
+            stream.cancel()
+            lastError = e.message
+            callback?.onError(e.message ?: "Synthesis failed")
+            throw e
+        } finally {
+            ready.close()
+        }
+        playback.join()
+    }
+
     /** Stop audio playback */
     fun stopPlayback() = player.stop()
 
@@ -202,6 +325,9 @@ class SupertonicTTS(private val context: Context? = null) {
     /** Set playback volume (0.0 to 1.0) */
     fun setVolume(volume: Float) = player.setVolume(volume)
 
+    /** Buffer health of the last native playback, null if none has run */
+    val lastPlaybackStats: PlaybackStats? get() = player.lastPlaybackStats
+
     // ========================================================================
     // INPUT SOURCES
     // ========================================================================
@@ -263,6 +389,71 @@ class SupertonicTTS(private val context: Context? = null) {
     // AUDIO SAVING
     // ========================================================================
 
+    /**
+     * Synthesize text straight into a WAV file.
+     *
+     * Audio is written chunk by chunk as it is synthesized, so memory use
+     * does not grow with the text: suitable for audiobook-length exports.
+     *
+     * @param text Input text to synthesize
+     * @param path Output file path (created or truncated)
+     * @param config Synthesis configuration
+     * @param format [AudioFormat.WAV_16] or [AudioFormat.WAV_32F]
+     * @param callback Optional progress callback
+     * @return Duration of the written audio in milliseconds
+     */
+    suspend fun synthesizeToFile(
+        text: String,
+        path: String,
+        config: TTSConfig = TTSConfig(),
+        format: AudioFormat = AudioFormat.WAV_16,
+        callback: TTSCallback? = null
+    ): Long = withContext(Dispatchers.IO) {
+        exportTo(text, config, callback) {
+            AudioSaver.openWavSink(path, engine.sampleRate, format, nativeLib)
+        }
+    }
+
+    /**
+     * Synthesize text straight into a WAV file at a content URI.
+     * Requires a Context (passed in constructor).
+     *
+     * @return Duration of the written audio in milliseconds
+     * @see synthesizeToFile
+     */
+    suspend fun synthesizeToFile(
+        text: String,
+        uri: Uri,
+        config: TTSConfig = TTSConfig(),
+        format: AudioFormat = AudioFormat.WAV_16,
+        callback: TTSCallback? = null
+    ): Long = withContext(Dispatchers.IO) {
+        val ctx = context ?: throw IllegalStateException("Context required for URI saving. Pass context in constructor.")
+        exportTo(text, config, callback) {
+            AudioSaver.openWavSink(uri, ctx, engine.sampleRate, format, nativeLib)
+        }
+    }
+
+    private suspend fun exportTo(
+        text: String,
+        config: TTSConfig,
+        callback: TTSCallback?,
+        open: () -> WavSink
+    ): Long {
+        return try {
+            open().use { sink ->
+                engine.synthesizeToSink(text, config, sink, callback)
+                sink.durationMs
+            }
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            lastError = e.message
+            callback?.onError(e.message ?: "Export failed")
+            throw e
+        }
+    }
+
     /**
      * Save a synthesis result to a file path.
      *
@@ -307,4 +498,12 @@ class SupertonicTTS(private val context: Context? = null) {
     fun toByteArray(result: SynthesisResult, format: AudioFormat): ByteArray {
         return AudioSaver.toByteArray(result, format, nativeLib)
     }
+
+    private companion object {
+        // Streamed playback buffer; synthesis runs ahead of playback by at most this much
+        const val RING_SECONDS = 4
+
+        // Under Context.cacheDir, so the system may reclaim it
+        const val AUDIO_CACHE_DIR = "supertonic_audio"
+    }
 }
@@ -2,8 +2,16 @@ package com.mp.ai_supertonic_tts.audio
 
 import android.media.AudioAttributes
 import android.media.AudioFormat
+import android.media.AudioManager
 import android.media.AudioTrack
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.models.PlaybackStats
 import com.mp.ai_supertonic_tts.models.SynthesisResult
+import java.io.Closeable
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.channels.ReceiveChannel
+import kotlinx.coroutines.currentCoroutineContext
+import kotlinx.coroutines.ensureActive
 
 /**
  * Audio playback via Android AudioTrack.
@@ -11,11 +19,32 @@ import com.mp.ai_supertonic_tts.models.SynthesisResult
  * Supports playing float32 audio from SynthesisResult directly
  * without needing to convert to PCM first (AudioTrack supports
  * ENCODING_PCM_FLOAT natively on API 21+).
+ *
+ * Audio is resampled natively to the device's output rate (usually
+ * 48 kHz), so tracks run at the native rate and streaming tracks can take
+ * the low-latency path with no resampling in the platform mixer.
+ *
+ * Streamed playback goes through an [AudioRing] drained by a native
+ * AAudio thread ([NativePlayback]): the caller only fills the ring, so the
+ * next chunk is synthesized while the current one plays, and each run
+ * leaves its buffer health in [lastPlaybackStats]. Devices without AAudio
+ * get a streaming AudioTrack instead.
  */
-class AudioPlayer {
+class AudioPlayer(private val nativeLib: SupertonicNativeLib = SupertonicNativeLib()) {
 
     private var audioTrack: AudioTrack? = null
 
+    @Volatile
+    private var nativePlayback: NativePlayback? = null
+
+    @Volatile
+    private var volume = 1f
+
+    /** Buffer health of the last streamed playback on the native path */
+    @Volatile
+    var lastPlaybackStats: PlaybackStats? = null
+        private set
+
     /**
      * Play a synthesis result.
      *
@@ -25,8 +54,15 @@ class AudioPlayer {
     fun play(result: SynthesisResult) {
         stop()
 
+        val sampleRate = outputRate(result.sampleRate)
+        val audio = if (sampleRate != result.sampleRate) {
+            nativeLib.nativeResample(result.audioData, result.sampleRate, sampleRate)
+        } else {
+            result.audioData
+        }
+
         val bufferSize = AudioTrack.getMinBufferSize(
-            result.sampleRate,
+            sampleRate,
             AudioFormat.CHANNEL_OUT_MONO,
             AudioFormat.ENCODING_PCM_FLOAT
         )
@@ -41,21 +77,21 @@ class AudioPlayer {
             .setAudioFormat(
                 AudioFormat.Builder()
                     .setEncoding(AudioFormat.ENCODING_PCM_FLOAT)
-                    .setSampleRate(result.sampleRate)
+                    .setSampleRate(sampleRate)
                     .setChannelMask(AudioFormat.CHANNEL_OUT_MONO)
                     .build()
             )
-            .setBufferSizeInBytes(maxOf(bufferSize, result.audioData.size * 4))
+            .setBufferSizeInBytes(maxOf(bufferSize, audio.size * 4))
             .setTransferMode(AudioTrack.MODE_STATIC)
             .build()
 
         audioTrack = track
 
-        track.write(result.audioData, 0, result.audioData.size, AudioTrack.WRITE_BLOCKING)
+        track.write(audio, 0, audio.size, AudioTrack.WRITE_BLOCKING)
         track.play()
 
         // Wait for playback to complete
-        val durationMs = (result.audioData.size.toLong() * 1000) / result.sampleRate
+        val durationMs = (audio.size.toLong() * 1000) / sampleRate
         Thread.sleep(durationMs + 100) // Small buffer for playback latency
 
         track.stop()
@@ -69,13 +105,200 @@ class AudioPlayer {
     fun playStreaming(result: SynthesisResult) {
         stop()
 
+        openStreamOutput(result.sampleRate).use { output ->
+            if (output.write(result.audioData)) output.finish()
+        }
+    }
+
+    /**
+     * Play results back to back on one streaming track as they arrive.
+     *
+     * Playback starts with the first result, while later ones may still be
+     * synthesizing. Returns once [results] is closed and everything was
+     * written; cancelling the caller stops playback immediately.
+     */
+    suspend fun playAll(results: ReceiveChannel<SynthesisResult>) {
+        stop()
+
+        var output: StreamOutput? = null
+        try {
+            for (result in results) {
+                val current = output ?: openStreamOutput(result.sampleRate).also { output = it }
+                if (!current.write(result.audioData)) break
+            }
+            output?.finish()
+        } catch (e: CancellationException) {
+            stop()
+            throw e
+        } finally {
+            output?.close()
+        }
+    }
+
+    /**
+     * Play audio from [ring] as it is written, until the writer finishes it.
+     *
+     * Blocks the calling thread for at most [RING_POLL_TIMEOUT_MS] at a
+     * time; cancelling the caller cancels the ring, which also stops the
+     * synthesis writing into it.
+     */
+    suspend fun playRing(ring: AudioRing, sampleRate: Int) {
+        stop()
+
+        val playback = NativePlayback.start(nativeLib, ring, sampleRate)
+        if (playback == null) {
+            playRingOnTrack(ring, sampleRate)
+            return
+        }
+        try {
+            attach(playback)
+            while (!playback.await(RING_POLL_TIMEOUT_MS)) {
+                currentCoroutineContext().ensureActive()
+            }
+        } catch (e: CancellationException) {
+            ring.cancel()
+            throw e
+        } finally {
+            detach(playback)
+        }
+    }
+
+    private suspend fun playRingOnTrack(ring: AudioRing, sampleRate: Int) {
+        val buffer = FloatArray(STREAM_CHUNK_SAMPLES)
+
+        TrackOutput(sampleRate).use { output ->
+            try {
+                while (true) {
+                    currentCoroutineContext().ensureActive()
+                    val count = ring.read(buffer, RING_POLL_TIMEOUT_MS)
+                    if (count < 0) break
+                    if (count > 0) output.write(buffer, count)
+                }
+                output.finish()
+            } catch (e: CancellationException) {
+                ring.cancel()
+                stop()
+                throw e
+            }
+        }
+    }
+
+    private fun attach(playback: NativePlayback) {
+        playback.setVolume(volume)
+        nativePlayback = playback
+    }
+
+    private fun detach(playback: NativePlayback) {
+        lastPlaybackStats = playback.stats()
+        if (nativePlayback === playback) nativePlayback = null
+        playback.close()
+    }
+
+    /**
+     * Audio written in pieces and played as it arrives
+     */
+    private interface StreamOutput : Closeable {
+        /** @return false once playback was stopped */
+        fun write(audio: FloatArray, length: Int = audio.size): Boolean
+
+        /** Play out everything written, then return */
+        fun finish()
+    }
+
+    private fun openStreamOutput(sampleRate: Int): StreamOutput {
+        val ring = AudioRing(nativeLib, sampleRate * RING_SECONDS)
+        val playback = NativePlayback.start(nativeLib, ring, sampleRate)
+        if (playback == null) {
+            ring.close()
+            return TrackOutput(sampleRate)
+        }
+        return RingOutput(ring, playback)
+    }
+
+    /**
+     * Writes into a ring that the native AAudio thread plays from
+     */
+    private inner class RingOutput(
+        private val ring: AudioRing,
+        private val playback: NativePlayback
+    ) : StreamOutput {
+
+        init {
+            attach(playback)
+        }
+
+        override fun write(audio: FloatArray, length: Int): Boolean = ring.write(audio, length)
+
+        override fun finish() {
+            ring.finish()
+            while (!playback.await(RING_POLL_TIMEOUT_MS)) {
+                // Woken periodically so a stop() from another thread is seen
+            }
+        }
+
+        override fun close() {
+            detach(playback)
+            ring.close()
+        }
+    }
+
+    /**
+     * A playing low-latency stream track at the device rate, with the
+     * resampler feeding it when the audio rate differs.
+     */
+    private inner class TrackOutput(sampleRate: Int) : StreamOutput {
+        private val track: AudioTrack
+        private val resampler: Resampler?
+
+        init {
+            val rate = outputRate(sampleRate)
+            resampler = if (rate != sampleRate) Resampler(nativeLib, sampleRate, rate) else null
+            track = createStreamTrack(rate)
+            audioTrack = track
+            track.setVolume(volume)
+            track.play()
+        }
+
+        override fun write(audio: FloatArray, length: Int): Boolean {
+            if (resampler == null) {
+                writeChunked(track, audio, length)
+            } else {
+                val resampled = resampler.process(audio, length)
+                writeChunked(track, resampled, resampler.lastCount)
+            }
+            return audioTrack === track
+        }
+
+        /** Write the resampler tail and wait for the track to drain */
+        override fun finish() {
+            resampler?.let {
+                val tail = it.flush()
+                writeChunked(track, tail, it.lastCount)
+            }
+            track.stop()
+        }
+
+        override fun close() {
+            resampler?.close()
+        }
+    }
+
+    /**
+     * The device's native output rate, so the mixer does not resample
+     */
+    private fun outputRate(sampleRate: Int): Int {
+        val native = AudioTrack.getNativeOutputSampleRate(AudioManager.STREAM_MUSIC)
+        return if (native > 0) native else sampleRate
+    }
+
+    private fun createStreamTrack(sampleRate: Int): AudioTrack {
         val bufferSize = AudioTrack.getMinBufferSize(
-            result.sampleRate,
+            sampleRate,
             AudioFormat.CHANNEL_OUT_MONO,
             AudioFormat.ENCODING_PCM_FLOAT
         )
 
-        val track = AudioTrack.Builder()
+        return AudioTrack.Builder()
             .setAudioAttributes(
                 AudioAttributes.Builder()
                     .setUsage(AudioAttributes.USAGE_MEDIA)
@@ -85,32 +308,29 @@ class AudioPlayer {
             .setAudioFormat(
                 AudioFormat.Builder()
                     .setEncoding(AudioFormat.ENCODING_PCM_FLOAT)
-                    .setSampleRate(result.sampleRate)
+                    .setSampleRate(sampleRate)
                     .setChannelMask(AudioFormat.CHANNEL_OUT_MONO)
                     .build()
             )
-            .setBufferSizeInBytes(maxOf(bufferSize, 4096 * 4))
+            .setBufferSizeInBytes(maxOf(bufferSize, STREAM_CHUNK_SAMPLES * 4))
             .setTransferMode(AudioTrack.MODE_STREAM)
+            .setPerformanceMode(AudioTrack.PERFORMANCE_MODE_LOW_LATENCY)
             .build()
+    }
 
-        audioTrack = track
-        track.play()
-
-        // Write in chunks
-        val chunkSize = 4096
+    private fun writeChunked(track: AudioTrack, audio: FloatArray, length: Int = audio.size) {
+        val chunkSize = STREAM_CHUNK_SAMPLES
         var offset = 0
-        while (offset < result.audioData.size) {
-            val remaining = result.audioData.size - offset
+        while (offset < length) {
+            val remaining = length - offset
             val writeSize = minOf(chunkSize, remaining)
-            track.write(result.audioData, offset, writeSize, AudioTrack.WRITE_BLOCKING)
+            track.write(audio, offset, writeSize, AudioTrack.WRITE_BLOCKING)
             offset += writeSize
         }
-
-        // Wait for remaining buffer to drain
-        track.stop()
     }
 
     fun stop() {
+        nativePlayback?.stop()
         audioTrack?.let { track ->
             try {
                 if (track.playState == AudioTrack.PLAYSTATE_PLAYING) {
@@ -125,6 +345,7 @@ class AudioPlayer {
     }
 
     fun pause() {
+        nativePlayback?.pause()
         audioTrack?.let { track ->
             if (track.playState == AudioTrack.PLAYSTATE_PLAYING) {
                 track.pause()
@@ -133,6 +354,7 @@ class AudioPlayer {
     }
 
     fun resume() {
+        nativePlayback?.resume()
         audioTrack?.let { track ->
             if (track.playState == AudioTrack.PLAYSTATE_PAUSED) {
                 track.play()
@@ -141,14 +363,27 @@ class AudioPlayer {
     }
 
     fun isPlaying(): Boolean {
+        nativePlayback?.let { return !it.isPaused }
         return audioTrack?.playState == AudioTrack.PLAYSTATE_PLAYING
     }
 
     fun setVolume(volume: Float) {
-        audioTrack?.setVolume(volume.coerceIn(0f, 1f))
+        this.volume = volume.coerceIn(0f, 1f)
+        nativePlayback?.setVolume(this.volume)
+        audioTrack?.setVolume(this.volume)
     }
 
     fun release() {
         stop()
     }
+
+    private companion object {
+        const val STREAM_CHUNK_SAMPLES = 4096
+
+        // Bounds how long a cancelled coroutine can stay blocked in a ring read
+        const val RING_POLL_TIMEOUT_MS = 50
+
+        // Ring for playStreaming/playAll: how far the caller can write ahead
+        const val RING_SECONDS = 4
+    }
 }
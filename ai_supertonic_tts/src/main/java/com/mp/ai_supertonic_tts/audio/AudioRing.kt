@@ -0,0 +1,86 @@
+package com.mp.ai_supertonic_tts.audio
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import java.io.Closeable
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * Native ring buffer between streamed synthesis and playback.
+ *
+ * The pipeline writes each vocoder window into the ring as soon as it is
+ * decoded; [AudioPlayer.playRing] plays from it on a native thread.
+ * Neither side locks the other, so playback never waits on inference
+ * unless the ring is actually empty.
+ *
+ * @param capacity Ring size in samples (rounded up to a power of two)
+ */
+class AudioRing internal constructor(
+    private val nativeLib: SupertonicNativeLib,
+    capacity: Int
+) : Closeable {
+
+    // Guards the handle against close() while a call is in flight
+    private val lock = ReentrantReadWriteLock()
+    private var handle: Long = nativeLib.nativeAudioRingCreate(capacity)
+
+    /** True once [cancel] was called */
+    @Volatile
+    var isCancelled = false
+        private set
+
+    /**
+     * Read up to `out.size` samples, waiting at most [timeoutMs].
+     *
+     * @return Samples read, 0 on timeout, -1 once finished and drained or cancelled
+     */
+    internal fun read(out: FloatArray, timeoutMs: Int): Int = lock.read {
+        if (handle != 0L) nativeLib.nativeAudioRingRead(handle, out, timeoutMs) else -1
+    }
+
+    /** Write `audio[0, length)`, waiting for space. False if cancelled. */
+    internal fun write(audio: FloatArray, length: Int = audio.size): Boolean = lock.read {
+        handle != 0L && nativeLib.nativeAudioRingWrite(handle, audio, 0, length)
+    }
+
+    /** Write [samples] of silence, waiting for space. False if cancelled. */
+    internal fun writeSilence(samples: Int): Boolean = lock.read {
+        handle != 0L && nativeLib.nativeAudioRingWriteSilence(handle, samples)
+    }
+
+    /** Run [block] with the native handle, or return null once closed */
+    internal fun <T> withHandle(block: (Long) -> T): T? = lock.read {
+        if (handle != 0L) block(handle) else null
+    }
+
+    /**
+     * No more audio will be written; the reader drains what is left.
+     */
+    fun finish() = lock.read {
+        if (handle != 0L) nativeLib.nativeAudioRingClose(handle)
+    }
+
+    /**
+     * Stop both sides immediately, dropping unplayed audio.
+     */
+    fun cancel() {
+        isCancelled = true
+        lock.read {
+            if (handle != 0L) nativeLib.nativeAudioRingCancel(handle)
+        }
+    }
+
+    /**
+     * Cancel the ring and free the native buffer.
+     */
+    override fun close() {
+        cancel()
+        lock.write {
+            if (handle != 0L) {
+                nativeLib.nativeAudioRingDestroy(handle)
+                handle = 0L
+            }
+        }
+    }
+}
@@ -2,13 +2,17 @@ package com.mp.ai_supertonic_tts.audio
 
 import android.content.Context
 import android.net.Uri
+import android.os.ParcelFileDescriptor
 import com.mp.ai_supertonic_tts.SupertonicNativeLib
 import com.mp.ai_supertonic_tts.models.AudioFormat
 import com.mp.ai_supertonic_tts.models.SynthesisResult
 import java.io.File
 import java.io.FileOutputStream
+import java.io.IOException
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
+import java.nio.channels.Channels
+import java.nio.channels.WritableByteChannel
 
 /**
  * Save synthesis results to files in various audio formats.
@@ -31,8 +35,8 @@ object AudioSaver {
         nativeLib: SupertonicNativeLib
     ): Boolean {
         return try {
-            val bytes = toByteArray(result, format, nativeLib)
-            FileOutputStream(File(path)).use { it.write(bytes) }
+            val buffer = toByteBuffer(result, format, nativeLib)
+            FileOutputStream(File(path)).use { writeFully(it.channel, buffer) }
             true
         } catch (_: Exception) {
             false
@@ -57,14 +61,55 @@ object AudioSaver {
         nativeLib: SupertonicNativeLib
     ): Boolean {
         return try {
-            val bytes = toByteArray(result, format, nativeLib)
-            context.contentResolver.openOutputStream(uri)?.use { it.write(bytes) }
+            val buffer = toByteBuffer(result, format, nativeLib)
+            context.contentResolver.openOutputStream(uri)?.use {
+                writeFully(Channels.newChannel(it), buffer)
+            }
             true
         } catch (_: Exception) {
             false
         }
     }
 
+    /**
+     * Open a streaming WAV file at [path] (created or truncated).
+     *
+     * @param format [AudioFormat.WAV_16] or [AudioFormat.WAV_32F]
+     * @throws IOException if the file cannot be opened
+     */
+    fun openWavSink(
+        path: String,
+        sampleRate: Int,
+        format: AudioFormat,
+        nativeLib: SupertonicNativeLib
+    ): WavSink {
+        val fd = ParcelFileDescriptor.open(
+            File(path),
+            ParcelFileDescriptor.MODE_WRITE_ONLY or ParcelFileDescriptor.MODE_CREATE or
+                ParcelFileDescriptor.MODE_TRUNCATE
+        )
+        return fd.use { WavSink(nativeLib, it, sampleRate, 1, format) }
+    }
+
+    /**
+     * Open a streaming WAV file at a content URI. Providers that only hand
+     * out non-seekable descriptors get a valid WAV with "unknown" sizes.
+     *
+     * @param format [AudioFormat.WAV_16] or [AudioFormat.WAV_32F]
+     * @throws IOException if the URI cannot be opened
+     */
+    fun openWavSink(
+        uri: Uri,
+        context: Context,
+        sampleRate: Int,
+        format: AudioFormat,
+        nativeLib: SupertonicNativeLib
+    ): WavSink {
+        val fd = context.contentResolver.openFileDescriptor(uri, "rwt")
+            ?: throw IOException("Could not open URI: $uri")
+        return fd.use { WavSink(nativeLib, it, sampleRate, 1, format) }
+    }
+
     /**
      * Convert a synthesis result to a byte array in the specified format.
      */
@@ -80,23 +125,75 @@ object AudioSaver {
             AudioFormat.WAV_32F -> nativeLib.nativeEncodeWav32f(
                 result.audioData, result.sampleRate, result.channels
             )
+            AudioFormat.FLAC, AudioFormat.WAV_ADPCM -> encodeCompressed(result, format, nativeLib)
             AudioFormat.PCM_16 -> nativeLib.nativeEncodePcm16(result.audioData)
-            AudioFormat.PCM_32F -> {
-                val buf = ByteBuffer.allocate(result.audioData.size * 4)
-                buf.order(ByteOrder.LITTLE_ENDIAN)
-                for (sample in result.audioData) {
-                    buf.putFloat(sample)
-                }
-                buf.array()
+            AudioFormat.PCM_32F -> floatBytes(result.audioData, ByteOrder.LITTLE_ENDIAN, direct = false).array()
+            AudioFormat.RAW_FLOAT -> floatBytes(result.audioData, ByteOrder.nativeOrder(), direct = false).array()
+        }
+    }
+
+    /**
+     * Encode a synthesis result for writing to a channel.
+     *
+     * 16-bit formats are encoded natively straight into a direct buffer,
+     * so the encoded bytes are never copied through the Java heap.
+     */
+    fun toByteBuffer(
+        result: SynthesisResult,
+        format: AudioFormat,
+        nativeLib: SupertonicNativeLib
+    ): ByteBuffer {
+        val audio = result.audioData
+        return when (format) {
+            AudioFormat.WAV_16 -> {
+                val buf = ByteBuffer.allocateDirect(WAV_HEADER_SIZE + audio.size * 2)
+                val written = nativeLib.nativeEncodeWav16Direct(audio, result.sampleRate, result.channels, buf)
+                check(written >= 0) { "WAV encoding failed" }
+                buf.limit(written)
+                buf
             }
-            AudioFormat.RAW_FLOAT -> {
-                val buf = ByteBuffer.allocate(result.audioData.size * 4)
-                buf.order(ByteOrder.nativeOrder())
-                for (sample in result.audioData) {
-                    buf.putFloat(sample)
-                }
-                buf.array()
+            AudioFormat.PCM_16 -> {
+                val buf = ByteBuffer.allocateDirect(audio.size * 2)
+                val written = nativeLib.nativeEncodePcm16Direct(audio, buf)
+                check(written >= 0) { "PCM encoding failed" }
+                buf.limit(written)
+                buf
             }
+            AudioFormat.WAV_32F -> ByteBuffer.wrap(
+                nativeLib.nativeEncodeWav32f(audio, result.sampleRate, result.channels)
+            )
+            AudioFormat.FLAC, AudioFormat.WAV_ADPCM -> ByteBuffer.wrap(
+                encodeCompressed(result, format, nativeLib)
+            )
+            AudioFormat.PCM_32F -> floatBytes(audio, ByteOrder.LITTLE_ENDIAN, direct = true)
+            AudioFormat.RAW_FLOAT -> floatBytes(audio, ByteOrder.nativeOrder(), direct = true)
         }
     }
+
+    private const val WAV_HEADER_SIZE = 44
+
+    private fun encodeCompressed(
+        result: SynthesisResult,
+        format: AudioFormat,
+        nativeLib: SupertonicNativeLib
+    ): ByteArray {
+        val bytes = if (format == AudioFormat.FLAC) {
+            nativeLib.nativeEncodeFlac(result.audioData, result.sampleRate, result.channels)
+        } else {
+            nativeLib.nativeEncodeWavAdpcm(result.audioData, result.sampleRate, result.channels)
+        }
+        return checkNotNull(bytes) { "$format encoding failed" }
+    }
+
+    // One bulk put instead of a putFloat() per sample
+    private fun floatBytes(audio: FloatArray, order: ByteOrder, direct: Boolean): ByteBuffer {
+        val size = audio.size * 4
+        val buf = (if (direct) ByteBuffer.allocateDirect(size) else ByteBuffer.allocate(size)).order(order)
+        buf.asFloatBuffer().put(audio)
+        return buf
+    }
+
+    private fun writeFully(channel: WritableByteChannel, buffer: ByteBuffer) {
+        while (buffer.hasRemaining()) channel.write(buffer)
+    }
 }
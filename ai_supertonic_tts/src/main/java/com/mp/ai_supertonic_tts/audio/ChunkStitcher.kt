@@ -0,0 +1,69 @@
+package com.mp.ai_supertonic_tts.audio
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.models.TTSConfig
+import java.io.Closeable
+
+/**
+ * Joins synthesized chunks natively in one pass.
+ *
+ * Each chunk's leading and trailing silence is trimmed with an energy
+ * gate, chunks are joined with `chunkSilenceMs` of silence or a
+ * `chunkCrossfadeMs` equal-power crossfade, and `gain` and a peak limiter
+ * at `peakLimit` are applied on the way out. Output is written straight
+ * into the result array ([stitch]) or encoded by a [WavSink] ([writeTo]),
+ * so there is no Kotlin concatenation and no separate clipping pass.
+ */
+class ChunkStitcher internal constructor(
+    private val nativeLib: SupertonicNativeLib,
+    val sampleRate: Int,
+    config: TTSConfig
+) : Closeable {
+
+    private var handle: Long = nativeLib.nativeStitcherCreate(
+        sampleRate, config.chunkSilenceMs, config.chunkCrossfadeMs,
+        config.trimSilence, config.gain, config.peakLimit
+    )
+
+    init {
+        require(handle != 0L) { "Invalid sample rate: $sampleRate" }
+    }
+
+    /**
+     * Stitch whole chunks into one buffer.
+     */
+    fun stitch(chunks: List<FloatArray>): FloatArray {
+        check(handle != 0L) { "ChunkStitcher is closed" }
+        return checkNotNull(nativeLib.nativeStitcherStitch(handle, chunks.toTypedArray())) {
+            "Stitching failed"
+        }
+    }
+
+    /**
+     * Stitch the next chunk into [sink]. The end of a chunk is held back
+     * for the crossfade until the next one, or [finishTo].
+     *
+     * @throws java.io.IOException if the write fails
+     */
+    fun writeTo(sink: WavSink, audio: FloatArray) {
+        check(handle != 0L) { "ChunkStitcher is closed" }
+        sink.writeWith { nativeLib.nativeStitcherWrite(handle, audio, it) }
+    }
+
+    /**
+     * Write the held-back end of the last chunk to [sink].
+     *
+     * @throws java.io.IOException if the write fails
+     */
+    fun finishTo(sink: WavSink) {
+        check(handle != 0L) { "ChunkStitcher is closed" }
+        sink.writeWith { nativeLib.nativeStitcherFinish(handle, it) }
+    }
+
+    override fun close() {
+        if (handle != 0L) {
+            nativeLib.nativeStitcherDestroy(handle)
+            handle = 0L
+        }
+    }
+}
@@ -0,0 +1,92 @@
+package com.mp.ai_supertonic_tts.audio
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.models.PlaybackStats
+import java.io.Closeable
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * Native playback of an [AudioRing]: a dedicated thread drains the ring
+ * into an AAudio stream at the device rate, resampling on the way.
+ *
+ * The ring must stay open until [close].
+ */
+internal class NativePlayback private constructor(
+    private val nativeLib: SupertonicNativeLib,
+    private val ring: AudioRing,
+    private var handle: Long,
+    private val sampleRate: Int
+) : Closeable {
+
+    // Guards the handle against close() while a call is in flight
+    private val lock = ReentrantReadWriteLock()
+
+    @Volatile
+    var isPaused = false
+        private set
+
+    /** @return true once everything was played, or playback stopped */
+    fun await(timeoutMs: Int): Boolean = lock.read {
+        handle == 0L || nativeLib.nativePlaybackWait(handle, timeoutMs)
+    }
+
+    fun pause() = lock.read {
+        isPaused = true
+        if (handle != 0L) nativeLib.nativePlaybackPause(handle)
+    }
+
+    fun resume() = lock.read {
+        isPaused = false
+        if (handle != 0L) nativeLib.nativePlaybackResume(handle)
+    }
+
+    fun setVolume(volume: Float) = lock.read {
+        if (handle != 0L) nativeLib.nativePlaybackSetGain(handle, volume)
+    }
+
+    /**
+     * Stop now. The ring is cancelled too, so whatever writes into it
+     * gives up instead of waiting for space.
+     */
+    fun stop() {
+        ring.cancel()
+        lock.read {
+            if (handle != 0L) nativeLib.nativePlaybackStop(handle)
+        }
+    }
+
+    fun stats(): PlaybackStats? = lock.read {
+        val values = handle.takeIf { it != 0L }?.let { nativeLib.nativePlaybackStats(it) }
+            ?: return@read null
+        PlaybackStats(
+            samplesPlayed = values[0].toLong(),
+            underruns = values[1].toLong(),
+            starvedMs = values[2],
+            firstAudioMs = values[3],
+            ringUnderruns = values[4].toLong(),
+            ringLowWaterMs = values[5] * 1000.0 / sampleRate,
+            deviceXruns = values[6].toLong(),
+            deviceRate = values[7].toInt()
+        )
+    }
+
+    /** Stop and join the playback thread */
+    override fun close() {
+        lock.write {
+            if (handle != 0L) {
+                nativeLib.nativePlaybackDestroy(handle)
+                handle = 0L
+            }
+        }
+    }
+
+    companion object {
+        /** @return null if AAudio is unavailable (use AudioTrack instead) */
+        fun start(nativeLib: SupertonicNativeLib, ring: AudioRing, sampleRate: Int): NativePlayback? {
+            val handle = ring.withHandle { nativeLib.nativePlaybackStart(it, sampleRate) } ?: 0L
+            return if (handle != 0L) NativePlayback(nativeLib, ring, handle, sampleRate) else null
+        }
+    }
+}
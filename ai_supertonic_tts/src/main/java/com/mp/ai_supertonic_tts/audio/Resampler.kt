@@ -0,0 +1,66 @@
+package com.mp.ai_supertonic_tts.audio
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import java.io.Closeable
+
+/**
+ * Streaming sample rate converter (native polyphase windowed sinc).
+ *
+ * Filter history and phase carry over between [process] calls, so audio
+ * can be fed in blocks of any size. Output goes into a buffer owned by
+ * the resampler and reused across calls.
+ */
+class Resampler internal constructor(
+    private val nativeLib: SupertonicNativeLib,
+    val inRate: Int,
+    val outRate: Int
+) : Closeable {
+
+    private var handle: Long = nativeLib.nativeResamplerCreate(inRate, outRate)
+    private var output = FloatArray(0)
+
+    /** Samples written by the last [process] or [flush] */
+    var lastCount = 0
+        private set
+
+    init {
+        require(handle != 0L) { "Invalid sample rates: $inRate -> $outRate" }
+    }
+
+    /**
+     * Resample the first [length] samples of [input].
+     *
+     * @return Buffer holding the result in its first [lastCount] samples
+     *         (valid until the next call)
+     */
+    fun process(input: FloatArray, length: Int = input.size): FloatArray {
+        check(handle != 0L) { "Resampler is closed" }
+        ensureCapacity(nativeLib.nativeResamplerMaxOutput(handle, length))
+        lastCount = nativeLib.nativeResamplerProcess(handle, input, length, output)
+        check(lastCount >= 0) { "Resampling failed" }
+        return output
+    }
+
+    /**
+     * End of stream: the remaining output, as with [process]. The
+     * resampler can then be reused for a new stream.
+     */
+    fun flush(): FloatArray {
+        check(handle != 0L) { "Resampler is closed" }
+        ensureCapacity(nativeLib.nativeResamplerMaxOutput(handle, 0))
+        lastCount = nativeLib.nativeResamplerFlush(handle, output)
+        check(lastCount >= 0) { "Resampling failed" }
+        return output
+    }
+
+    override fun close() {
+        if (handle != 0L) {
+            nativeLib.nativeResamplerDestroy(handle)
+            handle = 0L
+        }
+    }
+
+    private fun ensureCapacity(size: Int) {
+        if (output.size < size) output = FloatArray(size)
+    }
+}
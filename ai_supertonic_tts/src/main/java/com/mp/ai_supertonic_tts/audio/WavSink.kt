@@ -0,0 +1,102 @@
+package com.mp.ai_supertonic_tts.audio
+
+import android.os.ParcelFileDescriptor
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.models.AudioFormat
+import java.io.Closeable
+import java.io.IOException
+
+/**
+ * Streaming WAV file writer.
+ *
+ * Audio is appended as it is synthesized and encoded natively straight to
+ * the file descriptor, so exporting an hour-long audiobook never holds
+ * more than one chunk in memory. The header sizes are filled in by
+ * [close]; files over 4 GB are written as RF64.
+ *
+ * Open with [AudioSaver.openWavSink].
+ */
+class WavSink internal constructor(
+    private val nativeLib: SupertonicNativeLib,
+    fd: ParcelFileDescriptor,
+    val sampleRate: Int,
+    val channels: Int = 1,
+    format: AudioFormat = AudioFormat.WAV_16
+) : Closeable {
+
+    private var handle: Long
+
+    /** Frames written so far */
+    var framesWritten = 0L
+        private set
+
+    /** Audio duration written so far */
+    val durationMs: Long get() = framesWritten * 1000 / sampleRate
+
+    init {
+        require(format == AudioFormat.WAV_16 || format == AudioFormat.WAV_32F) {
+            "WavSink writes WAV_16 or WAV_32F, not $format"
+        }
+        // The native writer owns the fd from here on
+        handle = nativeLib.nativeWavWriterOpen(
+            fd.detachFd(), sampleRate, channels, format == AudioFormat.WAV_32F
+        )
+        if (handle == 0L) throw IOException("Could not start WAV file")
+    }
+
+    /**
+     * Append interleaved float audio.
+     *
+     * @throws IOException if the write fails
+     */
+    @Synchronized
+    fun write(audio: FloatArray, offset: Int = 0, length: Int = audio.size - offset) {
+        check(handle != 0L) { "WavSink is closed" }
+        if (!nativeLib.nativeWavWriterWrite(handle, audio, offset, length)) throw error("Write")
+        framesWritten += length / channels
+    }
+
+    /**
+     * Append [frames] frames of silence.
+     *
+     * @throws IOException if the write fails
+     */
+    @Synchronized
+    fun writeSilence(frames: Int) {
+        check(handle != 0L) { "WavSink is closed" }
+        if (!nativeLib.nativeWavWriterWriteSilence(handle, frames)) throw error("Write")
+        framesWritten += frames
+    }
+
+    /**
+     * Append through a native call that writes to this sink's writer and
+     * returns the frames it wrote, or -1 on failure.
+     *
+     * @throws IOException if the write fails
+     */
+    @Synchronized
+    internal fun writeWith(write: (Long) -> Long) {
+        check(handle != 0L) { "WavSink is closed" }
+        val frames = write(handle)
+        if (frames < 0) throw error("Write")
+        framesWritten += frames
+    }
+
+    /**
+     * Flush, fill in the header sizes and close the file.
+     *
+     * @throws IOException if the final flush or header update fails
+     */
+    @Synchronized
+    override fun close() {
+        if (handle == 0L) return
+        val ok = nativeLib.nativeWavWriterClose(handle)
+        val failure = if (ok) null else error("Close")
+        nativeLib.nativeWavWriterDestroy(handle)
+        handle = 0L
+        if (failure != null) throw failure
+    }
+
+    private fun error(operation: String) =
+        IOException("$operation failed: ${nativeLib.nativeWavWriterLastError(handle) ?: "unknown error"}")
+}
@@ -15,6 +15,9 @@ interface TTSCallback {
     /** Called after each chunk is synthesized (for multi-chunk text) */
     fun onChunkProgress(chunkIndex: Int, totalChunks: Int) {}
 
+    /** Called after each streamed segment is synthesized (see SupertonicTTS.speakStream) */
+    fun onSegmentReady(segmentIndex: Int, text: String) {}
+
     /** Called when the final audio is ready */
     fun onAudioReady(result: SynthesisResult) {}
 
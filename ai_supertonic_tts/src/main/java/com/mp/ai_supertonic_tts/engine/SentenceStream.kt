@@ -0,0 +1,88 @@
+package com.mp.ai_supertonic_tts.engine
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.models.Language
+import java.io.Closeable
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * Streams LLM output into TTS segments as it is generated.
+ *
+ * Feed every generated token with [feed] and call [finish] when generation
+ * ends. Sentence and clause boundaries are detected natively as the text
+ * arrives, and each completed segment is queued for synthesis right away,
+ * so the first audio is ready after one sentence of generation instead of
+ * after the whole reply.
+ *
+ * [feed], [finish] and [cancel] may be called from the generation thread
+ * while a synthesis loop consumes the segments on another thread.
+ */
+class SentenceStream internal constructor(
+    private val nativeLib: SupertonicNativeLib,
+    val language: Language,
+    maxLength: Int = 0,
+    firstClauseMinLength: Int = DEFAULT_FIRST_CLAUSE_MIN
+) : Closeable {
+
+    // Guards the handle against close() while a call is in flight
+    private val lock = ReentrantReadWriteLock()
+    private var handle: Long = nativeLib.nativeSentenceStreamCreate(
+        language.ordinal, maxLength, firstClauseMinLength
+    )
+
+    /**
+     * Append generated text (a token or any other piece).
+     * Ignored after [finish], [cancel] or [close].
+     */
+    fun feed(text: String) {
+        if (text.isEmpty()) return
+        lock.read {
+            if (handle != 0L) nativeLib.nativeSentenceStreamFeed(handle, text)
+        }
+    }
+
+    /**
+     * Generation finished: the remaining text becomes the last segment.
+     */
+    fun finish() = lock.read {
+        if (handle != 0L) nativeLib.nativeSentenceStreamFinish(handle)
+    }
+
+    /**
+     * Drop everything not yet synthesized and stop the consumer.
+     */
+    fun cancel() = lock.read {
+        if (handle != 0L) nativeLib.nativeSentenceStreamCancel(handle)
+    }
+
+    /**
+     * Next segment, "" if none arrived within [timeoutMs], or null once the
+     * stream is finished or cancelled and fully consumed.
+     */
+    internal fun poll(timeoutMs: Int): String? = lock.read {
+        if (handle != 0L) nativeLib.nativeSentenceStreamPoll(handle, timeoutMs) else null
+    }
+
+    /**
+     * Cancel the stream and free the native state.
+     */
+    override fun close() {
+        cancel()
+        lock.write {
+            if (handle != 0L) {
+                nativeLib.nativeSentenceStreamDestroy(handle)
+                handle = 0L
+            }
+        }
+    }
+
+    companion object {
+        /**
+         * The first segment may end at a clause break (", ", "; ") once it
+         * is this long, so speech starts before the first sentence is done.
+         */
+        const val DEFAULT_FIRST_CLAUSE_MIN = 40
+    }
+}
@@ -1,27 +1,18 @@
 package com.mp.ai_supertonic_tts.engine
 
-import ai.onnxruntime.OnnxTensor
-import ai.onnxruntime.OrtEnvironment
-import ai.onnxruntime.OrtSession
 import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import com.mp.ai_supertonic_tts.audio.AudioRing
+import com.mp.ai_supertonic_tts.audio.ChunkStitcher
+import com.mp.ai_supertonic_tts.audio.WavSink
 import com.mp.ai_supertonic_tts.callback.TTSCallback
 import com.mp.ai_supertonic_tts.models.SynthesisResult
 import com.mp.ai_supertonic_tts.models.TTSConfig
 import com.mp.ai_supertonic_tts.models.VoiceStyle
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.ensureActive
 import kotlinx.coroutines.withContext
 import org.json.JSONObject
 import java.io.File
-import java.nio.FloatBuffer
-import java.nio.LongBuffer
-import java.util.Random
-import kotlin.math.PI
-import kotlin.math.ceil
-import kotlin.math.cos
-import kotlin.math.ln
-import kotlin.math.min
-import kotlin.math.sin
-import kotlin.math.sqrt
 
 /**
  * ONNX inference engine for Supertonic TTS.
@@ -31,31 +22,33 @@ import kotlin.math.sqrt
  * 2. Text Encoder → encodes text into embeddings
  * 3. Vector Estimator → iterative flow-matching denoising
  * 4. Vocoder → converts latents to audio waveform
+ *
+ * Text processing and chunking run here; the model pipeline itself runs
+ * natively ([SupertonicNativeLib.synthesize]) so the denoising loop never
+ * crosses JNI.
  */
 class TTSEngine(private val nativeLib: SupertonicNativeLib) {
 
-    private var environment: OrtEnvironment? = null
-    private var dpSession: OrtSession? = null
-    private var teSession: OrtSession? = null
-    private var veSession: OrtSession? = null
-    private var vocSession: OrtSession? = null
-
     private var textProcessor: TextProcessor? = null
     private val voiceStyles = mutableMapOf<String, VoiceStyle>()
 
     // Model config from tts.json
-    private var sampleRate: Int = 44100
+    var sampleRate: Int = 44100
+        private set
     private var baseChunkSize: Int = 512
     private var chunkCompressFactor: Int = 6
     private var latentDim: Int = 24
 
-    private val latentDimTotal: Int get() = latentDim * chunkCompressFactor
-
     var lastError: String? = null
         private set
 
-    fun isLoaded(): Boolean = dpSession != null && teSession != null &&
-            veSession != null && vocSession != null && textProcessor != null
+    // Synthesis cache, re-created for every model load (null = off)
+    private var audioCache: AudioCacheSettings? = null
+    private var modelId: String = ""
+
+    private data class AudioCacheSettings(val directory: File?, val memoryBytes: Long, val diskBytes: Long)
+
+    fun isLoaded(): Boolean = nativeLib.isPipelineLoaded() && textProcessor != null
 
     /**
      * Load Supertonic ONNX models from a directory.
@@ -74,6 +67,10 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
      *     F1.json, F2.json, ..., M1.json, M2.json, ...
      * ```
      *
+     * On first load, unicode_indexer.json and each voice JSON get a binary
+     * `.bin` cache next to them ([TensorCache]); later loads map those
+     * instead of parsing JSON.
+     *
      * @param modelDir Root directory containing onnx/ and voice_styles/
      * @param useNNAPI Enable NNAPI acceleration
      * @return true if all models loaded successfully
@@ -104,31 +101,29 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
             // Load config
             loadConfig("$onnxDir/tts.json")
 
-            // Load unicode indexer
-            val indexer = TextProcessor.loadUnicodeIndexer("$onnxDir/unicode_indexer.json")
-            textProcessor = TextProcessor(indexer)
-
-            // Create ONNX environment and sessions
-            environment = OrtEnvironment.getEnvironment()
-            val env = environment!!
+            // Load unicode indexer (mapped binary cache; JSON if it can't be built)
+            val indexerPath = "$onnxDir/unicode_indexer.json"
+            textProcessor = TensorCache.load(nativeLib, indexerPath, TensorCache.KIND_UNICODE_INDEXER)
+                ?.let { TextProcessor(it) }
+                ?: TextProcessor(TextProcessor.loadUnicodeIndexer(indexerPath), nativeLib)
 
-            val opts = OrtSession.SessionOptions()
-            if (useNNAPI) {
-                try {
-                    opts.addNnapi()
-                } catch (_: Exception) {
-                    // NNAPI not available, fall back to CPU
-                }
+            // Create ONNX sessions (native pipeline)
+            if (!nativeLib.loadPipeline(
+                    onnxDir, sampleRate, baseChunkSize, chunkCompressFactor, latentDim,
+                    useNNAPI = useNNAPI
+                )
+            ) {
+                lastError = nativeLib.pipelineError() ?: "Failed to load ONNX models"
+                release()
+                return false
             }
 
-            dpSession = env.createSession("$onnxDir/duration_predictor.onnx", opts)
-            teSession = env.createSession("$onnxDir/text_encoder.onnx", opts)
-            veSession = env.createSession("$onnxDir/vector_estimator.onnx", opts)
-            vocSession = env.createSession("$onnxDir/vocoder.onnx", opts)
-
             // Load voice styles
             loadVoiceStyles(voiceDir)
 
+            modelId = modelFingerprint(requiredFiles)
+            applyAudioCache()
+
             lastError = null
             return true
         } catch (e: Exception) {
@@ -174,45 +169,13 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
 
         callback?.onSynthesisStart(text.length, chunks.size)
 
-        val audioSegments = mutableListOf<FloatArray>()
-        var totalSamples = 0
-        var totalDuration = 0f
-        val silenceSamples = (config.chunkSilenceMs * sampleRate / 1000)
-
-        for ((index, chunk) in chunks.withIndex()) {
-            if (chunk.isBlank()) continue
-
-            val chunkAudio = synthesizeChunk(chunk, config, style)
-            val chunkDur = chunkAudio.size.toFloat() / sampleRate
-
-            // Add silence gap between chunks (not before first audio segment)
-            if (audioSegments.isNotEmpty() && config.chunkSilenceMs > 0) {
-                val silence = FloatArray(silenceSamples)
-                audioSegments.add(silence)
-                totalSamples += silenceSamples
-                totalDuration += config.chunkSilenceMs / 1000f
-            }
-
-            audioSegments.add(chunkAudio)
-            totalSamples += chunkAudio.size
-            totalDuration += chunkDur
+        val chunkAudio = synthesizeChunks(chunks.filter { it.isNotBlank() }, config, style, callback)
 
-            callback?.onChunkProgress(index + 1, chunks.size)
-        }
-
-        // Concatenate all segments into one array
-        val audioArray = FloatArray(totalSamples)
-        var offset = 0
-        for (segment in audioSegments) {
-            System.arraycopy(segment, 0, audioArray, offset, segment.size)
-            offset += segment.size
-        }
-
-        // Clip audio to [-1, 1]
-        nativeLib.nativeClipAudio(audioArray)
+        // Trim, join, gain and limit natively, straight into the result
+        val audioArray = ChunkStitcher(nativeLib, sampleRate, config).use { it.stitch(chunkAudio) }
 
         val synthesisTime = System.currentTimeMillis() - startTime
-        val durationMs = (totalDuration * 1000).toLong()
+        val durationMs = audioArray.size.toLong() * 1000 / sampleRate
 
         val result = SynthesisResult(
             audioData = audioArray,
@@ -227,147 +190,274 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
     }
 
     /**
-     * Synthesize a single chunk of text (no chunking).
+     * Synthesize segments from a [SentenceStream] as they close.
+     *
+     * Each segment is synthesized and handed to [onSegment] while the
+     * producer keeps generating, so [onSegment] runs for the first sentence
+     * long before the reply is complete. Segments after the first start
+     * with `config.chunkSilenceMs` of silence.
+     *
+     * @param stream Segment source fed by the LLM token stream
+     * @param config Synthesis configuration (chunking options are ignored)
+     * @param callback Optional progress callback
+     * @param onSegment Receives each segment's audio, in order
+     * @return Number of segments synthesized
      */
-    private fun synthesizeChunk(text: String, config: TTSConfig, style: VoiceStyle): FloatArray {
-        val env = environment ?: throw IllegalStateException("Environment not initialized")
+    suspend fun synthesizeStream(
+        stream: SentenceStream,
+        config: TTSConfig,
+        callback: TTSCallback? = null,
+        onSegment: suspend (SynthesisResult) -> Unit
+    ): Int = withContext(Dispatchers.Default) {
+        if (!isLoaded()) {
+            throw IllegalStateException("Model not loaded. Call loadModel() first.")
+        }
 
-        // 1. Process text
-        val processed = textProcessor!!.process(text, config.language)
-        val seqLen = processed.sequenceLength
+        val style = voiceStyles[config.voice]
+            ?: throw IllegalArgumentException("Voice '${config.voice}' not found. Available: ${getAvailableVoices()}")
 
-        // Create tensors
-        val textIdsTensor = createLongTensor(
-            processed.textIds, longArrayOf(1, seqLen.toLong()), env
-        )
-        val textMaskTensor = createFloatTensor(
-            processed.textMask, longArrayOf(1, 1, seqLen.toLong()), env
-        )
-        val styleDpTensor = createFloatTensor(
-            style.styleDp, style.styleDpShape, env
-        )
-        val styleTtlTensor = createFloatTensor(
-            style.styleTtl, style.styleTtlShape, env
-        )
+        val silenceSamples = (config.chunkSilenceMs * sampleRate / 1000)
+        var count = 0
 
-        try {
-            // 2. Duration prediction
-            val dpInputs = mapOf(
-                "text_ids" to textIdsTensor,
-                "style_dp" to styleDpTensor,
-                "text_mask" to textMaskTensor
-            )
-            val dpResult = dpSession!!.run(dpInputs)
-            val durationRaw = extractFloatOutput(dpResult)
-            dpResult.close()
+        while (true) {
+            ensureActive()
+            val text = stream.poll(STREAM_POLL_TIMEOUT_MS) ?: break
+            if (text.isBlank()) continue
 
-            val duration = durationRaw / config.speed
+            val startTime = System.currentTimeMillis()
+            val chunkAudio = synthesizeChunk(text, config, style)
 
-            // 3. Text encoding
-            val teInputs = mapOf(
-                "text_ids" to textIdsTensor,
-                "style_ttl" to styleTtlTensor,
-                "text_mask" to textMaskTensor
+            val audio = if (count > 0 && silenceSamples > 0) {
+                FloatArray(silenceSamples + chunkAudio.size).also {
+                    System.arraycopy(chunkAudio, 0, it, silenceSamples, chunkAudio.size)
+                }
+            } else {
+                chunkAudio
+            }
+            nativeLib.nativeClipAudio(audio)
+
+            count++
+            callback?.onSegmentReady(count, text)
+            onSegment(
+                SynthesisResult(
+                    audioData = audio,
+                    sampleRate = sampleRate,
+                    channels = 1,
+                    durationMs = audio.size.toLong() * 1000 / sampleRate,
+                    synthesisTimeMs = System.currentTimeMillis() - startTime
+                )
             )
-            val teResult = teSession!!.run(teInputs)
-            val textEmbTensor = teResult.get(0) as OnnxTensor
+        }
+        count
+    }
+
+    /**
+     * Synthesize text straight into [ring] for playback.
+     *
+     * Each chunk is vocoded in short overlapping windows and every window
+     * is written to the ring as soon as it is decoded, so the first audio
+     * plays after a fraction of the first chunk instead of after the whole
+     * text. Chunks after the first start with `config.chunkSilenceMs` of
+     * silence. The ring is finished on return; cancelling the ring stops
+     * synthesis at the next window.
+     *
+     * @param text Input text to synthesize
+     * @param config Synthesis configuration (batching is not used)
+     * @param ring Destination ring, read by [com.mp.ai_supertonic_tts.audio.AudioPlayer.playRing]
+     * @param callback Optional progress callback
+     */
+    suspend fun synthesizeToRing(
+        text: String,
+        config: TTSConfig,
+        ring: AudioRing,
+        callback: TTSCallback? = null
+    ) = withContext(Dispatchers.Default) {
+        if (!isLoaded()) {
+            throw IllegalStateException("Model not loaded. Call loadModel() first.")
+        }
+
+        val style = voiceStyles[config.voice]
+            ?: throw IllegalArgumentException("Voice '${config.voice}' not found. Available: ${getAvailableVoices()}")
 
-            // 4. Initialize noisy latent
-            val wavLen = (duration * sampleRate).toLong()
-            val chunkSize = baseChunkSize.toLong() * chunkCompressFactor.toLong()
-            val latentLen = ((wavLen + chunkSize - 1) / chunkSize).toInt()
+        val chunks = if (config.chunkingEnabled) {
+            TextChunker.chunk(text, config.language)
+        } else {
+            listOf(text)
+        }.filter { it.isNotBlank() }
 
-            val noisyLatent = generateGaussianNoise(latentDimTotal * latentLen)
-            val latentMask = FloatArray(latentLen) { 1.0f }
+        callback?.onSynthesisStart(text.length, chunks.size)
 
-            // Apply mask to noisy latent
-            for (d in 0 until latentDimTotal) {
-                for (t in 0 until latentLen) {
-                    noisyLatent[d * latentLen + t] *= latentMask[t]
+        val silenceSamples = (config.chunkSilenceMs * sampleRate / 1000)
+        try {
+            for ((index, chunk) in chunks.withIndex()) {
+                ensureActive()
+                if (index > 0 && silenceSamples > 0 && !ring.writeSilence(silenceSamples)) break
+
+                val textIds = textProcessor!!.process(chunk, config.language).textIds
+                val written = ring.withHandle {
+                    nativeLib.synthesizeToRing(textIds, style, config.steps, it, config.speed, config.seed)
+                } ?: false
+                if (!written) {
+                    if (ring.isCancelled) break
+                    throw IllegalStateException(nativeLib.pipelineError() ?: "Synthesis failed")
                 }
+                callback?.onChunkProgress(index + 1, chunks.size)
             }
+        } finally {
+            ring.finish()
+        }
+    }
 
-            // 5. Denoising loop (Euler integration)
-            var xt = noisyLatent
-            val totalSteps = config.steps
-            val totalStepArr = floatArrayOf(totalSteps.toFloat())
-            val totalStepTensor = OnnxTensor.createTensor(env, totalStepArr)
-
-            for (step in 0 until totalSteps) {
-                val currentStepArr = floatArrayOf(step.toFloat())
-                val currentStepTensor = OnnxTensor.createTensor(env, currentStepArr)
-                val xtTensor = createFloatTensor(
-                    xt, longArrayOf(1, latentDimTotal.toLong(), latentLen.toLong()), env
-                )
-                val latentMaskTensor2 = createFloatTensor(
-                    latentMask, longArrayOf(1, 1, latentLen.toLong()), env
-                )
-                // Recreate textMask tensor for vector estimator
-                val textMask2 = createFloatTensor(
-                    processed.textMask, longArrayOf(1, 1, seqLen.toLong()), env
-                )
+    /**
+     * Synthesize text into [sink] chunk by chunk.
+     *
+     * Chunks are synthesized in windows of `config.maxBatchSize` consecutive
+     * chunks and written as soon as their window is done, so memory stays
+     * at one window of audio however long the text is. Chunks are joined
+     * by a [ChunkStitcher] that encodes straight into the sink.
+     *
+     * @param text Input text to synthesize
+     * @param config Synthesis configuration
+     * @param sink Destination file
+     * @param callback Optional progress callback
+     * @return Number of chunks written
+     */
+    suspend fun synthesizeToSink(
+        text: String,
+        config: TTSConfig,
+        sink: WavSink,
+        callback: TTSCallback? = null
+    ): Int = withContext(Dispatchers.Default) {
+        if (!isLoaded()) {
+            throw IllegalStateException("Model not loaded. Call loadModel() first.")
+        }
 
-                val veInputs = mapOf(
-                    "noisy_latent" to xtTensor,
-                    "text_emb" to textEmbTensor,
-                    "style_ttl" to styleTtlTensor,
-                    "latent_mask" to latentMaskTensor2,
-                    "text_mask" to textMask2,
-                    "current_step" to currentStepTensor,
-                    "total_step" to totalStepTensor
-                )
+        val style = voiceStyles[config.voice]
+            ?: throw IllegalArgumentException("Voice '${config.voice}' not found. Available: ${getAvailableVoices()}")
 
-                val veResult = veSession!!.run(veInputs)
-                xt = extractFlatFloatOutput(veResult, latentDimTotal * latentLen)
-                veResult.close()
+        val chunks = if (config.chunkingEnabled) {
+            TextChunker.chunk(text, config.language)
+        } else {
+            listOf(text)
+        }.filter { it.isNotBlank() }
+
+        callback?.onSynthesisStart(text.length, chunks.size)
 
-                currentStepTensor.close()
-                xtTensor.close()
-                latentMaskTensor2.close()
-                textMask2.close()
+        var done = 0
+        ChunkStitcher(nativeLib, sampleRate, config).use { stitcher ->
+            for (window in chunks.chunked(maxOf(config.maxBatchSize, 1))) {
+                ensureActive()
+                for (audio in synthesizeChunks(window, config, style, null)) {
+                    stitcher.writeTo(sink, audio)
+                    done++
+                }
+                callback?.onChunkProgress(done, chunks.size)
             }
+            stitcher.finishTo(sink)
+        }
+        done
+    }
 
-            totalStepTensor.close()
-            teResult.close()
+    /**
+     * Synthesize chunks, batching chunks of similar length together.
+     *
+     * @return Audio per chunk, in chunk order
+     */
+    private fun synthesizeChunks(
+        chunks: List<String>,
+        config: TTSConfig,
+        style: VoiceStyle,
+        callback: TTSCallback?
+    ): List<FloatArray> {
+        if (config.maxBatchSize <= 1 || chunks.size <= 1) {
+            return chunks.mapIndexed { index, chunk ->
+                synthesizeChunk(chunk, config, style).also {
+                    callback?.onChunkProgress(index + 1, chunks.size)
+                }
+            }
+        }
 
-            // 6. Vocoding
-            val latentTensor = createFloatTensor(
-                xt, longArrayOf(1, latentDimTotal.toLong(), latentLen.toLong()), env
+        val processor = textProcessor!!
+        val textIds = chunks.map { processor.process(it, config.language).textIds }
+        val results = arrayOfNulls<FloatArray>(chunks.size)
+        var done = 0
+
+        for (bucket in bucketByLength(textIds, config.maxBatchSize)) {
+            val audio = nativeLib.synthesizeBatch(
+                Array(bucket.size) { textIds[bucket[it]] }, style, config.steps, config.speed, config.seed
             )
-            val vocInputs = mapOf("latent" to latentTensor)
-            val vocResult = vocSession!!.run(vocInputs)
+            for ((i, chunkIndex) in bucket.withIndex()) results[chunkIndex] = audio[i]
 
-            val wavTensor = vocResult.get(0) as OnnxTensor
-            val wavInfo = wavTensor.info as ai.onnxruntime.TensorInfo
-            val wavTotalSize = wavInfo.shape.fold(1L) { acc, v -> acc * v }.toInt()
-            val wavBuf = wavTensor.floatBuffer
-            val wav = FloatArray(wavTotalSize)
-            wavBuf.get(wav)
+            done += bucket.size
+            callback?.onChunkProgress(done, chunks.size)
+        }
+        return results.map { it!! }
+    }
 
-            vocResult.close()
-            latentTensor.close()
+    /**
+     * Group chunk indices into batches of similar length. Chunks are taken
+     * shortest first; a batch closes when it is full or when the next chunk
+     * would pad its shortest member by more than [MAX_BATCH_PAD_RATIO].
+     */
+    private fun bucketByLength(textIds: List<LongArray>, maxBatchSize: Int): List<IntArray> {
+        val order = textIds.indices.sortedBy { textIds[it].size }
+        val buckets = mutableListOf<IntArray>()
+        var start = 0
+        while (start < order.size) {
+            val shortest = textIds[order[start]].size
+            var end = start + 1
+            while (end < order.size && end - start < maxBatchSize &&
+                textIds[order[end]].size <= shortest * MAX_BATCH_PAD_RATIO
+            ) {
+                end++
+            }
+            buckets.add(IntArray(end - start) { order[start + it] })
+            start = end
+        }
+        return buckets
+    }
 
-            // Trim to actual audio length
-            val actualLen = min(wav.size, (duration * sampleRate).toInt())
-            return wav.copyOf(actualLen)
+    /**
+     * Synthesize a single chunk of text (no chunking).
+     */
+    private fun synthesizeChunk(text: String, config: TTSConfig, style: VoiceStyle): FloatArray {
+        val processed = textProcessor!!.process(text, config.language)
+        return nativeLib.synthesize(processed.textIds, style, config.steps, config.speed, config.seed)
+    }
 
-        } finally {
-            textIdsTensor.close()
-            textMaskTensor.close()
-            styleDpTensor.close()
-            styleTtlTensor.close()
-        }
+    /**
+     * Cache synthesized chunks by content (text ids, voice, steps, speed,
+     * seed and the model files), so a repeated phrase is replayed instead
+     * of synthesized. Kept across [loadModel] calls.
+     *
+     * @param directory Persistent tier (compressed, survives restarts), or null for memory only
+     * @param memoryBytes In-memory budget (decoded PCM)
+     * @param diskBytes On-disk budget
+     */
+    fun setAudioCache(
+        directory: File?,
+        memoryBytes: Long = DEFAULT_CACHE_MEMORY_BYTES,
+        diskBytes: Long = DEFAULT_CACHE_DISK_BYTES
+    ) {
+        audioCache = AudioCacheSettings(directory, memoryBytes, diskBytes)
+        if (isLoaded()) applyAudioCache()
+    }
+
+    /** Stop caching; files already on disk are kept */
+    fun disableAudioCache() {
+        audioCache = null
+        nativeLib.removeAudioCache()
     }
 
+    /** Forget every cached phrase, in memory and on disk */
+    fun clearAudioCache() = nativeLib.clearAudioCache()
+
     /**
      * Release all ONNX resources.
      */
     fun release() {
-        dpSession?.close(); dpSession = null
-        teSession?.close(); teSession = null
-        veSession?.close(); veSession = null
-        vocSession?.close(); vocSession = null
-        environment = null
+        nativeLib.releasePipeline()
+        textProcessor?.close()
         textProcessor = null
         voiceStyles.clear()
     }
@@ -376,6 +466,31 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
     // PRIVATE HELPERS
     // ========================================================================
 
+    private fun applyAudioCache() {
+        val settings = audioCache ?: return
+        nativeLib.setAudioCache(
+            settings.directory?.absolutePath, settings.memoryBytes, settings.diskBytes,
+            sampleRate, modelId
+        )
+    }
+
+    // Changes whenever a model file is replaced, so stale audio never matches
+    private fun modelFingerprint(files: List<String>): String =
+        files.joinToString("|") { path ->
+            File(path).let { "${it.name}:${it.length()}:${it.lastModified()}" }
+        }
+
+    companion object {
+        const val DEFAULT_CACHE_MEMORY_BYTES = 16L shl 20
+        const val DEFAULT_CACHE_DISK_BYTES = 64L shl 20
+
+        // Bounds how long a cancelled coroutine can stay blocked in poll()
+        private const val STREAM_POLL_TIMEOUT_MS = 50
+
+        // Longest chunk in a batch may be at most this much longer than the shortest
+        private const val MAX_BATCH_PAD_RATIO = 1.25f
+    }
+
     private fun loadConfig(path: String) {
         val json = JSONObject(File(path).readText())
         val ae = json.getJSONObject("ae")
@@ -393,7 +508,7 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
 
         dir.listFiles()?.filter { it.extension == "json" }?.forEach { file ->
             try {
-                val style = VoiceStyle.loadFromJson(file.absolutePath)
+                val style = loadVoiceStyle(file)
                 voiceStyles[style.name] = style
             } catch (_: Exception) {
                 // Skip invalid voice files
@@ -401,73 +516,16 @@ class TTSEngine(private val nativeLib: SupertonicNativeLib) {
         }
     }
 
-    /**
-     * Generate Gaussian noise using Box-Muller transform.
-     */
-    private fun generateGaussianNoise(size: Int): FloatArray {
-        val result = FloatArray(size)
-        val rng = Random()
-        var i = 0
-        while (i < size - 1) {
-            val u1 = maxOf(1e-7f, rng.nextFloat())
-            val u2 = rng.nextFloat()
-            val mag = sqrt(-2.0f * ln(u1))
-            result[i] = mag * cos(2.0f * PI.toFloat() * u2)
-            result[i + 1] = mag * sin(2.0f * PI.toFloat() * u2)
-            i += 2
-        }
-        if (size % 2 == 1) {
-            val u1 = maxOf(1e-7f, rng.nextFloat())
-            val u2 = rng.nextFloat()
-            result[size - 1] = sqrt(-2.0f * ln(u1)) * cos(2.0f * PI.toFloat() * u2)
-        }
-        return result
-    }
-
-    /**
-     * Extract the first scalar float from an ONNX result.
-     */
-    private fun extractFloatOutput(result: OrtSession.Result): Float {
-        val tensor = result.get(0) as OnnxTensor
-        val value = tensor.value
-        return when (value) {
-            is FloatArray -> value[0]
-            is Array<*> -> {
-                @Suppress("UNCHECKED_CAST")
-                val arr = value as Array<FloatArray>
-                arr[0][0]
-            }
-            is Float -> value
-            else -> throw IllegalStateException("Unexpected output type: ${value?.javaClass}")
-        }
-    }
-
-    /**
-     * Extract a flat float array from an ONNX tensor result.
-     */
-    private fun extractFlatFloatOutput(result: OrtSession.Result, expectedSize: Int): FloatArray {
-        val tensor = result.get(0) as OnnxTensor
-        val buf = tensor.floatBuffer
-        val arr = FloatArray(expectedSize)
-        buf.get(arr)
-        return arr
-    }
-
-    /**
-     * Create an ONNX float tensor from a flat array + shape.
-     */
-    private fun createFloatTensor(
-        data: FloatArray, shape: LongArray, env: OrtEnvironment
-    ): OnnxTensor {
-        return OnnxTensor.createTensor(env, FloatBuffer.wrap(data), shape)
-    }
-
-    /**
-     * Create an ONNX long tensor from a flat array + shape.
-     */
-    private fun createLongTensor(
-        data: LongArray, shape: LongArray, env: OrtEnvironment
-    ): OnnxTensor {
-        return OnnxTensor.createTensor(env, LongBuffer.wrap(data), shape)
-    }
+    // From the voice's mapped binary cache when possible. Styles are small,
+    // so they are copied out and the mapping is closed right away.
+    private fun loadVoiceStyle(file: File): VoiceStyle =
+        TensorCache.load(nativeLib, file.absolutePath, TensorCache.KIND_VOICE_STYLE)?.use { cache ->
+            VoiceStyle(
+                name = file.nameWithoutExtension,
+                styleTtl = cache.floatArray(0),
+                styleTtlShape = cache.shape(0),
+                styleDp = cache.floatArray(1),
+                styleDpShape = cache.shape(1)
+            )
+        } ?: VoiceStyle.loadFromJson(file.absolutePath)
 }
@@ -0,0 +1,87 @@
+package com.mp.ai_supertonic_tts.engine
+
+import com.mp.ai_supertonic_tts.SupertonicNativeLib
+import java.io.Closeable
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.FloatBuffer
+import java.nio.IntBuffer
+
+/**
+ * Memory-mapped binary copy of a model JSON asset.
+ *
+ * The unicode indexer and voice style JSONs are parsed natively once and
+ * written next to the JSON as `<name>.bin` (flat int32/float32 tensors with
+ * shape headers). Later loads map that file and read it through read-only
+ * direct buffers, so there is no JSON parsing and no heap copy. A cache
+ * whose JSON has changed (size or mtime) is rebuilt.
+ *
+ * Buffers from [bytes], [ints] and [floats] are only valid until [close].
+ */
+class TensorCache private constructor(
+    internal val nativeLib: SupertonicNativeLib,
+    private var handle: Long
+) : Closeable {
+
+    /** Number of tensors in the file */
+    val size: Int = nativeLib.nativeTensorCacheCount(handle)
+
+    fun shape(index: Int): LongArray {
+        check(handle != 0L) { "TensorCache is closed" }
+        return checkNotNull(nativeLib.nativeTensorCacheShape(handle, index)) { "No tensor $index" }
+    }
+
+    /** Raw tensor bytes (read-only, native order) */
+    fun bytes(index: Int): ByteBuffer {
+        check(handle != 0L) { "TensorCache is closed" }
+        val mapped = checkNotNull(nativeLib.nativeTensorCacheBuffer(handle, index)) { "No tensor $index" }
+        return mapped.asReadOnlyBuffer().order(ByteOrder.nativeOrder())
+    }
+
+    fun ints(index: Int): IntBuffer = bytes(index).asIntBuffer()
+
+    fun floats(index: Int): FloatBuffer = bytes(index).asFloatBuffer()
+
+    /** Heap copy of a float tensor (one bulk copy out of the mapping) */
+    fun floatArray(index: Int): FloatArray {
+        val data = floats(index)
+        return FloatArray(data.remaining()).also { data.get(it) }
+    }
+
+    override fun close() {
+        if (handle != 0L) {
+            nativeLib.nativeTensorCacheDestroy(handle)
+            handle = 0L
+        }
+    }
+
+    companion object {
+        /** unicode_indexer.json: one int32 tensor, codepoint -> vocab index */
+        const val KIND_UNICODE_INDEXER = 0
+
+        /** Voice style JSON: float32 style_ttl, then float32 style_dp */
+        const val KIND_VOICE_STYLE = 1
+
+        /** Where the cache for [jsonPath] lives */
+        fun cachePath(jsonPath: String): String = jsonPath.removeSuffix(".json") + ".bin"
+
+        /**
+         * Map the cache for [jsonPath], building it first if it is missing or
+         * stale.
+         *
+         * @return null if no valid cache exists and none could be written
+         *         (e.g. a read-only model directory); parse the JSON instead
+         */
+        fun load(nativeLib: SupertonicNativeLib, jsonPath: String, kind: Int): TensorCache? {
+            val path = cachePath(jsonPath)
+            var handle = nativeLib.nativeTensorCacheOpen(path, jsonPath)
+            if (handle == 0L && File(jsonPath).exists() &&
+                nativeLib.nativeTensorCacheConvert(jsonPath, path, kind)
+            ) {
+                handle = nativeLib.nativeTensorCacheOpen(path, jsonPath)
+            }
+            return if (handle != 0L) TensorCache(nativeLib, handle) else null
+        }
+    }
+}
@@ -8,6 +8,10 @@ enum class AudioFormat {
     WAV_16,
     /** 32-bit IEEE float WAV file (highest quality, larger file) */
     WAV_32F,
+    /** Lossless FLAC file (same 16-bit samples as WAV_16; size depends on content) */
+    FLAC,
+    /** 4-bit IMA-ADPCM WAV file (lossy, 4x smaller than WAV_16, fastest compact format) */
+    WAV_ADPCM,
     /** Raw 16-bit PCM bytes (no WAV header) */
     PCM_16,
     /** Raw 32-bit float PCM bytes (no WAV header) */
@@ -0,0 +1,29 @@
+package com.mp.ai_supertonic_tts.models
+
+/**
+ * Buffer health of one streamed playback on the native (AAudio) path.
+ *
+ * @param samplesPlayed Samples handed to the device, at [deviceRate]
+ * @param underruns Times the device ran dry while more audio was still
+ *        coming, i.e. audible gaps because synthesis fell behind
+ * @param starvedMs Total length of those gaps
+ * @param firstAudioMs Playback start to first audio queued (-1 if none)
+ * @param ringUnderruns Times the playback thread found the ring empty
+ * @param ringLowWaterMs Least audio that was buffered ahead once playback had started
+ * @param deviceXruns Glitches reported by the audio device itself
+ * @param deviceRate Output sample rate in Hz
+ */
+data class PlaybackStats(
+    val samplesPlayed: Long,
+    val underruns: Long,
+    val starvedMs: Double,
+    val firstAudioMs: Double,
+    val ringUnderruns: Long,
+    val ringLowWaterMs: Double,
+    val deviceXruns: Long,
+    val deviceRate: Int
+) {
+    /** Audio played in milliseconds */
+    val playedMs: Double
+        get() = if (deviceRate > 0) samplesPlayed * 1000.0 / deviceRate else 0.0
+}
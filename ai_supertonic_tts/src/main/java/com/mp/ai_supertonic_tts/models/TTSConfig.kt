@@ -27,6 +27,15 @@ enum class Language(val tag: String) {
  * @param useNNAPI Enable NNAPI acceleration (uses device GPU/NPU if available).
  * @param chunkingEnabled Automatically split long text into chunks at sentence boundaries.
  * @param chunkSilenceMs Silence duration between chunks in milliseconds.
+ * @param chunkCrossfadeMs When > 0, chunks overlap with an equal-power crossfade of this
+ *                         length instead of being separated by silence.
+ * @param trimSilence Trim each chunk's leading and trailing silence before joining.
+ * @param gain Linear output gain.
+ * @param peakLimit Peak limiter ceiling; output never exceeds it.
+ * @param maxBatchSize Chunks of similar length are synthesized together, up to this
+ *                     many per batch. 1 = one chunk at a time.
+ * @param seed Latent noise seed. 0 = random each call; any other value makes synthesis
+ *             reproducible (same text, voice and settings give the same audio).
  */
 data class TTSConfig(
     val speed: Float = 1.05f,
@@ -35,5 +44,11 @@ data class TTSConfig(
     val voice: String = "F1",
     val useNNAPI: Boolean = false,
     val chunkingEnabled: Boolean = true,
-    val chunkSilenceMs: Int = 300
+    val chunkSilenceMs: Int = 300,
+    val chunkCrossfadeMs: Int = 0,
+    val trimSilence: Boolean = true,
+    val gain: Float = 1.0f,
+    val peakLimit: Float = 1.0f,
+    val maxBatchSize: Int = 4,
+    val seed: Long = 0L
 )